@@ -0,0 +1,1398 @@
+#include "Convolution.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONV_X86
+#include <immintrin.h>
+#endif
+
+#define AVX2_LANES 8
+#define AVX512_LANES 16
+#define CONV_BLOCK 4 // vectors a SIMD kernel sums at once, to overlap the latency of their chains of adds
+#define GRADIENT_TAPS (GRADIENT_SIZE * GRADIENT_SIZE)
+#define SEPARABLE_TOLERANCE 1e-6f // the largest error of a separation, relative to the largest weight
+#define FFT_MIN_SIZE 16
+#define FFT_MAX_SIZE 512 // the largest fft tile side, unless the kernel needs a larger one
+// the costs of the strategies in ns, measured on one AVX-512 core over images larger than its caches (see
+// chooseConvStrategy), only their ratios matter
+#define COST_DIRECT_TAP 1.2 // one tap of a direct kernel over one vector of pixels
+#define COST_FFT_BUTTERFLY 3.0 // one radix-2 butterfly, per point and level
+#define COST_FFT_POINT 12.0 // copying a point into a tile, multiplying its spectrum and adding it back
+
+typedef std::complex<double> Complex;
+
+/**
+ * A row kernel computes output pixels [begin, end) of one row from kRows input rows:
+ * out[c] = sum of rows[i][c + j - kCols / 2] * w[i * kCols + j], rounded with rint if round is set.
+ * A full kernel runs as one of kRows * kCols taps, the passes of a separable kernel as one of 1 * taps (not
+ * rounded) and one of taps * 1. It only reads inside the image, the caller keeps the border out of [begin, end).
+ */
+typedef void (*ConvRowFn)(const float* const* rows, const float* w, int kRows, int kCols, bool round, float* out,
+                          int begin, int end);
+
+/**
+ * A kernel of convolveGradients, in the form convolve runs it: a separable kernel as its factors, another one as its
+ * weights
+ */
+struct GradientKernel
+{
+    bool separable;
+    float col[GRADIENT_SIZE]; // the vertical factors of a separable kernel
+    float row[GRADIENT_SIZE]; // its horizontal factors
+    float w[GRADIENT_TAPS]; // the weights of a kernel that is not separable
+};
+
+/**
+ * A gradient row kernel computes output pixels [begin, end) of one row of convolveGradients from the three input
+ * rows around it (a row outside the image is a row of zeros): the responses of both kernels, summed the way
+ * convolve sums them, and their rounded sum clamped to [lo, hi]. The responses themselves are stored too, in the
+ * rows that are not nullptr. It reads the columns [begin - 1, end + 1).
+ */
+typedef void (*GradientRowFn)(const float* const* rows, const GradientKernel* kernels, float lo, float hi,
+                              float* out, float* gradX, float* gradY, int begin, int end);
+
+/**
+ * A clamp row kernel limits n values of a row to [lo, hi] in place, keeping NaN
+ */
+typedef void (*ClampRowFn)(float* row, float lo, float hi, int n);
+
+/**
+ * This struct describes the row kernels of one instruction set
+ */
+struct ConvKernels
+{
+    const char* name;
+    int lanes; // pixels per vector
+    ConvRowFn row;
+    GradientRowFn gradient;
+    ClampRowFn clamp;
+};
+
+/**
+ * Portable row kernel, also used for the tails of the AVX2 kernel
+ */
+static void convRowScalar(const float* const* rows, const float* w, int kRows, int kCols, bool round, float* out,
+                          int begin, int end)
+{
+    int radius = kCols / 2;
+    for (int c = begin; c < end; c++)
+    {
+        float sum = 0;
+        for (int i = 0; i < kRows; i++)
+        {
+            for (int j = 0; j < kCols; j++)
+            {
+                sum += rows[i][c + j - radius] * w[i * kCols + j];
+            }
+        }
+        out[c] = round ? rintf(sum) : sum;
+    }
+}
+
+/**
+ * The response of a gradient kernel to a 3x3 neighbourhood
+ * @param kernel - the kernel
+ * @param x - the GRADIENT_TAPS pixels of the neighbourhood, row by row
+ * @return the sum convolve computes there (not rounded)
+ */
+static inline float gradientResponse(const GradientKernel& kernel, const float* x)
+{
+    float sum = 0;
+    if (kernel.separable)
+    {
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            float partial = 0;
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                partial += x[i * GRADIENT_SIZE + j] * kernel.row[j];
+            }
+            sum += partial * kernel.col[i];
+        }
+        return sum;
+    }
+    for (int t = 0; t < GRADIENT_TAPS; t++)
+    {
+        sum += x[t] * kernel.w[t];
+    }
+    return sum;
+}
+
+/**
+ * Combines the responses of the two gradient kernels at one pixel
+ * @param gx - the response of the first kernel
+ * @param gy - the response of the second kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @return the rounded responses summed and clamped, NaN passes through as in limitVals
+ */
+static inline float combineGradients(float gx, float gy, float lo, float hi)
+{
+    float val = rintf(gx) + rintf(gy);
+    return val < lo ? lo : (val > hi ? hi : val);
+}
+
+/**
+ * Portable gradient row kernel, also used for the tails of the AVX2 kernel
+ */
+static void gradientRowScalar(const float* const* rows, const GradientKernel* kernels, float lo, float hi,
+                              float* out, float* gradX, float* gradY, int begin, int end)
+{
+    for (int c = begin; c < end; c++)
+    {
+        float x[GRADIENT_TAPS];
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                x[i * GRADIENT_SIZE + j] = rows[i][c + j - 1];
+            }
+        }
+        float gx = gradientResponse(kernels[0], x);
+        float gy = gradientResponse(kernels[1], x);
+        out[c] = combineGradients(gx, gy, lo, hi);
+        if (gradX != nullptr)
+        {
+            gradX[c] = gx;
+            gradY[c] = gy;
+        }
+    }
+}
+
+/**
+ * Portable clamp row kernel, also used for the tail of the AVX2 kernel
+ */
+static void clampRowScalar(float* row, float lo, float hi, int n)
+{
+    for (int c = 0; c < n; c++)
+    {
+        float val = row[c] < lo ? lo : row[c];
+        row[c] = val > hi ? hi : val;
+    }
+}
+
+#ifdef CONV_X86
+
+/**
+ * Sums VECTORS consecutive vectors of 8 pixels of an AVX2 row kernel, each in its own chain of adds
+ * @param c - the first pixel
+ */
+template <int VECTORS>
+__attribute__((target("avx2")))
+static inline void convBlockAvx2(const float* const* rows, const float* w, int kRows, int kCols, bool round,
+                                 float* out, int c)
+{
+    __m256 acc[VECTORS];
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; v++)
+    {
+        acc[v] = _mm256_setzero_ps();
+    }
+    for (int i = 0; i < kRows; i++)
+    {
+        const float* in = rows[i] + c - kCols / 2;
+        for (int j = 0; j < kCols; j++)
+        {
+            __m256 wv = _mm256_broadcast_ss(w + i * kCols + j);
+            #pragma GCC unroll 16
+            for (int v = 0; v < VECTORS; v++)
+            {
+                acc[v] = _mm256_add_ps(acc[v], _mm256_mul_ps(_mm256_loadu_ps(in + j + v * AVX2_LANES), wv));
+            }
+        }
+    }
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; v++)
+    {
+        if (round)
+        {
+            acc[v] = _mm256_round_ps(acc[v], _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        }
+        _mm256_storeu_ps(out + c + v * AVX2_LANES, acc[v]);
+    }
+}
+
+/**
+ * AVX2 row kernel, CONV_BLOCK vectors of 8 pixels at a time
+ */
+__attribute__((target("avx2")))
+static void convRowAvx2(const float* const* rows, const float* w, int kRows, int kCols, bool round, float* out,
+                        int begin, int end)
+{
+    int c = begin;
+    for (; c + AVX2_LANES * CONV_BLOCK <= end; c += AVX2_LANES * CONV_BLOCK)
+    {
+        convBlockAvx2<CONV_BLOCK>(rows, w, kRows, kCols, round, out, c);
+    }
+    for (; c + AVX2_LANES <= end; c += AVX2_LANES)
+    {
+        convBlockAvx2<1>(rows, w, kRows, kCols, round, out, c);
+    }
+    convRowScalar(rows, w, kRows, kCols, round, out, c, end);
+}
+
+/**
+ * The response of a gradient kernel to 8 neighbourhoods, as gradientResponse
+ * @param x - the GRADIENT_TAPS vectors of the neighbourhoods, row by row
+ */
+__attribute__((target("avx2")))
+static inline __m256 gradientResponseAvx2(const GradientKernel& kernel, const __m256* x)
+{
+    __m256 sum = _mm256_setzero_ps();
+    if (kernel.separable)
+    {
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            __m256 partial = _mm256_setzero_ps();
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                partial = _mm256_add_ps(partial, _mm256_mul_ps(x[i * GRADIENT_SIZE + j],
+                                                               _mm256_set1_ps(kernel.row[j])));
+            }
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(partial, _mm256_set1_ps(kernel.col[i])));
+        }
+        return sum;
+    }
+    for (int t = 0; t < GRADIENT_TAPS; t++)
+    {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x[t], _mm256_set1_ps(kernel.w[t])));
+    }
+    return sum;
+}
+
+/**
+ * AVX2 gradient row kernel, 8 pixels at a time
+ */
+__attribute__((target("avx2")))
+static void gradientRowAvx2(const float* const* rows, const GradientKernel* kernels, float lo, float hi,
+                            float* out, float* gradX, float* gradY, int begin, int end)
+{
+    __m256 loV = _mm256_set1_ps(lo);
+    __m256 hiV = _mm256_set1_ps(hi);
+    int c = begin;
+    for (; c + AVX2_LANES <= end; c += AVX2_LANES)
+    {
+        __m256 x[GRADIENT_TAPS];
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                x[i * GRADIENT_SIZE + j] = _mm256_loadu_ps(rows[i] + c + j - 1);
+            }
+        }
+        __m256 gx = gradientResponseAvx2(kernels[0], x);
+        __m256 gy = gradientResponseAvx2(kernels[1], x);
+        __m256 val = _mm256_add_ps(_mm256_round_ps(gx, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC),
+                                   _mm256_round_ps(gy, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        // max and min return their second operand on NaN, so NaN passes through
+        _mm256_storeu_ps(out + c, _mm256_min_ps(hiV, _mm256_max_ps(loV, val)));
+        if (gradX != nullptr)
+        {
+            _mm256_storeu_ps(gradX + c, gx);
+            _mm256_storeu_ps(gradY + c, gy);
+        }
+    }
+    gradientRowScalar(rows, kernels, lo, hi, out, gradX, gradY, c, end);
+}
+
+/**
+ * AVX2 clamp row kernel: 8 values at a time, scalar tail
+ */
+__attribute__((target("avx2")))
+static void clampRowAvx2(float* row, float lo, float hi, int n)
+{
+    __m256 loV = _mm256_set1_ps(lo);
+    __m256 hiV = _mm256_set1_ps(hi);
+    int c = 0;
+    for (; c + AVX2_LANES <= n; c += AVX2_LANES)
+    {
+        // max and min return their second operand on NaN, so NaN passes through
+        _mm256_storeu_ps(row + c, _mm256_min_ps(hiV, _mm256_max_ps(loV, _mm256_loadu_ps(row + c))));
+    }
+    clampRowScalar(row + c, lo, hi, n - c);
+}
+
+// AVX-512F brings FMA along, the products and sums must stay separate roundings as in the other kernels, so they
+// use the explicit-rounding forms, which the compiler does not contract (masked to the lanes of the chunk)
+#define MUL512(mask, a, b) _mm512_maskz_mul_round_ps((mask), (a), (b), _MM_FROUND_CUR_DIRECTION)
+#define ADD512(mask, a, b) _mm512_maskz_add_round_ps((mask), (a), (b), _MM_FROUND_CUR_DIRECTION)
+#define ROUND512(mask, a) _mm512_maskz_roundscale_ps((mask), (a), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+/**
+ * Mask of the lanes of a row chunk that lie before end
+ * @param c - the first pixel of the chunk
+ * @param end - the end of the row range
+ * @return the lane mask
+ */
+static inline __mmask16 tailMask(int c, int end)
+{
+    return end - c >= AVX512_LANES ? (__mmask16)0xFFFF : (__mmask16)((1u << (end - c)) - 1);
+}
+
+/**
+ * Sums VECTORS consecutive vectors of 16 pixels of an AVX-512 row kernel, each in its own chain of adds
+ * @param c - the first pixel
+ * @param mask - the lanes of the last vector that lie in the row range (the others are full)
+ */
+template <int VECTORS>
+__attribute__((target("avx512f")))
+static inline void convBlockAvx512(const float* const* rows, const float* w, int kRows, int kCols, bool round,
+                                   float* out, int c, __mmask16 mask)
+{
+    __mmask16 masks[VECTORS];
+    __m512 acc[VECTORS];
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; v++)
+    {
+        masks[v] = v == VECTORS - 1 ? mask : (__mmask16)0xFFFF;
+        acc[v] = _mm512_setzero_ps();
+    }
+    for (int i = 0; i < kRows; i++)
+    {
+        const float* in = rows[i] + c - kCols / 2;
+        for (int j = 0; j < kCols; j++)
+        {
+            __m512 wv = _mm512_set1_ps(w[i * kCols + j]);
+            #pragma GCC unroll 16
+            for (int v = 0; v < VECTORS; v++)
+            {
+                __m512 x = _mm512_maskz_loadu_ps(masks[v], in + j + v * AVX512_LANES);
+                acc[v] = ADD512(masks[v], acc[v], MUL512(masks[v], x, wv));
+            }
+        }
+    }
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; v++)
+    {
+        if (round)
+        {
+            acc[v] = ROUND512(masks[v], acc[v]);
+        }
+        _mm512_mask_storeu_ps(out + c + v * AVX512_LANES, masks[v], acc[v]);
+    }
+}
+
+/**
+ * AVX-512 row kernel, CONV_BLOCK vectors of 16 pixels at a time, the tail with masked loads and stores
+ */
+__attribute__((target("avx512f")))
+static void convRowAvx512(const float* const* rows, const float* w, int kRows, int kCols, bool round, float* out,
+                          int begin, int end)
+{
+    int c = begin;
+    for (; c + AVX512_LANES * CONV_BLOCK <= end; c += AVX512_LANES * CONV_BLOCK)
+    {
+        convBlockAvx512<CONV_BLOCK>(rows, w, kRows, kCols, round, out, c, (__mmask16)0xFFFF);
+    }
+    for (; c < end; c += AVX512_LANES)
+    {
+        convBlockAvx512<1>(rows, w, kRows, kCols, round, out, c, tailMask(c, end));
+    }
+}
+
+/**
+ * The response of a gradient kernel to 16 neighbourhoods, as gradientResponse
+ * @param x - the GRADIENT_TAPS vectors of the neighbourhoods, row by row
+ * @param mask - the lanes in the row range
+ */
+__attribute__((target("avx512f")))
+static inline __m512 gradientResponseAvx512(const GradientKernel& kernel, const __m512* x, __mmask16 mask)
+{
+    __m512 sum = _mm512_setzero_ps();
+    if (kernel.separable)
+    {
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            __m512 partial = _mm512_setzero_ps();
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                partial = ADD512(mask, partial, MUL512(mask, x[i * GRADIENT_SIZE + j], _mm512_set1_ps(kernel.row[j])));
+            }
+            sum = ADD512(mask, sum, MUL512(mask, partial, _mm512_set1_ps(kernel.col[i])));
+        }
+        return sum;
+    }
+    for (int t = 0; t < GRADIENT_TAPS; t++)
+    {
+        sum = ADD512(mask, sum, MUL512(mask, x[t], _mm512_set1_ps(kernel.w[t])));
+    }
+    return sum;
+}
+
+/**
+ * AVX-512 gradient row kernel, 16 pixels at a time, the tail with masked loads and stores
+ */
+__attribute__((target("avx512f")))
+static void gradientRowAvx512(const float* const* rows, const GradientKernel* kernels, float lo, float hi,
+                              float* out, float* gradX, float* gradY, int begin, int end)
+{
+    __m512 loV = _mm512_set1_ps(lo);
+    __m512 hiV = _mm512_set1_ps(hi);
+    for (int c = begin; c < end; c += AVX512_LANES)
+    {
+        __mmask16 mask = tailMask(c, end);
+        __m512 x[GRADIENT_TAPS];
+        for (int i = 0; i < GRADIENT_SIZE; i++)
+        {
+            for (int j = 0; j < GRADIENT_SIZE; j++)
+            {
+                x[i * GRADIENT_SIZE + j] = _mm512_maskz_loadu_ps(mask, rows[i] + c + j - 1);
+            }
+        }
+        __m512 gx = gradientResponseAvx512(kernels[0], x, mask);
+        __m512 gy = gradientResponseAvx512(kernels[1], x, mask);
+        __m512 val = ADD512(mask, ROUND512(mask, gx), ROUND512(mask, gy));
+        // max and min return their second operand on NaN, so NaN passes through
+        _mm512_mask_storeu_ps(out + c, mask, _mm512_maskz_min_ps(mask, hiV, _mm512_maskz_max_ps(mask, loV, val)));
+        if (gradX != nullptr)
+        {
+            _mm512_mask_storeu_ps(gradX + c, mask, gx);
+            _mm512_mask_storeu_ps(gradY + c, mask, gy);
+        }
+    }
+}
+
+/**
+ * AVX-512 clamp row kernel: 16 values at a time, the tail masked
+ */
+__attribute__((target("avx512f")))
+static void clampRowAvx512(float* row, float lo, float hi, int n)
+{
+    __m512 loV = _mm512_set1_ps(lo);
+    __m512 hiV = _mm512_set1_ps(hi);
+    for (int c = 0; c < n; c += AVX512_LANES)
+    {
+        __mmask16 mask = tailMask(c, n);
+        __m512 val = _mm512_maskz_loadu_ps(mask, row + c);
+        _mm512_mask_storeu_ps(row + c, mask, _mm512_maskz_min_ps(mask, hiV, _mm512_maskz_max_ps(mask, loV, val)));
+    }
+}
+
+#endif //CONV_X86
+
+/**
+ * Picks the widest row kernel the running cpu supports
+ * @return the row kernel
+ */
+static ConvKernels detectKernels()
+{
+#ifdef CONV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return {"avx512", AVX512_LANES, convRowAvx512, gradientRowAvx512, clampRowAvx512};
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return {"avx2", AVX2_LANES, convRowAvx2, gradientRowAvx2, clampRowAvx2};
+    }
+#endif
+    return {"scalar", 1, convRowScalar, gradientRowScalar, clampRowScalar};
+}
+
+/**
+ * Returns the row kernel for this cpu, detected once
+ * @return the row kernel
+ */
+static const ConvKernels& selectKernels()
+{
+    static const ConvKernels kernels = detectKernels();
+    return kernels;
+}
+
+/**
+ * Returns the name of the row kernel convolve dispatches to on this cpu
+ * @return "avx512", "avx2" or "scalar"
+ */
+const char* convKernelName()
+{
+    return selectKernels().name;
+}
+
+/**
+ * Limits every element of a matrix to [lo, hi] in place, NaN is kept
+ * @param image - the matrix
+ * @param lo - the smallest value
+ * @param hi - the largest value
+ */
+void clampValues(Matrix& image, float lo, float hi)
+{
+    ClampRowFn clamp = selectKernels().clamp;
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols(), [&](int begin, int end, int)
+    {
+        for (int r = begin; r < end; r++)
+        {
+            clamp(image.getData() + (size_t)r * image.getStride(), lo, hi, image.getCols());
+        }
+    });
+}
+
+/**
+ * Checks if a kernel is separable, i.e. kernel(i, j) == col[i] * row[j] for finite factors, up to a millionth of
+ * the largest weight (kernels of small integer weights, as blur and sobel, separate exactly)
+ * @param kernel - the kernel
+ * @param col - set to the kernel.getRows() vertical factors
+ * @param row - set to the kernel.getCols() horizontal factors
+ * @return true if the kernel is separable
+ */
+bool separateKernel(const Matrix& kernel, float* col, float* row)
+{
+    // the row through the largest weight, scaled along its column
+    int pivotRow = 0;
+    int pivotCol = 0;
+    for (int i = 0; i < kernel.getRows(); i++)
+    {
+        for (int j = 0; j < kernel.getCols(); j++)
+        {
+            if (std::fabs(kernel(i, j)) > std::fabs(kernel(pivotRow, pivotCol)))
+            {
+                pivotRow = i;
+                pivotCol = j;
+            }
+        }
+    }
+    float pivot = kernel(pivotRow, pivotCol);
+    if (pivot == 0 || !std::isfinite(pivot))
+    {
+        return false;
+    }
+    for (int j = 0; j < kernel.getCols(); j++)
+    {
+        row[j] = kernel(pivotRow, j);
+    }
+    for (int i = 0; i < kernel.getRows(); i++)
+    {
+        col[i] = kernel(i, pivotCol) / pivot;
+    }
+    float tolerance = SEPARABLE_TOLERANCE * std::fabs(pivot);
+    for (int i = 0; i < kernel.getRows(); i++)
+    {
+        for (int j = 0; j < kernel.getCols(); j++)
+        {
+            if (!std::isfinite(col[i]) || !std::isfinite(row[j]) ||
+                !(std::fabs(col[i] * row[j] - kernel(i, j)) <= tolerance))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Calculates the sum that should be in image[r][c] after convolution, skipping the taps outside the image
+ * @param image - the image
+ * @param w - the kRows * kCols weights
+ * @param kRows - num of rows in the kernel
+ * @param kCols - num of cols in the kernel
+ * @param r - the row
+ * @param c - the column
+ * @return the sum (not rounded)
+ */
+static float borderSum(const MatrixView& image, const float* w, int kRows, int kCols, int r, int c)
+{
+    float sum = 0;
+    for (int i = 0; i < kRows; i++)
+    {
+        for (int j = 0; j < kCols; j++)
+        {
+            int y = r + i - kRows / 2;
+            int x = c + j - kCols / 2;
+            if (y >= 0 && y < image.getRows() && x >= 0 && x < image.getCols())
+            {
+                sum += image.getData()[(size_t)y * image.getRowStride() + x] * w[i * kCols + j];
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * Convolves with a full kernel, the border pixel by pixel and the interior rows through the row kernel
+ * @param image - the image, with contiguous rows
+ * @param kernel - the kernel
+ * @param res - the output matrix, of the image dimensions
+ */
+static void convolveDirect(const MatrixView& image, const Matrix& kernel, Matrix& res)
+{
+    int rows = image.getRows();
+    int cols = image.getCols();
+    int kRows = kernel.getRows();
+    int kCols = kernel.getCols();
+    int radiusY = kRows / 2;
+    int radiusX = kCols / 2;
+    std::vector<float> w((size_t)kRows * kCols);
+    for (int i = 0; i < kRows; i++)
+    {
+        for (int j = 0; j < kCols; j++)
+        {
+            w[(size_t)i * kCols + j] = kernel(i, j);
+        }
+    }
+    ConvRowFn convRow = selectKernels().row;
+    ThreadPool& pool = ThreadPool::shared();
+    std::vector<const float*> inRows((size_t)pool.getNumThreads() * kRows); // the input rows of every worker
+    // every output row depends on the input only, so the bands need nothing from each other
+    pool.parallelRows(rows, (long long)cols * kRows * kCols, [&](int begin, int end, int worker)
+    {
+        const float** in = inRows.data() + (size_t)worker * kRows;
+        for (int r = begin; r < end; r++)
+        {
+            float* out = res.getData() + (size_t)r * res.getStride();
+            if (r < radiusY || r >= rows - radiusY || cols <= 2 * radiusX)
+            {
+                for (int c = 0; c < cols; c++)
+                {
+                    out[c] = rintf(borderSum(image, w.data(), kRows, kCols, r, c));
+                }
+                continue;
+            }
+            for (int c = 0; c < radiusX; c++)
+            {
+                out[c] = rintf(borderSum(image, w.data(), kRows, kCols, r, c));
+                out[cols - 1 - c] = rintf(borderSum(image, w.data(), kRows, kCols, r, cols - 1 - c));
+            }
+            for (int i = 0; i < kRows; i++)
+            {
+                in[i] = image.getData() + (size_t)(r + i - radiusY) * image.getRowStride();
+            }
+            convRow(in, w.data(), kRows, kCols, true, out, radiusX, cols - radiusX);
+        }
+    });
+}
+
+/**
+ * Calculates the horizontal partial sum at one pixel of a row, skipping the taps outside the row
+ * @param in - the image row
+ * @param cols - num of cols in the image
+ * @param w - the horizontal factors
+ * @param taps - num of horizontal factors
+ * @param c - the column
+ * @return the partial sum
+ */
+static float horizontalSum(const float* in, int cols, const float* w, int taps, int c)
+{
+    float sum = 0;
+    for (int j = 0; j < taps; j++)
+    {
+        int x = c + j - taps / 2;
+        if (x >= 0 && x < cols)
+        {
+            sum += in[x] * w[j];
+        }
+    }
+    return sum;
+}
+
+/**
+ * Runs the horizontal pass of a separable kernel over one row
+ * @param in - the image row
+ * @param cols - num of cols in the image
+ * @param w - the horizontal factors
+ * @param taps - num of horizontal factors
+ * @param out - the row of partial sums
+ */
+static void horizontalPass(const float* in, int cols, const float* w, int taps, float* out)
+{
+    int radius = taps / 2;
+    if (cols <= 2 * radius) // no interior
+    {
+        for (int c = 0; c < cols; c++)
+        {
+            out[c] = horizontalSum(in, cols, w, taps, c);
+        }
+        return;
+    }
+    for (int c = 0; c < radius; c++)
+    {
+        out[c] = horizontalSum(in, cols, w, taps, c);
+        out[cols - 1 - c] = horizontalSum(in, cols, w, taps, cols - 1 - c);
+    }
+    selectKernels().row(&in, w, 1, taps, false, out, radius, cols - radius);
+}
+
+/**
+ * Convolves with a separable kernel: a horizontal pass into a ring of kRows rows of partial sums, then a vertical
+ * pass out of it (rows above and below the image read a zero row, which adds nothing). Every band of output rows
+ * runs the horizontal pass again over the radius rows it shares with each neighbour. The rings of all the workers
+ * are allocated up front, on the calling thread, from its current allocator (the bands run on threads where it is
+ * not current, and an arena must not be shared between threads).
+ * @param image - the image, with contiguous rows
+ * @param col - the kRows vertical factors
+ * @param kRows - num of rows in the kernel
+ * @param row - the kCols horizontal factors
+ * @param kCols - num of cols in the kernel
+ * @param res - the output matrix, of the image dimensions
+ */
+static void convolveSeparable(const MatrixView& image, const float* col, int kRows, const float* row, int kCols,
+                              Matrix& res)
+{
+    int rows = image.getRows();
+    int cols = image.getCols();
+    int radius = kRows / 2;
+    ConvRowFn convRow = selectKernels().row;
+    ThreadPool& pool = ThreadPool::shared();
+    int workers = pool.getNumThreads();
+    Matrix rings(workers * kRows + 1, cols); // a ring of kRows rows for every worker, the last row stays zero
+    std::vector<const float*> inRows((size_t)workers * kRows);
+    const float* zeroRow = rings.getData() + (size_t)workers * kRows * rings.getStride();
+    pool.parallelRows(rows, (long long)cols * (kRows + kCols), [&](int begin, int end, int worker)
+    {
+        float* ring = rings.getData() + (size_t)worker * kRows * rings.getStride();
+        auto ringRow = [&](int r) { return ring + (size_t)(r % kRows) * rings.getStride(); };
+        auto pass = [&](int r)
+        {
+            horizontalPass(image.getData() + (size_t)r * image.getRowStride(), cols, row, kCols, ringRow(r));
+        };
+        const float** in = inRows.data() + (size_t)worker * kRows;
+
+        for (int r = std::max(0, begin - radius); r < begin + radius && r < rows; r++)
+        {
+            pass(r);
+        }
+        for (int r = begin; r < end; r++)
+        {
+            if (r + radius < rows)
+            {
+                pass(r + radius);
+            }
+            for (int i = 0; i < kRows; i++)
+            {
+                int y = r + i - radius;
+                in[i] = y >= 0 && y < rows ? ringRow(y) : zeroRow;
+            }
+            convRow(in, col, kRows, 1, true, res.getData() + (size_t)r * res.getStride(), 0, cols);
+        }
+    });
+}
+
+/**
+ * The plan of a radix-2 fft of one size
+ */
+struct FftPlan
+{
+    int size;
+    std::vector<int> reversed; // the bit reversal permutation
+    std::vector<Complex> twiddles; // e^(-2 pi i k / size) for k < size / 2
+};
+
+/**
+ * Builds the plan of an fft
+ * @param size - the size, a power of two
+ * @return the plan
+ */
+static FftPlan makeFftPlan(int size)
+{
+    FftPlan plan{size, std::vector<int>(size), std::vector<Complex>(size / 2)};
+    int levels = __builtin_ctz((unsigned)size);
+    for (int k = 0; k < size; k++)
+    {
+        int r = 0;
+        for (int bit = 0; bit < levels; bit++)
+        {
+            r |= ((k >> bit) & 1) << (levels - 1 - bit);
+        }
+        plan.reversed[k] = r;
+    }
+    for (int k = 0; k < size / 2; k++)
+    {
+        double angle = -2 * M_PI * k / size;
+        plan.twiddles[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+    return plan;
+}
+
+/**
+ * Multiplies two complex numbers (std::complex guards every product against infinities, the data here is finite)
+ * @param a - the first factor
+ * @param b - the second factor
+ * @return a * b
+ */
+static inline Complex complexMul(const Complex& a, const Complex& b)
+{
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+/**
+ * Runs an fft over vectors of points at once: point k of the transform is the vector at data + k * pitch, of width
+ * complex numbers, and every butterfly runs along the whole vector. With width 1 this is a 1-D fft of contiguous
+ * points, with the pitch and width of a tile row it transforms all the columns of the tile, reading whole rows.
+ * @param plan - the plan, of the transform size
+ * @param data - the points
+ * @param pitch - the distance between points
+ * @param width - the length of a vector
+ * @param inverse - true for the inverse transform (not scaled)
+ */
+static void fftVectors(const FftPlan& plan, Complex* data, size_t pitch, int width, bool inverse)
+{
+    int n = plan.size;
+    for (int k = 0; k < n; k++)
+    {
+        int r = plan.reversed[k];
+        if (k < r)
+        {
+            std::swap_ranges(data + k * pitch, data + k * pitch + width, data + r * pitch);
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        int half = len / 2;
+        int step = n / len;
+        for (int start = 0; start < n; start += len)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                Complex w = plan.twiddles[(size_t)k * step];
+                if (inverse)
+                {
+                    w = std::conj(w);
+                }
+                Complex* a = data + (size_t)(start + k) * pitch;
+                Complex* b = a + (size_t)half * pitch;
+                for (int x = 0; x < width; x++)
+                {
+                    Complex t = complexMul(b[x], w);
+                    b[x] = a[x] - t;
+                    a[x] += t;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * This struct is the working state of an fft convolution with one tile size
+ */
+struct FftTiles
+{
+    FftPlan rowPlan; // along a row, of tileCols points
+    FftPlan colPlan; // along a column, of tileRows points
+    int tileRows, tileCols;
+    std::vector<Complex> spectrum; // the spectrum of the kernel, scaled by the inverse transform size
+    std::vector<Complex> work;
+};
+
+/**
+ * Runs a 2-D fft over a tile, a pass along the rows and one along the columns
+ * @param tiles - the fft state
+ * @param data - the tile
+ * @param usedRows - the forward transform skips the rows from usedRows on, which are all zeros, and the inverse one
+ * leaves them unfinished, they are not read
+ * @param inverse - true for the inverse transform (not scaled)
+ */
+static void fftTile(const FftTiles& tiles, Complex* data, int usedRows, bool inverse)
+{
+    if (inverse)
+    {
+        fftVectors(tiles.colPlan, data, tiles.tileCols, tiles.tileCols, true);
+    }
+    for (int r = 0; r < usedRows; r++)
+    {
+        fftVectors(tiles.rowPlan, data + (size_t)r * tiles.tileCols, 1, 1, inverse);
+    }
+    if (!inverse)
+    {
+        fftVectors(tiles.colPlan, data, tiles.tileCols, tiles.tileCols, false);
+    }
+}
+
+/**
+ * Prepares an fft convolution: the plans and the spectrum of the kernel, flipped because convolution here is
+ * the sum of image(r + i - kRows / 2, c + j - kCols / 2) * kernel(i, j)
+ * @param kernel - the kernel
+ * @param tileRows - the rows of a tile, a power of two of at least kernel.getRows()
+ * @param tileCols - the cols of a tile, a power of two of at least kernel.getCols()
+ * @return the fft state
+ */
+static FftTiles makeFftTiles(const Matrix& kernel, int tileRows, int tileCols)
+{
+    size_t tileSize = (size_t)tileRows * tileCols;
+    FftTiles tiles{makeFftPlan(tileCols), makeFftPlan(tileRows), tileRows, tileCols,
+                   std::vector<Complex>(tileSize), std::vector<Complex>(tileSize)};
+    int kRows = kernel.getRows();
+    int kCols = kernel.getCols();
+    double scale = 1.0 / (double)tileSize;
+    for (int i = 0; i < kRows; i++)
+    {
+        for (int j = 0; j < kCols; j++)
+        {
+            tiles.spectrum[(size_t)i * tileCols + j] = kernel(kRows - 1 - i, kCols - 1 - j) * scale;
+        }
+    }
+    fftTile(tiles, tiles.spectrum.data(), kRows, false);
+    return tiles;
+}
+
+/**
+ * Copies a block of the image into the real or the imaginary parts of a tile of zeros
+ * @param image - the image
+ * @param y0 - the first row of the block
+ * @param x0 - the first column of the block
+ * @param h - num of rows in the block
+ * @param w - num of cols in the block
+ * @param work - the tile
+ * @param tileCols - the cols of the tile
+ * @param part - 0 for the real parts, 1 for the imaginary parts
+ */
+static void loadBlock(const MatrixView& image, int y0, int x0, int h, int w, Complex* work, int tileCols, int part)
+{
+    for (int r = 0; r < h; r++)
+    {
+        const float* in = image.getData() + (size_t)(y0 + r) * image.getRowStride() + x0;
+        auto out = reinterpret_cast<double*>(work + (size_t)r * tileCols); // std::complex is an array of two
+        for (int c = 0; c < w; c++)
+        {
+            out[2 * c + part] = in[c];
+        }
+    }
+}
+
+/**
+ * Adds the full convolution of a block, the real or the imaginary parts of a transformed tile, to the output:
+ * point (r, c) of it is pixel (y0 + r - radiusY, x0 + c - radiusX), the points outside the image are dropped
+ * @param work - the tile
+ * @param tileCols - the cols of the tile
+ * @param part - 0 for the real parts, 1 for the imaginary parts
+ * @param y0 - the first row of the block
+ * @param x0 - the first column of the block
+ * @param h - num of rows in the block
+ * @param w - num of cols in the block
+ * @param radiusY - kernel rows on each side of the center
+ * @param radiusX - kernel cols on each side of the center
+ * @param res - the output matrix
+ */
+static void addBlock(const Complex* work, int tileCols, int part, int y0, int x0, int h, int w, int radiusY,
+                     int radiusX, Matrix& res)
+{
+    int firstRow = std::max(0, radiusY - y0);
+    int endRow = std::min(h + 2 * radiusY, res.getRows() - y0 + radiusY);
+    int firstCol = std::max(0, radiusX - x0);
+    int endCol = std::min(w + 2 * radiusX, res.getCols() - x0 + radiusX);
+    for (int r = firstRow; r < endRow; r++)
+    {
+        auto in = reinterpret_cast<const double*>(work + (size_t)r * tileCols);
+        float* out = res.getData() + (size_t)(y0 + r - radiusY) * res.getStride() + x0 - radiusX;
+        for (int c = firstCol; c < endCol; c++)
+        {
+            out[c] += (float)in[2 * c + part];
+        }
+    }
+}
+
+/**
+ * Convolves through ffts with overlap-add: the image is cut into blocks of (tileRows - kRows + 1) *
+ * (tileCols - kCols + 1) pixels, every block is zero padded to a tile, transformed, multiplied by the spectrum of
+ * the kernel and transformed back, which gives the full linear convolution of the block, and the results of the
+ * blocks are added where they overlap. Two blocks side by side share a tile, one in the real parts and one in the
+ * imaginary parts: the kernel is real, so their convolutions stay apart.
+ * @param image - the image, with contiguous rows
+ * @param kernel - the kernel
+ * @param tileRows - the rows of a tile, a power of two of at least kernel.getRows()
+ * @param tileCols - the cols of a tile, a power of two of at least kernel.getCols()
+ * @param res - the output matrix, of the image dimensions, all zeros
+ */
+static void convolveFft(const MatrixView& image, const Matrix& kernel, int tileRows, int tileCols, Matrix& res)
+{
+    int rows = image.getRows();
+    int cols = image.getCols();
+    int radiusY = kernel.getRows() / 2;
+    int radiusX = kernel.getCols() / 2;
+    int blockRows = tileRows - 2 * radiusY;
+    int blockCols = tileCols - 2 * radiusX;
+    FftTiles tiles = makeFftTiles(kernel, tileRows, tileCols);
+    Complex* work = tiles.work.data();
+
+    for (int y0 = 0; y0 < rows; y0 += blockRows)
+    {
+        int h = std::min(blockRows, rows - y0);
+        int usedRows = std::min(h + 2 * radiusY, rows - y0 + radiusY); // the rows addBlock reads
+        for (int x0 = 0; x0 < cols; x0 += 2 * blockCols)
+        {
+            int x1 = x0 + blockCols;
+            int w0 = std::min(blockCols, cols - x0);
+            int w1 = std::max(0, std::min(blockCols, cols - x1));
+            std::fill(tiles.work.begin(), tiles.work.end(), Complex(0));
+            loadBlock(image, y0, x0, h, w0, work, tileCols, 0);
+            loadBlock(image, y0, x1, h, w1, work, tileCols, 1);
+            fftTile(tiles, work, h, false);
+            for (size_t k = 0; k < tiles.work.size(); k++)
+            {
+                work[k] = complexMul(work[k], tiles.spectrum[k]);
+            }
+            fftTile(tiles, work, usedRows, true);
+            addBlock(work, tileCols, 0, y0, x0, h, w0, radiusY, radiusX, res);
+            if (w1 > 0)
+            {
+                addBlock(work, tileCols, 1, y0, x1, h, w1, radiusY, radiusX, res);
+            }
+        }
+    }
+    for (int r = 0; r < rows; r++)
+    {
+        float* out = res.getData() + (size_t)r * res.getStride();
+        for (int c = 0; c < cols; c++)
+        {
+            out[c] = rintf(out[c]);
+        }
+    }
+}
+
+/**
+ * The smallest power of two that is not smaller than n
+ * @param n - a positive number
+ * @return the power of two
+ */
+static int ceilPow2(int n)
+{
+    int p = 1;
+    while (p < n)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+/**
+ * Estimates the time of an fft convolution with one tile size, in ns
+ * @param rows - num of rows in the image
+ * @param cols - num of cols in the image
+ * @param kRows - num of rows in the kernel
+ * @param kCols - num of cols in the kernel
+ * @param tileRows - the rows of a tile
+ * @param tileCols - the cols of a tile
+ * @return the estimate
+ */
+static double fftCost(int rows, int cols, int kRows, int kCols, int tileRows, int tileCols)
+{
+    // two blocks side by side share a tile
+    double tiles = std::ceil((double)rows / (tileRows - kRows + 1)) *
+                   std::ceil((double)cols / (2.0 * (tileCols - kCols + 1)));
+    double points = (double)tileRows * tileCols;
+    // a forward and an inverse transform, each a pass along the rows and one along the columns
+    double butterflies = points * (__builtin_ctz((unsigned)tileRows) + __builtin_ctz((unsigned)tileCols));
+    return tiles * (butterflies * COST_FFT_BUTTERFLY + points * COST_FFT_POINT);
+}
+
+/**
+ * Picks the cheapest fft tile for an image and a kernel
+ * @param rows - num of rows in the image
+ * @param cols - num of cols in the image
+ * @param kRows - num of rows in the kernel
+ * @param kCols - num of cols in the kernel
+ * @param tileRows - set to the rows of the tile
+ * @param tileCols - set to the cols of the tile
+ * @return the estimate of the time with that tile, in ns
+ */
+static double chooseFftTile(int rows, int cols, int kRows, int kCols, int& tileRows, int& tileCols)
+{
+    // a tile must hold the kernel and some pixels; past one tile over the whole image a larger one only adds work
+    int minRows = std::max(FFT_MIN_SIZE, ceilPow2(kRows + 1));
+    int minCols = std::max(FFT_MIN_SIZE, ceilPow2(kCols + 1));
+    int maxRows = std::max(minRows, std::min(FFT_MAX_SIZE, ceilPow2(rows + kRows - 1)));
+    int maxCols = std::max(minCols, std::min(FFT_MAX_SIZE, ceilPow2(cols + kCols - 1)));
+    double best = -1;
+    for (int tr = minRows; tr <= maxRows; tr <<= 1)
+    {
+        for (int tc = minCols; tc <= maxCols; tc <<= 1)
+        {
+            double cost = fftCost(rows, cols, kRows, kCols, tr, tc);
+            if (best < 0 || cost < best)
+            {
+                best = cost;
+                tileRows = tr;
+                tileCols = tc;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * Picks the strategy convolve uses for an image and a kernel, by estimating the time of each:
+ * a separable kernel always runs as two 1-D passes, kRows + kCols taps a pixel, which is cheaper than the fft for
+ * any kernel that fits in an image; otherwise direct costs kRows * kCols taps a pixel, and fft the transforms of the
+ * tiles, per pixel of a tile, which grows with the log of the tile rather than with the kernel.
+ * @param rows - num of rows in the image
+ * @param cols - num of cols in the image
+ * @param kernel - the kernel, of odd dimensions
+ * @return CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ */
+int chooseConvStrategy(int rows, int cols, const Matrix& kernel)
+{
+    int kRows = kernel.getRows();
+    int kCols = kernel.getCols();
+    std::vector<float> col(kRows);
+    std::vector<float> row(kCols);
+    if (separateKernel(kernel, col.data(), row.data()))
+    {
+        return CONV_SEPARABLE;
+    }
+    double vectors = (double)rows * std::ceil((double)cols / selectKernels().lanes);
+    double direct = vectors * kRows * kCols * COST_DIRECT_TAP;
+    int tileRows = 0;
+    int tileCols = 0;
+    return chooseFftTile(rows, cols, kRows, kCols, tileRows, tileCols) < direct ? CONV_FFT : CONV_DIRECT;
+}
+
+/**
+ * Convolves an image with a kernel of odd dimensions (pixels outside the image count as 0) and rounds every output
+ * pixel to the nearest integer with rintf.
+ * @param image - the image
+ * @param kernel - the kernel, of odd dimensions
+ * @param strategy - CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ * @return new matrix holding the convolved image
+ */
+Matrix convolve(const MatrixView& image, const Matrix& kernel, int strategy)
+{
+    Matrix res(image.getRows(), image.getCols());
+    convolve(image, kernel, res, strategy);
+    return res;
+}
+
+/**
+ * Convolves an image with a kernel of odd dimensions into an existing matrix
+ * @param image - the image
+ * @param kernel - the kernel, of odd dimensions
+ * @param res - the output, of the image dimensions, must not overlap the image
+ * @param strategy - CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ */
+void convolve(const MatrixView& image, const Matrix& kernel, Matrix& res, int strategy)
+{
+    int kRows = kernel.getRows();
+    int kCols = kernel.getCols();
+    if (kRows % 2 == 0 || kCols % 2 == 0 || res.getRows() != image.getRows() || res.getCols() != image.getCols())
+    {
+        matrixDimError();
+    }
+    if (!image.hasContiguousRows()) // the row kernels read rows in place
+    {
+        Matrix copy = image.toMatrix();
+        convolve(MatrixView(copy), kernel, res, strategy);
+        return;
+    }
+    if (image.getRows() == 0 || image.getCols() == 0)
+    {
+        return;
+    }
+    if (strategy == CONV_AUTO)
+    {
+        strategy = chooseConvStrategy(image.getRows(), image.getCols(), kernel);
+    }
+    if (strategy == CONV_SEPARABLE)
+    {
+        std::vector<float> col(kRows);
+        std::vector<float> row(kCols);
+        if (separateKernel(kernel, col.data(), row.data()))
+        {
+            convolveSeparable(image, col.data(), kRows, row.data(), kCols, res);
+            return;
+        }
+        strategy = CONV_DIRECT;
+    }
+    if (strategy == CONV_FFT)
+    {
+        int tileRows = 0;
+        int tileCols = 0;
+        chooseFftTile(image.getRows(), image.getCols(), kRows, kCols, tileRows, tileCols);
+        for (int r = 0; r < res.getRows(); r++) // the tiles are added into it
+        {
+            float* out = res.getData() + (size_t)r * res.getStride();
+            std::fill(out, out + res.getCols(), 0.0f);
+        }
+        convolveFft(image, kernel, tileRows, tileCols, res);
+        return;
+    }
+    convolveDirect(image, kernel, res);
+}
+
+/**
+ * Prepares a kernel of convolveGradients in the form convolve runs it
+ * @param kernel - the GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @return the prepared kernel
+ */
+static GradientKernel makeGradientKernel(const Matrix& kernel)
+{
+    if (kernel.getRows() != GRADIENT_SIZE || kernel.getCols() != GRADIENT_SIZE)
+    {
+        matrixDimError();
+    }
+    GradientKernel res{};
+    res.separable = separateKernel(kernel, res.col, res.row); // as convolve picks, a 3x3 kernel never takes the fft
+    for (int t = 0; t < GRADIENT_TAPS; t++)
+    {
+        res.w[t] = kernel(t / GRADIENT_SIZE, t % GRADIENT_SIZE);
+    }
+    return res;
+}
+
+/**
+ * Computes a pixel of convolveGradients in the first or the last column, reading zeros outside the image
+ * @param rows - the three input rows around the output row
+ * @param cols - num of cols in the image
+ * @param kernels - the two kernels
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param out - the output row
+ * @param gradX - the row of responses to the first kernel, or nullptr
+ * @param gradY - the row of responses to the second kernel, or nullptr
+ * @param c - the column
+ */
+static void gradientBorderPixel(const float* const* rows, int cols, const GradientKernel* kernels, float lo, float hi,
+                                float* out, float* gradX, float* gradY, int c)
+{
+    float x[GRADIENT_TAPS];
+    for (int t = 0; t < GRADIENT_TAPS; t++)
+    {
+        int col = c + t % GRADIENT_SIZE - 1;
+        x[t] = col >= 0 && col < cols ? rows[t / GRADIENT_SIZE][col] : 0;
+    }
+    float gx = gradientResponse(kernels[0], x);
+    float gy = gradientResponse(kernels[1], x);
+    out[c] = combineGradients(gx, gy, lo, hi);
+    if (gradX != nullptr)
+    {
+        gradX[c] = gx;
+        gradY[c] = gy;
+    }
+}
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results into an existing matrix
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param res - the output, of the image dimensions
+ * @param gradX - if not nullptr, set to the responses to kernelX, not rounded
+ * @param gradY - if not nullptr, set to the responses to kernelY, not rounded
+ * @param sink - if not nullptr, receives the responses of every row, which are not kept (gradX and gradY must be
+ * nullptr)
+ */
+static void gradientsInto(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                          Matrix& res, Matrix* gradX, Matrix* gradY, const GradientRowSink* sink = nullptr)
+{
+    if (!image.hasContiguousRows()) // the row kernels read rows in place
+    {
+        Matrix copy = image.toMatrix();
+        gradientsInto(MatrixView(copy), kernelX, kernelY, lo, hi, res, gradX, gradY, sink);
+        return;
+    }
+    GradientKernel kernels[2] = {makeGradientKernel(kernelX), makeGradientKernel(kernelY)};
+    int rows = image.getRows();
+    int cols = image.getCols();
+    // both responses are kept if either is asked for, the row kernels store them together
+    Matrix tempX;
+    Matrix tempY;
+    Matrix& gx = gradX != nullptr ? *gradX : tempX;
+    Matrix& gy = gradY != nullptr ? *gradY : tempY;
+    bool keep = gradX != nullptr || gradY != nullptr;
+    if (keep)
+    {
+        gx = Matrix(rows, cols);
+        gy = Matrix(rows, cols);
+    }
+    if (rows == 0 || cols == 0)
+    {
+        return;
+    }
+    std::vector<float> zeros(cols + 2); // a row outside the image, with a pixel of margin on each side
+    GradientRowFn gradient = selectKernels().gradient;
+    ThreadPool& pool = ThreadPool::shared();
+    // a row of responses to each kernel for every worker, taken on this thread so it comes from its allocator
+    Matrix rowGrads(sink != nullptr ? 2 * pool.getNumThreads() : 0, cols);
+    pool.parallelRows(rows, (long long)cols * GRADIENT_TAPS, [&](int begin, int end, int worker)
+    {
+        for (int r = begin; r < end; r++)
+        {
+            const float* in[GRADIENT_SIZE];
+            for (int i = 0; i < GRADIENT_SIZE; i++)
+            {
+                int y = r + i - 1;
+                in[i] = y >= 0 && y < rows ? image.getData() + (size_t)y * image.getRowStride() : zeros.data() + 1;
+            }
+            float* out = res.getData() + (size_t)r * res.getStride();
+            float* outX = keep ? gx.getData() + (size_t)r * gx.getStride() : nullptr;
+            float* outY = keep ? gy.getData() + (size_t)r * gy.getStride() : nullptr;
+            if (sink != nullptr)
+            {
+                outX = rowGrads.getData() + (size_t)2 * worker * rowGrads.getStride();
+                outY = outX + rowGrads.getStride();
+            }
+            if (cols > 2)
+            {
+                gradient(in, kernels, lo, hi, out, outX, outY, 1, cols - 1);
+            }
+            gradientBorderPixel(in, cols, kernels, lo, hi, out, outX, outY, 0);
+            if (cols > 1)
+            {
+                gradientBorderPixel(in, cols, kernels, lo, hi, out, outX, outY, cols - 1);
+            }
+            if (sink != nullptr)
+            {
+                (*sink)(r, outX, outY);
+            }
+        }
+    });
+}
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param gradX - if not nullptr, set to the responses to kernelX, not rounded
+ * @param gradY - if not nullptr, set to the responses to kernelY, not rounded
+ * @return new matrix holding the combined image
+ */
+Matrix convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                         Matrix* gradX, Matrix* gradY)
+{
+    Matrix res(image.getRows(), image.getCols());
+    gradientsInto(image, kernelX, kernelY, lo, hi, res, gradX, gradY);
+    return res;
+}
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results, handing the responses of every row
+ * to a sink
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param sink - receives the responses of every row
+ * @return new matrix holding the combined image
+ */
+Matrix convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                         const GradientRowSink& sink)
+{
+    Matrix res(image.getRows(), image.getCols());
+    gradientsInto(image, kernelX, kernelY, lo, hi, res, nullptr, nullptr, &sink);
+    return res;
+}
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results into an existing matrix
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                       Matrix& res)
+{
+    if (res.getRows() != image.getRows() || res.getCols() != image.getCols())
+    {
+        matrixDimError();
+    }
+    gradientsInto(image, kernelX, kernelY, lo, hi, res, nullptr, nullptr);
+}
\ No newline at end of file
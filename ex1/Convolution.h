@@ -0,0 +1,134 @@
+#ifndef EXERCISE5_CONVOLUTION_H
+#define EXERCISE5_CONVOLUTION_H
+
+#include "Matrix.h"
+#include <functional>
+
+// the strategies of convolve
+#define CONV_AUTO 0 // pick one of the others with chooseConvStrategy
+#define CONV_DIRECT 1 // every tap of the kernel at every pixel
+#define CONV_SEPARABLE 2 // a horizontal and a vertical 1-D pass, for kernels separateKernel splits (else direct)
+#define CONV_FFT 3 // overlap-add of fft tiles
+#define GRADIENT_SIZE 3 // the kernels convolveGradients takes are GRADIENT_SIZE * GRADIENT_SIZE
+
+/**
+ * Convolves an image with a kernel of odd dimensions (pixels outside the image count as 0) and rounds every output
+ * pixel to the nearest integer with rintf.
+ * The direct and separable strategies run the interior, where the whole kernel lies inside the image, branch free
+ * through the widest SIMD row kernel the cpu supports (AVX-512, AVX2 or portable scalar, chosen once at runtime)
+ * and handle the border separately; every kernel multiplies and adds in the same order, so their result does not
+ * depend on the cpu. The direct strategy sums the taps row by row, in the order of the former per-pixel loop. The
+ * separable one sums each row of the neighbourhood first and then the partial sums: on images whose sums are exact
+ * in float (e.g. integer pixels and power of two weights, as blur and sobel) it agrees with the direct one bit for
+ * bit, on fractional pixels the other order may round a sum that lies within a few ulps of a half to the other
+ * integer, so such a pixel differs by 1. The fft strategy sums in double precision, it agrees with the direct one up
+ * to the same rounding.
+ * The direct and separable strategies cut the output into bands of rows run in parallel on ThreadPool::shared(),
+ * every pixel still sums the same taps in the same order, so the result does not depend on the number of threads.
+ * @param image - the image
+ * @param kernel - the kernel, of odd dimensions
+ * @param strategy - CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ * @return new matrix holding the convolved image
+ */
+Matrix convolve(const MatrixView& image, const Matrix& kernel, int strategy = CONV_AUTO);
+
+/**
+ * Convolves an image with a kernel of odd dimensions into an existing matrix, as convolve does, so a caller that
+ * filters many images of one size allocates the output once
+ * @param image - the image
+ * @param kernel - the kernel, of odd dimensions
+ * @param res - the output, of the image dimensions, must not overlap the image
+ * @param strategy - CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ */
+void convolve(const MatrixView& image, const Matrix& kernel, Matrix& res, int strategy = CONV_AUTO);
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results, as the sobel operator does:
+ * out = rint(kernelX * image) + rint(kernelY * image), clamped to [lo, hi] (NaN is kept).
+ * Every neighbourhood is loaded once for both kernels, and the sums, the rounding, the addition and the clamping
+ * stay in SIMD registers, so only the output is written. Each response is summed with the same float operations
+ * convolve uses for its kernel, so the result is bit for bit the one of convolving twice, adding and clamping.
+ * The rows run in parallel bands, as convolve does.
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param gradX - if not nullptr, set to the responses to kernelX, not rounded
+ * @param gradY - if not nullptr, set to the responses to kernelY, not rounded
+ * @return new matrix holding the combined image
+ */
+Matrix convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                         Matrix* gradX = nullptr, Matrix* gradY = nullptr);
+
+/**
+ * Receives the responses of one row of convolveGradients to both kernels, not rounded: the row and its cols responses
+ * to each kernel. It is called once for every row, from the parallel bands (so rows arrive in any order, some at
+ * once), and the responses are only valid during the call.
+ */
+typedef std::function<void(int row, const float* gradX, const float* gradY)> GradientRowSink;
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results, as convolveGradients does, handing
+ * the responses of every row to a sink as soon as the row is done instead of keeping them for the whole image
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param sink - receives the responses of every row
+ * @return new matrix holding the combined image
+ */
+Matrix convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                         const GradientRowSink& sink);
+
+/**
+ * Convolves an image with two 3x3 kernels in one pass and combines the results into an existing matrix, as
+ * convolveGradients does
+ * @param image - the image
+ * @param kernelX - the first GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param kernelY - the second GRADIENT_SIZE * GRADIENT_SIZE kernel
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void convolveGradients(const MatrixView& image, const Matrix& kernelX, const Matrix& kernelY, float lo, float hi,
+                       Matrix& res);
+
+/**
+ * Limits every element of a matrix to [lo, hi] in place (NaN is kept), with the row kernels of convolve
+ * @param image - the matrix
+ * @param lo - the smallest value
+ * @param hi - the largest value
+ */
+void clampValues(Matrix& image, float lo, float hi);
+
+/**
+ * Picks the strategy convolve uses for an image and a kernel, by estimating the time of each:
+ * a separable kernel always runs as two 1-D passes, kRows + kCols taps a pixel, which is cheaper than the fft for
+ * any kernel that fits in an image; otherwise direct costs kRows * kCols taps a pixel, and fft the transforms of the
+ * tiles, per pixel of a tile, which grows with the log of the tile rather than with the kernel.
+ * @param rows - num of rows in the image
+ * @param cols - num of cols in the image
+ * @param kernel - the kernel, of odd dimensions
+ * @return CONV_DIRECT, CONV_SEPARABLE or CONV_FFT
+ */
+int chooseConvStrategy(int rows, int cols, const Matrix& kernel);
+
+/**
+ * Checks if a kernel is separable, i.e. kernel(i, j) == col[i] * row[j] for finite factors, up to a millionth of
+ * the largest weight (kernels of small integer weights, as blur and sobel, separate exactly)
+ * @param kernel - the kernel
+ * @param col - set to the kernel.getRows() vertical factors
+ * @param row - set to the kernel.getCols() horizontal factors
+ * @return true if the kernel is separable
+ */
+bool separateKernel(const Matrix& kernel, float* col, float* row);
+
+/**
+ * Returns the name of the row kernels convolve dispatches to on this cpu
+ * @return "avx512", "avx2" or "scalar"
+ */
+const char* convKernelName();
+
+#endif //EXERCISE5_CONVOLUTION_H
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "FilterBatch.h"
+#include "Filters.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+/**
+ * Runs a filter over every image of a batch, a task an image
+ * @param images - the images
+ * @param results - resized to the number of images, results[i] set to the filtered images[i]
+ * @param filter - the filter, from an image into a matrix of its dimensions
+ */
+template <typename Filter>
+static void runBatch(const std::vector<MatrixView>& images, std::vector<Matrix>& results, Filter filter)
+{
+    results.resize(images.size());
+    // the outputs outlive the batch, they come from the allocator of the caller
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (results[i].getRows() != images[i].getRows() || results[i].getCols() != images[i].getCols())
+        {
+            results[i] = Matrix(images[i].getRows(), images[i].getCols());
+        }
+    }
+    PoolAllocator pool;
+    ThreadPool::shared().parallelFor((int)images.size(), [&](int task, int)
+    {
+        MatrixAllocatorScope scope(pool);
+        filter(images[task], results[task]);
+    });
+}
+
+/**
+ * Runs a filter over every frame of a packed batch, a task a frame
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame
+ * @param filter - the filter, from an image into a matrix of its dimensions
+ * @return new matrix holding the filtered frames, stacked the same way
+ */
+template <typename Filter>
+static Matrix runPacked(const MatrixView& frames, int frameRows, Filter filter)
+{
+    if (frameRows <= 0 || frames.getRows() % frameRows != 0)
+    {
+        matrixDimError();
+    }
+    int cols = frames.getCols();
+    Matrix res(frames.getRows(), cols);
+    // every task filters into a frame of its own, the pool hands the buffers of finished tasks out again
+    PoolAllocator pool;
+    ThreadPool::shared().parallelFor(frames.getRows() / frameRows, [&](int task, int)
+    {
+        MatrixAllocatorScope scope(pool);
+        Matrix out(frameRows, cols);
+        filter(frames.rowRange(task * frameRows, frameRows), out);
+        for (int i = 0; i < frameRows; i++)
+        {
+            const float* src = out.getData() + (size_t)i * out.getStride();
+            float* dst = res.getData() + (size_t)(task * frameRows + i) * res.getStride();
+            std::copy(src, src + cols, dst);
+        }
+    });
+    return res;
+}
+
+/**
+ * Performs gaussian blurring on a batch of images
+ * @param images - the images (or regions of them)
+ * @param results - resized to the number of images, results[i] set to the blurred images[i]
+ */
+void blurBatch(const std::vector<MatrixView>& images, std::vector<Matrix>& results)
+{
+    runBatch(images, results, [](const MatrixView& image, Matrix& res) { blur(image, res); });
+}
+
+/**
+ * Performs sobel edge detection on a batch of images
+ * @param images - the images (or regions of them)
+ * @param results - resized to the number of images, results[i] set to the edges of images[i]
+ */
+void sobelBatch(const std::vector<MatrixView>& images, std::vector<Matrix>& results)
+{
+    runBatch(images, results, [](const MatrixView& image, Matrix& res) { sobel(image, res); });
+}
+
+/**
+ * Performs quantization on a batch of images
+ * @param images - the images (or regions of them)
+ * @param levels - the quantization is performed according to this number of levels
+ * @param results - resized to the number of images, results[i] set to the quantized images[i]
+ */
+void quantizationBatch(const std::vector<MatrixView>& images, int levels, std::vector<Matrix>& results)
+{
+    const QuantTable& table = QuantTable::uniform(levels);
+    runBatch(images, results, [&](const MatrixView& image, Matrix& res) { quantization(image, table, res); });
+}
+
+/**
+ * Performs gaussian blurring on a packed batch of frames, every frame on its own
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @return new matrix holding the blurred frames, stacked the same way
+ */
+Matrix blurBatch(const MatrixView& frames, int frameRows)
+{
+    return runPacked(frames, frameRows, [](const MatrixView& image, Matrix& res) { blur(image, res); });
+}
+
+/**
+ * Performs sobel edge detection on a packed batch of frames, every frame on its own
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @return new matrix holding the edges of the frames, stacked the same way
+ */
+Matrix sobelBatch(const MatrixView& frames, int frameRows)
+{
+    return runPacked(frames, frameRows, [](const MatrixView& image, Matrix& res) { sobel(image, res); });
+}
+
+/**
+ * Performs quantization on a packed batch of frames, which is point-wise, so the whole stack is quantized at once
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new matrix holding the quantized frames, stacked the same way
+ */
+Matrix quantizationBatch(const MatrixView& frames, int frameRows, int levels)
+{
+    if (frameRows <= 0 || frames.getRows() % frameRows != 0)
+    {
+        matrixDimError();
+    }
+    return quantization(frames, levels);
+}
\ No newline at end of file
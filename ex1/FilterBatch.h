@@ -0,0 +1,63 @@
+#ifndef EXERCISE5_FILTERBATCH_H
+#define EXERCISE5_FILTERBATCH_H
+
+#include "Matrix.h"
+#include <vector>
+
+/**
+ * Performs gaussian blurring on a batch of images.
+ * The batch filters are meant for many small frames (thumbnails), where the cost of a call rather than the pixels
+ * dominates: the kernels are built once for the program, an output that already has the right dimensions is
+ * written in place (a caller that keeps its results between batches allocates nothing), the temporaries of the
+ * filters come from a pool shared by the batch, and the frames are spread over the shared thread pool, a frame a
+ * task. Every frame gets the result of the single image filter, bit for bit.
+ * @param images - the images (or regions of them)
+ * @param results - resized to the number of images, results[i] set to the blurred images[i] (kept and written in
+ * place if it already has its dimensions)
+ */
+void blurBatch(const std::vector<MatrixView>& images, std::vector<Matrix>& results);
+
+/**
+ * Performs sobel edge detection on a batch of images
+ * @param images - the images (or regions of them)
+ * @param results - resized to the number of images, results[i] set to the edges of images[i] (kept and written in
+ * place if it already has its dimensions)
+ */
+void sobelBatch(const std::vector<MatrixView>& images, std::vector<Matrix>& results);
+
+/**
+ * Performs quantization on a batch of images
+ * @param images - the images (or regions of them)
+ * @param levels - the quantization is performed according to this number of levels
+ * @param results - resized to the number of images, results[i] set to the quantized images[i] (kept and written
+ * in place if it already has its dimensions)
+ */
+void quantizationBatch(const std::vector<MatrixView>& images, int levels, std::vector<Matrix>& results);
+
+/**
+ * Performs gaussian blurring on a packed batch of frames, every frame on its own: the frames are stacked one
+ * under the other in a single (count * frameRows) x cols matrix, as a tensor of count frames
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @return new matrix holding the blurred frames, stacked the same way
+ */
+Matrix blurBatch(const MatrixView& frames, int frameRows);
+
+/**
+ * Performs sobel edge detection on a packed batch of frames, every frame on its own
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @return new matrix holding the edges of the frames, stacked the same way
+ */
+Matrix sobelBatch(const MatrixView& frames, int frameRows);
+
+/**
+ * Performs quantization on a packed batch of frames
+ * @param frames - the frames, stacked
+ * @param frameRows - the rows of a frame, must divide the rows of frames
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new matrix holding the quantized frames, stacked the same way
+ */
+Matrix quantizationBatch(const MatrixView& frames, int frameRows, int levels);
+
+#endif //EXERCISE5_FILTERBATCH_H
@@ -0,0 +1,191 @@
+#include "FilterPipeline.h"
+#include "Filters.h"
+#include "MatrixFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+#define STENCIL_RADIUS 1 // blur and sobel read the 3x3 neighbourhood
+
+/**
+ * Constructs an empty pipeline
+ * @param tileRows - the rows of an output tile
+ * @param tileCols - the cols of an output tile
+ */
+FilterPipeline::FilterPipeline(int tileRows, int tileCols): _tileRows(tileRows), _tileCols(tileCols)
+{
+    if (tileRows <= 0 || tileCols <= 0)
+    {
+        matrixDimError();
+    }
+}
+
+/**
+ * Adds a stage
+ * @param apply - the filter, from an image (or a region of it) to a new image of its dimensions
+ * @param radius - the pixels on each side of an output pixel it reads, 0 for a point-wise filter
+ * @return this pipeline
+ */
+FilterPipeline& FilterPipeline::add(std::function<Matrix(const MatrixView&)> apply, int radius)
+{
+    _stages.push_back({std::move(apply), radius});
+    return *this;
+}
+
+/**
+ * Adds a gaussian blurring stage, as the blur filter
+ * @return this pipeline
+ */
+FilterPipeline& FilterPipeline::blur()
+{
+    return add([](const MatrixView& image) { return ::blur(image); }, STENCIL_RADIUS);
+}
+
+/**
+ * Adds a sobel edge detection stage, as the sobel filter
+ * @return this pipeline
+ */
+FilterPipeline& FilterPipeline::sobel()
+{
+    return add([](const MatrixView& image) { return ::sobel(image); }, STENCIL_RADIUS);
+}
+
+/**
+ * Adds a quantization stage, as the quantization filter
+ * @param levels - the quantization is performed according to this number of levels
+ * @return this pipeline
+ */
+FilterPipeline& FilterPipeline::quantization(int levels)
+{
+    return add([levels](const MatrixView& image) { return ::quantization(image, levels); }, 0);
+}
+
+/**
+ * Adds a convolution stage, as the convolution filter
+ * @param convMat - the convolution matrix, of odd dimensions
+ * @return this pipeline
+ */
+FilterPipeline& FilterPipeline::convolution(const Matrix& convMat)
+{
+    int radius = std::max(convMat.getRows(), convMat.getCols()) / 2;
+    return add([convMat](const MatrixView& image) { return ::convolution(image, convMat); }, radius);
+}
+
+/**
+ * Getter to the halo of a tile
+ * @return the sum of the radii of the stages
+ */
+int FilterPipeline::getHalo() const
+{
+    int halo = 0;
+    for (const Stage& stage : _stages)
+    {
+        halo += stage.radius;
+    }
+    return halo;
+}
+
+/**
+ * Runs the stages over an image
+ * @param image - the image (or a region of it)
+ * @return new matrix which is the result of running all the stages on the image
+ */
+Matrix FilterPipeline::run(const MatrixView& image) const
+{
+    int rows = image.getRows();
+    int cols = image.getCols();
+    int halo = getHalo();
+    Matrix res(rows, cols);
+    int rowTiles = (rows + _tileRows - 1) / _tileRows;
+    int colTiles = (cols + _tileCols - 1) / _tileCols;
+    // the intermediates of every tile have the same few sizes, a pool hands the same buffers out again
+    PoolAllocator pool;
+    // the tiles write apart, and the filters run inline inside a task, so every tile goes through the stages on the
+    // worker that took it
+    ThreadPool::shared().parallelFor(rowTiles * colTiles, [&](int task, int)
+    {
+        MatrixAllocatorScope scope(pool);
+        int r0 = task / colTiles * _tileRows;
+        int c0 = task % colTiles * _tileCols;
+        int h = std::min(_tileRows, rows - r0);
+        int w = std::min(_tileCols, cols - c0);
+        int top = std::max(0, r0 - halo);
+        int left = std::max(0, c0 - halo);
+        int bottom = std::min(rows, r0 + h + halo);
+        int right = std::min(cols, c0 + w + halo);
+        MatrixView region = image.roi(top, left, bottom - top, right - left);
+        Matrix stageOut;
+        for (size_t s = 0; s < _stages.size(); s++)
+        {
+            stageOut = _stages[s].apply(s == 0 ? region : MatrixView(stageOut));
+        }
+        MatrixView kept = (_stages.empty() ? region : MatrixView(stageOut)).roi(r0 - top, c0 - left, h, w);
+        for (int i = 0; i < h; i++)
+        {
+            float* dst = res.getData() + (size_t)(r0 + i) * res.getStride() + c0;
+            auto src = kept.row(i);
+            for (int j = 0; j < w; j++)
+            {
+                dst[j] = src[j];
+            }
+        }
+    });
+    return res;
+}
+
+
+/**
+ * Runs the stages over an image that does not have to fit in memory, a band of rows at a time
+ * @param rows - num of rows in the image
+ * @param cols - num of cols in the image
+ * @param read - called to fill the rows of the image, in order, each row once
+ * @param write - called with the rows of the result, in order, each row once
+ * @param bandRows - the rows of the result produced at a time
+ */
+void FilterPipeline::runStream(int rows, int cols, const RowReader& read, const RowWriter& write, int bandRows) const
+{
+    if (rows < 0 || cols < 0 || bandRows <= 0)
+    {
+        matrixDimError();
+    }
+    int halo = getHalo();
+    Matrix window(std::min(rows, bandRows + 2 * halo), cols);
+    size_t stride = window.getStride();
+    // the results of every band have the same size, a pool hands the same buffers out again
+    PoolAllocator pool;
+    MatrixAllocatorScope scope(pool);
+    int top = 0, bottom = 0; // the rows of the image in the window, the first one in its first row
+    for (int r0 = 0; r0 < rows; r0 += bandRows)
+    {
+        int h = std::min(bandRows, rows - r0);
+        int newTop = std::max(0, r0 - halo);
+        int newBottom = std::min(rows, r0 + h + halo);
+        // the rows of the window the band still needs move up to its beginning
+        for (int i = 0; newTop > top && i < bottom - newTop; i++)
+        {
+            const float* src = window.getData() + (newTop - top + i) * stride;
+            std::copy(src, src + cols, window.getData() + i * stride);
+        }
+        read(window.getData() + (bottom - newTop) * stride, newBottom - bottom, (int)stride);
+        top = newTop;
+        bottom = newBottom;
+        Matrix out = run(MatrixView(window).rowRange(0, bottom - top));
+        write(out.getData() + (size_t)(r0 - top) * out.getStride(), h, out.getStride());
+    }
+}
+
+/**
+ * Runs the stages over an image in a binary matrix file into a new binary matrix file
+ * @param inPath - the path of the image
+ * @param outPath - the path of the result
+ * @param bandRows - the rows of the result produced at a time
+ */
+void FilterPipeline::runFile(const std::string& inPath, const std::string& outPath, int bandRows) const
+{
+    MatrixFileReader reader(inPath);
+    MatrixFileWriter writer(outPath, reader.getRows(), reader.getCols());
+    runStream(reader.getRows(), reader.getCols(),
+              [&](float* rows, int numRows, int stride) { reader.readRows(rows, numRows, stride); },
+              [&](const float* rows, int numRows, int stride) { writer.writeRows(rows, numRows, stride); },
+              bandRows);
+    writer.close();
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef EXERCISE5_FILTERPIPELINE_H
+#define EXERCISE5_FILTERPIPELINE_H
+
+#include "Matrix.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+#define PIPELINE_TILE_ROWS 128 // a float tile of 128 * 512 is 256 KB, a few of them stay in L2
+#define PIPELINE_TILE_COLS 512
+#define PIPELINE_BAND_ROWS 256 // the output rows runStream holds at once
+
+/**
+ * Fills the next rows of an image read in order
+ * @param rows - pointer to the first element of the first row to fill
+ * @param numRows - the number of rows
+ * @param stride - the row stride of rows (in floats)
+ */
+typedef std::function<void(float* rows, int numRows, int stride)> RowReader;
+
+/**
+ * Takes the next rows of an image written in order
+ * @param rows - pointer to the first element of the first row
+ * @param numRows - the number of rows
+ * @param stride - the row stride of rows (in floats)
+ */
+typedef std::function<void(const float* rows, int numRows, int stride)> RowWriter;
+
+/**
+ * This class represents a chain of image filters declared up front and run tile by tile.
+ * Instead of filtering the whole image stage after stage, run() cuts the output into tiles and takes each tile
+ * through all the stages while its intermediates are still in cache, so the image streams through memory once.
+ * Every tile is read with a halo: the stencil stages read pixels around each output pixel, so the input of a
+ * tile is grown by the sum of the radii of all the stages (clipped to the image). The stages run over the whole
+ * grown region, the pixels near its inner edges go wrong (they see zeros beyond it) but only within the halo, and
+ * the tile is cut out of the middle. Every kept pixel is computed from the same neighbourhood with the same
+ * operations as by the whole-image filters, so the result is the same bit for bit (but for a convolution with a
+ * kernel large enough to go through the fft, whose sums agree up to their rounding).
+ * The tiles do not depend on each other, they run in parallel on the shared thread pool.
+ */
+class FilterPipeline
+{
+
+private:
+
+    /**
+     * A stage of the pipeline
+     */
+    struct Stage
+    {
+        std::function<Matrix(const MatrixView&)> apply;
+        int radius; // the pixels on each side of an output pixel it reads
+    };
+
+    std::vector<Stage> _stages;
+    int _tileRows, _tileCols;
+
+public:
+
+    /**
+     * Constructs an empty pipeline
+     * @param tileRows - the rows of an output tile
+     * @param tileCols - the cols of an output tile
+     */
+    explicit FilterPipeline(int tileRows = PIPELINE_TILE_ROWS, int tileCols = PIPELINE_TILE_COLS);
+
+    /**
+     * Adds a stage
+     * @param apply - the filter, from an image (or a region of it) to a new image of its dimensions
+     * @param radius - the pixels on each side of an output pixel it reads, 0 for a point-wise filter
+     * @return this pipeline
+     */
+    FilterPipeline& add(std::function<Matrix(const MatrixView&)> apply, int radius);
+
+    /**
+     * Adds a gaussian blurring stage, as the blur filter
+     * @return this pipeline
+     */
+    FilterPipeline& blur();
+
+    /**
+     * Adds a sobel edge detection stage, as the sobel filter
+     * @return this pipeline
+     */
+    FilterPipeline& sobel();
+
+    /**
+     * Adds a quantization stage, as the quantization filter
+     * @param levels - the quantization is performed according to this number of levels
+     * @return this pipeline
+     */
+    FilterPipeline& quantization(int levels);
+
+    /**
+     * Adds a convolution stage, as the convolution filter
+     * @param convMat - the convolution matrix, of odd dimensions
+     * @return this pipeline
+     */
+    FilterPipeline& convolution(const Matrix& convMat);
+
+    /**
+     * Getter to the halo of a tile
+     * @return the sum of the radii of the stages
+     */
+    int getHalo() const;
+
+    /**
+     * Runs the stages over an image
+     * @param image - the image (or a region of it)
+     * @return new matrix which is the result of running all the stages on the image
+     */
+    Matrix run(const MatrixView& image) const;
+
+    /**
+     * Runs the stages over an image that does not have to fit in memory. The image is read in order a band of
+     * bandRows rows at a time, together with the halo rows below it, into a rolling window of
+     * bandRows + 2 * halo rows (the halo rows above the band are the ones kept from the band before it); the
+     * window goes through run() and the rows of the band are written out, final, before the next band is read.
+     * Only the window and the intermediates of run() are held at once, and the result is the result of run() on
+     * the whole image, bit for bit.
+     * @param rows - num of rows in the image
+     * @param cols - num of cols in the image
+     * @param read - called to fill the rows of the image, in order, each row once
+     * @param write - called with the rows of the result, in order, each row once
+     * @param bandRows - the rows of the result produced at a time
+     */
+    void runStream(int rows, int cols, const RowReader& read, const RowWriter& write,
+                   int bandRows = PIPELINE_BAND_ROWS) const;
+
+    /**
+     * Runs the stages over an image in a binary matrix file, with runStream, into a new binary matrix file
+     * @param inPath - the path of the image
+     * @param outPath - the path of the result
+     * @param bandRows - the rows of the result produced at a time
+     */
+    void runFile(const std::string& inPath, const std::string& outPath, int bandRows = PIPELINE_BAND_ROWS) const;
+};
+
+#endif //EXERCISE5_FILTERPIPELINE_H
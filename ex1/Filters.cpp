@@ -1,10 +1,25 @@
-#include "Matrix.h"
+#include "Filters.h"
+#include "Convolution.h"
+#include "Quantization.h"
+#include "Stencil.h"
+#include "ThreadPool.h"
 #include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTERS_X86
+#include <immintrin.h>
+#endif
+
 #define CONV_ROWS 3
 #define CONV_COLS 3
+#define FILTER_TAPS (CONV_ROWS * CONV_COLS)
 #define BLUR_CONV_CONST 1.0/16
 #define SOBEL_CONV_CONST 1.0/8
-#define NUM_OF_SHADES 256
+#define BLUR_CONV_SHIFT 4 // BLUR_CONV_CONST as a power of two
+#define SOBEL_CONV_SHIFT 3 // SOBEL_CONV_CONST as a power of two
 #define MAX_SHADE 255
 #define MIN_SHADE 0
 #define BLUR_CONV_0_0 1
@@ -34,6 +49,8 @@
 #define SOBEL_CONV2_2_0 -1
 #define SOBEL_CONV2_2_1 -2
 #define SOBEL_CONV2_2_2 -1
+#define AVX2_SHORTS 16
+#define AVX2_BYTES 32
 
 /**
  * Performs quantization on the input image by the given number of levels.
@@ -41,57 +58,65 @@
  * @param levels - the quantization is performed according to this number of levels
  * @return new matrix which is the result of running the operator on the image
  */
-Matrix quantization(const Matrix& image, int levels)
+Matrix quantization(const MatrixView& image, int levels)
 {
-    int rows = image.getRows();
-    int cols = image.getCols();
-    Matrix quantMat(rows, cols);
-    int range = NUM_OF_SHADES / levels; // the size of each range of shades that will get the same output shade
-    int* newShade = new int[levels]; // array of the new shades
-    // fill output shades
-    newShade[0] = range / 2 - 1;
-    for (int i = 1; i < levels; i++)
-    {
-        newShade[i] = newShade[i - 1] + range;
-    }
+    return quantization(image, QuantTable::uniform(levels));
+}
 
-    // fill output matrix
-    for (int i = 0; i < rows; i++)
-    {
-        for (int j = 0; j < cols; j++)
-        {
-            int intVal = (int)image(i, j) / range; // find range index
-            quantMat(i, j) = (float)newShade[intVal];
-        }
-    }
-    delete [] newShade;
+/**
+ * Performs quantization on the input image through a quantization table
+ * @param image - the matrix on which the quantization will be performed
+ * @param table - the table
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix quantization(const MatrixView& image, const QuantTable& table)
+{
+    Matrix quantMat(image.getRows(), image.getCols());
+    quantization(image, table, quantMat);
     return quantMat;
 }
 
 /**
- * Calculates the value that should be in image[r][c] after convolution
- * @param image - the image we want to perform convolution on
- * @param convMat - the convolution matrix
- * @param r - the row
- * @param c - the column
- * @return the value that should be in image[r][c] after convolution
+ * Performs quantization on the input image through a quantization table, into an existing matrix
+ * @param image - the matrix on which the quantization will be performed
+ * @param table - the table
+ * @param quantMat - the output, of the image dimensions (it may be the image itself)
  */
-float calcConvCell(const Matrix& image, const Matrix& convMat, const int& r, const int& c)
+void quantization(const MatrixView& image, const QuantTable& table, Matrix& quantMat)
 {
-    float sum = 0;
     int rows = image.getRows();
     int cols = image.getCols();
-    for (int i = 0; i < CONV_ROWS; i++)
+    if (quantMat.getRows() != rows || quantMat.getCols() != cols)
     {
-        for (int j = 0; j < CONV_COLS; j++)
+        matrixDimError();
+    }
+    ThreadPool::shared().parallelRows(rows, cols, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
         {
-            if (r + i - 1 >= 0 && r + i - 1 < rows && c + j - 1 >= 0 && c + j - 1 < cols)
+            float* dst = quantMat.getData() + (size_t)i * quantMat.getStride();
+            if (image.hasContiguousRows())
+            {
+                table.apply(image.getData() + (size_t)i * image.getRowStride(), dst, cols);
+                continue;
+            }
+            auto src = image.row(i);
+            for (int j = 0; j < cols; j++)
             {
-                sum += image(r + i - 1, c + j - 1) * convMat(i, j);
+                dst[j] = table[QuantTable::shadeOf(src[j])];
             }
         }
-    }
-    return sum;
+    });
+}
+
+/**
+ * Performs quantization on an image in place, through a quantization table
+ * @param image - the matrix on which the quantization will be performed, overwritten by the result
+ * @param table - the table
+ */
+void quantizeInPlace(Matrix& image, const QuantTable& table)
+{
+    quantization(MatrixView(image), table, image);
 }
 
 /**
@@ -100,20 +125,9 @@ float calcConvCell(const Matrix& image, const Matrix& convMat, const int& r, con
  * @param convMat - the convolution matrix
  * @return new matrix which is the result of running the operator on the image
  */
-Matrix convolution(const Matrix& image, const Matrix& convMat)
+Matrix convolution(const MatrixView& image, const Matrix& convMat)
 {
-    int rows = image.getRows();
-    int cols = image.getCols();
-    Matrix resMat(rows, cols);
-    // perform convolution
-    for (int i = 0; i < rows; i++)
-    {
-        for (int j = 0; j < cols; j++)
-        {
-            resMat(i, j) = rintf(calcConvCell(image, convMat, i, j));
-        }
-    }
-    return resMat;
+    return convolve(image, convMat);
 }
 
 /**
@@ -123,22 +137,190 @@ Matrix convolution(const Matrix& image, const Matrix& convMat)
  */
 void limitVals(Matrix& image)
 {
-    int rows = image.getRows();
+    clampValues(image, MIN_SHADE, MAX_SHADE);
+}
+
+/**
+ * The kernels of the sobel filter, for the gradients convolveGradients returns
+ */
+struct FilterKernels
+{
+    Matrix sobel1;
+    Matrix sobel2;
+};
+
+/**
+ * The blur kernel as a compile-time stencil: the corner weight of the kernel is 1, so its first column and its first
+ * row (over 2^BLUR_CONV_SHIFT) are the factors of the kernel
+ */
+typedef SeparableStencil<StencilTaps<0, BLUR_CONV_0_0, BLUR_CONV_1_0, BLUR_CONV_2_0>,
+                         StencilTaps<BLUR_CONV_SHIFT, BLUR_CONV_0_0, BLUR_CONV_0_1, BLUR_CONV_0_2>> BlurStencil;
+
+/**
+ * The first sobel kernel as a compile-time stencil, factored as the blur one
+ */
+typedef SeparableStencil<StencilTaps<0, SOBEL_CONV1_0_0, SOBEL_CONV1_1_0, SOBEL_CONV1_2_0>,
+                         StencilTaps<SOBEL_CONV_SHIFT, SOBEL_CONV1_0_0, SOBEL_CONV1_0_1, SOBEL_CONV1_0_2>>
+        SobelStencil1;
+
+/**
+ * The second sobel kernel as a compile-time stencil, factored as the blur one
+ */
+typedef SeparableStencil<StencilTaps<0, SOBEL_CONV2_0_0, SOBEL_CONV2_1_0, SOBEL_CONV2_2_0>,
+                         StencilTaps<SOBEL_CONV_SHIFT, SOBEL_CONV2_0_0, SOBEL_CONV2_0_1, SOBEL_CONV2_0_2>>
+        SobelStencil2;
+
+/**
+ * Returns the kernels of the filters, built on the first call from the default allocator (they are kept until the
+ * program ends, so they must not come from the allocator of a scope)
+ * @return the kernels
+ */
+static const FilterKernels& filterKernels()
+{
+    static const FilterKernels kernels = []
+    {
+        MatrixAllocatorScope scope(defaultMatrixAllocator());
+        Matrix convMat1(CONV_ROWS, CONV_COLS);
+        convMat1(0, 0) = SOBEL_CONV1_0_0;
+        convMat1(0, 1) = SOBEL_CONV1_0_1;
+        convMat1(0, 2) = SOBEL_CONV1_0_2;
+        convMat1(1, 0) = SOBEL_CONV1_1_0;
+        convMat1(1, 1) = SOBEL_CONV1_1_1;
+        convMat1(1, 2) = SOBEL_CONV1_1_2;
+        convMat1(2, 0) = SOBEL_CONV1_2_0;
+        convMat1(2, 1) = SOBEL_CONV1_2_1;
+        convMat1(2, 2) = SOBEL_CONV1_2_2;
+        convMat1 *= SOBEL_CONV_CONST;
+
+        Matrix convMat2(CONV_ROWS, CONV_COLS);
+        convMat2(0, 0) = SOBEL_CONV2_0_0;
+        convMat2(0, 1) = SOBEL_CONV2_0_1;
+        convMat2(0, 2) = SOBEL_CONV2_0_2;
+        convMat2(1, 0) = SOBEL_CONV2_1_0;
+        convMat2(1, 1) = SOBEL_CONV2_1_1;
+        convMat2(1, 2) = SOBEL_CONV2_1_2;
+        convMat2(2, 0) = SOBEL_CONV2_2_0;
+        convMat2(2, 1) = SOBEL_CONV2_2_1;
+        convMat2(2, 2) = SOBEL_CONV2_2_2;
+        convMat2 *= SOBEL_CONV_CONST;
+
+        return FilterKernels{convMat1, convMat2};
+    }();
+    return kernels;
+}
+
+/**
+ * Performs gaussian blurring on the input image.
+ * @param image - the image we want to blur
+ * @return new matrix which is the result of the operator on the image
+ */
+Matrix blur(const MatrixView& image)
+{
+    Matrix res(image.getRows(), image.getCols());
+    blur(image, res);
+    return res;
+}
+
+/**
+ * Performs gaussian blurring on the input image, into an existing matrix
+ * @param image - the image we want to blur
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void blur(const MatrixView& image, Matrix& res)
+{
+    convolveStencils<BlurStencil>(image, MIN_SHADE, MAX_SHADE, res);
+}
+
+/**
+ * Performs sobel edge detection on the input image
+ * @param image - the image we want to perform sobel edge detection on
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix sobel(const MatrixView& image)
+{
+    return sobel(image, nullptr, nullptr);
+}
+
+/**
+ * Performs sobel edge detection on the input image, into an existing matrix
+ * @param image - the image we want to perform sobel edge detection on
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void sobel(const MatrixView& image, Matrix& res)
+{
+    convolveStencils<SobelStencil1, SobelStencil2>(image, MIN_SHADE, MAX_SHADE, res);
+}
+
+/**
+ * Performs sobel edge detection on the input image, in one pass over it, and optionally computes the gradient
+ * @param image - the image we want to perform sobel edge detection on
+ * @param magnitude - if not nullptr, set to the magnitude of the gradient at every pixel
+ * @param orientation - if not nullptr, set to the direction of the gradient at every pixel
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix sobel(const MatrixView& image, Matrix* magnitude, Matrix* orientation)
+{
+    if (magnitude == nullptr && orientation == nullptr)
+    {
+        return convolveStencils<SobelStencil1, SobelStencil2>(image, MIN_SHADE, MAX_SHADE);
+    }
+    const FilterKernels& kernels = filterKernels();
     int cols = image.getCols();
-    for (int i = 0; i < rows; i++)
+    // set at the end, the image may be a view of one of them
+    Matrix mag(magnitude != nullptr ? image.getRows() : 0, cols);
+    Matrix angle(orientation != nullptr ? image.getRows() : 0, cols);
+    // every row of the gradient is turned into its magnitude and orientation in the band that computed it
+    Matrix res = convolveGradients(image, kernels.sobel1, kernels.sobel2, MIN_SHADE, MAX_SHADE,
+                                   [&](int i, const float* gx, const float* gy)
     {
-        for (int j = 0; j < cols; j++)
+        if (magnitude != nullptr)
         {
-            if (image(i, j) < MIN_SHADE)
+            float* magRow = mag.getData() + (size_t)i * mag.getStride();
+            for (int j = 0; j < cols; j++)
             {
-                image(i, j) = MIN_SHADE;
+                magRow[j] = std::sqrt(gx[j] * gx[j] + gy[j] * gy[j]);
             }
-            else if (image(i, j) > MAX_SHADE)
+        }
+        if (orientation != nullptr)
+        {
+            float* angleRow = angle.getData() + (size_t)i * angle.getStride();
+            for (int j = 0; j < cols; j++)
             {
-                image(i, j) = MAX_SHADE;
+                angleRow[j] = std::atan2(gy[j], gx[j]);
             }
         }
+    });
+    if (magnitude != nullptr)
+    {
+        *magnitude = std::move(mag);
     }
+    if (orientation != nullptr)
+    {
+        *orientation = std::move(angle);
+    }
+    return res;
+}
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the matrix on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix quantization(const Matrix& image, int levels)
+{
+    return quantization(MatrixView(image), levels);
+}
+
+/**
+ * Performs convolution on the input image
+ * @param image - the image we want to perform convolution on
+ * @param convMat - the convolution matrix
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix convolution(const Matrix& image, const Matrix& convMat)
+{
+    return convolution(MatrixView(image), convMat);
 }
 
 /**
@@ -148,21 +330,7 @@ void limitVals(Matrix& image)
  */
 Matrix blur(const Matrix& image)
 {
-    Matrix convMat(CONV_ROWS, CONV_COLS);
-    convMat(0, 0) = BLUR_CONV_0_0;
-    convMat(0, 1) = BLUR_CONV_0_1;
-    convMat(0, 2) = BLUR_CONV_0_2;
-    convMat(1, 0) = BLUR_CONV_1_0;
-    convMat(1, 1) = BLUR_CONV_1_1;
-    convMat(1, 2) = BLUR_CONV_1_2;
-    convMat(2, 0) = BLUR_CONV_2_0;
-    convMat(2, 1) = BLUR_CONV_2_1;
-    convMat(2, 2) = BLUR_CONV_2_2;
-    convMat *= BLUR_CONV_CONST;
-
-    Matrix res = convolution(image, convMat);
-    limitVals(res);
-    return res;
+    return blur(MatrixView(image));
 }
 
 /**
@@ -172,31 +340,622 @@ Matrix blur(const Matrix& image)
  */
 Matrix sobel(const Matrix& image)
 {
-    Matrix convMat1(CONV_ROWS, CONV_COLS);
-    convMat1(0, 0) = SOBEL_CONV1_0_0;
-    convMat1(0, 1) = SOBEL_CONV1_0_1;
-    convMat1(0, 2) = SOBEL_CONV1_0_2;
-    convMat1(1, 0) = SOBEL_CONV1_1_0;
-    convMat1(1, 1) = SOBEL_CONV1_1_1;
-    convMat1(1, 2) = SOBEL_CONV1_1_2;
-    convMat1(2, 0) = SOBEL_CONV1_2_0;
-    convMat1(2, 1) = SOBEL_CONV1_2_1;
-    convMat1(2, 2) = SOBEL_CONV1_2_2;
-    convMat1 *= SOBEL_CONV_CONST;
-
-    Matrix convMat2(CONV_ROWS, CONV_COLS);
-    convMat2(0, 0) = SOBEL_CONV2_0_0;
-    convMat2(0, 1) = SOBEL_CONV2_0_1;
-    convMat2(0, 2) = SOBEL_CONV2_0_2;
-    convMat2(1, 0) = SOBEL_CONV2_1_0;
-    convMat2(1, 1) = SOBEL_CONV2_1_1;
-    convMat2(1, 2) = SOBEL_CONV2_1_2;
-    convMat2(2, 0) = SOBEL_CONV2_2_0;
-    convMat2(2, 1) = SOBEL_CONV2_2_1;
-    convMat2(2, 2) = SOBEL_CONV2_2_2;
-    convMat2 *= SOBEL_CONV_CONST;
-
-    Matrix res = convolution(image, convMat1) + convolution(image, convMat2);
-    limitVals(res);
+    return sobel(MatrixView(image));
+}
+
+/**
+ * The blur kernel, as integer weights scaled by 2^BLUR_CONV_SHIFT
+ */
+static const int BLUR_WEIGHTS[CONV_ROWS][CONV_COLS] = {{BLUR_CONV_0_0, BLUR_CONV_0_1, BLUR_CONV_0_2},
+                                                       {BLUR_CONV_1_0, BLUR_CONV_1_1, BLUR_CONV_1_2},
+                                                       {BLUR_CONV_2_0, BLUR_CONV_2_1, BLUR_CONV_2_2}};
+
+/**
+ * The first sobel kernel, as integer weights scaled by 2^SOBEL_CONV_SHIFT
+ */
+static const int SOBEL_WEIGHTS1[CONV_ROWS][CONV_COLS] = {{SOBEL_CONV1_0_0, SOBEL_CONV1_0_1, SOBEL_CONV1_0_2},
+                                                         {SOBEL_CONV1_1_0, SOBEL_CONV1_1_1, SOBEL_CONV1_1_2},
+                                                         {SOBEL_CONV1_2_0, SOBEL_CONV1_2_1, SOBEL_CONV1_2_2}};
+
+/**
+ * The second sobel kernel, as integer weights scaled by 2^SOBEL_CONV_SHIFT
+ */
+static const int SOBEL_WEIGHTS2[CONV_ROWS][CONV_COLS] = {{SOBEL_CONV2_0_0, SOBEL_CONV2_0_1, SOBEL_CONV2_0_2},
+                                                         {SOBEL_CONV2_1_0, SOBEL_CONV2_1_1, SOBEL_CONV2_1_2},
+                                                         {SOBEL_CONV2_2_0, SOBEL_CONV2_2_1, SOBEL_CONV2_2_2}};
+
+/**
+ * The type the filters accumulate in for an element type. Integer images are summed exactly in int, which gives
+ * the same result as filtering them as floats (every partial sum is a small multiple of a power of two).
+ * @tparam T - the element type
+ */
+template <typename T>
+struct FilterAccum
+{
+    typedef int type;
+};
+
+template <>
+struct FilterAccum<double>
+{
+    typedef double type;
+};
+
+/**
+ * Divides an exact sum by 2^shift and rounds it to the nearest integer, ties to even as rintf does
+ * @param sum - the sum
+ * @param shift - the power of two
+ * @return the rounded quotient
+ */
+static int roundShift(int sum, int shift)
+{
+    int q = sum >> shift; // rounds towards minus infinity, negative sums included
+    int rem = sum - q * (1 << shift);
+    int half = 1 << (shift - 1);
+    if (rem > half || (rem == half && (q & 1)))
+    {
+        q++;
+    }
+    return q;
+}
+
+/**
+ * Divides a sum by 2^shift and rounds it to the nearest integer, ties to even
+ * @param sum - the sum
+ * @param shift - the power of two
+ * @return the rounded quotient
+ */
+static double roundShift(double sum, int shift)
+{
+    return std::rint(std::ldexp(sum, -shift));
+}
+
+/**
+ * Calculates the weighted sum of the 3x3 neighbourhood of image[r][c] (pixels outside the image count as 0)
+ * @param image - the image
+ * @param weights - the kernel weights
+ * @param r - the row
+ * @param c - the column
+ * @return the weighted sum
+ */
+template <typename Acc, typename T>
+static Acc weightedSum(const BasicMatrix<T>& image, const int weights[CONV_ROWS][CONV_COLS], int r, int c)
+{
+    Acc sum = 0;
+    for (int i = 0; i < CONV_ROWS; i++)
+    {
+        for (int j = 0; j < CONV_COLS; j++)
+        {
+            if (r + i - 1 >= 0 && r + i - 1 < image.getRows() && c + j - 1 >= 0 && c + j - 1 < image.getCols())
+            {
+                sum += (Acc)image.getData()[(size_t)(r + i - 1) * image.getStride() + c + j - 1] * weights[i][j];
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * Sets a value to be in the range of shades, as limitVals does
+ * @param val - the value
+ * @return the value, limited to [MIN_SHADE, MAX_SHADE]
+ */
+template <typename Acc>
+static Acc limitVal(Acc val)
+{
+    return val < MIN_SHADE ? MIN_SHADE : (val > MAX_SHADE ? MAX_SHADE : val);
+}
+
+/**
+ * Performs quantization on an image of any element type through a quantization table
+ * @param image - the image
+ * @param table - the table
+ * @return new image of the same element type
+ */
+template <typename T>
+static BasicMatrix<T> quantizationOf(const BasicMatrix<T>& image, const QuantTable& table)
+{
+    BasicMatrix<T> quantMat(image.getRows(), image.getCols());
+    T newShade[QUANT_NUM_SHADES]; // the table, in the element type
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        newShade[shade] = saturateCast<T>(table[shade]);
+    }
+
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols(), [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const T* src = image.getData() + (size_t)i * image.getStride();
+            T* dst = quantMat.getData() + (size_t)i * quantMat.getStride();
+            for (int j = 0; j < image.getCols(); j++)
+            {
+                dst[j] = newShade[QuantTable::shadeOf((double)src[j])];
+            }
+        }
+    });
+    return quantMat;
+}
+
+/**
+ * Performs gaussian blurring on an image of any element type
+ * @param image - the image
+ * @return new image of the same element type
+ */
+template <typename T>
+static BasicMatrix<T> blurOf(const BasicMatrix<T>& image)
+{
+    typedef typename FilterAccum<T>::type Acc;
+    BasicMatrix<T> res(image.getRows(), image.getCols());
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols() * FILTER_TAPS, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            T* dst = res.getData() + (size_t)i * res.getStride();
+            for (int j = 0; j < image.getCols(); j++)
+            {
+                Acc sum = weightedSum<Acc>(image, BLUR_WEIGHTS, i, j);
+                dst[j] = saturateCast<T>(limitVal(roundShift(sum, BLUR_CONV_SHIFT)));
+            }
+        }
+    });
     return res;
+}
+
+/**
+ * Performs sobel edge detection on an image of any element type
+ * @param image - the image
+ * @return new image of the same element type
+ */
+template <typename T>
+static BasicMatrix<T> sobelOf(const BasicMatrix<T>& image)
+{
+    typedef typename FilterAccum<T>::type Acc;
+    BasicMatrix<T> res(image.getRows(), image.getCols());
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols() * 2 * FILTER_TAPS, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            T* dst = res.getData() + (size_t)i * res.getStride();
+            for (int j = 0; j < image.getCols(); j++)
+            {
+                Acc edge = roundShift(weightedSum<Acc>(image, SOBEL_WEIGHTS1, i, j), SOBEL_CONV_SHIFT) +
+                           roundShift(weightedSum<Acc>(image, SOBEL_WEIGHTS2, i, j), SOBEL_CONV_SHIFT);
+                dst[j] = saturateCast<T>(limitVal(edge));
+            }
+        }
+    });
+    return res;
+}
+
+/**
+ * A byte row kernel filters a row of an 8-bit image from the rows around it. Both 3x3 kernels split into a column
+ * pass and a row pass: the blur is (1, 2, 1) down the columns then (1, 2, 1) along the row, the first sobel kernel
+ * (1, 2, 1) down the columns then (1, 0, -1) along the row, and the second (1, 0, -1) down the columns then
+ * (1, 2, 1) along the row. The column sums of a row fit in int16 and so do the full sums (at most 16 * 255).
+ * @param above - the row above (zeros for the first row)
+ * @param row - the row
+ * @param below - the row below (zeros for the last row)
+ * @param out - the output row
+ * @param cols - num of pixels in a row
+ * @param sums - scratch of cols + 2 elements, the first and the last of them 0
+ * @param diffs - scratch of cols + 2 elements, the first and the last of them 0
+ */
+typedef void (*ByteRowFn)(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int cols,
+                          int16_t* sums, int16_t* diffs);
+
+/**
+ * This struct describes the byte row kernels of one instruction set
+ */
+struct ByteFilterKernels
+{
+    const char* name;
+    ByteRowFn blur;
+    ByteRowFn sobel;
+};
+
+/**
+ * Portable blur row kernel, also used for the tails of the AVX2 kernel
+ * @param above - the row above
+ * @param row - the row
+ * @param below - the row below
+ * @param out - the output row
+ * @param cols - num of pixels in a row
+ * @param sums - scratch of cols + 2 elements, the first and the last of them 0
+ */
+static void blurRowBytesScalar(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out,
+                               int cols, int16_t* sums, int16_t*)
+{
+    for (int j = 0; j < cols; j++)
+    {
+        sums[j + 1] = (int16_t)(above[j] + 2 * row[j] + below[j]);
+    }
+    for (int j = 0; j < cols; j++)
+    {
+        out[j] = (uint8_t)limitVal(roundShift(sums[j] + 2 * sums[j + 1] + sums[j + 2], BLUR_CONV_SHIFT));
+    }
+}
+
+/**
+ * Portable sobel row kernel, also used for the tails of the AVX2 kernel
+ * @param above - the row above
+ * @param row - the row
+ * @param below - the row below
+ * @param out - the output row
+ * @param cols - num of pixels in a row
+ * @param sums - scratch of cols + 2 elements, the first and the last of them 0
+ * @param diffs - scratch of cols + 2 elements, the first and the last of them 0
+ */
+static void sobelRowBytesScalar(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out,
+                                int cols, int16_t* sums, int16_t* diffs)
+{
+    for (int j = 0; j < cols; j++)
+    {
+        sums[j + 1] = (int16_t)(above[j] + 2 * row[j] + below[j]);
+        diffs[j + 1] = (int16_t)(above[j] - below[j]);
+    }
+    for (int j = 0; j < cols; j++)
+    {
+        int gx = sums[j] - sums[j + 2];
+        int gy = diffs[j] + 2 * diffs[j + 1] + diffs[j + 2];
+        out[j] = (uint8_t)limitVal(roundShift(gx, SOBEL_CONV_SHIFT) + roundShift(gy, SOBEL_CONV_SHIFT));
+    }
+}
+
+#ifdef FILTERS_X86
+
+/**
+ * Divides 16 exact sums by 2^shift and rounds them to the nearest integer, ties to even, as roundShift does:
+ * adding half - 1 and the lowest bit of the quotient carries into the quotient exactly when it has to round up
+ * @param sum - the sums
+ * @param shift - the power of two
+ * @return the rounded quotients
+ */
+__attribute__((target("avx2")))
+static inline __m256i roundShiftAvx2(__m256i sum, int shift)
+{
+    __m256i odd = _mm256_and_si256(_mm256_srai_epi16(sum, shift), _mm256_set1_epi16(1));
+    __m256i bias = _mm256_add_epi16(odd, _mm256_set1_epi16((int16_t)((1 << (shift - 1)) - 1)));
+    return _mm256_srai_epi16(_mm256_add_epi16(sum, bias), shift);
+}
+
+/**
+ * Loads 16 pixels widened to int16
+ * @param pixels - the pixels
+ * @return the pixels, in 16 lanes
+ */
+__attribute__((target("avx2")))
+static inline __m256i loadBytesAvx2(const uint8_t* pixels)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)pixels));
+}
+
+/**
+ * Packs 32 values to bytes with unsigned saturation (which limits them to [MIN_SHADE, MAX_SHADE]) and stores them
+ * @param out - the output pixels
+ * @param lo - the first 16 values
+ * @param hi - the last 16 values
+ */
+__attribute__((target("avx2")))
+static inline void storeBytesAvx2(uint8_t* out, __m256i lo, __m256i hi)
+{
+    // the pack works within 128-bit lanes, the permute puts the quarters back in order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i*)out, packed);
+}
+
+/**
+ * AVX2 blur row kernel, 16 column sums and 32 output pixels at a time
+ * @param above - the row above
+ * @param row - the row
+ * @param below - the row below
+ * @param out - the output row
+ * @param cols - num of pixels in a row
+ * @param sums - scratch of cols + 2 elements, the first and the last of them 0
+ */
+__attribute__((target("avx2")))
+static void blurRowBytesAvx2(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out,
+                             int cols, int16_t* sums, int16_t*)
+{
+    int j = 0;
+    for (; j + AVX2_SHORTS <= cols; j += AVX2_SHORTS)
+    {
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(loadBytesAvx2(above + j), loadBytesAvx2(below + j)),
+                                       _mm256_slli_epi16(loadBytesAvx2(row + j), 1));
+        _mm256_storeu_si256((__m256i*)(sums + j + 1), sum);
+    }
+    for (; j < cols; j++)
+    {
+        sums[j + 1] = (int16_t)(above[j] + 2 * row[j] + below[j]);
+    }
+    j = 0;
+    for (; j + AVX2_BYTES <= cols; j += AVX2_BYTES)
+    {
+        __m256i half[2];
+        for (int k = 0; k < 2; k++)
+        {
+            const int16_t* s = sums + j + k * AVX2_SHORTS;
+            __m256i left = _mm256_loadu_si256((const __m256i*)s);
+            __m256i mid = _mm256_loadu_si256((const __m256i*)(s + 1));
+            __m256i right = _mm256_loadu_si256((const __m256i*)(s + 2));
+            __m256i sum = _mm256_add_epi16(_mm256_add_epi16(left, right), _mm256_slli_epi16(mid, 1));
+            half[k] = roundShiftAvx2(sum, BLUR_CONV_SHIFT);
+        }
+        storeBytesAvx2(out + j, half[0], half[1]);
+    }
+    for (; j < cols; j++)
+    {
+        out[j] = (uint8_t)limitVal(roundShift(sums[j] + 2 * sums[j + 1] + sums[j + 2], BLUR_CONV_SHIFT));
+    }
+}
+
+/**
+ * AVX2 sobel row kernel, 16 column sums and 32 output pixels at a time
+ * @param above - the row above
+ * @param row - the row
+ * @param below - the row below
+ * @param out - the output row
+ * @param cols - num of pixels in a row
+ * @param sums - scratch of cols + 2 elements, the first and the last of them 0
+ * @param diffs - scratch of cols + 2 elements, the first and the last of them 0
+ */
+__attribute__((target("avx2")))
+static void sobelRowBytesAvx2(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out,
+                              int cols, int16_t* sums, int16_t* diffs)
+{
+    int j = 0;
+    for (; j + AVX2_SHORTS <= cols; j += AVX2_SHORTS)
+    {
+        __m256i up = loadBytesAvx2(above + j);
+        __m256i down = loadBytesAvx2(below + j);
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(up, down), _mm256_slli_epi16(loadBytesAvx2(row + j), 1));
+        _mm256_storeu_si256((__m256i*)(sums + j + 1), sum);
+        _mm256_storeu_si256((__m256i*)(diffs + j + 1), _mm256_sub_epi16(up, down));
+    }
+    for (; j < cols; j++)
+    {
+        sums[j + 1] = (int16_t)(above[j] + 2 * row[j] + below[j]);
+        diffs[j + 1] = (int16_t)(above[j] - below[j]);
+    }
+    j = 0;
+    for (; j + AVX2_BYTES <= cols; j += AVX2_BYTES)
+    {
+        __m256i half[2];
+        for (int k = 0; k < 2; k++)
+        {
+            const int16_t* s = sums + j + k * AVX2_SHORTS;
+            const int16_t* d = diffs + j + k * AVX2_SHORTS;
+            __m256i gx = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)s),
+                                          _mm256_loadu_si256((const __m256i*)(s + 2)));
+            __m256i gy = _mm256_add_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)d),
+                                                           _mm256_loadu_si256((const __m256i*)(d + 2))),
+                                          _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(d + 1)), 1));
+            half[k] = _mm256_add_epi16(roundShiftAvx2(gx, SOBEL_CONV_SHIFT), roundShiftAvx2(gy, SOBEL_CONV_SHIFT));
+        }
+        storeBytesAvx2(out + j, half[0], half[1]);
+    }
+    for (; j < cols; j++)
+    {
+        int gx = sums[j] - sums[j + 2];
+        int gy = diffs[j] + 2 * diffs[j + 1] + diffs[j + 2];
+        out[j] = (uint8_t)limitVal(roundShift(gx, SOBEL_CONV_SHIFT) + roundShift(gy, SOBEL_CONV_SHIFT));
+    }
+}
+
+#endif //FILTERS_X86
+
+/**
+ * Lists the byte row kernels the running cpu supports
+ * @return the byte row kernels, the widest first
+ */
+static std::vector<ByteFilterKernels> supportedByteKernels()
+{
+    std::vector<ByteFilterKernels> kernels;
+#ifdef FILTERS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.push_back({"avx2", blurRowBytesAvx2, sobelRowBytesAvx2});
+    }
+#endif
+    kernels.push_back({"scalar", blurRowBytesScalar, sobelRowBytesScalar});
+    return kernels;
+}
+
+/**
+ * Returns the byte row kernels in use, the widest the cpu supports unless useByteFilterKernel picked others
+ * @return the byte row kernels
+ */
+static ByteFilterKernels& selectByteKernels()
+{
+    static ByteFilterKernels kernels = supportedByteKernels().front();
+    return kernels;
+}
+
+/**
+ * Returns the name of the row kernels the 8-bit blur and sobel dispatch to on this cpu
+ * @return "avx2" or "scalar"
+ */
+const char* byteFilterKernelName()
+{
+    return selectByteKernels().name;
+}
+
+/**
+ * Makes the 8-bit blur and sobel dispatch to row kernels the cpu supports instead of the widest ones
+ * @param name - "avx2" or "scalar"
+ * @return true if the cpu supports the kernels (otherwise the kernels are not changed)
+ */
+bool useByteFilterKernel(const char* name)
+{
+    for (const ByteFilterKernels& kernels : supportedByteKernels())
+    {
+        if (std::strcmp(kernels.name, name) == 0)
+        {
+            selectByteKernels() = kernels;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs a byte row kernel over every row of an 8-bit image
+ * @param image - the image
+ * @param rowFn - the row kernel
+ * @param rowWork - the work of a row, for cutting the image into bands
+ * @return new 8-bit image which is the result of the kernel on the image
+ */
+static ByteMatrix filterBytes(const ByteMatrix& image, ByteRowFn rowFn, long long rowWork)
+{
+    int rows = image.getRows();
+    int cols = image.getCols();
+    ByteMatrix res(rows, cols);
+    std::vector<uint8_t> zeros(cols, 0); // the rows beyond the image
+    ThreadPool& pool = ThreadPool::shared();
+    size_t scratchSize = (size_t)cols + 2;
+    std::vector<int16_t> scratch(2 * scratchSize * pool.getNumThreads(), 0); // the sums and diffs of every worker
+    pool.parallelRows(rows, rowWork, [&](int begin, int end, int worker)
+    {
+        int16_t* sums = scratch.data() + 2 * scratchSize * worker;
+        int16_t* diffs = sums + scratchSize;
+        for (int i = begin; i < end; i++)
+        {
+            const uint8_t* row = image.getData() + (size_t)i * image.getStride();
+            const uint8_t* above = i > 0 ? row - image.getStride() : zeros.data();
+            const uint8_t* below = i < rows - 1 ? row + image.getStride() : zeros.data();
+            rowFn(above, row, below, res.getData() + (size_t)i * res.getStride(), cols, sums, diffs);
+        }
+    });
+    return res;
+}
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the 8-bit image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix quantization(const ByteMatrix& image, int levels)
+{
+    return quantization(image, QuantTable::uniform(levels));
+}
+
+/**
+ * Performs quantization on the input image through a quantization table
+ * @param image - the 8-bit image on which the quantization will be performed
+ * @param table - the table
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix quantization(const ByteMatrix& image, const QuantTable& table)
+{
+    ByteMatrix quantMat(image.getRows(), image.getCols());
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols(), [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            table.apply(image.getData() + (size_t)i * image.getStride(),
+                        quantMat.getData() + (size_t)i * quantMat.getStride(), image.getCols());
+        }
+    });
+    return quantMat;
+}
+
+/**
+ * Performs quantization on an 8-bit image in place, through a quantization table
+ * @param image - the 8-bit image on which the quantization will be performed, overwritten by the result
+ * @param table - the table
+ */
+void quantizeInPlace(ByteMatrix& image, const QuantTable& table)
+{
+    ThreadPool::shared().parallelRows(image.getRows(), image.getCols(), [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            uint8_t* row = image.getData() + (size_t)i * image.getStride();
+            table.apply(row, row, image.getCols());
+        }
+    });
+}
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the 16-bit image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new 16-bit image which is the result of running the operator on the image
+ */
+ShortMatrix quantization(const ShortMatrix& image, int levels)
+{
+    return quantizationOf(image, QuantTable::uniform(levels));
+}
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the double image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new double image which is the result of running the operator on the image
+ */
+DoubleMatrix quantization(const DoubleMatrix& image, int levels)
+{
+    return quantizationOf(image, QuantTable::uniform(levels));
+}
+
+/**
+ * Performs gaussian blurring on the input image.
+ * @param image - the 8-bit image we want to blur
+ * @return new 8-bit image which is the result of the operator on the image
+ */
+ByteMatrix blur(const ByteMatrix& image)
+{
+    return filterBytes(image, selectByteKernels().blur, image.getCols());
+}
+
+/**
+ * Performs gaussian blurring on the input image.
+ * @param image - the 16-bit image we want to blur
+ * @return new 16-bit image which is the result of the operator on the image
+ */
+ShortMatrix blur(const ShortMatrix& image)
+{
+    return blurOf(image);
+}
+
+/**
+ * Performs gaussian blurring on the input image.
+ * @param image - the double image we want to blur
+ * @return new double image which is the result of the operator on the image
+ */
+DoubleMatrix blur(const DoubleMatrix& image)
+{
+    return blurOf(image);
+}
+
+/**
+ * Performs sobel edge detection on the input image
+ * @param image - the 8-bit image we want to perform sobel edge detection on
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix sobel(const ByteMatrix& image)
+{
+    return filterBytes(image, selectByteKernels().sobel, 2 * image.getCols());
+}
+
+/**
+ * Performs sobel edge detection on the input image
+ * @param image - the 16-bit image we want to perform sobel edge detection on
+ * @return new 16-bit image which is the result of running the operator on the image
+ */
+ShortMatrix sobel(const ShortMatrix& image)
+{
+    return sobelOf(image);
+}
+
+/**
+ * Performs sobel edge detection on the input image
+ * @param image - the double image we want to perform sobel edge detection on
+ * @return new double image which is the result of running the operator on the image
+ */
+DoubleMatrix sobel(const DoubleMatrix& image)
+{
+    return sobelOf(image);
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+#ifndef EXERCISE5_FILTERS_H
+#define EXERCISE5_FILTERS_H
+
+#include "Matrix.h"
+#include "Quantization.h"
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the matrix (or a region of it) on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix quantization(const MatrixView& image, int levels);
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the matrix on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix quantization(const Matrix& image, int levels);
+
+/**
+ * Performs quantization on the input image through a quantization table (see QuantTable for uniform, equalized
+ * and custom levels)
+ * @param image - the matrix (or a region of it) on which the quantization will be performed
+ * @param table - the table
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix quantization(const MatrixView& image, const QuantTable& table);
+
+/**
+ * Performs quantization on the input image through a quantization table, into an existing matrix
+ * @param image - the matrix (or a region of it) on which the quantization will be performed
+ * @param table - the table
+ * @param quantMat - the output, of the image dimensions (it may be the image itself)
+ */
+void quantization(const MatrixView& image, const QuantTable& table, Matrix& quantMat);
+
+/**
+ * Performs quantization on an image in place, through a quantization table, without allocating an output
+ * @param image - the matrix on which the quantization will be performed, overwritten by the result
+ * @param table - the table
+ */
+void quantizeInPlace(Matrix& image, const QuantTable& table);
+
+/**
+ * Performs convolution on the input image
+ * @param image - the image (or a region of it) we want to perform convolution on
+ * @param convMat - the convolution matrix, of odd dimensions
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix convolution(const MatrixView& image, const Matrix& convMat);
+
+/**
+ * Performs convolution on the input image
+ * @param image - the image we want to perform convolution on
+ * @param convMat - the convolution matrix, of odd dimensions
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix convolution(const Matrix& image, const Matrix& convMat);
+
+/**
+ * This function checks if the values in the image are out of limits (smaller than 0 or larger than 255). if yes,
+ * sets the values to be in the right range.
+ * @param image - the image we are working on
+ */
+void limitVals(Matrix& image);
+
+/**
+ * Performs gaussian blurring on the input image.
+ * The kernel runs as two 1-D passes, on fractional pixels a result may differ by 1 from summing the nine taps in
+ * order (see convolve), on integer pixels it is the same.
+ * @param image - the image (or a region of it) we want to blur
+ * @return new matrix which is the result of the operator on the image
+ */
+Matrix blur(const MatrixView& image);
+
+/**
+ * Performs gaussian blurring on the input image.
+ * @param image - the image we want to blur
+ * @return new matrix which is the result of the operator on the image
+ */
+Matrix blur(const Matrix& image);
+
+/**
+ * Performs gaussian blurring on the input image, into an existing matrix (a caller filtering many images of one
+ * size allocates the output once)
+ * @param image - the image (or a region of it) we want to blur
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void blur(const MatrixView& image, Matrix& res);
+
+/**
+ * Performs sobel edge detection on the input image.
+ * Both kernels run as two 1-D passes, so on fractional pixels a result may differ by 1 as blur's does.
+ * @param image - the image (or a region of it) we want to perform sobel edge detection on
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix sobel(const MatrixView& image);
+
+/**
+ * Performs sobel edge detection on the input image, in one pass over it, and optionally computes the gradient:
+ * gx and gy are the responses to the two sobel kernels (not rounded), the magnitude is sqrt(gx^2 + gy^2) and the
+ * orientation atan2(gy, gx), in radians in [-pi, pi]
+ * @param image - the image (or a region of it) we want to perform sobel edge detection on
+ * @param magnitude - if not nullptr, set to the magnitude of the gradient at every pixel
+ * @param orientation - if not nullptr, set to the direction of the gradient at every pixel
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix sobel(const MatrixView& image, Matrix* magnitude, Matrix* orientation);
+
+/**
+ * Performs sobel edge detection on the input image
+ * @param image - the image we want to perform sobel edge detection on
+ * @return new matrix which is the result of running the operator on the image
+ */
+Matrix sobel(const Matrix& image);
+
+/**
+ * Performs sobel edge detection on the input image, into an existing matrix
+ * @param image - the image (or a region of it) we want to perform sobel edge detection on
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+void sobel(const MatrixView& image, Matrix& res);
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the 8-bit image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix quantization(const ByteMatrix& image, int levels);
+
+/**
+ * Performs quantization on the input image through a quantization table
+ * @param image - the 8-bit image on which the quantization will be performed
+ * @param table - the table
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix quantization(const ByteMatrix& image, const QuantTable& table);
+
+/**
+ * Performs quantization on an 8-bit image in place, through a quantization table, without allocating an output
+ * @param image - the 8-bit image on which the quantization will be performed, overwritten by the result
+ * @param table - the table
+ */
+void quantizeInPlace(ByteMatrix& image, const QuantTable& table);
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the 16-bit image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new 16-bit image which is the result of running the operator on the image
+ */
+ShortMatrix quantization(const ShortMatrix& image, int levels);
+
+/**
+ * Performs quantization on the input image by the given number of levels.
+ * @param image - the double image on which the quantization will be performed
+ * @param levels - the quantization is performed according to this number of levels
+ * @return new double image which is the result of running the operator on the image
+ */
+DoubleMatrix quantization(const DoubleMatrix& image, int levels);
+
+/**
+ * Performs gaussian blurring on the input image, summing in integers (the same result as the float blur, bit for
+ * bit). The kernel is applied as a column pass and a row pass in int16, the division by 16 is a rounding shift and
+ * the result is packed back to bytes with saturation, 32 pixels at a time with AVX2 when the cpu has it.
+ * @param image - the 8-bit image we want to blur
+ * @return new 8-bit image which is the result of the operator on the image
+ */
+ByteMatrix blur(const ByteMatrix& image);
+
+/**
+ * Performs gaussian blurring on the input image, summing in integers (the same result as the float blur).
+ * @param image - the 16-bit image we want to blur
+ * @return new 16-bit image which is the result of the operator on the image
+ */
+ShortMatrix blur(const ShortMatrix& image);
+
+/**
+ * Performs gaussian blurring on the input image, summing in double precision.
+ * @param image - the double image we want to blur
+ * @return new double image which is the result of the operator on the image
+ */
+DoubleMatrix blur(const DoubleMatrix& image);
+
+/**
+ * Performs sobel edge detection on the input image, summing in integers (the same result as the float sobel, bit
+ * for bit), in int16 and 32 pixels at a time with AVX2 as the 8-bit blur
+ * @param image - the 8-bit image we want to perform sobel edge detection on
+ * @return new 8-bit image which is the result of running the operator on the image
+ */
+ByteMatrix sobel(const ByteMatrix& image);
+
+/**
+ * Performs sobel edge detection on the input image, summing in integers (the same result as the float sobel)
+ * @param image - the 16-bit image we want to perform sobel edge detection on
+ * @return new 16-bit image which is the result of running the operator on the image
+ */
+ShortMatrix sobel(const ShortMatrix& image);
+
+/**
+ * Performs sobel edge detection on the input image, summing in double precision
+ * @param image - the double image we want to perform sobel edge detection on
+ * @return new double image which is the result of running the operator on the image
+ */
+DoubleMatrix sobel(const DoubleMatrix& image);
+
+/**
+ * Returns the name of the row kernels the 8-bit blur and sobel dispatch to on this cpu
+ * @return "avx2" or "scalar"
+ */
+const char* byteFilterKernelName();
+
+/**
+ * Makes the 8-bit blur and sobel dispatch to row kernels the cpu supports instead of the widest ones, so the kernels
+ * can be compared on one machine; it must not be called while an 8-bit image is being filtered
+ * @param name - "avx2" or "scalar"
+ * @return true if the cpu supports the kernels (otherwise the kernels are not changed)
+ */
+bool useByteFilterKernel(const char* name);
+
+#endif //EXERCISE5_FILTERS_H
\ No newline at end of file
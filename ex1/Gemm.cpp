@@ -0,0 +1,324 @@
+#include "Gemm.h"
+#include "MatrixAlloc.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86
+#include <immintrin.h>
+#endif
+
+#define GEMM_ALIGNMENT 64
+#define SCALAR_MR 4
+#define SCALAR_NR 8
+#define AVX2_MR 6
+#define AVX2_NR 16
+#define AVX512_MR 8
+#define AVX512_NR 32
+#define MAX_MR 8
+#define MAX_NR 32
+
+/**
+ * A micro-kernel computes c[MR][NR] += packedA[kc][MR] * packedB[kc][NR]
+ */
+typedef void (*MicroKernel)(int kc, const float* pa, const float* pb, float* c, int ldc);
+
+/**
+ * This struct describes a micro-kernel and the register tile it works on
+ */
+struct GemmKernel
+{
+    const char* name;
+    int mr, nr;
+    MicroKernel fn;
+};
+
+/**
+ * Portable micro-kernel, written so the compiler can keep the tile in registers
+ */
+static void kernelScalar(int kc, const float* pa, const float* pb, float* c, int ldc)
+{
+    float acc[SCALAR_MR][SCALAR_NR] = {};
+    for (int p = 0; p < kc; p++)
+    {
+        for (int i = 0; i < SCALAR_MR; i++)
+        {
+            float ai = pa[i];
+            for (int j = 0; j < SCALAR_NR; j++)
+            {
+                acc[i][j] += ai * pb[j];
+            }
+        }
+        pa += SCALAR_MR;
+        pb += SCALAR_NR;
+    }
+    for (int i = 0; i < SCALAR_MR; i++)
+    {
+        for (int j = 0; j < SCALAR_NR; j++)
+        {
+            c[(size_t)i * ldc + j] += acc[i][j];
+        }
+    }
+}
+
+#ifdef GEMM_X86
+
+/**
+ * AVX2 + FMA micro-kernel, a 6x16 tile held in 12 ymm accumulators
+ */
+__attribute__((target("avx2,fma")))
+static void kernelAvx2(int kc, const float* pa, const float* pb, float* c, int ldc)
+{
+    __m256 acc[AVX2_MR][2];
+    for (int i = 0; i < AVX2_MR; i++)
+    {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int p = 0; p < kc; p++)
+    {
+        __m256 b0 = _mm256_load_ps(pb);
+        __m256 b1 = _mm256_load_ps(pb + 8);
+        for (int i = 0; i < AVX2_MR; i++)
+        {
+            __m256 ai = _mm256_broadcast_ss(pa + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        pa += AVX2_MR;
+        pb += AVX2_NR;
+    }
+    for (int i = 0; i < AVX2_MR; i++)
+    {
+        float* row = c + (size_t)i * ldc;
+        _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[i][0]));
+        _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[i][1]));
+    }
+}
+
+/**
+ * AVX-512 micro-kernel, an 8x32 tile held in 16 zmm accumulators
+ */
+__attribute__((target("avx512f")))
+static void kernelAvx512(int kc, const float* pa, const float* pb, float* c, int ldc)
+{
+    __m512 acc[AVX512_MR][2];
+    for (int i = 0; i < AVX512_MR; i++)
+    {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+    for (int p = 0; p < kc; p++)
+    {
+        __m512 b0 = _mm512_load_ps(pb);
+        __m512 b1 = _mm512_load_ps(pb + 16);
+        for (int i = 0; i < AVX512_MR; i++)
+        {
+            __m512 ai = _mm512_set1_ps(pa[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        pa += AVX512_MR;
+        pb += AVX512_NR;
+    }
+    for (int i = 0; i < AVX512_MR; i++)
+    {
+        float* row = c + (size_t)i * ldc;
+        _mm512_storeu_ps(row, _mm512_add_ps(_mm512_loadu_ps(row), acc[i][0]));
+        _mm512_storeu_ps(row + 16, _mm512_add_ps(_mm512_loadu_ps(row + 16), acc[i][1]));
+    }
+}
+
+#endif //GEMM_X86
+
+/**
+ * Picks the widest micro-kernel the running cpu supports
+ * @return the micro-kernel description
+ */
+static GemmKernel detectKernel()
+{
+#ifdef GEMM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return {"avx512", AVX512_MR, AVX512_NR, kernelAvx512};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return {"avx2", AVX2_MR, AVX2_NR, kernelAvx2};
+    }
+#endif
+    return {"scalar", SCALAR_MR, SCALAR_NR, kernelScalar};
+}
+
+/**
+ * Returns the micro-kernel for this cpu, detected once
+ * @return the micro-kernel description
+ */
+static const GemmKernel& selectKernel()
+{
+    static const GemmKernel kernel = detectKernel();
+    return kernel;
+}
+
+/**
+ * Packs an mc*kc block of A into slivers of mr rows, each stored column by column (zero padded)
+ */
+static void packA(int mc, int kc, const float* a, int lda, int mr, float* dst)
+{
+    for (int ir = 0; ir < mc; ir += mr)
+    {
+        int rows = std::min(mr, mc - ir);
+        for (int p = 0; p < kc; p++)
+        {
+            for (int i = 0; i < rows; i++)
+            {
+                dst[i] = a[(size_t)(ir + i) * lda + p];
+            }
+            for (int i = rows; i < mr; i++)
+            {
+                dst[i] = 0;
+            }
+            dst += mr;
+        }
+    }
+}
+
+/**
+ * Packs a kc*nc block of B into slivers of nr cols, each stored row by row (zero padded)
+ */
+static void packB(int kc, int nc, const float* b, int ldb, int nr, float* dst)
+{
+    for (int jr = 0; jr < nc; jr += nr)
+    {
+        int cols = std::min(nr, nc - jr);
+        for (int p = 0; p < kc; p++)
+        {
+            std::memcpy(dst, b + (size_t)p * ldb + jr, cols * sizeof(float));
+            std::memset(dst + cols, 0, (nr - cols) * sizeof(float));
+            dst += nr;
+        }
+    }
+}
+
+/**
+ * Multiplies a packed mc*kc block of A by a packed kc*nc block of B into c, tile by tile
+ */
+static void macroKernel(int mc, int nc, int kc, const float* pa, const float* pb, float* c, int ldc,
+                        const GemmKernel& ker)
+{
+    alignas(GEMM_ALIGNMENT) float tile[MAX_MR * MAX_NR];
+    for (int jr = 0; jr < nc; jr += ker.nr)
+    {
+        int cols = std::min(ker.nr, nc - jr);
+        for (int ir = 0; ir < mc; ir += ker.mr)
+        {
+            int rows = std::min(ker.mr, mc - ir);
+            const float* a = pa + (size_t)ir * kc;
+            const float* b = pb + (size_t)jr * kc;
+            float* out = c + (size_t)ir * ldc + jr;
+            if (rows == ker.mr && cols == ker.nr)
+            {
+                ker.fn(kc, a, b, out, ldc);
+                continue;
+            }
+            // edge tile: run the full kernel on a scratch tile and keep only the valid part
+            std::memset(tile, 0, sizeof(tile));
+            ker.fn(kc, a, b, tile, ker.nr);
+            for (int i = 0; i < rows; i++)
+            {
+                for (int j = 0; j < cols; j++)
+                {
+                    out[(size_t)i * ldc + j] += tile[i * ker.nr + j];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Row oriented product for small sizes, every inner loop walks rows of b and c contiguously
+ */
+static void smallGemm(int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc)
+{
+    for (int i = 0; i < m; i++)
+    {
+        float* cRow = c + (size_t)i * ldc;
+        for (int p = 0; p < k; p++)
+        {
+            float aip = a[(size_t)i * lda + p];
+            const float* bRow = b + (size_t)p * ldb;
+            for (int j = 0; j < n; j++)
+            {
+                cRow[j] += aip * bRow[j];
+            }
+        }
+    }
+}
+
+/**
+ * Computes c = a * b for row major float matrices.
+ * @param m - num of rows in a and c
+ * @param n - num of cols in b and c
+ * @param k - num of cols in a and rows in b
+ * @param a - the left matrix
+ * @param lda - the row stride of a (in floats)
+ * @param b - the right matrix
+ * @param ldb - the row stride of b (in floats)
+ * @param c - the output matrix, overwritten, must not overlap a or b
+ * @param ldc - the row stride of c (in floats)
+ */
+void gemm(int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc)
+{
+    for (int i = 0; i < m; i++)
+    {
+        std::memset(c + (size_t)i * ldc, 0, n * sizeof(float));
+    }
+    if ((long long)m * n * k < GEMM_SMALL_FLOPS)
+    {
+        smallGemm(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+
+    const GemmKernel& ker = selectKernel();
+    size_t packAFloats = (size_t)GEMM_MC * GEMM_KC;
+    size_t packBFloats = (size_t)GEMM_KC * ((GEMM_NC + ker.nr - 1) / ker.nr * ker.nr);
+    int rowTiles = (m + GEMM_MC - 1) / GEMM_MC;
+    int colTiles = (n + GEMM_NC - 1) / GEMM_NC;
+
+    ThreadPool& pool = ThreadPool::shared();
+    // a pair of pack buffers per worker of the pool running the tasks, taken here since the current allocator
+    // belongs to the calling thread
+    MatrixAllocator& alloc = currentMatrixAllocator();
+    size_t packBytes = (size_t)pool.getNumThreads() * (packAFloats + packBFloats) * sizeof(float);
+    float* packBuffers = static_cast<float*>(alloc.allocate(packBytes));
+    pool.parallelFor(rowTiles * colTiles, [&](int task, int worker)
+    {
+        float* packedA = packBuffers + (size_t)worker * (packAFloats + packBFloats);
+        float* packedB = packedA + packAFloats;
+
+        int ic = task / colTiles * GEMM_MC;
+        int jc = task % colTiles * GEMM_NC;
+        int mc = std::min(GEMM_MC, m - ic);
+        int nc = std::min(GEMM_NC, n - jc);
+        for (int pc = 0; pc < k; pc += GEMM_KC)
+        {
+            int kc = std::min(GEMM_KC, k - pc);
+            packB(kc, nc, b + (size_t)pc * ldb + jc, ldb, ker.nr, packedB);
+            packA(mc, kc, a + (size_t)ic * lda + pc, lda, ker.mr, packedA);
+            macroKernel(mc, nc, kc, packedA, packedB, c + (size_t)ic * ldc + jc, ldc, ker);
+        }
+    });
+
+    alloc.deallocate(packBuffers, packBytes);
+}
+
+/**
+ * Returns the name of the micro-kernel gemm dispatches to on this cpu
+ * @return "avx512", "avx2" or "scalar"
+ */
+const char* gemmKernelName()
+{
+    return selectKernel().name;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef EXERCISE5_GEMM_H
+#define EXERCISE5_GEMM_H
+
+#define GEMM_KC 256 // depth of a packed panel, a MR*KC sliver of A plus a KC*NR sliver of B stay in L1
+#define GEMM_MC 96 // rows of a packed A block (multiple of every MR), the block stays in L2
+#define GEMM_NC 256 // cols of an output tile (one task), its packed B block stays in L2
+#define GEMM_SMALL_FLOPS 32768 // below m*n*k this many, packing costs more than it saves
+
+/**
+ * Computes c = a * b for row major float matrices.
+ * Large products are cache blocked, packed and run through the widest micro-kernel the cpu supports
+ * (AVX-512, AVX2+FMA or portable scalar), chosen once at runtime.
+ * The output is split into GEMM_MC*GEMM_NC tiles that run as tasks on ThreadPool::shared(). Every tile is
+ * computed the same way whatever thread runs it, so the result does not depend on the number of threads.
+ * @param m - num of rows in a and c
+ * @param n - num of cols in b and c
+ * @param k - num of cols in a and rows in b
+ * @param a - the left matrix
+ * @param lda - the row stride of a (in floats)
+ * @param b - the right matrix
+ * @param ldb - the row stride of b (in floats)
+ * @param c - the output matrix, overwritten, must not overlap a or b
+ * @param ldc - the row stride of c (in floats)
+ */
+void gemm(int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc);
+
+/**
+ * Returns the name of the micro-kernel gemm dispatches to on this cpu
+ * @return "avx512", "avx2" or "scalar"
+ */
+const char* gemmKernelName();
+
+#endif //EXERCISE5_GEMM_H
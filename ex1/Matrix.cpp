@@ -1,4 +1,11 @@
 #include "Matrix.h"
+#include "Gemm.h"
+#include <charconv>
+#include <cstring>
+#include <locale>
+#include <string>
+#include <utility>
+#include <vector>
 
 #define ERR_DIM_MSG "Invalid matrix dimensions."
 #define ERR_DIV_MSG "Division by zero."
@@ -10,362 +17,693 @@
 #define VEC_COL 1
 #define END_OF_LINE "\n"
 #define SPACE " "
+#define PARSE_CHUNK_SIZE (1 << 16) // bytes read from / written to the stream at once
+#define FLOAT_TEXT_MAX_CHARS 64 // enough for any float in general or scientific format, plus the precision
 
 /**
-* Constructs matrix rows * cols, initiates all elements to 0.
-* @param rows - num of rows in the matrix
-* @param cols - num of cols in the matrix
+* Prints the invalid matrix dimensions error and exits (shared by the expression operators)
 */
-Matrix::Matrix(int rows, int cols): _rows(rows), _cols(cols)
+void matrixDimError()
 {
-    if (_rows < NEGATIVE || _cols < NEGATIVE)
-    {
-        exit(EXIT_FAILURE);
-    }
+    std::cerr << ERR_DIM_MSG << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+* Prints the division by zero error and exits (shared by the expression operators)
+*/
+void matrixDivError()
+{
+    std::cerr << ERR_DIV_MSG << std::endl;
+    exit(EXIT_FAILURE);
+}
 
-    // allocate memory for _mat
-    _mat = new float*[_rows];
-    for (int i = 0; i <_rows; i++)
+/**
+* Constructs a leaf referring to an expiring matrix
+* @param m - the expiring matrix
+*/
+MatrixTemp::MatrixTemp(Matrix& m): _m(&m), _data(m.getData()), _rows(m.getRows()), _cols(m.getCols()),
+                                   _stride(m.getStride()) {}
+
+/**
+* Moves the buffer of the expiring matrix into dst (once)
+* @param dst - the matrix the expression is evaluated into
+* @return true if dst now holds the buffer, false if it was already claimed
+*/
+bool MatrixTemp::claimBuffer(Matrix& dst) const
+{
+    if (_m->getData() != _data)
     {
-        _mat[i] = new float[_cols];
+        return false;
     }
+    dst = std::move(*_m);
+    return true;
+}
 
-    // initiate all elements to 0
-    for (int i = 0; i < _rows; i++)
+/**
+* Transforms the matrix into a column vector, reusing the existing buffer
+* @return the matrix after transformation
+*/
+Matrix& Matrix::vectorize()
+{
+    if (_stride != _cols)
     {
-        for (int j = 0; j < _cols; j++)
+        // squeeze out the row padding, rows only move backwards so a forward memmove is safe
+        for (int i = 1; i < _rows; i++)
         {
-            _mat[i][j] = INIT_VAL;
+            std::memmove(_mat + (size_t)i * _cols, _mat + (size_t)i * _stride, _cols * sizeof(float));
         }
     }
+    _rows = _rows * _cols;
+    _cols = VEC_COL;
+    _stride = VEC_COL;
+    return *this;
 }
 
 /**
-* Copy constructor - constructs matrix from another matrix
-* @param m - the matrix that is being copied
+* Matrix multiplication
+* @param rhs - the matrix from the right in the multiplication
+* @return A new matrix after multiplication
 */
-Matrix::Matrix(const Matrix &m): _rows(m._rows), _cols(m._cols)
+Matrix Matrix::operator*(const Matrix &rhs) const
 {
-    // allocate memory for _mat
-    _mat = new float*[_rows];
-    for (int i = 0; i <_rows; i++)
+    if (_cols != rhs._rows) // check valid dimensions
     {
-        _mat[i] = new float[_cols];
+        std::cerr << ERR_DIM_MSG << std::endl;
+        exit(EXIT_FAILURE);
     }
 
-    // copy the values from m._mat to _mat
-    for (int i = 0; i < _rows; i++)
+    Matrix multMat(_rows, rhs._cols);
+    gemm(_rows, rhs._cols, _cols, _mat, _stride, rhs._mat, rhs._stride, multMat._mat, multMat._stride);
+    return multMat;
+}
+
+/**
+* Matrix multiplication of views, rows are read in place and only views with strided rows (transposed) are
+* copied first
+* @param lhs - the view on the left
+* @param rhs - the view on the right
+* @return A new matrix after multiplication
+*/
+Matrix multiplyViews(const MatrixView& lhs, const MatrixView& rhs)
+{
+    if (lhs.getCols() != rhs.getRows()) // check valid dimensions
     {
-        for (int j = 0; j < _cols; j++)
-        {
-            _mat[i][j] = m._mat[i][j];
-        }
+        std::cerr << ERR_DIM_MSG << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!lhs.hasContiguousRows())
+    {
+        return multiplyViews(MatrixView(lhs.toMatrix()), rhs);
     }
+    if (!rhs.hasContiguousRows())
+    {
+        return multiplyViews(lhs, MatrixView(rhs.toMatrix()));
+    }
+    Matrix multMat(lhs.getRows(), rhs.getCols());
+    gemm(lhs.getRows(), rhs.getCols(), lhs.getCols(), lhs.getData(), lhs.getRowStride(), rhs.getData(),
+         rhs.getRowStride(), multMat.getData(), multMat.getStride());
+    return multMat;
 }
 
 /**
-* This method deletes the _mat which was dynamically allocated
+* Matrix multiplication accumulation
+* @param rhs - the matrix on the right
+* @return the matrix after multiplication
 */
-void Matrix::_deleteTheMat()
+Matrix& Matrix::operator*=(const Matrix &rhs)
 {
-    for (int i = 0; i < _rows; i++)
+    if (_cols != rhs._rows) // check valid dimensions
     {
-        delete [] _mat[i];
+        std::cerr << ERR_DIM_MSG << std::endl;
+        exit(EXIT_FAILURE);
     }
-    delete [] _mat;
+
+    *this = (*this) * rhs; // the product needs its own buffer, then it is moved in
+    return *this;
 }
 
 /**
-* Destructure - Destroys the matrix
+* Scalar multiplication accumulation
+* @param rhs - the scalar
+* @return the matrix after scalar multiplication accumulation
 */
-Matrix::~Matrix()
+Matrix& Matrix::operator*=(const float &rhs)
 {
-    _deleteTheMat();
+    for (int i = 0; i < _rows; i++)
+    {
+        for (int j = 0; j < _cols; j++)
+        {
+            _mat[i * _stride + j] *= rhs;
+        }
+    }
+    return *this;
 }
 
 /**
-* Transforms the matrix into a column vector
-* @return the matrix after transformation
+* Scalar division accumulation
+* @param rhs - the scalar
+* @return the matrix after scalar division accumulation
 */
-Matrix& Matrix::vectorize()
+Matrix& Matrix::operator/=(const float &rhs)
 {
-    int vecRows = _rows * _cols;
-    int vecCols = VEC_COL;
-    int vecIdx = 0;
+    if (rhs == DIV_BY_ZERO)
+    {
+        std::cerr << ERR_DIV_MSG << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return (*this) *= (1 / rhs);
+}
 
-    // allocate new vector mat (_rows*_cols rows, 1 column)
-    auto** vecMat = new float*[vecRows];
-    for (int i = 0; i <vecRows; i++)
+/**
+* Matrix addition accumulation
+* @param rhs - the matrix to add
+* @return the matrix after addition accumulation
+*/
+Matrix& Matrix::operator+=(const Matrix &rhs)
+{
+    if (_rows != rhs._rows || _cols != rhs._cols) // check valid dimensions
     {
-       vecMat[i] = new float[vecCols];
+        std::cerr << ERR_DIM_MSG << std::endl;
+        exit(EXIT_FAILURE);
     }
 
-    // copy the elements to the transformed matrix
     for (int i = 0; i < _rows; i++)
     {
         for (int j = 0; j < _cols; j++)
         {
-            vecMat[vecIdx++][0] = _mat[i][j];
+            _mat[i * _stride + j] += rhs._mat[i * rhs._stride + j];
         }
     }
+    return *this;
+}
 
-    _deleteTheMat(); // delete the previous _mat
-    _mat = vecMat; // set _mat as the vector mat
-    _rows = vecRows;
-    _cols = vecCols;
+/**
+* Matrix scalar addition accumulation
+* @param rhs - the scalar
+* @return the matrix after scalar addition accumulation
+*/
+Matrix& Matrix::operator+=(const float &rhs)
+{
+    for (int i = 0; i < _rows; i++)
+    {
+        for (int j = 0; j < _cols; j++)
+        {
+            _mat[i * _stride + j] += rhs;
+        }
+    }
     return *this;
 }
 
 /**
-* Prints matrix elements
+* Checks if a character is a separator for the text parser (the same set as the "C" locale isspace)
+* @param c - the character
+* @return true if c is whitespace, false otherwise
 */
-void Matrix::print() const
+static bool isSpace(char c)
 {
-    std::cout << *this;
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
 /**
-* Assignment operator
-* @param rhs - the matrix we are copying
-* @return the matrix after assignment
+* Parses a float with std::from_chars, accepting what the stream extraction accepts on top of it: an explicit plus
+* sign, and a value too small for a float, which underflows to zero (or a subnormal) instead of failing
+* @param first - the first character of the text
+* @param last - past the last character of the text
+* @param val - set to the float
+* @return the from_chars result, result_out_of_range only if the value is too large
 */
-Matrix& Matrix::operator=(const Matrix& rhs)
+static std::from_chars_result parseFloat(const char* first, const char* last, float& val)
 {
-    if (this != &rhs)
+    if (*first == '+' && first + 1 < last) // from_chars does not accept an explicit plus sign
     {
-        _deleteTheMat(); // delete the _mat (dynamically allocated)
-        _rows = rhs._rows;
-        _cols = rhs._cols;
-        // allocate memory for new _mat
-        _mat = new float*[_rows];
-        for (int i = 0; i <_rows; i++)
+        first++;
+    }
+    std::from_chars_result res = std::from_chars(first, last, val);
+    if (res.ec == std::errc::result_out_of_range)
+    {
+        long double wide;
+        std::from_chars_result wideRes = std::from_chars(first, last, wide);
+        if (wideRes.ec == std::errc() && std::fabs(wide) < 1)
         {
-            _mat[i] = new float[_cols];
+            val = (float)wide;
+            res.ec = std::errc();
         }
+    }
+    return res;
+}
 
-        // copy the values from rhs._mat to _mat
-        for (int i = 0; i < _rows; i++)
+/**
+* Parses the elements of a matrix from a stream that cannot seek back, a token at a time, so no character after the
+* last element is taken from it. A token made of a number followed by other characters is consumed whole.
+* @param sb - the stream buffer
+* @param rhs - the matrix
+* @return the state to set on the stream
+*/
+static std::ios::iostate readUnseekable(std::streambuf* sb, Matrix& rhs)
+{
+    typedef std::streambuf::traits_type Traits;
+    std::ios::iostate state = std::ios::goodbit;
+    std::string token;
+    float val;
+    for (int row = 0; row < rhs.getRows(); row++)
+    {
+        float* rowData = rhs.getData() + (size_t)row * rhs.getStride();
+        for (int col = 0; col < rhs.getCols(); col++)
         {
-            for (int j = 0; j < _cols; j++)
+            int c = sb->sgetc();
+            while (c != Traits::eof() && isSpace(Traits::to_char_type(c)))
+            {
+                c = sb->snextc();
+            }
+            if (c == Traits::eof())
+            {
+                return state | std::ios::eofbit | std::ios::failbit; // ran out of input before the matrix was full
+            }
+            token.clear();
+            while (c != Traits::eof() && !isSpace(Traits::to_char_type(c)))
+            {
+                token.push_back(Traits::to_char_type(c));
+                c = sb->snextc();
+            }
+            if (c == Traits::eof())
             {
-                _mat[i][j] = rhs._mat[i][j];
+                state |= std::ios::eofbit;
+            }
+            const char* first = token.data();
+            const char* last = token.data() + token.size();
+            std::from_chars_result res = parseFloat(first, last, val);
+            if (res.ec != std::errc())
+            {
+                return state | std::ios::failbit;
+            }
+            rowData[col] = val;
+            if (res.ptr != last) // the rest of the token is not an element
+            {
+                return state | std::ios::failbit;
             }
         }
     }
-    return *this;
+    return state;
 }
 
 /**
-* This method calculates a cell in a matrix after performing matrix multiplication
-* @param rhs - the matrix on the right
-* @param row - the number of the row
-* @param col - the number of the column
-* @return the value that was calculated that should be in the cell [row][col]
+* Input stream operator.
+* With the classic locale the input is parsed with std::from_chars (correctly rounded, like the locale-aware
+* extraction it replaces). A seekable stream is read in large chunks and the characters read past the last element
+* are handed back, any other stream is read a token at a time.
+* Unlike the extraction, from_chars also reads "inf", "infinity" and "nan" (in any case, optionally signed), so
+* the text operator<< writes for infinite and NaN elements reads back.
+* @param is - the input stream
+* @param rhs - the matrix
+* @return the input stream
 */
-float Matrix::_calcMultCell(const Matrix &rhs, const int& row, const int& col) const
+std::istream& operator>>(std::istream& is, Matrix& rhs)
 {
-    float sum = 0;
-    for (int i = 0; i < _cols; i++)
+    if (!is.good())
+    {
+        std::cerr << ERR_IS_MSG << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int row = 0;
+    int col = 0;
+    float val;
+    if (is.getloc() != std::locale::classic()) // the locale may change the number format, keep its extraction
     {
-        sum += _mat[row][i] * rhs._mat[i][col];
+        while (row < rhs._rows && is >> val)
+        {
+            rhs._mat[row * rhs._stride + col] = val;
+            col++;
+            if (rhs._cols == col)
+            {
+                col = 0;
+                row++;
+            }
+        }
+        return is;
     }
-    return sum;
+
+    std::streambuf* sb = is.rdbuf();
+    if (sb->pubseekoff(0, std::ios::cur, std::ios::in) == std::streampos(-1)) // e.g. a pipe
+    {
+        is.setstate(readUnseekable(sb, rhs));
+        return is;
+    }
+    std::vector<char> buf(PARSE_CHUNK_SIZE);
+    size_t pos = 0; // next unparsed character
+    size_t len = 0; // characters in buf
+    bool eof = false;
+    std::ios::iostate state = std::ios::goodbit;
+    // keeps buf[pos, len) and appends the next chunk of the stream
+    auto refill = [&]()
+    {
+        std::memmove(buf.data(), buf.data() + pos, len - pos);
+        len -= pos;
+        pos = 0;
+        if (len == buf.size()) // a single token fills the whole buffer
+        {
+            buf.resize(buf.size() * 2);
+        }
+        std::streamsize got = sb->sgetn(buf.data() + len, (std::streamsize)(buf.size() - len));
+        len += (size_t)got;
+        eof = got == 0;
+    };
+
+    while (row < rhs._rows)
+    {
+        while (pos < len && isSpace(buf[pos]))
+        {
+            pos++;
+        }
+        if (pos == len)
+        {
+            if (eof)
+            {
+                state |= std::ios::eofbit | std::ios::failbit; // ran out of input before the matrix was full
+                break;
+            }
+            refill();
+            continue;
+        }
+        size_t end = pos;
+        while (end < len && !isSpace(buf[end]))
+        {
+            end++;
+        }
+        if (end == len && !eof) // the token may continue in the next chunk
+        {
+            refill();
+            continue;
+        }
+        const char* first = buf.data() + pos;
+        std::from_chars_result res = parseFloat(first, buf.data() + end, val);
+        if (res.ec == std::errc::invalid_argument)
+        {
+            state |= std::ios::failbit; // not a number
+            break;
+        }
+        if (res.ec == std::errc::result_out_of_range)
+        {
+            pos = res.ptr - buf.data(); // consumed, as the stream extraction does
+            state |= std::ios::failbit;
+            break;
+        }
+        rhs._mat[row * rhs._stride + col] = val;
+        col++;
+        if (rhs._cols == col)
+        {
+            col = 0;
+            row++;
+        }
+        pos = res.ptr - buf.data();
+        if (pos == len && eof)
+        {
+            state |= std::ios::eofbit;
+        }
+    }
+    if (pos < len) // hand back what was read ahead
+    {
+        sb->pubseekoff(-(std::streamoff)(len - pos), std::ios::cur, std::ios::in);
+    }
+    is.setstate(state);
+    return is;
 }
 
 /**
-* Matrix multiplication
-* @param rhs - the matrix from the right in the multiplication
-* @return A new matrix after multiplication
+* Writes the matrix elements formatted with std::to_chars, a row at a time
+* @param os - the output stream
+* @param rhs - the matrix
+* @param shortest - if true every element is written with the shortest text that reads back to the same float,
+* otherwise as the stream would (its float field and precision)
 */
-Matrix Matrix::operator*(const Matrix &rhs) const
+static void writeText(std::ostream& os, const Matrix& rhs, bool shortest)
 {
-    if (_cols != rhs._rows) // check valid dimensions
+    std::chars_format fmt = std::chars_format::general;
+    if ((os.flags() & std::ios::floatfield) == std::ios::fixed)
     {
-        std::cerr << ERR_DIM_MSG << std::endl;
-        exit(EXIT_FAILURE);
+        fmt = std::chars_format::fixed;
     }
+    else if ((os.flags() & std::ios::floatfield) == std::ios::scientific)
+    {
+        fmt = std::chars_format::scientific;
+    }
+    int precision = (int)os.precision();
+    size_t maxValChars = FLOAT_TEXT_MAX_CHARS + (shortest ? 0 : precision);
+    std::vector<char> out(PARSE_CHUNK_SIZE + maxValChars);
+    char* const outBegin = out.data();
+    char* const outLimit = outBegin + PARSE_CHUNK_SIZE;
+    char* p = outBegin;
 
-    Matrix multMat(_rows, rhs._cols);
-    for (int i = 0; i < _rows; i++)
+    for (int i = 0; i < rhs.getRows(); i++)
     {
-        for (int j = 0; j < rhs._cols; j++)
+        const float* rowData = rhs.getData() + (size_t)i * rhs.getStride();
+        for (int j = 0; j < rhs.getCols(); j++)
+        {
+            char* const valEnd = p + maxValChars;
+            p = (shortest ? std::to_chars(p, valEnd, rowData[j]) :
+                 std::to_chars(p, valEnd, rowData[j], fmt, precision)).ptr;
+            if (j != rhs.getCols() - 1)
+            {
+                *p++ = *SPACE;
+            }
+            if (p >= outLimit)
+            {
+                os.write(outBegin, p - outBegin);
+                p = outBegin;
+            }
+        }
+        if (i != rhs.getRows() - 1)
+        {
+            *p++ = *END_OF_LINE;
+        }
+        if (p >= outLimit) // rows without elements only add their line ends
         {
-           multMat._mat[i][j] = _calcMultCell(rhs, i, j);
+            os.write(outBegin, p - outBegin);
+            p = outBegin;
         }
     }
-    return multMat;
+    os.write(outBegin, p - outBegin);
 }
 
 /**
-* Scalar multiplication on the right
-* @param rhs - the scalar
-* @return new matrix after multiplication
+* Output stream operator.
+* Elements are formatted with std::to_chars using the stream's float field and precision, which gives the same
+* text as formatting them one by one through the stream. Streams with a width, showpos, showpoint, uppercase,
+* hexfloat or a non-classic locale are formatted by the stream itself.
+* @param os - the output stream
+* @param rhs - the matrix
+* @return the output stream
 */
-Matrix Matrix::operator*(const float &rhs) const
+std::ostream& operator<<(std::ostream& os, const Matrix& rhs)
 {
-    Matrix multMat = Matrix(_rows, _cols);
-    for (int i = 0; i < _rows; i++)
+    std::ios::fmtflags special = std::ios::showpos | std::ios::showpoint | std::ios::uppercase;
+    bool hexFloat = (os.flags() & std::ios::floatfield) == (std::ios::fixed | std::ios::scientific);
+    if (os.width() == 0 && !(os.flags() & special) && !hexFloat && os.getloc() == std::locale::classic())
     {
-        for (int j = 0; j < _cols; j++)
+        writeText(os, rhs, false);
+        return os;
+    }
+    for (int i = 0; i < rhs._rows; i++)
+    {
+        for (int j = 0; j < rhs._cols; j++)
         {
-            multMat._mat[i][j] = _mat[i][j] * rhs;
+            os << rhs._mat[i * rhs._stride + j];
+            if (j != rhs._cols - 1)
+            {
+                os << SPACE;
+            }
+        }
+        if (i != rhs._rows - 1)
+        {
+            os << END_OF_LINE;
         }
     }
-    return multMat;
+    return os;
 }
 
 /**
-* Scalar multiplication on the left
-* @param lhs - the scalar
-* @param rhs - the matrix to be multiplied
-* @return new matrix after multiplication
+* Writes the matrix in the operator<< layout, every element with the shortest text that reads back (through
+* operator>>) to exactly the same float
+* @param os - the output stream
+* @param m - the matrix
+* @return the output stream
 */
-Matrix operator*(const float &lhs, const Matrix &rhs) { return  rhs * lhs; }
+std::ostream& writeExact(std::ostream& os, const Matrix& m)
+{
+    writeText(os, m, true);
+    return os;
+}
 
 /**
-* Matrix multiplication accumulation
-* @param rhs - the matrix on the right
-* @return the matrix after multiplication
+* This method calculates the row stride for a given number of columns
+* @param cols - num of cols in the matrix
+* @return cols rounded up to a whole number of MAT_ALIGNMENT blocks (wide rows only)
 */
-Matrix& Matrix::operator*=(const Matrix &rhs)
+template <typename T>
+int MatrixStorage<T>::_calcStride(int cols)
 {
-    if (_cols != rhs._rows) // check valid dimensions
+    if (cols < MAT_PAD_MIN_COLS)
     {
-        std::cerr << ERR_DIM_MSG << std::endl;
-        exit(EXIT_FAILURE);
+        return cols;
     }
+    int blockElems = MAT_ALIGNMENT / (int)sizeof(T);
+    return (cols + blockElems - 1) / blockElems * blockElems;
+}
 
-    int multRows = _rows;
-    int multCols = rhs._cols;
-    auto** multMat = new float*[multRows];
-    for (int i = 0; i < multRows; i++)
+/**
+* This method allocates a buffer for a rows * cols matrix and sets the dimensions
+* @param rows - num of rows in the matrix
+* @param cols - num of cols in the matrix
+* @param initVals - if true all elements are initiated to 0, otherwise only the row padding is
+*/
+template <typename T>
+void MatrixStorage<T>::_allocTheMat(int rows, int cols, bool initVals)
+{
+    _rows = rows;
+    _cols = cols;
+    _stride = _calcStride(cols);
+    size_t bytes = (size_t)_rows * _stride * sizeof(T);
+    _alloc = &currentMatrixAllocator();
+    _bytes = bytes;
+    _mat = static_cast<T*>(_alloc->allocate(bytes));
+    if (initVals)
     {
-        multMat[i] = new float[multCols];
+        std::memset(_mat, INIT_VAL, bytes); // initiate all elements (and the row padding) to 0
     }
-
-    // calculate matrices multiplication
-    for (int i = 0; i < multRows; i++)
+    else if (_stride != _cols)
     {
-        for (int j = 0; j < multCols; j++)
+        for (int i = 0; i < _rows; i++)
         {
-            multMat[i][j] = _calcMultCell(rhs, i, j);
+            std::memset(_mat + (size_t)i * _stride + _cols, INIT_VAL, (_stride - _cols) * sizeof(T));
         }
     }
-
-    _deleteTheMat(); // delete the previous _mat
-    _mat = multMat;
-    _rows = multRows;
-    _cols = multCols;
-    return *this;
 }
 
 /**
-* Scalar multiplication accumulation
-* @param rhs - the scalar
-* @return the matrix after scalar multiplication accumulation
+* Constructs matrix rows * cols, initiates all elements to 0.
+* @param rows - num of rows in the matrix
+* @param cols - num of cols in the matrix
 */
-Matrix& Matrix::operator*=(const float &rhs)
+template <typename T>
+MatrixStorage<T>::MatrixStorage(int rows, int cols)
 {
-    for (int i = 0; i < _rows; i++)
+    if (rows < NEGATIVE || cols < NEGATIVE)
     {
-        for (int j = 0; j < _cols; j++)
-        {
-            _mat[i][j] *= rhs;
-        }
+        exit(EXIT_FAILURE);
     }
-    return *this;
+    _allocTheMat(rows, cols);
 }
 
 /**
-* Scalar division on the right
-* @param rhs - the scalar
-* @return new matrix after division
+* Constructs matrix rows * cols with its buffer taken from the given allocator, initiates all elements to 0.
+* @param rows - num of rows in the matrix
+* @param cols - num of cols in the matrix
+* @param alloc - the allocator
 */
-Matrix Matrix::operator/(const float &rhs) const
+template <typename T>
+MatrixStorage<T>::MatrixStorage(int rows, int cols, MatrixAllocator& alloc)
 {
-    if (rhs == DIV_BY_ZERO)
+    if (rows < NEGATIVE || cols < NEGATIVE)
     {
-        std::cerr << ERR_DIV_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    return (*this) * (1 / rhs);
+    MatrixAllocatorScope scope(alloc);
+    _allocTheMat(rows, cols);
 }
 
 /**
-* Scalar division accumulation
-* @param rhs - the scalar
-* @return the matrix after scalar division accumulation
+* Copy constructor - constructs matrix from another matrix
+* @param m - the matrix that is being copied
 */
-Matrix& Matrix::operator/=(const float &rhs)
+template <typename T>
+MatrixStorage<T>::MatrixStorage(const MatrixStorage &m)
 {
-    if (rhs == DIV_BY_ZERO)
-    {
-        std::cerr << ERR_DIV_MSG << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    return (*this) *= (1 / rhs);
+    _allocTheMat(m._rows, m._cols, false);
+    std::memcpy(_mat, m._mat, (size_t)_rows * _stride * sizeof(T)); // same cols, so same stride
 }
 
 /**
-* Matrix addition
-* @param rhs - the matrix to add
-* @return new matrix after addition
+* Move constructor - constructs matrix by taking over the buffer of another matrix
+* @param m - the matrix that is being moved, left as an empty 0*0 matrix
 */
-Matrix Matrix::operator+(const Matrix &rhs) const
+template <typename T>
+MatrixStorage<T>::MatrixStorage(MatrixStorage &&m) noexcept: _rows(m._rows), _cols(m._cols), _stride(m._stride),
+                                                             _mat(m._mat), _alloc(m._alloc), _bytes(m._bytes)
 {
-    if (_rows != rhs._rows || _cols != rhs._cols) // check valid dimensions
-    {
-        std::cerr << ERR_DIM_MSG << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    m._rows = m._cols = m._stride = 0;
+    m._mat = nullptr;
+}
 
-    Matrix addMat = Matrix(_rows, _cols);
-    for (int i = 0; i < _rows; i++)
+/**
+* This method deletes the _mat which was dynamically allocated
+*/
+template <typename T>
+void MatrixStorage<T>::_deleteTheMat()
+{
+    if (_mat != nullptr)
     {
-        for (int j = 0; j < _cols; j++)
-        {
-            addMat._mat[i][j] = _mat[i][j] + rhs._mat[i][j];
-        }
+        _alloc->deallocate(_mat, _bytes);
+        _mat = nullptr;
     }
-    return addMat;
 }
 
 /**
-* Matrix addition accumulation
-* @param rhs - the matrix to add
-* @return the matrix after addition accumulation
+* Destructure - Destroys the matrix
 */
-Matrix& Matrix::operator+=(const Matrix &rhs)
+template <typename T>
+MatrixStorage<T>::~MatrixStorage()
 {
-    if (_rows != rhs._rows || _cols != rhs._cols) // check valid dimensions
-    {
-        std::cerr << ERR_DIM_MSG << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    _deleteTheMat();
+}
 
-    for (int i = 0; i < _rows; i++)
+/**
+* Prints matrix elements
+*/
+template <typename T>
+void MatrixStorage<T>::print() const
+{
+    std::cout << static_cast<const BasicMatrix<T>&>(*this);
+}
+
+/**
+* Assignment operator
+* @param rhs - the matrix we are copying
+* @return the matrix after assignment
+*/
+template <typename T>
+MatrixStorage<T>& MatrixStorage<T>::operator=(const MatrixStorage& rhs)
+{
+    if (this != &rhs)
     {
-        for (int j = 0; j < _cols; j++)
+        if (_rows != rhs._rows || _cols != rhs._cols || _stride != rhs._stride)
         {
-            _mat[i][j] += rhs._mat[i][j];
+            _deleteTheMat(); // delete the _mat (dynamically allocated)
+            _allocTheMat(rhs._rows, rhs._cols, false);
         }
+        std::memcpy(_mat, rhs._mat, (size_t)_rows * _stride * sizeof(T));
     }
     return *this;
 }
 
 /**
-* Matrix scalar addition accumulation
-* @param rhs - the scalar
-* @return the matrix after scalar addition accumulation
+* Move assignment operator
+* @param rhs - the matrix we are moving from, left as an empty 0*0 matrix
+* @return the matrix after assignment
 */
-Matrix& Matrix::operator+=(const float &rhs)
+template <typename T>
+MatrixStorage<T>& MatrixStorage<T>::operator=(MatrixStorage&& rhs) noexcept
 {
-    for (int i = 0; i < _rows; i++)
+    if (this != &rhs)
     {
-        for (int j = 0; j < _cols; j++)
-        {
-            _mat[i][j] += rhs;
-        }
+        _deleteTheMat();
+        _rows = rhs._rows;
+        _cols = rhs._cols;
+        _stride = rhs._stride;
+        _mat = rhs._mat;
+        _alloc = rhs._alloc;
+        _bytes = rhs._bytes;
+        rhs._rows = rhs._cols = rhs._stride = 0;
+        rhs._mat = nullptr;
     }
     return *this;
 }
@@ -374,66 +712,66 @@ Matrix& Matrix::operator+=(const float &rhs)
 * Parenthesis indexing (non-const)
 * @param pos1 - num of row
 * @param pos2 - num of column
-* @return the number in the index in the matrix
+* @return a reference to the number in the index in the matrix
 */
-float& Matrix::operator()(int pos1, int pos2)
+template <typename T>
+T& MatrixStorage<T>::operator()(int pos1, int pos2)
 {
     if (pos1 < NEGATIVE || pos1 > _rows - 1 || pos2 < NEGATIVE || pos2 > _cols - 1) // check indexes validity
     {
         std::cerr << ERR_INDEX_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    return _mat[pos1][pos2];
+    return _mat[(size_t)pos1 * _stride + pos2];
 }
 
 /**
 * Parenthesis indexing (const)
 * @param pos1 - num of row
 * @param pos2 - num of column
-* @return a reference to the number in the index in the matrix
+* @return the number in the index in the matrix
 */
-float Matrix::operator()(int pos1, int pos2) const
+template <typename T>
+T MatrixStorage<T>::operator()(int pos1, int pos2) const
 {
     if (pos1 < NEGATIVE || pos1 > _rows - 1 || pos2 < NEGATIVE || pos2 > _cols - 1) // check indexes validity
     {
         std::cerr << ERR_INDEX_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    return _mat[pos1][pos2];
+    return _mat[(size_t)pos1 * _stride + pos2];
 }
 
 /**
-* Brackets indexing (const)
+* Brackets indexing (non-const)
 * @param pos - the index
-* @return the number in the index in the matrix
+* @return a reference to the number in the index in the matrix
 */
-float& Matrix::operator[](int pos)
+template <typename T>
+T& MatrixStorage<T>::operator[](int pos)
 {
     if (pos < NEGATIVE || pos > _rows * _cols - 1) // check index validity
     {
         std::cerr << ERR_INDEX_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    int r = pos / _cols;
-    int c = pos % _cols;
-    return _mat[r][c];
+    return _mat[(size_t)(pos / _cols) * _stride + pos % _cols];
 }
 
 /**
-* Brackets indexing (non-const)
+* Brackets indexing (const)
 * @param pos - the index
-* @return a reference to the number in the index in the matrix
+* @return the number in the index in the matrix
 */
-float Matrix::operator[](int pos) const
+template <typename T>
+T MatrixStorage<T>::operator[](int pos) const
 {
     if (pos < NEGATIVE || pos > _rows * _cols - 1) // check index validity
     {
         std::cerr << ERR_INDEX_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    int r = pos / _cols;
-    int c = pos % _cols;
-    return _mat[r][c];
+    return _mat[(size_t)(pos / _cols) * _stride + pos % _cols];
 }
 
 /**
@@ -441,7 +779,8 @@ float Matrix::operator[](int pos) const
 * @param rhs - the matrix to check equality to
 * @return true if the matrices are equal, false otherwise
 */
-bool Matrix::operator==(const Matrix &rhs) const
+template <typename T>
+bool MatrixStorage<T>::operator==(const MatrixStorage &rhs) const
 {
     if (_rows != rhs._rows || _cols != rhs._cols)
     {
@@ -452,7 +791,7 @@ bool Matrix::operator==(const Matrix &rhs) const
     {
         for (int j = 0; j < _cols; j++)
         {
-            if (_mat[i][j] != rhs._mat[i][j])
+            if (_mat[(size_t)i * _stride + j] != rhs._mat[(size_t)i * rhs._stride + j])
             {
                 return false;
             }
@@ -466,62 +805,68 @@ bool Matrix::operator==(const Matrix &rhs) const
 * @param rhs - the matrix to check inequality to
 * @return true if the matrices are inequal, false otherwise
 */
-bool Matrix::operator!=(const Matrix &rhs) const
+template <typename T>
+bool MatrixStorage<T>::operator!=(const MatrixStorage &rhs) const
 {
     return !((*this) == rhs);
 }
 
 /**
-* Input stream operator
+* Input stream operator, every element is read as a number and converted with saturateCast
 * @param is - the input stream
 * @param rhs - the matrix
 * @return the input stream
 */
-std::istream& operator>>(std::istream& is, Matrix& rhs)
+template <typename T>
+std::istream& operator>>(std::istream& is, BasicMatrix<T>& rhs)
 {
     if (!is.good())
     {
         std::cerr << ERR_IS_MSG << std::endl;
         exit(EXIT_FAILURE);
     }
-    int row = 0;
-    int col = 0;
-    float val;
-    while (is >> val)
+    double val;
+    for (int i = 0; i < rhs.getRows() * rhs.getCols() && is >> val; i++)
     {
-        rhs._mat[row][col] = val;
-        col++;
-        if (rhs._cols == col)
-        {
-            col = 0;
-            row++;
-        }
+        rhs.getData()[(size_t)(i / rhs.getCols()) * rhs.getStride() + i % rhs.getCols()] = saturateCast<T>(val);
     }
     return is;
 }
 
 /**
-* Output stream operator
+* Output stream operator, in the layout of the Matrix output
 * @param os - the output stream
 * @param rhs - the matrix
 * @return the output stream
 */
-std::ostream& operator<<(std::ostream& os, const Matrix& rhs)
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const BasicMatrix<T>& rhs)
 {
-    for (int i = 0; i < rhs._rows; i++)
+    for (int i = 0; i < rhs.getRows(); i++)
     {
-        for (int j = 0; j < rhs._cols; j++)
+        for (int j = 0; j < rhs.getCols(); j++)
         {
-            os << rhs._mat[i][j];
-            if (j != rhs._cols - 1)
+            os << +rhs.getData()[(size_t)i * rhs.getStride() + j]; // + prints 8-bit elements as numbers
+            if (j != rhs.getCols() - 1)
             {
                 os << SPACE;
             }
         }
-        if (i != rhs._rows - 1)
+        if (i != rhs.getRows() - 1)
         {
             os << END_OF_LINE;
         }
     }
     return os;
-}
\ No newline at end of file
+}
+
+template class MatrixStorage<float>;
+template class MatrixStorage<uint8_t>;
+template class MatrixStorage<int16_t>;
+template class MatrixStorage<double>;
+template std::istream& operator>>(std::istream& is, ByteMatrix& rhs);
+template std::istream& operator>>(std::istream& is, ShortMatrix& rhs);
+template std::istream& operator>>(std::istream& is, DoubleMatrix& rhs);
+template std::ostream& operator<<(std::ostream& os, const ByteMatrix& rhs);
+template std::ostream& operator<<(std::ostream& os, const ShortMatrix& rhs);
+template std::ostream& operator<<(std::ostream& os, const DoubleMatrix& rhs);
\ No newline at end of file
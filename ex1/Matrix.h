@@ -2,158 +2,232 @@
 #ifndef EXERCISE5_MATRIX_H
 #define EXERCISE5_MATRIX_H
 
+#include "MatrixAlloc.h"
+#include "MatrixExpr.h"
+#include "MatrixView.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
 #define INIT_ROW 1
 #define INIT_COL 1
+#define MAT_ALIGNMENT 64 // bytes, the buffer and the rows of padded matrices (MAT_PAD_MIN_COLS cols or more) start on
+// a cache line (and AVX-512 register) boundary, the rows of narrower matrices after the first need not
+#define MAT_PAD_MIN_COLS 64 // narrower rows are not padded, so small matrices and vectors stay dense
 
 /**
- * This class represents a matrix
+ * Converts an element to another element type. Conversions to an integer type round to the nearest integer (ties
+ * to even, as rintf does) and saturate at the limits of the type, NaN converts to 0.
+ * @tparam To - the target element type
+ * @tparam From - the source element type
+ * @param val - the element
+ * @return the converted element
  */
-class Matrix
+template <typename To, typename From>
+inline To saturateCast(From val)
 {
+    if constexpr (std::is_floating_point<To>::value)
+    {
+        return static_cast<To>(val);
+    }
+    else if constexpr (std::is_floating_point<From>::value)
+    {
+        if (val != val) // NaN
+        {
+            return 0;
+        }
+        double rounded = std::rint((double)val);
+        if (rounded <= (double)std::numeric_limits<To>::min())
+        {
+            return std::numeric_limits<To>::min();
+        }
+        if (rounded >= (double)std::numeric_limits<To>::max())
+        {
+            return std::numeric_limits<To>::max();
+        }
+        return static_cast<To>(rounded);
+    }
+    else
+    {
+        auto wide = (long long)val;
+        if (wide < (long long)std::numeric_limits<To>::min())
+        {
+            return std::numeric_limits<To>::min();
+        }
+        if (wide > (long long)std::numeric_limits<To>::max())
+        {
+            return std::numeric_limits<To>::max();
+        }
+        return static_cast<To>(wide);
+    }
+}
 
-private:
+/**
+ * Converts a block of elements to another element type with saturateCast
+ * @param src - pointer to the first source element
+ * @param srcStride - the row stride of src (in elements)
+ * @param dst - pointer to the first destination element
+ * @param dstStride - the row stride of dst (in elements)
+ * @param rows - num of rows
+ * @param cols - num of cols
+ */
+template <typename To, typename From>
+void convertElements(const From* src, int srcStride, To* dst, int dstStride, int rows, int cols)
+{
+    for (int i = 0; i < rows; i++)
+    {
+        const From* srcRow = src + (size_t)i * srcStride;
+        To* dstRow = dst + (size_t)i * dstStride;
+        for (int j = 0; j < cols; j++)
+        {
+            dstRow[j] = saturateCast<To>(srcRow[j]);
+        }
+    }
+}
+
+/**
+ * This class holds the elements of a BasicMatrix: a single MAT_ALIGNMENT aligned buffer with padded wide rows,
+ * taken from the allocator current on the thread (see MatrixAllocatorScope), the heap by default. It gives every
+ * element type the same construction, indexing, comparison and printing; it is only used as the base of
+ * BasicMatrix, whose float specialization adds the arithmetic.
+ * @tparam T - the element type
+ */
+template <typename T>
+class MatrixStorage
+{
+
+protected:
     int _rows, _cols;
-    float** _mat;
+    int _stride; // distance (in elements) between the beginnings of two consecutive rows
+    T* _mat; // single contiguous MAT_ALIGNMENT aligned buffer of _rows * _stride elements
+    MatrixAllocator* _alloc; // the allocator _mat came from
+    size_t _bytes; // the size _mat was allocated with
 
     /**
-     * This method deletes the _mat which was dynamically allocated
+     * Selects the constructor that leaves the matrix empty (0*0 without a buffer) for the derived constructor to fill
      */
-    void _deleteTheMat();
+    struct NoBuffer {};
 
     /**
-     * This method calculates a cell in a matrix after performing matrix multiplication
-     * @param rhs - the matrix on the right
-     * @param row - the number of the row
-     * @param col - the number of the column
-     * @return the value that was calculated that should be in the cell [row][col]
+     * Constructs an empty 0*0 matrix without a buffer
      */
-    float _calcMultCell(const Matrix& rhs, const int& row, const int& col) const;
-
-public:
+    explicit MatrixStorage(NoBuffer): _rows(0), _cols(0), _stride(0), _mat(nullptr), _alloc(nullptr), _bytes(0) {}
 
     /**
-     * Constructs matrix rows * cols, initiates all elements to 0.
-     * @param rows - num of rows in the matrix
+     * This method calculates the row stride for a given number of columns
      * @param cols - num of cols in the matrix
+     * @return cols rounded up to a whole number of MAT_ALIGNMENT blocks (wide rows only)
      */
-    Matrix(int rows, int cols);
+    static int _calcStride(int cols);
 
     /**
-     * Default constructor - Constructs 1*1 matrix, the single element is initiated to 0.
+     * This method allocates a buffer for a rows * cols matrix and sets the dimensions
+     * @param rows - num of rows in the matrix
+     * @param cols - num of cols in the matrix
+     * @param initVals - if true all elements are initiated to 0, otherwise only the row padding is
      */
-    Matrix(): Matrix(INIT_ROW, INIT_COL){}
+    void _allocTheMat(int rows, int cols, bool initVals = true);
 
     /**
-     * Copy constructor - constructs matrix from another matrix
-     * @param m - the matrix that is being copied
+     * This method deletes the _mat which was dynamically allocated
      */
-    Matrix(const Matrix &m);
+    void _deleteTheMat();
 
-    /**
-     * Destructure - Destroys the matrix
-     */
-    ~Matrix();
+public:
 
     /**
-     * Getter to number of rows
-     * @return the amount of rows
+     * Constructs matrix rows * cols, initiates all elements to 0.
+     * @param rows - num of rows in the matrix
+     * @param cols - num of cols in the matrix
      */
-    int getRows() const { return  _rows; }
+    MatrixStorage(int rows, int cols);
 
     /**
-     * Getter to number of columns
-     * @return the amount of columns
+     * Constructs matrix rows * cols with its buffer taken from the given allocator, initiates all elements to 0.
+     * @param rows - num of rows in the matrix
+     * @param cols - num of cols in the matrix
+     * @param alloc - the allocator
      */
-    int getCols() const { return _cols; }
+    MatrixStorage(int rows, int cols, MatrixAllocator& alloc);
 
     /**
-     * Transforms the matrix into a column vector
-     * @return the matrix after transformation
+     * Default constructor - Constructs 1*1 matrix, the single element is initiated to 0.
      */
-    Matrix& vectorize();
+    MatrixStorage(): MatrixStorage(INIT_ROW, INIT_COL){}
 
     /**
-     * Prints matrix elements
+     * Copy constructor - constructs matrix from another matrix
+     * @param m - the matrix that is being copied
      */
-    void print() const;
+    MatrixStorage(const MatrixStorage &m);
 
     /**
-     * Assignment operator
-     * @param rhs - the matrix we are copying
-     * @return the matrix after assignment
+     * Move constructor - constructs matrix by taking over the buffer of another matrix
+     * @param m - the matrix that is being moved, left as an empty 0*0 matrix
      */
-    Matrix& operator=(const Matrix& rhs);
+    MatrixStorage(MatrixStorage &&m) noexcept;
 
     /**
-     * Matrix multiplication
-     * @param rhs - the matrix from the right in the multiplication
-     * @return A new matrix after multiplication
+     * Constructs matrix by converting a matrix of another element type (saturating)
+     * @param m - the matrix that is being converted
      */
-    Matrix operator*(const Matrix& rhs) const;
+    template <typename U>
+    explicit MatrixStorage(const MatrixStorage<U> &m);
 
     /**
-     * Scalar multiplication on the right
-     * @param rhs - the scalar
-     * @return new matrix after multiplication
+     * Destructure - Destroys the matrix
      */
-    Matrix operator*(const float &rhs) const;
+    ~MatrixStorage();
 
     /**
-     * Scalar multiplication on the left
-     * @param lhs - the scalar
-     * @param rhs - the matrix to be multiplied
-     * @return new matrix after multiplication
+     * Getter to number of rows
+     * @return the amount of rows
      */
-    friend Matrix operator*(const float &lhs, const Matrix &rhs);
+    int getRows() const { return _rows; }
 
     /**
-     * Matrix multiplication accumulation
-     * @param rhs - the matrix on the right
-     * @return the matrix after multiplication
+     * Getter to number of columns
+     * @return the amount of columns
      */
-    Matrix& operator*=(const Matrix& rhs);
+    int getCols() const { return _cols; }
 
     /**
-     * Scalar multiplication accumulation
-     * @param rhs - the scalar
-     * @return the matrix after scalar multiplication accumulation
+     * Getter to the row stride
+     * @return the distance (in elements) between the beginnings of two consecutive rows
      */
-    Matrix& operator*=(const float &rhs);
+    int getStride() const { return _stride; }
 
     /**
-     * Scalar division on the right
-     * @param rhs - the scalar
-     * @return new matrix after division
+     * Getter to the underlying buffer, element (r, c) is at getData()[r * getStride() + c]
+     * @return a pointer to the first element
      */
-    Matrix operator/(const float &rhs) const;
+    T* getData() { return _mat; }
 
     /**
-     * Scalar division accumulation
-     * @param rhs - the scalar
-     * @return the matrix after scalar division accumulation
+     * Getter to the underlying buffer (const)
+     * @return a pointer to the first element
      */
-    Matrix& operator/=(const float &rhs);
+    const T* getData() const { return _mat; }
 
     /**
-     * Matrix addition
-     * @param rhs - the matrix to add
-     * @return new matrix after addition
+     * Prints matrix elements
      */
-    Matrix operator+(const Matrix& rhs) const;
+    void print() const;
 
     /**
-     * Matrix addition accumulation
-     * @param rhs - the matrix to add
-     * @return the matrix after addition accumulation
+     * Assignment operator
+     * @param rhs - the matrix we are copying
+     * @return the matrix after assignment
      */
-    Matrix& operator+=(const Matrix& rhs);
+    MatrixStorage& operator=(const MatrixStorage& rhs);
 
     /**
-     * Matrix scalar addition accumulation
-     * @param rhs - the scalar
-     * @return the matrix after scalar addition accumulation
+     * Move assignment operator
+     * @param rhs - the matrix we are moving from, left as an empty 0*0 matrix
+     * @return the matrix after assignment
      */
-    Matrix& operator+=(const float& rhs);
+    MatrixStorage& operator=(MatrixStorage&& rhs) noexcept;
 
     /**
      * Parenthesis indexing (const)
@@ -161,7 +235,7 @@ public:
      * @param pos2 - num of column
      * @return the number in the index in the matrix
      */
-    float operator()(int pos1, int pos2) const;
+    T operator()(int pos1, int pos2) const;
 
     /**
      * Parenthesis indexing (non-const)
@@ -169,38 +243,168 @@ public:
      * @param pos2 - num of column
      * @return a reference to the number in the index in the matrix
      */
-    float& operator()(int pos1, int pos2);
+    T& operator()(int pos1, int pos2);
 
     /**
      * Brackets indexing (const)
      * @param pos - the index
      * @return the number in the index in the matrix
      */
-    float operator[] (int pos) const;
+    T operator[](int pos) const;
 
     /**
      * Brackets indexing (non-const)
      * @param pos - the index
      * @return a reference to the number in the index in the matrix
      */
-    float& operator[](int pos);
+    T& operator[](int pos);
 
     /**
      * Equality operator
      * @param rhs - the matrix to check equality to
      * @return true if the matrices are equal, false otherwise
      */
-    bool operator==(const Matrix& rhs) const;
+    bool operator==(const MatrixStorage& rhs) const;
 
     /**
      * Inequality operator
      * @param rhs - the matrix to check inequality to
      * @return true if the matrices are inequal, false otherwise
      */
-    bool operator!=(const Matrix& rhs) const;
+    bool operator!=(const MatrixStorage& rhs) const;
+};
+
+/**
+ * This class represents a matrix of integer or double elements (ByteMatrix, ShortMatrix and DoubleMatrix), so
+ * images keep their own element size through the filters. It holds, indexes, compares and prints elements (see
+ * MatrixStorage); arithmetic is done on a Matrix, converting with the explicit (saturating) constructors.
+ * @tparam T - the element type, uint8_t, int16_t or double
+ */
+template <typename T>
+class BasicMatrix : public MatrixStorage<T>
+{
+
+public:
+    using MatrixStorage<T>::MatrixStorage;
+
+    BasicMatrix() = default;
+};
+
+/**
+ * This class represents a matrix of floats (Matrix), the full featured element type of BasicMatrix. On top of the
+ * storage, indexing and printing of MatrixStorage it does the arithmetic: element-wise arithmetic (+, scalar * and
+ * scalar /) builds a lazy MatrixExpr which is evaluated in a single fused pass when it is assigned to a Matrix,
+ * and products run on the gemm kernels. Regions are referred to without copying through MatrixView.
+ */
+template <>
+class BasicMatrix<float> : public MatrixStorage<float>, public MatrixExpr<Matrix>
+{
+
+private:
 
     /**
-     * Input stream operator
+     * This method evaluates an expression of the same dimensions into _mat
+     * @param expr - the expression
+     */
+    template <typename E>
+    void _evalExpr(const E& expr);
+
+public:
+    using MatrixStorage<float>::MatrixStorage;
+    using MatrixStorage<float>::getRows;
+    using MatrixStorage<float>::getCols;
+
+    BasicMatrix() = default;
+
+    /**
+     * Constructs matrix by evaluating an element-wise expression
+     * @param expr - the expression
+     */
+    template <typename E>
+    BasicMatrix(const MatrixExpr<E> &expr);
+
+    /**
+     * Constructs matrix by evaluating an expiring element-wise expression, reusing the buffer of an expiring
+     * operand when there is one
+     * @param expr - the expression
+     */
+    template <typename E>
+    BasicMatrix(MatrixExpr<E> &&expr);
+
+    /**
+     * Transforms the matrix into a column vector, reusing the existing buffer
+     * @return the matrix after transformation
+     */
+    Matrix& vectorize();
+
+    /**
+     * Assignment of an element-wise expression, evaluated in place when the dimensions are unchanged
+     * @param rhs - the expression
+     * @return the matrix after assignment
+     */
+    template <typename E>
+    Matrix& operator=(const MatrixExpr<E>& rhs);
+
+    /**
+     * Assignment of an expiring element-wise expression
+     * @param rhs - the expression
+     * @return the matrix after assignment
+     */
+    template <typename E>
+    Matrix& operator=(MatrixExpr<E>&& rhs);
+
+    /**
+     * Matrix multiplication
+     * @param rhs - the matrix from the right in the multiplication
+     * @return A new matrix after multiplication
+     */
+    Matrix operator*(const Matrix& rhs) const;
+
+    /**
+     * Matrix multiplication accumulation
+     * @param rhs - the matrix on the right
+     * @return the matrix after multiplication
+     */
+    Matrix& operator*=(const Matrix& rhs);
+
+    /**
+     * Scalar multiplication accumulation
+     * @param rhs - the scalar
+     * @return the matrix after scalar multiplication accumulation
+     */
+    Matrix& operator*=(const float &rhs);
+
+    /**
+     * Scalar division accumulation
+     * @param rhs - the scalar
+     * @return the matrix after scalar division accumulation
+     */
+    Matrix& operator/=(const float &rhs);
+
+    /**
+     * Matrix addition accumulation
+     * @param rhs - the matrix to add
+     * @return the matrix after addition accumulation
+     */
+    Matrix& operator+=(const Matrix& rhs);
+
+    /**
+     * Matrix addition accumulation of an element-wise expression, in a single pass
+     * @param rhs - the expression to add
+     * @return the matrix after addition accumulation
+     */
+    template <typename E>
+    Matrix& operator+=(const MatrixExpr<E>& rhs);
+
+    /**
+     * Matrix scalar addition accumulation
+     * @param rhs - the scalar
+     * @return the matrix after scalar addition accumulation
+     */
+    Matrix& operator+=(const float& rhs);
+
+    /**
+     * Input stream operator, with the classic locale "inf" and "nan" elements read back too
      * @param is - the input stream
      * @param rhs - the matrix
      * @return the input stream
@@ -217,4 +421,380 @@ public:
 
 };
 
-#endif //EXERCISE5_MATRIX_H
+/**
+ * Writes the matrix in the operator<< layout, every element with the shortest text that reads back (through
+ * operator>>) to exactly the same float
+ * @param os - the output stream
+ * @param m - the matrix
+ * @return the output stream
+ */
+std::ostream& writeExact(std::ostream& os, const Matrix& m);
+
+
+typedef BasicMatrix<uint8_t> ByteMatrix;
+typedef BasicMatrix<int16_t> ShortMatrix;
+typedef BasicMatrix<double> DoubleMatrix;
+
+/**
+ * Input stream operator, every element is read as a number and converted with saturateCast
+ * @param is - the input stream
+ * @param rhs - the matrix
+ * @return the input stream
+ */
+template <typename T>
+std::istream& operator>>(std::istream& is, BasicMatrix<T>& rhs);
+
+/**
+ * Output stream operator, in the layout of the Matrix output
+ * @param os - the output stream
+ * @param rhs - the matrix
+ * @return the output stream
+ */
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const BasicMatrix<T>& rhs);
+
+/**
+ * Constructs matrix by converting a matrix of another element type (saturating)
+ * @param m - the matrix that is being converted
+ */
+template <typename T>
+template <typename U>
+MatrixStorage<T>::MatrixStorage(const MatrixStorage<U> &m): MatrixStorage(NoBuffer())
+{
+    _allocTheMat(m.getRows(), m.getCols(), false);
+    convertElements(m.getData(), m.getStride(), _mat, _stride, _rows, _cols);
+}
+
+/**
+* This method evaluates an expression of the same dimensions into _mat
+* @param expr - the expression
+*/
+template <typename E>
+void Matrix::_evalExpr(const E& expr)
+{
+    for (int i = 0; i < _rows; i++)
+    {
+        auto src = expr.row(i);
+        float* dst = _mat + i * _stride;
+        MAT_IVDEP
+        for (int j = 0; j < _cols; j++)
+        {
+            dst[j] = src[j];
+        }
+    }
+}
+
+/**
+* Constructs matrix by evaluating an element-wise expression
+* @param expr - the expression
+*/
+template <typename E>
+Matrix::BasicMatrix(const MatrixExpr<E> &expr): MatrixStorage<float>(NoBuffer())
+{
+    _allocTheMat(expr.getRows(), expr.getCols(), false);
+    _evalExpr(expr.self());
+}
+
+/**
+* Constructs matrix by evaluating an expiring element-wise expression, reusing the buffer of an expiring
+* operand when there is one
+* @param expr - the expression
+*/
+template <typename E>
+Matrix::BasicMatrix(MatrixExpr<E> &&expr): MatrixStorage<float>(NoBuffer())
+{
+    if (!expr.self().claimBuffer(*this))
+    {
+        _allocTheMat(expr.getRows(), expr.getCols(), false);
+    }
+    else if (expr.self().unsafeInPlace(_mat, _stride)) // another leaf reads the claimed buffer out of order
+    {
+        *this = Matrix(static_cast<const MatrixExpr<E>&>(expr));
+        return;
+    }
+    _evalExpr(expr.self());
+}
+
+/**
+* Assignment of an element-wise expression, evaluated in place when the dimensions are unchanged
+* @param rhs - the expression
+* @return the matrix after assignment
+*/
+template <typename E>
+Matrix& Matrix::operator=(const MatrixExpr<E>& rhs)
+{
+    if (_rows == rhs.getRows() && _cols == rhs.getCols() && !rhs.self().unsafeInPlace(_mat, _stride))
+    {
+        _evalExpr(rhs.self());
+        return *this;
+    }
+    return *this = Matrix(rhs);
+}
+
+/**
+* Assignment of an expiring element-wise expression
+* @param rhs - the expression
+* @return the matrix after assignment
+*/
+template <typename E>
+Matrix& Matrix::operator=(MatrixExpr<E>&& rhs)
+{
+    if (_rows == rhs.getRows() && _cols == rhs.getCols() && !rhs.self().unsafeInPlace(_mat, _stride))
+    {
+        _evalExpr(rhs.self());
+        return *this;
+    }
+    return *this = Matrix(std::move(rhs));
+}
+
+/**
+* Matrix addition accumulation of an element-wise expression, in a single pass
+* @param rhs - the expression to add
+* @return the matrix after addition accumulation
+*/
+template <typename E>
+Matrix& Matrix::operator+=(const MatrixExpr<E>& rhs)
+{
+    if (_rows != rhs.getRows() || _cols != rhs.getCols()) // check valid dimensions
+    {
+        matrixDimError();
+    }
+    if (rhs.self().unsafeInPlace(_mat, _stride))
+    {
+        return *this += Matrix(rhs);
+    }
+    for (int i = 0; i < _rows; i++)
+    {
+        auto src = rhs.self().row(i);
+        float* dst = _mat + i * _stride;
+        MAT_IVDEP
+        for (int j = 0; j < _cols; j++)
+        {
+            dst[j] += src[j];
+        }
+    }
+    return *this;
+}
+
+/**
+ * Evaluates the expression
+ * @return a new matrix holding the result
+ */
+template <typename E>
+Matrix MatrixExpr<E>::eval() const
+{
+    return Matrix(*this);
+}
+
+/**
+ * Wraps a matrix that outlives the expression as a leaf
+ * @param m - the matrix
+ * @return the leaf node
+ */
+inline MatrixRef toNode(const Matrix& m)
+{
+    return MatrixRef(m.getData(), m.getRows(), m.getCols(), m.getStride());
+}
+
+/**
+ * Wraps an expiring matrix as a leaf, whose buffer the result may reuse
+ * @param m - the matrix
+ * @return the leaf node
+ */
+inline MatrixTemp toNode(Matrix&& m)
+{
+    return MatrixTemp(m);
+}
+
+/**
+ * Expression nodes are small (references and scalars) and are stored by value
+ * @param expr - the expression
+ * @return a copy of the node
+ */
+template <typename E>
+E toNode(const MatrixExpr<E>& expr)
+{
+    return expr.self();
+}
+
+/**
+ * The node type an operand is stored as
+ * @tparam T - the operand type
+ */
+template <typename T>
+using NodeOf = decltype(toNode(std::declval<T>()));
+
+/**
+ * Evaluates an operand that has to be materialized (a Matrix is used as is)
+ * @param m - the matrix
+ * @return the matrix
+ */
+inline const Matrix& evalExpr(const Matrix& m)
+{
+    return m;
+}
+
+/**
+ * Evaluates an operand that has to be materialized
+ * @param expr - the expression
+ * @return a new matrix holding the result
+ */
+template <typename E>
+Matrix evalExpr(const MatrixExpr<E>& expr)
+{
+    return Matrix(expr);
+}
+
+/**
+ * Matrix addition
+ * @param lhs - the left matrix or expression
+ * @param rhs - the matrix or expression to add
+ * @return a lazy expression of the sum
+ */
+template <typename L, typename R, typename = typename std::enable_if<IsMatrixExpr<L>::value &&
+                                                                    IsMatrixExpr<R>::value>::type>
+MatrixSum<NodeOf<L>, NodeOf<R>> operator+(L&& lhs, R&& rhs)
+{
+    return MatrixSum<NodeOf<L>, NodeOf<R>>(toNode(std::forward<L>(lhs)), toNode(std::forward<R>(rhs)));
+}
+
+/**
+ * Scalar multiplication on the right
+ * @param lhs - the matrix or expression to be multiplied
+ * @param rhs - the scalar
+ * @return a lazy expression of the product
+ */
+template <typename E, typename = typename std::enable_if<IsMatrixExpr<E>::value>::type>
+MatrixScale<NodeOf<E>> operator*(E&& lhs, const float& rhs)
+{
+    return MatrixScale<NodeOf<E>>(toNode(std::forward<E>(lhs)), rhs);
+}
+
+/**
+ * Scalar multiplication on the left
+ * @param lhs - the scalar
+ * @param rhs - the matrix or expression to be multiplied
+ * @return a lazy expression of the product
+ */
+template <typename E, typename = typename std::enable_if<IsMatrixExpr<E>::value>::type>
+MatrixScale<NodeOf<E>> operator*(const float& lhs, E&& rhs)
+{
+    return MatrixScale<NodeOf<E>>(toNode(std::forward<E>(rhs)), lhs);
+}
+
+/**
+ * Scalar division on the right
+ * @param lhs - the matrix or expression to be divided
+ * @param rhs - the scalar
+ * @return a lazy expression of the quotient
+ */
+template <typename E, typename = typename std::enable_if<IsMatrixExpr<E>::value>::type>
+MatrixScale<NodeOf<E>> operator/(E&& lhs, const float& rhs)
+{
+    if (rhs == 0)
+    {
+        matrixDivError();
+    }
+    return MatrixScale<NodeOf<E>>(toNode(std::forward<E>(lhs)), 1 / rhs);
+}
+
+/**
+ * Evaluates an operand of a matrix multiplication (a view is used as is)
+ * @param v - the view
+ * @return the view
+ */
+inline const MatrixView& productOperand(const MatrixView& v)
+{
+    return v;
+}
+
+/**
+ * Evaluates an operand of a matrix multiplication (a matrix is used as is)
+ * @param m - the matrix
+ * @return the matrix
+ */
+inline const Matrix& productOperand(const Matrix& m)
+{
+    return m;
+}
+
+/**
+ * Evaluates an operand of a matrix multiplication
+ * @param expr - the expression
+ * @return a new matrix holding the result
+ */
+template <typename E>
+Matrix productOperand(const MatrixExpr<E>& expr)
+{
+    return Matrix(expr);
+}
+
+/**
+ * Matrix multiplication of views, rows are read in place and only views with strided rows (transposed) are
+ * copied first
+ * @param lhs - the view on the left
+ * @param rhs - the view on the right
+ * @return A new matrix after multiplication
+ */
+Matrix multiplyViews(const MatrixView& lhs, const MatrixView& rhs);
+
+/**
+ * Enables the binary operators taking two matrix operands when at least one of them is an expression
+ * (Matrix with Matrix is handled by the Matrix members)
+ * @tparam L - the left operand type
+ * @tparam R - the right operand type
+ */
+template <typename L, typename R>
+using EnableIfExprOperands = typename std::enable_if<IsMatrixExpr<L>::value && IsMatrixExpr<R>::value &&
+                                                     !(std::is_same<L, Matrix>::value &&
+                                                       std::is_same<R, Matrix>::value)>::type;
+
+/**
+ * Matrix multiplication where an operand is an expression (it is evaluated first)
+ * @param lhs - the matrix or expression on the left
+ * @param rhs - the matrix or expression on the right
+ * @return A new matrix after multiplication
+ */
+template <typename L, typename R, typename = EnableIfExprOperands<L, R>>
+Matrix operator*(const L& lhs, const R& rhs)
+{
+    return multiplyViews(MatrixView(productOperand(lhs)), MatrixView(productOperand(rhs)));
+}
+
+/**
+ * Equality operator where an operand is an expression (it is evaluated first)
+ * @param lhs - the matrix or expression on the left
+ * @param rhs - the matrix or expression on the right
+ * @return true if the matrices are equal, false otherwise
+ */
+template <typename L, typename R, typename = EnableIfExprOperands<L, R>>
+bool operator==(const L& lhs, const R& rhs)
+{
+    return evalExpr(lhs) == evalExpr(rhs);
+}
+
+/**
+ * Inequality operator where an operand is an expression (it is evaluated first)
+ * @param lhs - the matrix or expression on the left
+ * @param rhs - the matrix or expression on the right
+ * @return true if the matrices are inequal, false otherwise
+ */
+template <typename L, typename R, typename = EnableIfExprOperands<L, R>>
+bool operator!=(const L& lhs, const R& rhs)
+{
+    return !(evalExpr(lhs) == evalExpr(rhs));
+}
+
+/**
+ * Output stream operator for an expression (it is evaluated first)
+ * @param os - the output stream
+ * @param rhs - the expression
+ * @return the output stream
+ */
+template <typename E>
+std::ostream& operator<<(std::ostream& os, const MatrixExpr<E>& rhs)
+{
+    return os << evalExpr(rhs.self());
+}
+
+#endif //EXERCISE5_MATRIX_H
\ No newline at end of file
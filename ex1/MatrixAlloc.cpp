@@ -0,0 +1,299 @@
+#include "MatrixAlloc.h"
+#include <new>
+
+#define SMALL_CLASSES 16 // the classes that are plain multiples of ALLOC_ALIGNMENT
+#define STEPS_PER_DOUBLING 4
+#define SMALL_CLASSES_LOG2 4
+
+static thread_local MatrixAllocator* tlsCurrent = nullptr; // the allocator of the innermost scope
+
+/**
+ * Rounds a size up to a whole number of ALLOC_ALIGNMENT blocks
+ * @param bytes - the size
+ * @return the rounded size
+ */
+static size_t alignBytes(size_t bytes)
+{
+    return (bytes + ALLOC_ALIGNMENT - 1) / ALLOC_ALIGNMENT * ALLOC_ALIGNMENT;
+}
+
+/**
+ * Allocates an ALLOC_ALIGNMENT aligned buffer from the heap
+ * @param bytes - the size of the buffer
+ * @return the buffer
+ */
+static void* heapAllocate(size_t bytes)
+{
+    return ::operator new(bytes, std::align_val_t(ALLOC_ALIGNMENT));
+}
+
+/**
+ * Gives a buffer back to the heap
+ * @param p - the buffer
+ */
+static void heapDeallocate(void* p)
+{
+    ::operator delete(p, std::align_val_t(ALLOC_ALIGNMENT));
+}
+
+MatrixAllocator::MatrixAllocator(): _allocations(0), _heapAllocations(0), _bytesInUse(0), _peakBytes(0)
+{
+}
+
+/**
+ * Allocates a buffer
+ * @param bytes - the size of the buffer
+ * @return the buffer, ALLOC_ALIGNMENT aligned
+ */
+void* MatrixAllocator::allocate(size_t bytes)
+{
+    void* p = _allocate(bytes);
+    _allocations++;
+    size_t inUse = _bytesInUse += bytes;
+    size_t peak = _peakBytes.load(std::memory_order_relaxed);
+    while (inUse > peak && !_peakBytes.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+    {
+    }
+    return p;
+}
+
+/**
+ * Gives a buffer back
+ * @param p - the buffer (nullptr is ignored)
+ * @param bytes - the size it was allocated with
+ */
+void MatrixAllocator::deallocate(void* p, size_t bytes)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+    _bytesInUse -= bytes;
+    _deallocate(p, bytes);
+}
+
+/**
+ * Getter to the counters
+ * @return a snapshot of the counters
+ */
+MatrixAllocStats MatrixAllocator::getStats() const
+{
+    return {_allocations.load(), _heapAllocations.load(), _bytesInUse.load(), _peakBytes.load()};
+}
+
+/**
+ * Resets the counters, the peak starts again from the bytes in use
+ */
+void MatrixAllocator::resetStats()
+{
+    _allocations = 0;
+    _heapAllocations = 0;
+    _peakBytes = _bytesInUse.load();
+}
+
+void* HeapAllocator::_allocate(size_t bytes)
+{
+    _countHeapAllocation();
+    return heapAllocate(bytes);
+}
+
+void HeapAllocator::_deallocate(void* p, size_t)
+{
+    heapDeallocate(p);
+}
+
+PoolAllocator::PoolAllocator(): _free(), _cachedBytes(0)
+{
+}
+
+/**
+ * Destructor - releases the cached buffers
+ */
+PoolAllocator::~PoolAllocator()
+{
+    trim();
+}
+
+/**
+ * The size class of a buffer
+ * @param bytes - the size of the buffer
+ * @return the index of the smallest class holding it
+ */
+int PoolAllocator::_classOf(size_t bytes)
+{
+    size_t units = bytes == 0 ? 1 : (bytes + ALLOC_ALIGNMENT - 1) / ALLOC_ALIGNMENT;
+    if (units <= SMALL_CLASSES)
+    {
+        return (int)units - 1;
+    }
+    // units is in (2^e, 2^(e+1)], which is split into STEPS_PER_DOUBLING classes of 2^(e-2) units
+    int e = (int)(sizeof(unsigned long long) * 8 - 1) - __builtin_clzll((unsigned long long)(units - 1));
+    size_t step = (size_t)1 << (e - 2);
+    int sub = (int)((units + step - 1) / step) - STEPS_PER_DOUBLING - 1;
+    return SMALL_CLASSES + (e - SMALL_CLASSES_LOG2) * STEPS_PER_DOUBLING + sub;
+}
+
+/**
+ * The size of the buffers of a class
+ * @param sizeClass - the index of the class
+ * @return the size in bytes
+ */
+size_t PoolAllocator::_classBytes(int sizeClass)
+{
+    if (sizeClass < SMALL_CLASSES)
+    {
+        return (size_t)(sizeClass + 1) * ALLOC_ALIGNMENT;
+    }
+    int e = (sizeClass - SMALL_CLASSES) / STEPS_PER_DOUBLING + SMALL_CLASSES_LOG2;
+    int sub = (sizeClass - SMALL_CLASSES) % STEPS_PER_DOUBLING;
+    return ((size_t)(STEPS_PER_DOUBLING + 1 + sub) << (e - 2)) * ALLOC_ALIGNMENT;
+}
+
+void* PoolAllocator::_allocate(size_t bytes)
+{
+    int sizeClass = _classOf(bytes);
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        FreeBuffer* buffer = _free[sizeClass];
+        if (buffer != nullptr)
+        {
+            _free[sizeClass] = buffer->next;
+            _cachedBytes -= _classBytes(sizeClass);
+            return buffer;
+        }
+    }
+    _countHeapAllocation();
+    return heapAllocate(_classBytes(sizeClass));
+}
+
+void PoolAllocator::_deallocate(void* p, size_t bytes)
+{
+    int sizeClass = _classOf(bytes);
+    auto buffer = static_cast<FreeBuffer*>(p);
+    std::lock_guard<std::mutex> guard(_lock);
+    buffer->next = _free[sizeClass];
+    _free[sizeClass] = buffer;
+    _cachedBytes += _classBytes(sizeClass);
+}
+
+/**
+ * Getter to the size of the cached buffers
+ * @return the bytes held in the free lists
+ */
+size_t PoolAllocator::getCachedBytes()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _cachedBytes;
+}
+
+/**
+ * Releases the cached buffers to the heap
+ */
+void PoolAllocator::trim()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (FreeBuffer*& head : _free)
+    {
+        while (head != nullptr)
+        {
+            FreeBuffer* next = head->next;
+            heapDeallocate(head);
+            head = next;
+        }
+    }
+    _cachedBytes = 0;
+}
+
+/**
+ * Constructs an empty arena
+ * @param blockBytes - the size of the blocks it allocates (a larger buffer gets a block of its own)
+ */
+ArenaAllocator::ArenaAllocator(size_t blockBytes): _blockBytes(alignBytes(blockBytes)), _block(0), _offset(0)
+{
+}
+
+/**
+ * Destructor - releases the blocks
+ */
+ArenaAllocator::~ArenaAllocator()
+{
+    for (Block& block : _blocks)
+    {
+        heapDeallocate(block.data);
+    }
+}
+
+void* ArenaAllocator::_allocate(size_t bytes)
+{
+    bytes = alignBytes(bytes);
+    // fill the blocks in order, skipping the rest of a block that cannot hold the buffer
+    while (_block < _blocks.size() && _offset + bytes > _blocks[_block].bytes)
+    {
+        _block++;
+        _offset = 0;
+    }
+    if (_block == _blocks.size())
+    {
+        size_t blockBytes = bytes > _blockBytes ? bytes : _blockBytes;
+        _countHeapAllocation();
+        _blocks.push_back({static_cast<char*>(heapAllocate(blockBytes)), blockBytes});
+    }
+    void* p = _blocks[_block].data + _offset;
+    _offset += bytes;
+    return p;
+}
+
+void ArenaAllocator::_deallocate(void*, size_t)
+{
+    // the memory comes back all at once in reset()
+}
+
+/**
+ * Getter to the size of the arena
+ * @return the bytes in all the blocks
+ */
+size_t ArenaAllocator::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const Block& block : _blocks)
+    {
+        capacity += block.bytes;
+    }
+    return capacity;
+}
+
+/**
+ * The allocator used when no MatrixAllocatorScope is active
+ * @return the shared HeapAllocator
+ */
+MatrixAllocator& defaultMatrixAllocator()
+{
+    static HeapAllocator heap;
+    return heap;
+}
+
+/**
+ * The allocator new matrix buffers come from on the calling thread
+ * @return the allocator of the innermost active MatrixAllocatorScope, or the default allocator
+ */
+MatrixAllocator& currentMatrixAllocator()
+{
+    return tlsCurrent != nullptr ? *tlsCurrent : defaultMatrixAllocator();
+}
+
+/**
+ * Makes an allocator current
+ * @param alloc - the allocator
+ */
+MatrixAllocatorScope::MatrixAllocatorScope(MatrixAllocator& alloc): _previous(tlsCurrent)
+{
+    tlsCurrent = &alloc;
+}
+
+/**
+ * Destructor - makes the previous allocator current again
+ */
+MatrixAllocatorScope::~MatrixAllocatorScope()
+{
+    tlsCurrent = _previous;
+}
@@ -0,0 +1,259 @@
+#ifndef EXERCISE5_MATRIXALLOC_H
+#define EXERCISE5_MATRIXALLOC_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#define ALLOC_ALIGNMENT 64 // every buffer starts on a cache line, as MAT_ALIGNMENT requires
+#define POOL_NUM_CLASSES 256
+#define ARENA_DEFAULT_BLOCK_BYTES (16 << 20)
+
+/**
+ * A snapshot of the counters of an allocator
+ */
+struct MatrixAllocStats
+{
+    long allocations; // buffers handed out
+    long heapAllocations; // buffers (or arena blocks) taken from the heap to serve them
+    size_t bytesInUse; // bytes handed out and not given back yet
+    size_t peakBytes; // the largest bytesInUse since the counters were reset
+};
+
+/**
+ * This class is the base of the allocators of matrix buffers.
+ * Every matrix takes its buffer from the allocator current on its thread when the buffer is allocated (see
+ * MatrixAllocatorScope) and gives it back to the same allocator, so an allocator must outlive its matrices.
+ * The counters are kept here, so every allocator reports them the same way.
+ */
+class MatrixAllocator
+{
+
+private:
+    std::atomic<long> _allocations, _heapAllocations;
+    std::atomic<size_t> _bytesInUse, _peakBytes;
+
+protected:
+
+    /**
+     * Allocates a buffer
+     * @param bytes - the size of the buffer
+     * @return the buffer, ALLOC_ALIGNMENT aligned
+     */
+    virtual void* _allocate(size_t bytes) = 0;
+
+    /**
+     * Gives a buffer back
+     * @param p - the buffer
+     * @param bytes - the size it was allocated with
+     */
+    virtual void _deallocate(void* p, size_t bytes) = 0;
+
+    /**
+     * Counts an allocation from the heap, called by the allocators whenever they have to take memory from it
+     */
+    void _countHeapAllocation() { _heapAllocations++; }
+
+public:
+
+    MatrixAllocator();
+
+    MatrixAllocator(const MatrixAllocator&) = delete;
+    MatrixAllocator& operator=(const MatrixAllocator&) = delete;
+
+    virtual ~MatrixAllocator() = default;
+
+    /**
+     * Allocates a buffer
+     * @param bytes - the size of the buffer
+     * @return the buffer, ALLOC_ALIGNMENT aligned
+     */
+    void* allocate(size_t bytes);
+
+    /**
+     * Gives a buffer back
+     * @param p - the buffer (nullptr is ignored)
+     * @param bytes - the size it was allocated with
+     */
+    void deallocate(void* p, size_t bytes);
+
+    /**
+     * Getter to the counters
+     * @return a snapshot of the counters
+     */
+    MatrixAllocStats getStats() const;
+
+    /**
+     * Resets the counters, the peak starts again from the bytes in use
+     */
+    void resetStats();
+};
+
+/**
+ * Allocates every buffer from the heap (the default)
+ */
+class HeapAllocator : public MatrixAllocator
+{
+
+protected:
+    void* _allocate(size_t bytes) override;
+
+    void _deallocate(void* p, size_t bytes) override;
+};
+
+/**
+ * Keeps the buffers given back in free lists by size class and hands them out again, so a steady stream of
+ * matrices of recurring sizes stops allocating from the heap. Size classes are multiples of ALLOC_ALIGNMENT up to
+ * 1 KB and then four per power of two, so a buffer wastes at most a fifth of its size. Thread safe.
+ */
+class PoolAllocator : public MatrixAllocator
+{
+
+private:
+
+    /**
+     * A cached buffer, the link is stored in the buffer itself
+     */
+    struct FreeBuffer
+    {
+        FreeBuffer* next;
+    };
+
+    std::mutex _lock;
+    FreeBuffer* _free[POOL_NUM_CLASSES];
+    size_t _cachedBytes;
+
+    /**
+     * The size class of a buffer
+     * @param bytes - the size of the buffer
+     * @return the index of the smallest class holding it
+     */
+    static int _classOf(size_t bytes);
+
+    /**
+     * The size of the buffers of a class
+     * @param sizeClass - the index of the class
+     * @return the size in bytes
+     */
+    static size_t _classBytes(int sizeClass);
+
+protected:
+    void* _allocate(size_t bytes) override;
+
+    void _deallocate(void* p, size_t bytes) override;
+
+public:
+
+    PoolAllocator();
+
+    /**
+     * Destructor - releases the cached buffers
+     */
+    ~PoolAllocator() override;
+
+    /**
+     * Getter to the size of the cached buffers
+     * @return the bytes held in the free lists
+     */
+    size_t getCachedBytes();
+
+    /**
+     * Releases the cached buffers to the heap
+     */
+    void trim();
+};
+
+/**
+ * Hands out buffers by bumping a pointer through large blocks; giving a buffer back does nothing and reset()
+ * makes the whole arena free again in O(1), keeping its blocks. Meant for the temporaries of one frame: every
+ * matrix allocated from the arena must be destroyed before it is reset. Not thread safe.
+ */
+class ArenaAllocator : public MatrixAllocator
+{
+
+private:
+
+    /**
+     * A block of the arena
+     */
+    struct Block
+    {
+        char* data;
+        size_t bytes;
+    };
+
+    std::vector<Block> _blocks;
+    size_t _blockBytes; // the size of new blocks
+    size_t _block; // the block being filled
+    size_t _offset; // the first free byte in it
+
+protected:
+    void* _allocate(size_t bytes) override;
+
+    void _deallocate(void* p, size_t bytes) override;
+
+public:
+
+    /**
+     * Constructs an empty arena
+     * @param blockBytes - the size of the blocks it allocates (a larger buffer gets a block of its own)
+     */
+    explicit ArenaAllocator(size_t blockBytes = ARENA_DEFAULT_BLOCK_BYTES);
+
+    /**
+     * Destructor - releases the blocks
+     */
+    ~ArenaAllocator() override;
+
+    /**
+     * Makes the whole arena free again, every matrix allocated from it must have been destroyed
+     */
+    void reset() { _block = 0; _offset = 0; }
+
+    /**
+     * Getter to the size of the arena
+     * @return the bytes in all the blocks
+     */
+    size_t getCapacity() const;
+};
+
+/**
+ * The allocator used when no MatrixAllocatorScope is active
+ * @return the shared HeapAllocator
+ */
+MatrixAllocator& defaultMatrixAllocator();
+
+/**
+ * The allocator new matrix buffers come from on the calling thread
+ * @return the allocator of the innermost active MatrixAllocatorScope, or the default allocator
+ */
+MatrixAllocator& currentMatrixAllocator();
+
+/**
+ * Makes an allocator current on the calling thread for its lifetime (scopes nest)
+ */
+class MatrixAllocatorScope
+{
+
+private:
+    MatrixAllocator* _previous;
+
+public:
+
+    /**
+     * Makes an allocator current
+     * @param alloc - the allocator
+     */
+    explicit MatrixAllocatorScope(MatrixAllocator& alloc);
+
+    MatrixAllocatorScope(const MatrixAllocatorScope&) = delete;
+    MatrixAllocatorScope& operator=(const MatrixAllocatorScope&) = delete;
+
+    /**
+     * Destructor - makes the previous allocator current again
+     */
+    ~MatrixAllocatorScope();
+};
+
+#endif //EXERCISE5_MATRIXALLOC_H
@@ -0,0 +1,286 @@
+#ifndef EXERCISE5_MATRIXEXPR_H
+#define EXERCISE5_MATRIXEXPR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// the element-wise evaluation loops have no loop-carried dependencies even when the destination is one of the
+// operands (element i only reads element i), so the compiler may vectorize them without runtime alias checks
+#if defined(__clang__)
+#define MAT_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define MAT_IVDEP _Pragma("GCC ivdep")
+#else
+#define MAT_IVDEP
+#endif
+
+template <typename T>
+class BasicMatrix;
+
+typedef BasicMatrix<float> Matrix;
+
+/**
+ * Prints the invalid matrix dimensions error and exits (shared by the expression operators)
+ */
+void matrixDimError();
+
+/**
+ * Prints the division by zero error and exits (shared by the expression operators)
+ */
+void matrixDivError();
+
+/**
+ * Checks if evaluating an expression element by element into dst could overwrite an element of a leaf before it
+ * is read, i.e. the leaf overlaps dst but does not map element (r, c) to the address dst does.
+ * @param data - pointer to element (0, 0) of the leaf
+ * @param rows - num of rows (of both the leaf and dst)
+ * @param cols - num of cols (of both the leaf and dst)
+ * @param rowStride - the row stride of the leaf (in floats)
+ * @param colStride - the column stride of the leaf (in floats)
+ * @param dst - pointer to element (0, 0) of the destination
+ * @param dstStride - the row stride of the destination (in floats)
+ * @return true if the evaluation must not be done in place
+ */
+inline bool leafUnsafeInPlace(const float* data, int rows, int cols, int rowStride, int colStride, const float* dst,
+                              int dstStride)
+{
+    if (rows == 0 || cols == 0 || (data == dst && rowStride == dstStride && colStride == 1))
+    {
+        return false;
+    }
+    auto begin = (uintptr_t)data;
+    auto end = (uintptr_t)(data + (size_t)(rows - 1) * rowStride + (size_t)(cols - 1) * colStride + 1);
+    auto dstBegin = (uintptr_t)dst;
+    auto dstEnd = (uintptr_t)(dst + (size_t)(rows - 1) * dstStride + cols);
+    return begin < dstEnd && dstBegin < end;
+}
+
+/**
+ * A non-template base of every matrix expression, used to recognize them in overload resolution
+ */
+class MatrixExprTag {};
+
+/**
+ * This class is the base of every element-wise matrix expression (CRTP).
+ * An expression is a lazy tree of small nodes; nothing is computed until it is assigned to a Matrix, which
+ * evaluates the whole tree in a single pass. Every node E provides getRows(), getCols(), row(r) - a cursor
+ * whose [c] returns element (r, c) - claimBuffer(dst) and unsafeInPlace(dst, dstStride).
+ * Expressions refer to their operands, so they must be evaluated within the statement that builds them.
+ * @tparam E - the concrete expression type
+ */
+template <typename E>
+class MatrixExpr : public MatrixExprTag
+{
+
+public:
+
+    /**
+     * The concrete expression
+     * @return a reference to this expression as E
+     */
+    const E& self() const { return static_cast<const E&>(*this); }
+
+    /**
+     * Getter to number of rows
+     * @return the amount of rows
+     */
+    int getRows() const { return self().getRows(); }
+
+    /**
+     * Getter to number of columns
+     * @return the amount of columns
+     */
+    int getCols() const { return self().getCols(); }
+
+    /**
+     * Evaluates the expression
+     * @return a new matrix holding the result
+     */
+    Matrix eval() const;
+};
+
+/**
+ * Checks if a type is a matrix expression (including Matrix itself)
+ * @tparam T - the type
+ */
+template <typename T>
+struct IsMatrixExpr : std::is_base_of<MatrixExprTag, typename std::decay<T>::type> {};
+
+/**
+ * Leaf node referring to the elements of a matrix that outlives the expression
+ */
+class MatrixRef : public MatrixExpr<MatrixRef>
+{
+
+private:
+    const float* _data;
+    int _rows, _cols, _stride;
+
+public:
+
+    /**
+     * Constructs a leaf
+     * @param data - pointer to the first element
+     * @param rows - num of rows
+     * @param cols - num of cols
+     * @param stride - the row stride (in floats)
+     */
+    MatrixRef(const float* data, int rows, int cols, int stride) :
+            _data(data), _rows(rows), _cols(cols), _stride(stride) {}
+
+    int getRows() const { return _rows; }
+
+    int getCols() const { return _cols; }
+
+    const float* row(int r) const { return _data + r * _stride; }
+
+    bool claimBuffer(Matrix&) const { return false; }
+
+    bool unsafeInPlace(const float* dst, int dstStride) const
+    {
+        return leafUnsafeInPlace(_data, _rows, _cols, _stride, 1, dst, dstStride);
+    }
+};
+
+/**
+ * Leaf node referring to an expiring matrix, whose buffer the result may take over
+ */
+class MatrixTemp : public MatrixExpr<MatrixTemp>
+{
+
+private:
+    Matrix* _m; // the expiring matrix, it lives until the end of the full expression
+    const float* _data; // its buffer, stays valid after the buffer is claimed
+    int _rows, _cols, _stride;
+
+public:
+
+    /**
+     * Constructs a leaf
+     * @param m - the expiring matrix
+     */
+    explicit MatrixTemp(Matrix& m);
+
+    int getRows() const { return _rows; }
+
+    int getCols() const { return _cols; }
+
+    const float* row(int r) const { return _data + r * _stride; }
+
+    /**
+     * Moves the buffer of the expiring matrix into dst (once)
+     * @param dst - the matrix the expression is evaluated into
+     * @return true if dst now holds the buffer, false if it was already claimed
+     */
+    bool claimBuffer(Matrix& dst) const;
+
+    bool unsafeInPlace(const float* dst, int dstStride) const
+    {
+        return leafUnsafeInPlace(_data, _rows, _cols, _stride, 1, dst, dstStride);
+    }
+};
+
+/**
+ * Node adding two expressions element by element
+ */
+template <typename L, typename R>
+class MatrixSum : public MatrixExpr<MatrixSum<L, R>>
+{
+
+private:
+    L _lhs;
+    R _rhs;
+
+    /**
+     * Row cursor of a sum
+     */
+    template <typename LRow, typename RRow>
+    struct Row
+    {
+        LRow lhs;
+        RRow rhs;
+
+        float operator[](int c) const { return lhs[c] + rhs[c]; }
+    };
+
+public:
+
+    /**
+     * Constructs a sum, the operands must have the same dimensions
+     * @param lhs - the left operand
+     * @param rhs - the right operand
+     */
+    MatrixSum(L lhs, R rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs))
+    {
+        if (_lhs.getRows() != _rhs.getRows() || _lhs.getCols() != _rhs.getCols())
+        {
+            matrixDimError();
+        }
+    }
+
+    int getRows() const { return _lhs.getRows(); }
+
+    int getCols() const { return _lhs.getCols(); }
+
+    auto row(int r) const -> Row<decltype(_lhs.row(r)), decltype(_rhs.row(r))>
+    {
+        return {_lhs.row(r), _rhs.row(r)};
+    }
+
+    bool claimBuffer(Matrix& dst) const { return _lhs.claimBuffer(dst) || _rhs.claimBuffer(dst); }
+
+    bool unsafeInPlace(const float* dst, int dstStride) const
+    {
+        return _lhs.unsafeInPlace(dst, dstStride) || _rhs.unsafeInPlace(dst, dstStride);
+    }
+};
+
+/**
+ * Node multiplying an expression by a scalar (division is multiplication by the reciprocal, as in Matrix)
+ */
+template <typename E>
+class MatrixScale : public MatrixExpr<MatrixScale<E>>
+{
+
+private:
+    E _expr;
+    float _scalar;
+
+    /**
+     * Row cursor of a scaled expression
+     */
+    template <typename ERow>
+    struct Row
+    {
+        ERow expr;
+        float scalar;
+
+        float operator[](int c) const { return expr[c] * scalar; }
+    };
+
+public:
+
+    /**
+     * Constructs a scaled expression
+     * @param expr - the expression
+     * @param scalar - the scalar
+     */
+    MatrixScale(E expr, float scalar) : _expr(std::move(expr)), _scalar(scalar) {}
+
+    int getRows() const { return _expr.getRows(); }
+
+    int getCols() const { return _expr.getCols(); }
+
+    auto row(int r) const -> Row<decltype(_expr.row(r))>
+    {
+        return {_expr.row(r), _scalar};
+    }
+
+    bool claimBuffer(Matrix& dst) const { return _expr.claimBuffer(dst); }
+
+    bool unsafeInPlace(const float* dst, int dstStride) const { return _expr.unsafeInPlace(dst, dstStride); }
+};
+
+#endif //EXERCISE5_MATRIXEXPR_H
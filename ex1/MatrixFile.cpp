@@ -0,0 +1,349 @@
+#include "MatrixFile.h"
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ERR_OPEN_MSG "Error opening matrix file."
+#define ERR_WRITE_MSG "Error writing matrix file."
+#define ERR_READ_MSG "Error reading matrix file."
+#define ERR_FORMAT_MSG "Invalid matrix file."
+#define ERR_ENDIAN_MSG "Binary matrix files are only supported on little-endian hosts."
+#define ERR_INDEX_MSG "Index out of range."
+#define NEGATIVE 0
+#define UNKNOWN_SIZE 0
+#define MAX_STREAM_DATA_OFFSET (1 << 20) // the largest gap before the payload of a file whose size is unknown
+
+/**
+ * Prints an error and exits
+ * @param msg - the error message
+ */
+static void fileError(const char* msg)
+{
+    std::cerr << msg << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Checks that the host stores numbers little-endian, as the file format does
+ */
+static void checkHostEndianness()
+{
+    uint32_t probe = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &probe, 1);
+    if (firstByte != 1)
+    {
+        fileError(ERR_ENDIAN_MSG);
+    }
+}
+
+/**
+ * The size of a regular file
+ * @param path - the file path
+ * @return the size in bytes, or UNKNOWN_SIZE if it is not a regular file (e.g. a pipe)
+ */
+static uint64_t regularFileSize(const std::string& path)
+{
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return UNKNOWN_SIZE;
+    }
+    return (uint64_t)st.st_size;
+}
+
+/**
+ * Validates a header read from a file, so the payload it describes lies within the file
+ * @param header - the header
+ * @param fileBytes - the size of the file, or UNKNOWN_SIZE (the payload may then start at most
+ * MAX_STREAM_DATA_OFFSET bytes into the file)
+ */
+static void checkHeader(const MatrixFileHeader& header, uint64_t fileBytes)
+{
+    if (std::memcmp(header.magic, MAT_FILE_MAGIC, MAT_FILE_MAGIC_LEN) != 0 || header.version != MAT_FILE_VERSION ||
+        header.dtype != MAT_FILE_DTYPE_FLOAT32 || header.rows < NEGATIVE || header.cols < NEGATIVE ||
+        header.rows > INT32_MAX || header.stride > INT32_MAX || header.stride < header.cols ||
+        header.dataOffset < MAT_FILE_HEADER_SIZE || header.dataOffset % sizeof(float) != 0)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    if (header.stride != 0 && (uint64_t)header.rows > UINT64_MAX / sizeof(float) / (uint64_t)header.stride)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    uint64_t payloadBytes = (uint64_t)header.rows * (uint64_t)header.stride * sizeof(float);
+    if (fileBytes == UNKNOWN_SIZE ? header.dataOffset > MAX_STREAM_DATA_OFFSET :
+        (header.dataOffset > fileBytes || payloadBytes > fileBytes - header.dataOffset))
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+}
+
+/**
+ * Creates the file and writes the header
+ * @param path - the file path
+ * @param rows - num of rows in the matrix
+ * @param cols - num of cols in the matrix
+ * @param stride - the row stride stored in the file (0 means dense rows)
+ */
+MatrixFileWriter::MatrixFileWriter(const std::string& path, int rows, int cols, int stride) :
+        _os(path, std::ios::binary | std::ios::trunc), _rows(rows), _cols(cols),
+        _stride(stride == 0 ? cols : stride), _rowsWritten(0)
+{
+    checkHostEndianness();
+    if (!_os.is_open())
+    {
+        fileError(ERR_OPEN_MSG);
+    }
+    if (_rows < NEGATIVE || _cols < NEGATIVE || _stride < _cols)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, MAT_FILE_MAGIC, MAT_FILE_MAGIC_LEN);
+    header.version = MAT_FILE_VERSION;
+    header.dtype = MAT_FILE_DTYPE_FLOAT32;
+    header.rows = _rows;
+    header.cols = _cols;
+    header.stride = _stride;
+    header.dataOffset = MAT_FILE_HEADER_SIZE;
+    _os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+/**
+ * Destructor - closes the file
+ */
+MatrixFileWriter::~MatrixFileWriter()
+{
+    if (_os.is_open())
+    {
+        close();
+    }
+}
+
+/**
+ * Appends rows to the file
+ * @param data - pointer to the first element of the first row
+ * @param numRows - the number of rows to append
+ * @param srcStride - the row stride of data (in floats)
+ */
+void MatrixFileWriter::writeRows(const float* data, int numRows, int srcStride)
+{
+    if (_rowsWritten + numRows > _rows)
+    {
+        fileError(ERR_WRITE_MSG);
+    }
+    if (srcStride == _stride) // same layout, the rows (with their padding) go out in a single write
+    {
+        _os.write(reinterpret_cast<const char*>(data), (std::streamsize)numRows * _stride * sizeof(float));
+    }
+    else
+    {
+        std::vector<float> padding(_stride - _cols, 0);
+        for (int i = 0; i < numRows; i++)
+        {
+            _os.write(reinterpret_cast<const char*>(data + (size_t)i * srcStride), _cols * sizeof(float));
+            _os.write(reinterpret_cast<const char*>(padding.data()), padding.size() * sizeof(float));
+        }
+    }
+    if (!_os)
+    {
+        fileError(ERR_WRITE_MSG);
+    }
+    _rowsWritten += numRows;
+}
+
+/**
+ * Flushes and closes the file, all the rows must have been written
+ */
+void MatrixFileWriter::close()
+{
+    _os.close();
+    if (!_os || _rowsWritten != _rows)
+    {
+        fileError(ERR_WRITE_MSG);
+    }
+}
+
+/**
+ * Opens the file and reads the header
+ * @param path - the file path
+ */
+MatrixFileReader::MatrixFileReader(const std::string& path) : _is(path, std::ios::binary), _rows(0), _cols(0),
+                                                              _stride(0), _rowsRead(0)
+{
+    checkHostEndianness();
+    if (!_is.is_open())
+    {
+        fileError(ERR_OPEN_MSG);
+    }
+    MatrixFileHeader header{};
+    _is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!_is)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    checkHeader(header, regularFileSize(path));
+    auto gap = (std::streamsize)(header.dataOffset - MAT_FILE_HEADER_SIZE);
+    _is.ignore(gap); // ignore rather than seek, for pipes
+    if (!_is || _is.gcount() != gap)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    _rows = (int)header.rows;
+    _cols = (int)header.cols;
+    _stride = (int)header.stride;
+}
+
+/**
+ * Reads the next rows of the file
+ * @param data - pointer to the first element of the first row to fill
+ * @param numRows - the number of rows to read
+ * @param dstStride - the row stride of data (in floats)
+ */
+void MatrixFileReader::readRows(float* data, int numRows, int dstStride)
+{
+    if (numRows < NEGATIVE || _rowsRead + numRows > _rows)
+    {
+        fileError(ERR_READ_MSG);
+    }
+    if (dstStride == _stride) // same layout, a single read straight into the rows
+    {
+        _is.read(reinterpret_cast<char*>(data), (std::streamsize)numRows * _stride * sizeof(float));
+    }
+    else
+    {
+        for (int i = 0; i < numRows && _is; i++)
+        {
+            _is.read(reinterpret_cast<char*>(data + (size_t)i * dstStride), _cols * sizeof(float));
+            _is.ignore((std::streamsize)(_stride - _cols) * sizeof(float));
+        }
+    }
+    if (!_is)
+    {
+        fileError(ERR_READ_MSG);
+    }
+    _rowsRead += numRows;
+}
+
+/**
+ * Maps a binary matrix file
+ * @param path - the file path
+ */
+MappedMatrix::MappedMatrix(const std::string& path) : _map(nullptr), _mapBytes(0), _data(nullptr), _rows(0),
+                                                      _cols(0), _stride(0)
+{
+    checkHostEndianness();
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fileError(ERR_OPEN_MSG);
+    }
+    if ((uint64_t)st.st_size < MAT_FILE_HEADER_SIZE)
+    {
+        fileError(ERR_FORMAT_MSG);
+    }
+    _mapBytes = (size_t)st.st_size;
+    _map = mmap(nullptr, _mapBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (_map == MAP_FAILED)
+    {
+        _map = nullptr;
+        fileError(ERR_READ_MSG);
+    }
+
+    MatrixFileHeader header{};
+    std::memcpy(&header, _map, sizeof(header));
+    checkHeader(header, _mapBytes);
+    _rows = (int)header.rows;
+    _cols = (int)header.cols;
+    _stride = (int)header.stride;
+    _data = reinterpret_cast<const float*>(static_cast<const char*>(_map) + header.dataOffset);
+    madvise(_map, _mapBytes, MADV_SEQUENTIAL);
+}
+
+/**
+ * Move constructor - takes over the mapping
+ * @param m - the mapped matrix that is being moved, left empty
+ */
+MappedMatrix::MappedMatrix(MappedMatrix&& m) noexcept : _map(m._map), _mapBytes(m._mapBytes), _data(m._data),
+                                                        _rows(m._rows), _cols(m._cols), _stride(m._stride)
+{
+    m._map = nullptr;
+    m._mapBytes = 0;
+    m._data = nullptr;
+    m._rows = m._cols = m._stride = 0;
+}
+
+/**
+ * This method unmaps the file
+ */
+void MappedMatrix::_unmap()
+{
+    if (_map != nullptr)
+    {
+        munmap(_map, _mapBytes);
+        _map = nullptr;
+    }
+}
+
+/**
+ * Destructor - unmaps the file
+ */
+MappedMatrix::~MappedMatrix()
+{
+    _unmap();
+}
+
+/**
+ * Parenthesis indexing
+ * @param pos1 - num of row
+ * @param pos2 - num of column
+ * @return the number in the index in the matrix
+ */
+float MappedMatrix::operator()(int pos1, int pos2) const
+{
+    if (pos1 < NEGATIVE || pos1 > _rows - 1 || pos2 < NEGATIVE || pos2 > _cols - 1) // check indexes validity
+    {
+        fileError(ERR_INDEX_MSG);
+    }
+    return _data[(size_t)pos1 * _stride + pos2];
+}
+
+/**
+ * Copies the mapped matrix into memory
+ * @return a new matrix holding the elements
+ */
+Matrix MappedMatrix::toMatrix() const
+{
+    return Matrix(*this);
+}
+
+/**
+ * Saves a matrix as a binary matrix file (with its own row stride, so loading it back needs a single read)
+ * @param m - the matrix
+ * @param path - the file path
+ */
+void saveBinary(const Matrix& m, const std::string& path)
+{
+    MatrixFileWriter writer(path, m.getRows(), m.getCols(), m.getStride());
+    writer.writeRows(m.getData(), m.getRows(), m.getStride());
+    writer.close();
+}
+
+/**
+ * Loads a binary matrix file into memory
+ * @param path - the file path
+ * @return a new matrix holding the elements
+ */
+Matrix loadBinary(const std::string& path)
+{
+    MatrixFileReader reader(path);
+    Matrix m(reader.getRows(), reader.getCols());
+    reader.readRows(m.getData(), m.getRows(), m.getStride());
+    return m;
+}
\ No newline at end of file
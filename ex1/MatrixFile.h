@@ -0,0 +1,212 @@
+#ifndef EXERCISE5_MATRIXFILE_H
+#define EXERCISE5_MATRIXFILE_H
+
+#include "Matrix.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#define MAT_FILE_MAGIC "EX5MATRX"
+#define MAT_FILE_MAGIC_LEN 8
+#define MAT_FILE_VERSION 1
+#define MAT_FILE_DTYPE_FLOAT32 1
+#define MAT_FILE_HEADER_SIZE 64 // the payload starts on a cache line, so mapped rows keep the Matrix alignment
+
+/**
+ * The header of a binary matrix file, followed by rows * stride little-endian elements (row padding included).
+ * All fields are little-endian.
+ */
+struct MatrixFileHeader
+{
+    char magic[MAT_FILE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t dtype;
+    int64_t rows;
+    int64_t cols;
+    int64_t stride; // elements between the beginnings of two consecutive rows (>= cols)
+    uint64_t dataOffset; // byte offset of the payload from the beginning of the file
+    char reserved[16];
+};
+
+static_assert(sizeof(MatrixFileHeader) == MAT_FILE_HEADER_SIZE, "unexpected MatrixFileHeader layout");
+
+/**
+ * This class writes a binary matrix file row by row, so a matrix can be saved without holding it in memory
+ */
+class MatrixFileWriter
+{
+
+private:
+    std::ofstream _os;
+    int _rows, _cols, _stride;
+    int _rowsWritten;
+
+public:
+
+    /**
+     * Creates the file and writes the header
+     * @param path - the file path
+     * @param rows - num of rows in the matrix
+     * @param cols - num of cols in the matrix
+     * @param stride - the row stride stored in the file (0 means dense rows)
+     */
+    MatrixFileWriter(const std::string& path, int rows, int cols, int stride = 0);
+
+    MatrixFileWriter(const MatrixFileWriter&) = delete;
+    MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+    /**
+     * Destructor - closes the file
+     */
+    ~MatrixFileWriter();
+
+    /**
+     * Appends rows to the file
+     * @param data - pointer to the first element of the first row
+     * @param numRows - the number of rows to append
+     * @param srcStride - the row stride of data (in floats)
+     */
+    void writeRows(const float* data, int numRows, int srcStride);
+
+    /**
+     * Appends one row to the file
+     * @param row - the cols elements of the row
+     */
+    void writeRow(const float* row) { writeRows(row, 1, _cols); }
+
+    /**
+     * Flushes and closes the file, all the rows must have been written
+     */
+    void close();
+};
+
+/**
+ * This class reads a binary matrix file row by row, so a matrix can be processed without holding it in memory.
+ * The file is only read forward, so it may also be a pipe.
+ */
+class MatrixFileReader
+{
+
+private:
+    std::ifstream _is;
+    int _rows, _cols, _stride;
+    int _rowsRead;
+
+public:
+
+    /**
+     * Opens the file and reads the header
+     * @param path - the file path
+     */
+    explicit MatrixFileReader(const std::string& path);
+
+    MatrixFileReader(const MatrixFileReader&) = delete;
+    MatrixFileReader& operator=(const MatrixFileReader&) = delete;
+
+    int getRows() const { return _rows; }
+
+    int getCols() const { return _cols; }
+
+    /**
+     * Reads the next rows of the file
+     * @param data - pointer to the first element of the first row to fill
+     * @param numRows - the number of rows to read
+     * @param dstStride - the row stride of data (in floats)
+     */
+    void readRows(float* data, int numRows, int dstStride);
+};
+
+/**
+ * This class maps a binary matrix file read-only and exposes it as a matrix without copying it.
+ * It is a leaf of matrix expressions, so it can be used directly in element-wise arithmetic.
+ */
+class MappedMatrix : public MatrixExpr<MappedMatrix>
+{
+
+private:
+    void* _map; // the whole mapped file
+    size_t _mapBytes;
+    const float* _data;
+    int _rows, _cols, _stride;
+
+    /**
+     * This method unmaps the file
+     */
+    void _unmap();
+
+public:
+
+    /**
+     * Maps a binary matrix file
+     * @param path - the file path
+     */
+    explicit MappedMatrix(const std::string& path);
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    /**
+     * Move constructor - takes over the mapping
+     * @param m - the mapped matrix that is being moved, left empty
+     */
+    MappedMatrix(MappedMatrix&& m) noexcept;
+
+    /**
+     * Destructor - unmaps the file
+     */
+    ~MappedMatrix();
+
+    int getRows() const { return _rows; }
+
+    int getCols() const { return _cols; }
+
+    int getStride() const { return _stride; }
+
+    const float* getData() const { return _data; }
+
+    const float* row(int r) const { return _data + (size_t)r * _stride; }
+
+    bool claimBuffer(Matrix&) const { return false; }
+
+    bool unsafeInPlace(const float*, int) const { return false; } // a read-only mapping never overlaps a Matrix
+
+    /**
+     * Parenthesis indexing
+     * @param pos1 - num of row
+     * @param pos2 - num of column
+     * @return the number in the index in the matrix
+     */
+    float operator()(int pos1, int pos2) const;
+
+    /**
+     * Copies the mapped matrix into memory
+     * @return a new matrix holding the elements
+     */
+    Matrix toMatrix() const;
+};
+
+/**
+ * Wraps a mapped matrix as an expression leaf
+ * @param m - the mapped matrix
+ * @return the leaf node
+ */
+inline MatrixRef toNode(const MappedMatrix& m)
+{
+    return MatrixRef(m.getData(), m.getRows(), m.getCols(), m.getStride());
+}
+
+/**
+ * Saves a matrix as a binary matrix file (with its own row stride, so loading it back needs a single read)
+ * @param m - the matrix
+ * @param path - the file path
+ */
+void saveBinary(const Matrix& m, const std::string& path);
+
+/**
+ * Loads a binary matrix file into memory
+ * @param path - the file path
+ * @return a new matrix holding the elements
+ */
+Matrix loadBinary(const std::string& path);
+
+#endif //EXERCISE5_MATRIXFILE_H
@@ -0,0 +1,84 @@
+#include "Matrix.h"
+
+#define ERR_INDEX_MSG "Index out of range."
+#define NEGATIVE 0
+
+/**
+ * Prints the index out of range error and exits
+ */
+static void viewIndexError()
+{
+    std::cerr << ERR_INDEX_MSG << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Constructs a view of a whole matrix
+ * @param m - the matrix
+ */
+MatrixView::MatrixView(const Matrix& m) : MatrixView(m.getData(), m.getRows(), m.getCols(), m.getStride())
+{
+}
+
+/**
+ * Parenthesis indexing
+ * @param pos1 - num of row
+ * @param pos2 - num of column
+ * @return the number in the index in the view
+ */
+float MatrixView::operator()(int pos1, int pos2) const
+{
+    if (pos1 < NEGATIVE || pos1 > _rows - 1 || pos2 < NEGATIVE || pos2 > _cols - 1) // check indexes validity
+    {
+        viewIndexError();
+    }
+    return _data[(ptrdiff_t)pos1 * _rowStride + (ptrdiff_t)pos2 * _colStride];
+}
+
+/**
+ * A view of consecutive rows
+ * @param first - the first row
+ * @param count - the number of rows
+ * @return the view
+ */
+MatrixView MatrixView::rowRange(int first, int count) const
+{
+    return roi(first, 0, count, _cols);
+}
+
+/**
+ * A view of a rectangular region
+ * @param row - the top row
+ * @param col - the left column
+ * @param rows - the number of rows
+ * @param cols - the number of columns
+ * @return the view
+ */
+MatrixView MatrixView::roi(int row, int col, int rows, int cols) const
+{
+    if (row < NEGATIVE || col < NEGATIVE || rows < NEGATIVE || cols < NEGATIVE || row + rows > _rows ||
+        col + cols > _cols) // the region must lie inside the view
+    {
+        viewIndexError();
+    }
+    return MatrixView(_data + (ptrdiff_t)row * _rowStride + (ptrdiff_t)col * _colStride, rows, cols, _rowStride,
+                      _colStride);
+}
+
+/**
+ * A view of the transpose
+ * @return the view
+ */
+MatrixView MatrixView::transposed() const
+{
+    return MatrixView(_data, _cols, _rows, _colStride, _rowStride);
+}
+
+/**
+ * Copies the viewed elements into a new matrix
+ * @return the new matrix
+ */
+Matrix MatrixView::toMatrix() const
+{
+    return Matrix(*this);
+}
@@ -0,0 +1,114 @@
+#ifndef EXERCISE5_MATRIXVIEW_H
+#define EXERCISE5_MATRIXVIEW_H
+
+#include "MatrixExpr.h"
+
+/**
+ * This class represents a read-only, non-owning view of matrix elements: a pointer, dimensions and the strides
+ * (in floats) between consecutive rows and consecutive columns. Views of a whole Matrix, a range of rows, a
+ * rectangular region or the transpose are taken without copying, and are materialized only when assigned to a
+ * Matrix. A view must not outlive the matrix it refers to.
+ */
+class MatrixView : public MatrixExpr<MatrixView>
+{
+
+private:
+    const float* _data;
+    int _rows, _cols;
+    int _rowStride, _colStride;
+
+    /**
+     * Row cursor of a view
+     */
+    struct Row
+    {
+        const float* data;
+        int step;
+
+        float operator[](int c) const { return data[c * step]; }
+    };
+
+public:
+
+    /**
+     * Constructs a view of raw elements
+     * @param data - pointer to element (0, 0)
+     * @param rows - num of rows
+     * @param cols - num of cols
+     * @param rowStride - distance (in floats) between elements (r, c) and (r + 1, c)
+     * @param colStride - distance (in floats) between elements (r, c) and (r, c + 1)
+     */
+    MatrixView(const float* data, int rows, int cols, int rowStride, int colStride = 1) :
+            _data(data), _rows(rows), _cols(cols), _rowStride(rowStride), _colStride(colStride) {}
+
+    /**
+     * Constructs a view of a whole matrix
+     * @param m - the matrix
+     */
+    MatrixView(const Matrix& m);
+
+    int getRows() const { return _rows; }
+
+    int getCols() const { return _cols; }
+
+    int getRowStride() const { return _rowStride; }
+
+    int getColStride() const { return _colStride; }
+
+    const float* getData() const { return _data; }
+
+    /**
+     * Checks if the elements of each row are adjacent in memory
+     * @return true if the column stride is 1
+     */
+    bool hasContiguousRows() const { return _colStride == 1; }
+
+    /**
+     * Parenthesis indexing
+     * @param pos1 - num of row
+     * @param pos2 - num of column
+     * @return the number in the index in the view
+     */
+    float operator()(int pos1, int pos2) const;
+
+    /**
+     * A view of consecutive rows
+     * @param first - the first row
+     * @param count - the number of rows
+     * @return the view
+     */
+    MatrixView rowRange(int first, int count) const;
+
+    /**
+     * A view of a rectangular region
+     * @param row - the top row
+     * @param col - the left column
+     * @param rows - the number of rows
+     * @param cols - the number of columns
+     * @return the view
+     */
+    MatrixView roi(int row, int col, int rows, int cols) const;
+
+    /**
+     * A view of the transpose
+     * @return the view
+     */
+    MatrixView transposed() const;
+
+    /**
+     * Copies the viewed elements into a new matrix
+     * @return the new matrix
+     */
+    Matrix toMatrix() const;
+
+    Row row(int r) const { return {_data + r * _rowStride, _colStride}; }
+
+    bool claimBuffer(Matrix&) const { return false; }
+
+    bool unsafeInPlace(const float* dst, int dstStride) const
+    {
+        return leafUnsafeInPlace(_data, _rows, _cols, _rowStride, _colStride, dst, dstStride);
+    }
+};
+
+#endif //EXERCISE5_MATRIXVIEW_H
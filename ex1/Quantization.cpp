@@ -0,0 +1,385 @@
+#include "Quantization.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUANT_X86
+#include <immintrin.h>
+#endif
+
+#define ERR_LEVELS_MSG "Invalid quantization levels."
+#define AVX2_BYTES 32
+#define AVX512_BYTES 64
+#define VBMI_SHADES 128 // the table entries a two-source byte permute looks up at once
+
+/**
+ * A byte kernel quantizes n pixels of an 8-bit image through the byte form of a table
+ */
+typedef void (*QuantByteFn)(const QuantBytes& table, const uint8_t* in, uint8_t* out, int n);
+
+/**
+ * This struct describes the byte kernel of one instruction set
+ */
+struct QuantKernel
+{
+    const char* name;
+    QuantByteFn bytes;
+};
+
+/**
+ * Prints the invalid quantization levels error and exits
+ */
+static void levelsError()
+{
+    std::cerr << ERR_LEVELS_MSG << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Checks the number of levels of a table
+ * @param levels - the number of levels
+ */
+static void checkLevels(int levels)
+{
+    if (levels < 1 || levels > QUANT_MAX_LEVELS)
+    {
+        levelsError();
+    }
+}
+
+/**
+ * Portable byte kernel, also used by the AVX2 kernel for its tail and for tables of many runs
+ * @param table - the table
+ * @param in - the input pixels
+ * @param out - the output pixels
+ * @param n - num of pixels
+ */
+static void quantBytesScalar(const QuantBytes& table, const uint8_t* in, uint8_t* out, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = table.shades[in[i]];
+    }
+}
+
+#ifdef QUANT_X86
+
+/**
+ * AVX2 byte kernel: the run of each of 32 pixels is the number of run starts it is not below, and indexes a byte
+ * shuffle of the run shades
+ * @param table - the table
+ * @param in - the input pixels
+ * @param out - the output pixels
+ * @param n - num of pixels
+ */
+__attribute__((target("avx2")))
+static void quantBytesAvx2(const QuantBytes& table, const uint8_t* in, uint8_t* out, int n)
+{
+    if (table.runs == 0)
+    {
+        quantBytesScalar(table, in, out, n);
+        return;
+    }
+    __m256i runShades = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table.runShades));
+    __m256i starts[QUANT_MAX_RUNS];
+    for (int k = 1; k < table.runs; k++)
+    {
+        starts[k] = _mm256_set1_epi8((char)table.starts[k]);
+    }
+    int i = 0;
+    for (; i + AVX2_BYTES <= n; i += AVX2_BYTES)
+    {
+        __m256i val = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i run = _mm256_setzero_si256();
+        for (int k = 1; k < table.runs; k++)
+        {
+            // val >= start, unsigned, is all ones, subtracting it counts the start
+            run = _mm256_sub_epi8(run, _mm256_cmpeq_epi8(_mm256_max_epu8(val, starts[k]), val));
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_shuffle_epi8(runShades, run));
+    }
+    quantBytesScalar(table, in + i, out + i, n - i);
+}
+
+/**
+ * AVX-512 VBMI byte kernel: each half of the table is permuted by the low 7 bits of 64 pixels and the top bit
+ * picks the half, the tail is masked
+ * @param table - the table
+ * @param in - the input pixels
+ * @param out - the output pixels
+ * @param n - num of pixels
+ */
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void quantBytesAvx512(const QuantBytes& table, const uint8_t* in, uint8_t* out, int n)
+{
+    __m512i quarter0 = _mm512_loadu_si512(table.shades);
+    __m512i quarter1 = _mm512_loadu_si512(table.shades + AVX512_BYTES);
+    __m512i quarter2 = _mm512_loadu_si512(table.shades + VBMI_SHADES);
+    __m512i quarter3 = _mm512_loadu_si512(table.shades + VBMI_SHADES + AVX512_BYTES);
+    for (int i = 0; i < n; i += AVX512_BYTES)
+    {
+        __mmask64 mask = n - i >= AVX512_BYTES ? ~(__mmask64)0 : ((__mmask64)1 << (n - i)) - 1;
+        __m512i val = _mm512_maskz_loadu_epi8(mask, in + i);
+        __m512i low = _mm512_permutex2var_epi8(quarter0, val, quarter1);
+        __m512i high = _mm512_permutex2var_epi8(quarter2, val, quarter3);
+        _mm512_mask_storeu_epi8(out + i, mask, _mm512_mask_blend_epi8(_mm512_movepi8_mask(val), low, high));
+    }
+}
+
+#endif
+
+/**
+ * Lists the byte kernels the running cpu supports
+ * @return the byte kernels, the widest first
+ */
+static std::vector<QuantKernel> supportedKernels()
+{
+    std::vector<QuantKernel> kernels;
+#ifdef QUANT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw"))
+    {
+        kernels.push_back({"avx512vbmi", quantBytesAvx512});
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.push_back({"avx2", quantBytesAvx2});
+    }
+#endif
+    kernels.push_back({"scalar", quantBytesScalar});
+    return kernels;
+}
+
+/**
+ * Returns the byte kernel in use, the widest the cpu supports unless useQuantKernel picked another
+ * @return the byte kernel
+ */
+static QuantKernel& selectKernel()
+{
+    static QuantKernel kernel = supportedKernels().front();
+    return kernel;
+}
+
+/**
+ * Returns the name of the byte kernel QuantTable dispatches to on this cpu
+ * @return "avx512vbmi", "avx2" or "scalar"
+ */
+const char* quantKernelName()
+{
+    return selectKernel().name;
+}
+
+/**
+ * Makes QuantTable dispatch to a byte kernel the cpu supports instead of the widest one
+ * @param name - "avx512vbmi", "avx2" or "scalar"
+ * @return true if the cpu supports the kernel (otherwise the kernel is not changed)
+ */
+bool useQuantKernel(const char* name)
+{
+    for (const QuantKernel& kernel : supportedKernels())
+    {
+        if (std::strcmp(kernel.name, name) == 0)
+        {
+            selectKernel() = kernel;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Fills the table
+ * @param bounds - the first shade of every level but the first, ascending, in (0, QUANT_NUM_SHADES)
+ * @param shades - the output shade of every level
+ */
+void QuantTable::_fill(const std::vector<int>& bounds, const std::vector<float>& shades)
+{
+    int level = 0;
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        if (level < (int)bounds.size() && shade == bounds[level])
+        {
+            level++;
+        }
+        _shades[shade] = shades[level];
+        _bytes.shades[shade] = saturateCast<uint8_t>(shades[level]);
+    }
+    // levels whose shades saturate to the same byte make one run
+    _bytes.runs = 0;
+    std::fill(_bytes.starts, _bytes.starts + QUANT_MAX_RUNS, 0);
+    std::fill(_bytes.runShades, _bytes.runShades + QUANT_MAX_RUNS, 0);
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        if (shade > 0 && _bytes.shades[shade] == _bytes.shades[shade - 1])
+        {
+            continue;
+        }
+        if (_bytes.runs == QUANT_MAX_RUNS)
+        {
+            _bytes.runs = 0;
+            break;
+        }
+        _bytes.starts[_bytes.runs] = (uint8_t)shade;
+        _bytes.runShades[_bytes.runs] = _bytes.shades[shade];
+        _bytes.runs++;
+    }
+}
+
+/**
+ * Constructs a table of levels of any widths
+ * @param bounds - the first shade of every level but the first, strictly ascending, in (0, QUANT_NUM_SHADES)
+ * @param shades - the output shade of every level, one more than the bounds
+ */
+QuantTable::QuantTable(const std::vector<int>& bounds, const std::vector<float>& shades)
+{
+    if (shades.size() != bounds.size() + 1)
+    {
+        levelsError();
+    }
+    checkLevels((int)shades.size());
+    for (size_t k = 0; k < bounds.size(); k++)
+    {
+        if (bounds[k] <= (k == 0 ? 0 : bounds[k - 1]) || bounds[k] >= QUANT_NUM_SHADES)
+        {
+            levelsError();
+        }
+    }
+    _fill(bounds, shades);
+}
+
+/**
+ * The table of the quantization filter, built on the first call for every number of levels and kept
+ * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+ * @return the table, alive until the program ends
+ */
+const QuantTable& QuantTable::uniform(int levels)
+{
+    checkLevels(levels);
+    static std::mutex lock;
+    static std::unique_ptr<QuantTable> tables[QUANT_MAX_LEVELS + 1];
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<QuantTable>& table = tables[levels];
+    if (!table)
+    {
+        int range = QUANT_NUM_SHADES / levels; // the size of each range of shades that get the same output shade
+        std::vector<int> bounds;
+        std::vector<float> shades;
+        for (int k = 0; k < levels; k++)
+        {
+            if (k > 0)
+            {
+                bounds.push_back(k * range);
+            }
+            shades.push_back((float)(range / 2 - 1 + k * range));
+        }
+        table.reset(new QuantTable());
+        table->_fill(bounds, shades);
+    }
+    return *table;
+}
+
+/**
+ * Builds the table of levels holding about the same number of pixels
+ * @param histogram - the number of pixels of every shade
+ * @param levels - the number of levels
+ * @return the table
+ */
+QuantTable QuantTable::_equalized(const std::vector<long long>& histogram, int levels)
+{
+    checkLevels(levels);
+    std::vector<long long> below(QUANT_NUM_SHADES + 1, 0); // below[s] - the pixels of shades smaller than s
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        below[shade + 1] = below[shade] + histogram[shade];
+    }
+    std::vector<int> bounds;
+    std::vector<float> shades;
+    int lo = 0;
+    for (int k = 1; k <= levels; k++)
+    {
+        int hi = QUANT_NUM_SHADES;
+        if (k < levels)
+        {
+            // leave a shade for every level after this one
+            long long target = below[QUANT_NUM_SHADES] * k / levels;
+            hi = lo + 1;
+            while (hi < QUANT_NUM_SHADES - (levels - k) && below[hi] < target)
+            {
+                hi++;
+            }
+            bounds.push_back(hi);
+        }
+        shades.push_back((float)((lo + hi - 1) / 2));
+        lo = hi;
+    }
+    QuantTable table;
+    table._fill(bounds, shades);
+    return table;
+}
+
+/**
+ * Builds the table that equalizes the histogram of an image
+ * @param image - the 8-bit image
+ * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+ * @return the table
+ */
+QuantTable QuantTable::equalized(const ByteMatrix& image, int levels)
+{
+    std::vector<long long> histogram(QUANT_NUM_SHADES, 0);
+    for (int i = 0; i < image.getRows(); i++)
+    {
+        const uint8_t* row = image.getData() + (size_t)i * image.getStride();
+        for (int j = 0; j < image.getCols(); j++)
+        {
+            histogram[row[j]]++;
+        }
+    }
+    return _equalized(histogram, levels);
+}
+
+/**
+ * Builds the table that equalizes the histogram of an image
+ * @param image - the image (or a region of it)
+ * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+ * @return the table
+ */
+QuantTable QuantTable::equalized(const MatrixView& image, int levels)
+{
+    std::vector<long long> histogram(QUANT_NUM_SHADES, 0);
+    for (int i = 0; i < image.getRows(); i++)
+    {
+        auto row = image.row(i);
+        for (int j = 0; j < image.getCols(); j++)
+        {
+            histogram[shadeOf(row[j])]++;
+        }
+    }
+    return _equalized(histogram, levels);
+}
+
+/**
+ * Quantizes a row of an 8-bit image (in and out may be the same row)
+ * @param in - the input pixels
+ * @param out - the output pixels
+ * @param n - num of pixels
+ */
+void QuantTable::apply(const uint8_t* in, uint8_t* out, int n) const
+{
+    selectKernel().bytes(_bytes, in, out, n);
+}
+
+/**
+ * Quantizes a row of an image (in and out may be the same row)
+ * @param in - the input pixels
+ * @param out - the output pixels
+ * @param n - num of pixels
+ */
+void QuantTable::apply(const float* in, float* out, int n) const
+{
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = _shades[shadeOf(in[i])];
+    }
+}
\ No newline at end of file
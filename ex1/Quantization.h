@@ -0,0 +1,141 @@
+#ifndef EXERCISE5_QUANTIZATION_H
+#define EXERCISE5_QUANTIZATION_H
+
+#include "Matrix.h"
+#include <vector>
+
+#define QUANT_NUM_SHADES 256 // a table has an entry for every shade
+#define QUANT_MAX_LEVELS QUANT_NUM_SHADES
+#define QUANT_MAX_RUNS 16 // the runs a byte shuffle can tell apart
+
+/**
+ * The form a quantization table takes for 8-bit images
+ */
+struct QuantBytes
+{
+    uint8_t shades[QUANT_NUM_SHADES]; // the output shade of every shade, converted with saturateCast
+    int runs; // the number of runs of consecutive shades with the same output shade, 0 if over QUANT_MAX_RUNS
+    uint8_t starts[QUANT_MAX_RUNS]; // the first shade of every run
+    uint8_t runShades[QUANT_MAX_RUNS]; // the output shade of every run
+};
+
+/**
+ * This class represents a quantization table: the output shade of every input shade 0..255.
+ * The shades are cut into levels by ascending bounds, every shade of a level maps to the shade of that level.
+ * Input below 0 (and NaN) counts as shade 0, input above 255 as shade 255, and a float is cut to its integer part
+ * as the filters always did. 8-bit images are looked up 64 pixels at a time with AVX-512 VBMI byte permutes of the
+ * whole table, or 32 at a time with AVX2 by counting the runs a pixel is past and shuffling the run shades (for
+ * tables of up to QUANT_MAX_RUNS runs, as quantization to 16 levels or less), chosen once at runtime. Other element
+ * types go through the table one pixel at a time.
+ */
+class QuantTable
+{
+
+private:
+    float _shades[QUANT_NUM_SHADES];
+    QuantBytes _bytes;
+
+    /**
+     * Fills the table
+     * @param bounds - the first shade of every level but the first, ascending, in (0, QUANT_NUM_SHADES)
+     * @param shades - the output shade of every level
+     */
+    void _fill(const std::vector<int>& bounds, const std::vector<float>& shades);
+
+    /**
+     * Builds the table of levels holding about the same number of pixels
+     * @param histogram - the number of pixels of every shade
+     * @param levels - the number of levels
+     * @return the table
+     */
+    static QuantTable _equalized(const std::vector<long long>& histogram, int levels);
+
+    QuantTable() = default;
+
+public:
+
+    /**
+     * Constructs a table of levels of any widths
+     * @param bounds - the first shade of every level but the first, strictly ascending, in (0, QUANT_NUM_SHADES)
+     * @param shades - the output shade of every level, one more than the bounds
+     */
+    QuantTable(const std::vector<int>& bounds, const std::vector<float>& shades);
+
+    /**
+     * The table of the quantization filter: levels of QUANT_NUM_SHADES / levels shades (the last one takes the
+     * remainder), each mapped to its middle shade. Built on the first call for every number of levels and kept.
+     * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+     * @return the table, alive until the program ends
+     */
+    static const QuantTable& uniform(int levels);
+
+    /**
+     * Builds the table that equalizes the histogram of an image: the bounds cut it into levels holding about the
+     * same number of pixels, each mapped to its middle shade
+     * @param image - the 8-bit image
+     * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+     * @return the table
+     */
+    static QuantTable equalized(const ByteMatrix& image, int levels);
+
+    /**
+     * Builds the table that equalizes the histogram of an image
+     * @param image - the image (or a region of it)
+     * @param levels - the number of levels, in [1, QUANT_MAX_LEVELS]
+     * @return the table
+     */
+    static QuantTable equalized(const MatrixView& image, int levels);
+
+    /**
+     * The shade a pixel is looked up by
+     * @param val - the pixel
+     * @return its integer part, limited to [0, QUANT_NUM_SHADES - 1] (NaN gives 0)
+     */
+    static int shadeOf(double val)
+    {
+        if (val >= QUANT_NUM_SHADES - 1)
+        {
+            return QUANT_NUM_SHADES - 1;
+        }
+        return val >= 0 ? (int)val : 0;
+    }
+
+    /**
+     * Getter to an entry of the table
+     * @param shade - the input shade, in [0, QUANT_NUM_SHADES)
+     * @return the output shade
+     */
+    float operator[](int shade) const { return _shades[shade]; }
+
+    /**
+     * Quantizes a row of an 8-bit image (in and out may be the same row)
+     * @param in - the input pixels
+     * @param out - the output pixels
+     * @param n - num of pixels
+     */
+    void apply(const uint8_t* in, uint8_t* out, int n) const;
+
+    /**
+     * Quantizes a row of an image (in and out may be the same row)
+     * @param in - the input pixels
+     * @param out - the output pixels
+     * @param n - num of pixels
+     */
+    void apply(const float* in, float* out, int n) const;
+};
+
+/**
+ * Returns the name of the byte kernel QuantTable dispatches to on this cpu
+ * @return "avx512vbmi", "avx2" or "scalar"
+ */
+const char* quantKernelName();
+
+/**
+ * Makes QuantTable dispatch to a byte kernel the cpu supports instead of the widest one, so the kernels can be
+ * compared on one machine; it must not be called while a table is being applied
+ * @param name - "avx512vbmi", "avx2" or "scalar"
+ * @return true if the cpu supports the kernel (otherwise the kernel is not changed)
+ */
+bool useQuantKernel(const char* name);
+
+#endif //EXERCISE5_QUANTIZATION_H
\ No newline at end of file
@@ -0,0 +1,553 @@
+#ifndef EXERCISE5_STENCIL_H
+#define EXERCISE5_STENCIL_H
+
+#include "Matrix.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STENCIL_X86
+#include <immintrin.h>
+#endif
+
+#define STENCIL_ISA_SCALAR 0
+#define STENCIL_ISA_AVX2 1
+#define STENCIL_ISA_AVX512 2
+#define STENCIL_AVX2_LANES 8
+#define STENCIL_AVX512_LANES 16
+
+/**
+ * The taps of a 1-D kernel known at compile time: the weight of tap j is Nums[j] / 2^Shift, which is exact in float.
+ * The stencils below are unrolled over the taps by the compiler: a zero tap costs nothing, a weight of 1 or -1 is an
+ * add or a subtract, and two nonzero taps of one magnitude (as the 1, 0, -1 of a derivative) are summed or
+ * subtracted first and multiplied once, which for a power of two rounds the same as two products.
+ * @tparam Shift - the power of two the numerators are divided by
+ * @tparam Nums - the numerators, an odd number of them
+ */
+template <int Shift, int... Nums>
+struct StencilTaps
+{
+    static_assert(sizeof...(Nums) % 2 == 1, "a stencil has an odd number of taps");
+    static_assert(Shift >= 0 && Shift < 31, "the weights are divided by a power of two of an int");
+
+    static constexpr int size = sizeof...(Nums);
+    static constexpr int radius = size / 2;
+    static constexpr int nums[size] = {Nums...};
+
+    /**
+     * The weight of a tap
+     * @param j - the tap
+     * @return Nums[j] / 2^Shift
+     */
+    static constexpr float weight(int j) { return (float)nums[j] / (float)(1 << Shift); }
+
+    /**
+     * The first nonzero tap
+     * @param from - the tap to look from
+     * @return the first nonzero tap from it, size if there is none
+     */
+    static constexpr int first(int from)
+    {
+        while (from < size && nums[from] == 0)
+        {
+            from++;
+        }
+        return from;
+    }
+
+    /**
+     * The number of nonzero taps
+     * @return the number
+     */
+    static constexpr int count()
+    {
+        int n = 0;
+        for (int j = first(0); j < size; j = first(j + 1))
+        {
+            n++;
+        }
+        return n;
+    }
+
+    /**
+     * Checks if the nonzero taps are two of one magnitude, a power of two, so their products factor exactly
+     * @return true if they are
+     */
+    static constexpr bool paired()
+    {
+        if (count() != 2)
+        {
+            return false;
+        }
+        int a = nums[first(0)];
+        int b = nums[first(first(0) + 1)];
+        int magnitude = a < 0 ? -a : a;
+        return (a == b || a == -b) && (magnitude & (magnitude - 1)) == 0;
+    }
+};
+
+/**
+ * A 2-D kernel known at compile time as the product of a vertical and a horizontal kernel:
+ * weight(i, j) = Col weight i * Row weight j. It runs the way convolve runs a separable kernel (every row of the
+ * neighbourhood summed through Row, the partial sums through Col, the taps in order), so for such weights its result
+ * is the result of convolve on matrix(), bit for bit.
+ * @tparam ColTaps - the vertical taps, a StencilTaps
+ * @tparam RowTaps - the horizontal taps, a StencilTaps
+ */
+template <typename ColTaps, typename RowTaps>
+struct SeparableStencil
+{
+    typedef ColTaps Col;
+    typedef RowTaps Row;
+
+    /**
+     * The kernel as a matrix, for the runtime convolution
+     * @return new Col::size x Row::size matrix of the weights
+     */
+    static Matrix matrix()
+    {
+        Matrix kernel(Col::size, Row::size);
+        for (int i = 0; i < Col::size; i++)
+        {
+            for (int j = 0; j < Row::size; j++)
+            {
+                kernel(i, j) = Col::weight(i) * Row::weight(j);
+            }
+        }
+        return kernel;
+    }
+};
+
+/**
+ * Returns the instruction set the stencils run with on this cpu, detected once
+ * @return STENCIL_ISA_AVX512, STENCIL_ISA_AVX2 or STENCIL_ISA_SCALAR
+ */
+inline int stencilIsa()
+{
+#ifdef STENCIL_X86
+    static const int isa = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return STENCIL_ISA_AVX512;
+        }
+        return __builtin_cpu_supports("avx2") ? STENCIL_ISA_AVX2 : STENCIL_ISA_SCALAR;
+    }();
+    return isa;
+#else
+    return STENCIL_ISA_SCALAR;
+#endif
+}
+
+/**
+ * Sums values through the taps of a 1-D kernel
+ * @param x - the Taps::size values
+ * @return the weighted sum
+ */
+template <typename Taps, size_t... J>
+inline float stencilTapsScalar(const float* x, std::index_sequence<J...>)
+{
+    constexpr int f = Taps::first(0);
+    if constexpr (Taps::count() == 0)
+    {
+        return 0;
+    }
+    else if constexpr (Taps::paired())
+    {
+        constexpr int s = Taps::first(f + 1);
+        return (Taps::nums[f] == Taps::nums[s] ? x[f] + x[s] : x[f] - x[s]) * Taps::weight(f);
+    }
+    else
+    {
+        float sum = x[f] * Taps::weight(f);
+        ((sum = (int)J > f && Taps::nums[J] != 0 ? sum + x[J] * Taps::weight(J) : sum), ...);
+        return sum;
+    }
+}
+
+/**
+ * Sums a row of the neighbourhood of a pixel through the horizontal taps, reading zeros outside the row
+ * @param in - the row
+ * @param c - the column of the pixel
+ * @param cols - num of cols in the row
+ * @return the partial sum
+ */
+template <typename Row, size_t... J>
+inline float stencilRowScalar(const float* in, int c, int cols, std::index_sequence<J...>)
+{
+    float x[Row::size];
+    ((x[J] = c + (int)J - Row::radius >= 0 && c + (int)J - Row::radius < cols ? in[c + (int)J - Row::radius] : 0),
+     ...);
+    return stencilTapsScalar<Row>(x, std::make_index_sequence<Row::size>());
+}
+
+/**
+ * The response of a stencil at one pixel
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius (rows outside the image are zeros)
+ * @param c - the column of the pixel
+ * @param cols - num of cols in the image
+ * @return the sum convolve computes there (not rounded)
+ */
+template <typename S, size_t... I>
+inline float stencilResponseScalar(const float* const* center, int c, int cols, std::index_sequence<I...>)
+{
+    typedef typename S::Col Col;
+    typedef typename S::Row Row;
+    float partials[Col::size];
+    ((partials[I] = Col::nums[I] == 0 ? 0 : stencilRowScalar<Row>(center[(int)I - Col::radius], c, cols,
+                                                                    std::make_index_sequence<Row::size>())), ...);
+    // convolve starts its sums from +0, which turns a -0 into +0
+    return 0.0f + stencilTapsScalar<Col>(partials, std::make_index_sequence<Col::size>());
+}
+
+/**
+ * The response of a stencil at one pixel, rounded to the nearest integer with rintf
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param c - the column of the pixel
+ * @param cols - num of cols in the image
+ * @return the rounded sum
+ */
+template <typename S>
+inline float stencilRoundedScalar(const float* const* center, int c, int cols)
+{
+    return rintf(stencilResponseScalar<S>(center, c, cols, std::make_index_sequence<S::Col::size>()));
+}
+
+/**
+ * Computes output pixels [begin, end) of a row of convolveStencils, reading zeros outside the image
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param cols - num of cols in the image
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param out - the output row
+ * @param begin - the first pixel
+ * @param end - the pixel after the last one
+ */
+template <typename S, typename... Rest>
+inline void stencilPixelsScalar(const float* const* center, int cols, float lo, float hi, float* out, int begin,
+                                int end)
+{
+    for (int c = begin; c < end; c++)
+    {
+        float val = stencilRoundedScalar<S>(center, c, cols);
+        ((val += stencilRoundedScalar<Rest>(center, c, cols)), ...);
+        out[c] = val < lo ? lo : (val > hi ? hi : val);
+    }
+}
+
+#ifdef STENCIL_X86
+
+/**
+ * Sums 8 lanes of values through the taps of a 1-D kernel, as stencilTapsScalar
+ * @param x - the Taps::size vectors
+ * @return the weighted sums
+ */
+template <typename Taps, size_t... J>
+__attribute__((target("avx2")))
+inline __m256 stencilTapsAvx2(const __m256* x, std::index_sequence<J...>)
+{
+    constexpr int f = Taps::first(0);
+    if constexpr (Taps::count() == 0)
+    {
+        return _mm256_setzero_ps();
+    }
+    else if constexpr (Taps::paired())
+    {
+        constexpr int s = Taps::first(f + 1);
+        __m256 both = Taps::nums[f] == Taps::nums[s] ? _mm256_add_ps(x[f], x[s]) : _mm256_sub_ps(x[f], x[s]);
+        return Taps::weight(f) == 1 ? both : _mm256_mul_ps(both, _mm256_set1_ps(Taps::weight(f)));
+    }
+    else
+    {
+        __m256 sum = Taps::weight(f) == 1 ? x[f] : _mm256_mul_ps(x[f], _mm256_set1_ps(Taps::weight(f)));
+        ((sum = (int)J <= f || Taps::nums[J] == 0 ? sum
+                : Taps::weight(J) == 1 ? _mm256_add_ps(sum, x[J])
+                : Taps::weight(J) == -1 ? _mm256_sub_ps(sum, x[J])
+                : _mm256_add_ps(sum, _mm256_mul_ps(x[J], _mm256_set1_ps(Taps::weight(J))))), ...);
+        return sum;
+    }
+}
+
+/**
+ * Sums a row of the neighbourhoods of 8 pixels through the horizontal taps
+ * @param in - the first pixel of the first neighbourhood in the row
+ * @return the partial sums
+ */
+template <typename Row, size_t... J>
+__attribute__((target("avx2")))
+inline __m256 stencilRowAvx2(const float* in, std::index_sequence<J...>)
+{
+    __m256 x[Row::size];
+    ((x[J] = _mm256_loadu_ps(in + J)), ...);
+    return stencilTapsAvx2<Row>(x, std::make_index_sequence<Row::size>());
+}
+
+/**
+ * The responses of a stencil at 8 pixels, as stencilResponseScalar
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param c - the first pixel
+ * @return the sums convolve computes there (not rounded)
+ */
+template <typename S, size_t... I>
+__attribute__((target("avx2")))
+inline __m256 stencilResponseAvx2(const float* const* center, int c, std::index_sequence<I...>)
+{
+    typedef typename S::Col Col;
+    typedef typename S::Row Row;
+    __m256 partials[Col::size];
+    ((partials[I] = Col::nums[I] == 0 ? _mm256_setzero_ps()
+                    : stencilRowAvx2<Row>(center[(int)I - Col::radius] + c - Row::radius,
+                                          std::make_index_sequence<Row::size>())), ...);
+    return _mm256_add_ps(_mm256_setzero_ps(), stencilTapsAvx2<Col>(partials, std::make_index_sequence<Col::size>()));
+}
+
+/**
+ * The responses of a stencil at 8 pixels, rounded to the nearest integers as rintf does
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param c - the first pixel
+ * @return the rounded sums
+ */
+template <typename S>
+__attribute__((target("avx2")))
+inline __m256 stencilRoundedAvx2(const float* const* center, int c)
+{
+    __m256 sum = stencilResponseAvx2<S>(center, c, std::make_index_sequence<S::Col::size>());
+    return _mm256_round_ps(sum, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/**
+ * AVX2 row of convolveStencils: 8 pixels at a time, the tail scalar. Only reads inside the image, the caller keeps
+ * the border out of [begin, end).
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param cols - num of cols in the image
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param out - the output row
+ * @param begin - the first pixel
+ * @param end - the pixel after the last one
+ */
+template <typename S, typename... Rest>
+__attribute__((target("avx2")))
+void stencilPixelsAvx2(const float* const* center, int cols, float lo, float hi, float* out, int begin, int end)
+{
+    __m256 loV = _mm256_set1_ps(lo);
+    __m256 hiV = _mm256_set1_ps(hi);
+    int c = begin;
+    for (; c + STENCIL_AVX2_LANES <= end; c += STENCIL_AVX2_LANES)
+    {
+        __m256 val = stencilRoundedAvx2<S>(center, c);
+        ((val = _mm256_add_ps(val, stencilRoundedAvx2<Rest>(center, c))), ...);
+        // max and min return their second operand on NaN, so NaN passes through
+        _mm256_storeu_ps(out + c, _mm256_min_ps(hiV, _mm256_max_ps(loV, val)));
+    }
+    stencilPixelsScalar<S, Rest...>(center, cols, lo, hi, out, c, end);
+}
+
+// AVX-512F brings FMA along, the products and sums must stay separate roundings as in convolve, so they use the
+// explicit-rounding forms, which the compiler does not contract (the masked ones, all lanes)
+#define STENCIL_ALL512 ((__mmask16)0xFFFF)
+#define STENCIL_MUL512(a, b) _mm512_maskz_mul_round_ps(STENCIL_ALL512, (a), (b), _MM_FROUND_CUR_DIRECTION)
+#define STENCIL_ADD512(a, b) _mm512_maskz_add_round_ps(STENCIL_ALL512, (a), (b), _MM_FROUND_CUR_DIRECTION)
+#define STENCIL_SUB512(a, b) _mm512_maskz_sub_round_ps(STENCIL_ALL512, (a), (b), _MM_FROUND_CUR_DIRECTION)
+
+/**
+ * Sums 16 lanes of values through the taps of a 1-D kernel, as stencilTapsScalar
+ * @param x - the Taps::size vectors
+ * @return the weighted sums
+ */
+template <typename Taps, size_t... J>
+__attribute__((target("avx512f")))
+inline __m512 stencilTapsAvx512(const __m512* x, std::index_sequence<J...>)
+{
+    constexpr int f = Taps::first(0);
+    if constexpr (Taps::count() == 0)
+    {
+        return _mm512_setzero_ps();
+    }
+    else if constexpr (Taps::paired())
+    {
+        constexpr int s = Taps::first(f + 1);
+        __m512 both = Taps::nums[f] == Taps::nums[s] ? STENCIL_ADD512(x[f], x[s]) : STENCIL_SUB512(x[f], x[s]);
+        return Taps::weight(f) == 1 ? both : STENCIL_MUL512(both, _mm512_set1_ps(Taps::weight(f)));
+    }
+    else
+    {
+        __m512 sum = Taps::weight(f) == 1 ? x[f] : STENCIL_MUL512(x[f], _mm512_set1_ps(Taps::weight(f)));
+        ((sum = (int)J <= f || Taps::nums[J] == 0 ? sum
+                : Taps::weight(J) == 1 ? STENCIL_ADD512(sum, x[J])
+                : Taps::weight(J) == -1 ? STENCIL_SUB512(sum, x[J])
+                : STENCIL_ADD512(sum, STENCIL_MUL512(x[J], _mm512_set1_ps(Taps::weight(J))))), ...);
+        return sum;
+    }
+}
+
+/**
+ * Sums a row of the neighbourhoods of 16 pixels through the horizontal taps
+ * @param in - the first pixel of the first neighbourhood in the row
+ * @param mask - the lanes to read
+ * @return the partial sums
+ */
+template <typename Row, size_t... J>
+__attribute__((target("avx512f")))
+inline __m512 stencilRowAvx512(const float* in, __mmask16 mask, std::index_sequence<J...>)
+{
+    __m512 x[Row::size];
+    ((x[J] = _mm512_maskz_loadu_ps(mask, in + J)), ...);
+    return stencilTapsAvx512<Row>(x, std::make_index_sequence<Row::size>());
+}
+
+/**
+ * The responses of a stencil at 16 pixels, as stencilResponseScalar
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param c - the first pixel
+ * @param mask - the lanes to read
+ * @return the sums convolve computes there (not rounded)
+ */
+template <typename S, size_t... I>
+__attribute__((target("avx512f")))
+inline __m512 stencilResponseAvx512(const float* const* center, int c, __mmask16 mask, std::index_sequence<I...>)
+{
+    typedef typename S::Col Col;
+    typedef typename S::Row Row;
+    __m512 partials[Col::size];
+    ((partials[I] = Col::nums[I] == 0 ? _mm512_setzero_ps()
+                    : stencilRowAvx512<Row>(center[(int)I - Col::radius] + c - Row::radius, mask,
+                                            std::make_index_sequence<Row::size>())), ...);
+    return STENCIL_ADD512(_mm512_setzero_ps(), stencilTapsAvx512<Col>(partials, std::make_index_sequence<Col::size>()));
+}
+
+/**
+ * The responses of a stencil at 16 pixels, rounded to the nearest integers as rintf does
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param c - the first pixel
+ * @param mask - the lanes to read
+ * @return the rounded sums
+ */
+template <typename S>
+__attribute__((target("avx512f")))
+inline __m512 stencilRoundedAvx512(const float* const* center, int c, __mmask16 mask)
+{
+    __m512 sum = stencilResponseAvx512<S>(center, c, mask, std::make_index_sequence<S::Col::size>());
+    return _mm512_maskz_roundscale_ps(mask, sum, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+/**
+ * AVX-512 row of convolveStencils: 16 pixels at a time, the tail masked. Only reads inside the image, the caller
+ * keeps the border out of [begin, end).
+ * @param center - the rows of the neighbourhood, indexed from -radius to radius
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param out - the output row
+ * @param begin - the first pixel
+ * @param end - the pixel after the last one
+ */
+template <typename S, typename... Rest>
+__attribute__((target("avx512f")))
+void stencilPixelsAvx512(const float* const* center, float lo, float hi, float* out, int begin, int end)
+{
+    __m512 loV = _mm512_set1_ps(lo);
+    __m512 hiV = _mm512_set1_ps(hi);
+    for (int c = begin; c < end; c += STENCIL_AVX512_LANES)
+    {
+        __mmask16 mask = end - c >= STENCIL_AVX512_LANES ? STENCIL_ALL512 : (__mmask16)((1u << (end - c)) - 1);
+        __m512 val = stencilRoundedAvx512<S>(center, c, mask);
+        ((val = STENCIL_ADD512(val, stencilRoundedAvx512<Rest>(center, c, mask))), ...);
+        // max and min return their second operand on NaN, so NaN passes through
+        _mm512_mask_storeu_ps(out + c, mask, _mm512_maskz_min_ps(mask, hiV, _mm512_maskz_max_ps(mask, loV, val)));
+    }
+}
+
+#endif //STENCIL_X86
+
+/**
+ * Convolves an image with stencils known at compile time, rounds every response to the nearest integer with rintf,
+ * adds the rounded responses and clamps the sum to [lo, hi] (NaN is kept): with one stencil it is convolve followed
+ * by clampValues, with two the operator of convolveGradients. Each response is summed with the float operations
+ * convolve uses for the stencil's matrix(), so the result is the same bit for bit (for finite pixels), only with the
+ * taps unrolled, the zero taps left out and the border rows read from a row of zeros, in one pass over the image.
+ * The rows run in parallel bands on ThreadPool::shared(), as convolve does.
+ * @tparam Stencils - the stencils, SeparableStencil types
+ * @param image - the image
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @param res - the output, of the image dimensions, must not overlap the image
+ */
+template <typename... Stencils>
+void convolveStencils(const MatrixView& image, float lo, float hi, Matrix& res)
+{
+    static_assert(sizeof...(Stencils) > 0, "convolveStencils needs a stencil");
+    if (res.getRows() != image.getRows() || res.getCols() != image.getCols())
+    {
+        matrixDimError();
+    }
+    if (!image.hasContiguousRows()) // the rows are read in place
+    {
+        Matrix copy = image.toMatrix();
+        convolveStencils<Stencils...>(MatrixView(copy), lo, hi, res);
+        return;
+    }
+    constexpr int radiusY = std::max({Stencils::Col::radius...});
+    constexpr int radiusX = std::max({Stencils::Row::radius...});
+    constexpr long long taps = ((Stencils::Col::count() * Stencils::Row::count()) + ...);
+    int rows = image.getRows();
+    int cols = image.getCols();
+    if (rows == 0 || cols == 0)
+    {
+        return;
+    }
+    std::vector<float> zeros(cols); // a row outside the image
+    int isa = stencilIsa();
+    int interiorBegin = std::min(radiusX, cols);
+    int interiorEnd = std::max(cols - radiusX, interiorBegin);
+    ThreadPool::shared().parallelRows(rows, cols * std::max(taps, 1LL), [&](int begin, int end, int)
+    {
+        const float* in[2 * radiusY + 1];
+        for (int r = begin; r < end; r++)
+        {
+            for (int i = 0; i <= 2 * radiusY; i++)
+            {
+                int y = r + i - radiusY;
+                in[i] = y >= 0 && y < rows ? image.getData() + (size_t)y * image.getRowStride() : zeros.data();
+            }
+            const float* const* center = in + radiusY;
+            float* out = res.getData() + (size_t)r * res.getStride();
+            stencilPixelsScalar<Stencils...>(center, cols, lo, hi, out, 0, interiorBegin);
+            stencilPixelsScalar<Stencils...>(center, cols, lo, hi, out, interiorEnd, cols);
+#ifdef STENCIL_X86
+            if (isa == STENCIL_ISA_AVX512)
+            {
+                stencilPixelsAvx512<Stencils...>(center, lo, hi, out, interiorBegin, interiorEnd);
+                continue;
+            }
+            if (isa == STENCIL_ISA_AVX2)
+            {
+                stencilPixelsAvx2<Stencils...>(center, cols, lo, hi, out, interiorBegin, interiorEnd);
+                continue;
+            }
+#endif
+            stencilPixelsScalar<Stencils...>(center, cols, lo, hi, out, interiorBegin, interiorEnd);
+        }
+    });
+}
+
+/**
+ * Convolves an image with stencils known at compile time, as convolveStencils into a new matrix
+ * @tparam Stencils - the stencils, SeparableStencil types
+ * @param image - the image
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @return new matrix holding the combined image
+ */
+template <typename... Stencils>
+Matrix convolveStencils(const MatrixView& image, float lo, float hi)
+{
+    Matrix res(image.getRows(), image.getCols());
+    convolveStencils<Stencils...>(image, lo, hi, res);
+    return res;
+}
+
+#endif //EXERCISE5_STENCIL_H
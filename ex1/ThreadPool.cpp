@@ -0,0 +1,261 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+#define NO_WORKER (-1)
+
+static thread_local const ThreadPool* tlsPool = nullptr; // the pool this thread runs a task of
+static thread_local int tlsWorker = NO_WORKER; // the worker index of this thread in tlsPool while it runs a task
+
+/**
+ * The worker index a call running inline on this thread gets from a pool, an index of another pool may be out of its
+ * range so the call gets the caller index then
+ * @param pool - the pool
+ * @return the worker index
+ */
+static int inlineWorker(const ThreadPool* pool)
+{
+    return tlsPool == pool ? tlsWorker : POOL_CALLER_WORKER;
+}
+
+/**
+ * The storage of the shared pool
+ * @return the shared pool slot
+ */
+static std::unique_ptr<ThreadPool>& sharedSlot()
+{
+    static std::unique_ptr<ThreadPool> pool;
+    return pool;
+}
+
+/**
+ * Constructs a pool
+ * @param numThreads - the number of threads working on each job, including the caller (0 means one per core)
+ */
+ThreadPool::ThreadPool(int numThreads): _job(nullptr), _generation(0), _busyWorkers(0), _stop(false)
+{
+    if (numThreads <= 0)
+    {
+        numThreads = (int)std::thread::hardware_concurrency();
+    }
+    _numThreads = numThreads > 0 ? numThreads : 1;
+    _queues.reset(new WorkerQueue[_numThreads]);
+    for (int w = 1; w < _numThreads; w++)
+    {
+        _threads.emplace_back(&ThreadPool::_workerLoop, this, w);
+    }
+}
+
+/**
+ * Destructor - stops and joins the worker threads
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_wakeLock);
+        _stop = true;
+    }
+    _wakeCv.notify_all();
+    for (auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+/**
+ * The loop run by every background thread
+ * @param worker - the index of the worker
+ */
+void ThreadPool::_workerLoop(int worker)
+{
+    long seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_wakeLock);
+            _wakeCv.wait(lock, [&] { return _stop || _generation != seen; });
+            if (_stop)
+            {
+                return;
+            }
+            seen = _generation;
+        }
+        _runTasks(worker);
+        std::lock_guard<std::mutex> guard(_wakeLock);
+        if (--_busyWorkers == 0)
+        {
+            _doneCv.notify_all();
+        }
+    }
+}
+
+/**
+ * Takes the next task for a worker
+ * @param worker - the index of the worker
+ * @param task - set to the task index
+ * @return true if a task was found, false if all the queues are empty
+ */
+bool ThreadPool::_takeTask(int worker, int& task)
+{
+    {
+        WorkerQueue& own = _queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // steal from the back, the end furthest from where the owner is working
+    for (int i = 1; i < _numThreads; i++)
+    {
+        WorkerQueue& victim = _queues[(worker + i) % _numThreads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs tasks of the current job, first from the worker's own queue and then stolen from others
+ * @param worker - the index of the worker
+ */
+void ThreadPool::_runTasks(int worker)
+{
+    tlsPool = this;
+    tlsWorker = worker;
+    int task;
+    while (_takeTask(worker, task))
+    {
+        try
+        {
+            (*_job)(task, worker);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(_wakeLock);
+            if (!_error)
+            {
+                _error = std::current_exception();
+            }
+        }
+    }
+    tlsPool = nullptr;
+    tlsWorker = NO_WORKER;
+}
+
+/**
+ * Runs body(task, worker) for every task in [0, numTasks) and returns once all of them finished.
+ * @param numTasks - the number of tasks
+ * @param body - the task function, if it throws the first exception is rethrown here
+ */
+void ThreadPool::parallelFor(int numTasks, const std::function<void(int, int)>& body)
+{
+    if (tlsWorker != NO_WORKER || _numThreads == 1 || numTasks == 1) // nested or nothing to share, run inline
+    {
+        int worker = inlineWorker(this);
+        for (int task = 0; task < numTasks; task++)
+        {
+            body(task, worker);
+        }
+        return;
+    }
+    if (numTasks <= 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> jobGuard(_jobLock);
+    // deal contiguous runs of tasks to the workers, neighbouring tasks tend to share data
+    for (int w = 0; w < _numThreads; w++)
+    {
+        int begin = (int)((long long)numTasks * w / _numThreads);
+        int end = (int)((long long)numTasks * (w + 1) / _numThreads);
+        std::lock_guard<std::mutex> guard(_queues[w].lock);
+        for (int task = begin; task < end; task++)
+        {
+            _queues[w].tasks.push_back(task);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(_wakeLock);
+        _job = &body;
+        _error = nullptr;
+        _busyWorkers = (int)_threads.size();
+        _generation++;
+    }
+    _wakeCv.notify_all();
+    _runTasks(POOL_CALLER_WORKER);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(_wakeLock);
+        _doneCv.wait(lock, [&] { return _busyWorkers == 0; });
+        _job = nullptr;
+        error = _error;
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Runs body(begin, end, worker) over bands of consecutive rows that cover [0, rows), in parallel
+ * @param rows - num of rows
+ * @param rowWork - the work of a row, e.g. its number of pixels
+ * @param body - the band function
+ */
+void ThreadPool::parallelRows(int rows, long long rowWork, const std::function<void(int, int, int)>& body)
+{
+    if (rows <= 0)
+    {
+        return;
+    }
+    long long bands = 1;
+    if (tlsWorker == NO_WORKER && _numThreads > 1)
+    {
+        bands = std::min((long long)rows * rowWork / POOL_BAND_WORK, (long long)_numThreads * POOL_BANDS_PER_THREAD);
+        bands = std::max(1LL, std::min(bands, (long long)rows));
+    }
+    if (bands == 1)
+    {
+        body(0, rows, inlineWorker(this));
+        return;
+    }
+    parallelFor((int)bands, [&](int band, int worker)
+    {
+        body((int)(rows * band / bands), (int)(rows * (band + 1) / bands), worker);
+    });
+}
+
+/**
+ * The pool shared by the library (created on first use, one thread per core)
+ * @return the shared pool
+ */
+ThreadPool& ThreadPool::shared()
+{
+    static std::once_flag created;
+    std::call_once(created, [] {
+        if (!sharedSlot())
+        {
+            sharedSlot().reset(new ThreadPool(0));
+        }
+    });
+    return *sharedSlot();
+}
+
+/**
+ * Replaces the shared pool by one with the given number of threads, must not be called while it is working
+ * @param numThreads - the number of threads (0 means one per core)
+ */
+void ThreadPool::setSharedThreads(int numThreads)
+{
+    shared(); // make sure the lazy creation already happened
+    sharedSlot().reset(new ThreadPool(numThreads));
+}
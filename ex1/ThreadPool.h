@@ -0,0 +1,124 @@
+#ifndef EXERCISE5_THREADPOOL_H
+#define EXERCISE5_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define POOL_CALLER_WORKER 0 // the thread calling parallelFor works as worker 0
+#define POOL_BAND_WORK 32768 // the least work (e.g. pixels) parallelRows gives a band
+#define POOL_BANDS_PER_THREAD 4 // parallelRows cuts at most this many bands per thread, to even out the load
+
+/**
+ * This class represents a persistent pool of worker threads.
+ * Every parallelFor call deals its tasks out to per-worker queues; a worker that runs out of its own tasks
+ * steals from the back of the other queues, so uneven tasks still keep every thread busy.
+ */
+class ThreadPool
+{
+
+private:
+
+    /**
+     * A queue of task indices owned by one worker (others may steal from its back)
+     */
+    struct WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    int _numThreads; // workers including the calling thread
+    std::vector<std::thread> _threads;
+    std::unique_ptr<WorkerQueue[]> _queues;
+
+    std::mutex _jobLock; // one parallelFor at a time
+    std::mutex _wakeLock;
+    std::condition_variable _wakeCv, _doneCv;
+    const std::function<void(int, int)>* _job;
+    long _generation; // bumped for every job, workers wake up when it changes
+    int _busyWorkers;
+    bool _stop;
+    std::exception_ptr _error; // the first exception thrown by a task of the current job
+
+    /**
+     * The loop run by every background thread
+     * @param worker - the index of the worker
+     */
+    void _workerLoop(int worker);
+
+    /**
+     * Runs tasks of the current job, first from the worker's own queue and then stolen from others
+     * @param worker - the index of the worker
+     */
+    void _runTasks(int worker);
+
+    /**
+     * Takes the next task for a worker
+     * @param worker - the index of the worker
+     * @param task - set to the task index
+     * @return true if a task was found, false if all the queues are empty
+     */
+    bool _takeTask(int worker, int& task);
+
+public:
+
+    /**
+     * Constructs a pool
+     * @param numThreads - the number of threads working on each job, including the caller (0 means one per core)
+     */
+    explicit ThreadPool(int numThreads);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Destructor - stops and joins the worker threads
+     */
+    ~ThreadPool();
+
+    /**
+     * Getter to the number of threads
+     * @return the number of threads working on each job, including the caller
+     */
+    int getNumThreads() const { return _numThreads; }
+
+    /**
+     * Runs body(task, worker) for every task in [0, numTasks) and returns once all of them finished.
+     * worker is in [0, getNumThreads()) and no two tasks run concurrently with the same worker, so it can
+     * index per-thread scratch buffers. Calls made from inside a task (of this pool or another one) run inline on the
+     * calling thread, with its worker index in this pool or POOL_CALLER_WORKER.
+     * @param numTasks - the number of tasks
+     * @param body - the task function, if it throws the first exception is rethrown here
+     */
+    void parallelFor(int numTasks, const std::function<void(int, int)>& body);
+
+    /**
+     * Runs body(begin, end, worker) over bands of consecutive rows that cover [0, rows), in parallel as parallelFor
+     * runs tasks. Every band holds at least POOL_BAND_WORK work, so a small image stays in one band that runs inline,
+     * and nested calls or a pool of one thread run a single band [0, rows) too.
+     * @param rows - num of rows
+     * @param rowWork - the work of a row, e.g. its number of pixels
+     * @param body - the band function
+     */
+    void parallelRows(int rows, long long rowWork, const std::function<void(int, int, int)>& body);
+
+    /**
+     * The pool shared by the library (created on first use, one thread per core)
+     * @return the shared pool
+     */
+    static ThreadPool& shared();
+
+    /**
+     * Replaces the shared pool by one with the given number of threads, must not be called while it is working
+     * @param numThreads - the number of threads (0 means one per core)
+     */
+    static void setSharedThreads(int numThreads);
+};
+
+#endif //EXERCISE5_THREADPOOL_H
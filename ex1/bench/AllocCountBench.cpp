@@ -0,0 +1,55 @@
+// g++ -std=c++17 -O2 -I.. AllocCountBench.cpp ../*.cpp -pthread -o AllocCountBench
+#include "Filters.h"
+#include "Matrix.h"
+#include <cstdio>
+#include <utility>
+
+#define SIZE 512
+
+/**
+ * Makes a SIZE * SIZE matrix
+ * @param seed - varies the elements
+ * @return the matrix
+ */
+static Matrix makeMatrix(int seed)
+{
+    Matrix m(SIZE, SIZE);
+    for (int i = 0; i < SIZE * SIZE; i++)
+    {
+        m[i] = (float)((i * 13 + seed) % 256);
+    }
+    return m;
+}
+
+/**
+ * Prints the number of matrix buffers an expression allocates
+ * @param name - the expression
+ * @param expr - evaluates the expression
+ */
+template <typename F>
+static void report(const char* name, F expr)
+{
+    Matrix a = makeMatrix(1), b = makeMatrix(2), c = makeMatrix(3);
+    MatrixAllocator& alloc = defaultMatrixAllocator();
+    long before = alloc.getStats().allocations;
+    expr(a, b, c);
+    printf("%-36s %ld\n", name, alloc.getStats().allocations - before);
+}
+
+int main()
+{
+    printf("matrix buffers allocated per expression, %dx%d operands\n", SIZE, SIZE);
+    report("Matrix r = a + b", [](Matrix& a, Matrix& b, Matrix&) { Matrix r = a + b; });
+    report("Matrix r = a + b + c", [](Matrix& a, Matrix& b, Matrix& c) { Matrix r = a + b + c; });
+    report("Matrix r = (a + b) * 0.5f + c", [](Matrix& a, Matrix& b, Matrix& c) { Matrix r = (a + b) * 0.5f + c; });
+    report("Matrix r = std::move(a) + b + c", [](Matrix& a, Matrix& b, Matrix& c)
+    {
+        Matrix r = std::move(a) + b + c;
+    });
+    report("c = a + b (same shape)", [](Matrix& a, Matrix& b, Matrix& c) { c = a + b; });
+    report("Matrix r = a * b", [](Matrix& a, Matrix& b, Matrix&) { Matrix r = a * b; });
+    report("a *= b", [](Matrix& a, Matrix& b, Matrix&) { a *= b; });
+    report("Matrix r = blur(a)", [](Matrix& a, Matrix&, Matrix&) { Matrix r = blur(a); });
+    report("Matrix r = sobel(a)", [](Matrix& a, Matrix&, Matrix&) { Matrix r = sobel(a); });
+    return 0;
+}
\ No newline at end of file
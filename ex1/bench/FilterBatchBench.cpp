@@ -0,0 +1,73 @@
+// g++ -std=c++17 -O2 -I.. FilterBatchBench.cpp ../*.cpp -pthread -o FilterBatchBench
+#include "FilterBatch.h"
+#include "Filters.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define REPS 3
+#define FRAME_PIXELS_PER_SIZE 16777216 // the frames of every size hold about this many pixels together
+#define FRAME_LEVELS 4
+
+/**
+ * Seconds since an arbitrary point
+ * @return the time
+ */
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Times a run over the frames, the best of REPS runs
+ * @param run - runs the filter over all the frames
+ * @return the time in seconds
+ */
+template <typename F>
+static double bestSeconds(F run)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        double start = now();
+        run();
+        best = std::min(best, now() - start);
+    }
+    return best;
+}
+
+int main()
+{
+    printf("%-8s %7s %12s %12s %12s %12s %12s %12s\n", "frames", "count", "blur", "blurBatch", "sobel",
+           "sobelBatch", "quant", "quantBatch");
+    for (int size : {32, 64, 128, 256})
+    {
+        int count = FRAME_PIXELS_PER_SIZE / (size * size);
+        std::vector<Matrix> frames;
+        for (int k = 0; k < count; k++)
+        {
+            Matrix frame(size, size);
+            for (int i = 0; i < size; i++)
+            {
+                for (int j = 0; j < size; j++)
+                {
+                    frame(i, j) = (float)((i * 31 + j * 17 + k) % 256);
+                }
+            }
+            frames.push_back(frame);
+        }
+        std::vector<MatrixView> views(frames.begin(), frames.end());
+        std::vector<Matrix> results; // kept between the batches, as a caller running batch after batch would
+        double loopBlur = bestSeconds([&] { for (auto& v : views) { Matrix res = blur(v); } });
+        double batchBlur = bestSeconds([&] { blurBatch(views, results); });
+        double loopSobel = bestSeconds([&] { for (auto& v : views) { Matrix res = sobel(v); } });
+        double batchSobel = bestSeconds([&] { sobelBatch(views, results); });
+        double loopQuant = bestSeconds([&] { for (auto& v : views) { Matrix res = quantization(v, FRAME_LEVELS); } });
+        double batchQuant = bestSeconds([&] { quantizationBatch(views, FRAME_LEVELS, results); });
+        printf("%4dx%-3d %7d %8.0f fps %8.0f fps %8.0f fps %8.0f fps %8.0f fps %8.0f fps\n", size, size, count,
+               count / loopBlur, count / batchBlur, count / loopSobel, count / batchSobel, count / loopQuant,
+               count / batchQuant);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+// g++ -std=c++17 -O2 -I.. FilterBench.cpp ../*.cpp -pthread -o FilterBench, run as FilterBench [rows cols]
+#include "Convolution.h"
+#include "Filters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define DEFAULT_ROWS 2048
+#define DEFAULT_COLS 2048
+#define REPS 4
+#define KERNEL_SIZE 3
+#define MIN_SHADE 0
+#define MAX_SHADE 255
+#define MEGA 1e6
+
+/**
+ * The former convolution: the nine taps of a 3x3 kernel summed in order at every pixel (pixels outside the image
+ * skipped) and rounded with rintf
+ * @param image - the image
+ * @param kernel - the 3x3 kernel
+ * @return the convolved image
+ */
+static Matrix tapConvolution(const Matrix& image, const Matrix& kernel)
+{
+    Matrix res(image.getRows(), image.getCols());
+    for (int r = 0; r < image.getRows(); r++)
+    {
+        for (int c = 0; c < image.getCols(); c++)
+        {
+            float sum = 0;
+            for (int i = 0; i < KERNEL_SIZE; i++)
+            {
+                for (int j = 0; j < KERNEL_SIZE; j++)
+                {
+                    int y = r + i - 1, x = c + j - 1;
+                    if (y >= 0 && y < image.getRows() && x >= 0 && x < image.getCols())
+                    {
+                        sum += image(y, x) * kernel(i, j);
+                    }
+                }
+            }
+            res(r, c) = rintf(sum);
+        }
+    }
+    return res;
+}
+
+/**
+ * Makes a 3x3 kernel
+ * @param weights - the 9 weights, row by row
+ * @param scale - multiplies every weight
+ * @return the kernel
+ */
+static Matrix makeKernel(const float* weights, float scale)
+{
+    Matrix kernel(KERNEL_SIZE, KERNEL_SIZE);
+    for (int i = 0; i < KERNEL_SIZE * KERNEL_SIZE; i++)
+    {
+        kernel[i] = weights[i] * scale;
+    }
+    return kernel;
+}
+
+/**
+ * Times a filter, the best of REPS runs
+ * @param filter - runs the filter
+ * @return the time in seconds
+ */
+template <typename F>
+static double bestSeconds(F filter)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        filter();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int rows = argc > 2 ? atoi(argv[1]) : DEFAULT_ROWS;
+    int cols = argc > 2 ? atoi(argv[2]) : DEFAULT_COLS;
+    Matrix image(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            image(i, j) = (float)((i * 31 + j * 17) % (MAX_SHADE + 1));
+        }
+    }
+    const float blurWeights[] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    const float sobelXWeights[] = {1, 0, -1, 2, 0, -2, 1, 0, -1};
+    const float sobelYWeights[] = {1, 2, 1, 0, 0, 0, -1, -2, -1};
+    Matrix blurKernel = makeKernel(blurWeights, 1.0f / 16);
+    Matrix sobelX = makeKernel(sobelXWeights, 1.0f / 8), sobelY = makeKernel(sobelYWeights, 1.0f / 8);
+
+    Matrix tapBlur, tapSobel, newBlur, newSobel;
+    double tapBlurSec = bestSeconds([&]
+    {
+        tapBlur = tapConvolution(image, blurKernel);
+        clampValues(tapBlur, MIN_SHADE, MAX_SHADE);
+    });
+    double newBlurSec = bestSeconds([&] { newBlur = blur(image); });
+    double tapSobelSec = bestSeconds([&]
+    {
+        tapSobel = tapConvolution(image, sobelX) + tapConvolution(image, sobelY);
+        clampValues(tapSobel, MIN_SHADE, MAX_SHADE);
+    });
+    double newSobelSec = bestSeconds([&] { newSobel = sobel(image); });
+
+    double mp = (double)rows * cols / MEGA;
+    printf("%dx%d image, MP/s\n", rows, cols);
+    printf("%-8s %12s %12s %9s\n", "filter", "nine-tap", "new", "speedup");
+    printf("%-8s %12.1f %12.1f %8.1fx\n", "blur", mp / tapBlurSec, mp / newBlurSec, tapBlurSec / newBlurSec);
+    printf("%-8s %12.1f %12.1f %8.1fx\n", "sobel", mp / tapSobelSec, mp / newSobelSec, tapSobelSec / newSobelSec);
+    if (newBlur != tapBlur || newSobel != tapSobel)
+    {
+        printf("the new filters differ from the nine-tap loop\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
\ No newline at end of file
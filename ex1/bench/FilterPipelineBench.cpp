@@ -0,0 +1,65 @@
+// g++ -std=c++17 -O2 -I.. FilterPipelineBench.cpp ../*.cpp -pthread -o FilterPipelineBench, run as
+// FilterPipelineBench [rows cols [tileRows tileCols]]
+#include "FilterPipeline.h"
+#include "Filters.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define DEFAULT_ROWS 4096
+#define DEFAULT_COLS 4096
+#define REPS 4
+#define LEVELS 4
+#define STAGES 3
+#define MEGA 1e6
+
+/**
+ * Times a filter chain, the best of REPS runs
+ * @param chain - runs the chain
+ * @return the time in milliseconds
+ */
+template <typename F>
+static double bestMs(F chain)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        chain();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int rows = argc > 2 ? atoi(argv[1]) : DEFAULT_ROWS;
+    int cols = argc > 2 ? atoi(argv[2]) : DEFAULT_COLS;
+    int tileRows = argc > 4 ? atoi(argv[3]) : PIPELINE_TILE_ROWS;
+    int tileCols = argc > 4 ? atoi(argv[4]) : PIPELINE_TILE_COLS;
+    Matrix image(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            image(i, j) = (float)((i * 31 + j * 17) % 256);
+        }
+    }
+    FilterPipeline pipeline(tileRows, tileCols);
+    pipeline.blur().sobel().quantization(LEVELS);
+    double backToBack = bestMs([&] { Matrix res = quantization(sobel(blur(image)), LEVELS); });
+    double fused = bestMs([&] { Matrix res = pipeline.run(image); });
+
+    // memory traffic of full images: back to back every stage reads and writes one, the pipeline reads the image
+    // (its tiles grown by the halo) and writes the result, its intermediates stay in the cache
+    double imageMb = (double)rows * cols * sizeof(float) / MEGA;
+    int halo = pipeline.getHalo();
+    double grown = (double)(std::min(tileRows, rows) + 2 * halo) * (std::min(tileCols, cols) + 2 * halo) /
+                   ((double)std::min(tileRows, rows) * std::min(tileCols, cols));
+    printf("%dx%d blur -> sobel -> quantization(%d), tiles %dx%d\n", rows, cols, LEVELS, tileRows, tileCols);
+    printf("%-14s %9.1f ms %9.0f MB of full images\n", "back to back", backToBack, 2 * STAGES * imageMb);
+    printf("%-14s %9.1f ms %9.0f MB of full images\n", "pipeline", fused, (grown + 1) * imageMb);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+// g++ -std=c++17 -O2 -I.. FilterScalingBench.cpp ../*.cpp -pthread -o FilterScalingBench, run as
+// FilterScalingBench [maxThreads [size...]] (one thread per core and 4K, 8K and 16K square images by default; a 16K
+// image takes 1 GB, the run holds three)
+#include "Filters.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#define REPS 3
+#define LEVELS 4
+#define MAX_SHADE 255
+#define MEGA 1e6
+
+/**
+ * This struct is a filter, writing its result into an existing matrix
+ */
+struct Filter
+{
+    const char* name;
+    std::function<void(const MatrixView&, Matrix&)> apply;
+};
+
+/**
+ * Times a filter on the shared pool, the best of REPS runs
+ * @param filter - the filter
+ * @param image - the image
+ * @param res - set to the result
+ * @return the time in seconds
+ */
+static double bestSeconds(const Filter& filter, const Matrix& image, Matrix& res)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        filter.apply(MatrixView(image), res);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> sizes;
+    for (int i = 2; i < argc; i++)
+    {
+        sizes.push_back(atoi(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {4096, 8192, 16384};
+    }
+    std::vector<int> threadCounts; // the powers of two below maxThreads, then maxThreads
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    const QuantTable& table = QuantTable::uniform(LEVELS);
+    const Filter filters[] = {{"blur", [](const MatrixView& in, Matrix& out) { blur(in, out); }},
+                              {"sobel", [](const MatrixView& in, Matrix& out) { sobel(in, out); }},
+                              {"quantization", [&table](const MatrixView& in, Matrix& out)
+                              {
+                                  quantization(in, table, out);
+                              }}};
+
+    printf("%-14s %-13s %8s %10s %8s\n", "filter", "image", "threads", "MP/s", "speedup");
+    bool identical = true;
+    for (int size : sizes)
+    {
+        Matrix image(size, size);
+        for (int i = 0; i < size; i++)
+        {
+            float* row = image.getData() + (size_t)i * image.getStride();
+            for (int j = 0; j < size; j++)
+            {
+                row[j] = (float)((i * 31 + j * 17) % (MAX_SHADE + 1));
+            }
+        }
+        double mp = (double)size * size / MEGA;
+        for (const Filter& filter : filters)
+        {
+            Matrix serial(size, size);
+            Matrix res(size, size);
+            double serialSeconds = 0;
+            for (int threads : threadCounts)
+            {
+                ThreadPool::setSharedThreads(threads);
+                double seconds = bestSeconds(filter, image, threads == 1 ? serial : res);
+                if (threads == 1)
+                {
+                    serialSeconds = seconds;
+                }
+                bool same = threads == 1 || res == serial; // the result does not depend on the number of threads
+                identical = identical && same;
+                printf("%-14s %5d x %-5d %8d %10.1f %7.2fx%s\n", filter.name, size, size, threads, mp / seconds,
+                       serialSeconds / seconds, same ? "" : "  DIFFERS FROM 1 THREAD");
+            }
+        }
+    }
+    ThreadPool::setSharedThreads(0);
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
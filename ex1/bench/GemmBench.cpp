@@ -0,0 +1,79 @@
+// g++ -std=c++17 -O2 -I.. GemmBench.cpp ../*.cpp -pthread -o GemmBench
+#include "Gemm.h"
+#include "Matrix.h"
+#include <chrono>
+#include <cstdio>
+
+#define MIN_SIZE 16
+#define MAX_SIZE 4096
+#define NAIVE_MAX_SIZE 1024 // the naive kernel takes minutes above this
+#define MIN_FLOPS 2e9 // each measurement repeats the product until it did this much work
+
+/**
+ * The product computed a cell at a time by walking a column of rhs, as Matrix::operator* did before gemm
+ * @param lhs - the left matrix
+ * @param rhs - the right matrix
+ * @return the product
+ */
+static Matrix naiveProduct(const Matrix& lhs, const Matrix& rhs)
+{
+    Matrix res(lhs.getRows(), rhs.getCols());
+    for (int i = 0; i < lhs.getRows(); i++)
+    {
+        for (int j = 0; j < rhs.getCols(); j++)
+        {
+            float sum = 0;
+            for (int p = 0; p < lhs.getCols(); p++)
+            {
+                sum += lhs(i, p) * rhs(p, j);
+            }
+            res(i, j) = sum;
+        }
+    }
+    return res;
+}
+
+/**
+ * Measures a product of n * n matrices
+ * @param n - the size
+ * @param product - computes the product
+ * @return the GFLOP/s
+ */
+template <typename F>
+static double gflops(int n, F product)
+{
+    Matrix a(n, n), b(n, n);
+    for (int i = 0; i < n * n; i++)
+    {
+        a[i] = (float)(i % 7) * 0.5f;
+        b[i] = (float)(i % 5) * 0.25f;
+    }
+    double flops = 2.0 * n * n * n;
+    int reps = flops < MIN_FLOPS ? (int)(MIN_FLOPS / flops) : 1;
+    float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+    {
+        sink += product(a, b)(0, 0);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return sink == -1 ? 0 : flops * reps / seconds / 1e9;
+}
+
+int main()
+{
+    printf("kernel: %s\n%6s %12s %12s\n", gemmKernelName(), "n", "naive GF/s", "gemm GF/s");
+    for (int n = MIN_SIZE; n <= MAX_SIZE; n *= 2)
+    {
+        double fast = gflops(n, [](const Matrix& a, const Matrix& b) { return a * b; });
+        if (n <= NAIVE_MAX_SIZE)
+        {
+            printf("%6d %12.2f %12.2f\n", n, gflops(n, naiveProduct), fast);
+        }
+        else
+        {
+            printf("%6d %12s %12.2f\n", n, "-", fast);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+// g++ -std=c++17 -O2 -I.. GemmScalingBench.cpp ../*.cpp -pthread -o GemmScalingBench, run as
+// GemmScalingBench [maxThreads] (one per core by default)
+#include "Gemm.h"
+#include "Matrix.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#define MIN_FLOPS 4e9 // each measurement repeats the product until it did this much work
+#define REPS 3
+#define GIGA 1e9
+
+/**
+ * This struct is a shape of product: m x k times k x n
+ */
+struct Shape
+{
+    const char* name;
+    int m, n, k;
+};
+
+/**
+ * Compares two matrices bit for bit
+ * @param a - the first matrix
+ * @param b - the second matrix
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameBits(const Matrix& a, const Matrix& b)
+{
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.getRows(); i++)
+    {
+        if (std::memcmp(a.getData() + (size_t)i * a.getStride(), b.getData() + (size_t)i * b.getStride(),
+                        a.getCols() * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Times a product on the shared pool, the best of REPS measurements
+ * @param a - the left matrix
+ * @param b - the right matrix
+ * @param res - set to the product
+ * @return the time of a product in seconds
+ */
+static double bestSeconds(const Matrix& a, const Matrix& b, Matrix& res)
+{
+    double flops = 2.0 * a.getRows() * a.getCols() * b.getCols();
+    int reps = std::max(1, (int)(MIN_FLOPS / flops));
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < reps; i++)
+        {
+            res = a * b;
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    const Shape shapes[] = {{"square", 2048, 2048, 2048}, {"tall-skinny", 262144, 64, 64},
+                            {"tall", 65536, 256, 256}};
+    printf("kernel: %s\n%-12s %-20s %8s %10s %8s\n", gemmKernelName(), "shape", "m x n x k", "threads", "GFLOP/s",
+           "speedup");
+    std::vector<int> threadCounts; // the powers of two below maxThreads, then maxThreads
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    bool identical = true;
+    for (const Shape& shape : shapes)
+    {
+        Matrix a(shape.m, shape.k), b(shape.k, shape.n);
+        for (int i = 0; i < shape.m * shape.k; i++)
+        {
+            a[i] = (float)(i % 7) * 0.5f - 1.25f;
+        }
+        for (int i = 0; i < shape.k * shape.n; i++)
+        {
+            b[i] = (float)(i % 5) * 0.25f + 0.1f;
+        }
+        double flops = 2.0 * shape.m * shape.n * shape.k;
+        Matrix serial;
+        double serialSeconds = 0;
+        for (int threads : threadCounts)
+        {
+            ThreadPool::setSharedThreads(threads);
+            Matrix res;
+            double seconds = bestSeconds(a, b, res);
+            if (threads == 1)
+            {
+                serial = res;
+                serialSeconds = seconds;
+            }
+            bool same = sameBits(res, serial); // the result does not depend on the number of threads
+            identical = identical && same;
+            printf("%-12s %6d x %4d x %4d %8d %10.2f %7.2fx%s\n", shape.name, shape.m, shape.n, shape.k, threads,
+                   flops / seconds / GIGA, serialSeconds / seconds, same ? "" : "  DIFFERS FROM 1 THREAD");
+        }
+    }
+    ThreadPool::setSharedThreads(0);
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+// g++ -std=c++17 -O2 -I.. MatrixExprBench.cpp ../*.cpp -pthread -o MatrixExprBench, run as MatrixExprBench [size]
+#include "Matrix.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define DEFAULT_SIZE 8192
+#define REPS 3
+
+/**
+ * Times an expression, after one warm-up run
+ * @param name - the expression
+ * @param terms - the number of operand matrices it reads
+ * @param size - the size of the matrices
+ * @param expr - evaluates the expression
+ */
+template <typename F>
+static void report(const char* name, int terms, int size, F expr)
+{
+    expr();
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPS; r++)
+    {
+        expr();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / REPS;
+    double leastBytes = (terms + 1) * sizeof(float) * (double)size * size; // every operand read once, result written
+    printf("%-44s %8.1f ms %6.1f GB/s of the least traffic\n", name, seconds * 1e3, leastBytes / seconds / 1e9);
+}
+
+int main(int argc, char* argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : DEFAULT_SIZE;
+    Matrix a(n, n), b(n, n), c(n, n), d(n, n), e(n, n), r(n, n);
+    for (int i = 0; i < n; i++)
+    {
+        a(i, i) = 1;
+    }
+    printf("%dx%d matrices\n", n, n);
+    report("fused r = (a + b) * 0.5f + c", 3, n, [&] { r = (a + b) * 0.5f + c; });
+    report("one pass per operator", 3, n, [&]
+    {
+        Matrix t = (a + b).eval();
+        t = (t * 0.5f).eval();
+        r = (t + c).eval();
+    });
+    report("fused r = (a + b) * 0.5f + (c + d) * 0.25f + e", 5, n, [&]
+    {
+        r = (a + b) * 0.5f + (c + d) * 0.25f + e;
+    });
+    report("one pass per operator", 5, n, [&]
+    {
+        Matrix t = (a + b).eval();
+        t = (t * 0.5f).eval();
+        Matrix s = (c + d).eval();
+        s = (s * 0.25f).eval();
+        t = (t + s).eval();
+        r = (t + e).eval();
+    });
+    return 0;
+}
\ No newline at end of file
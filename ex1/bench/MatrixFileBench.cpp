@@ -0,0 +1,104 @@
+// g++ -std=c++17 -O2 -I.. MatrixFileBench.cpp ../*.cpp -pthread -o MatrixFileBench, run as
+// MatrixFileBench [rows cols] (5000 x 5000 by default, a 100 MB binary file)
+#include "MatrixFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_SIZE 5000
+#define MILLI 1e3
+#define KB_PER_MB 1024.0
+
+/**
+ * Milliseconds since an arbitrary point
+ * @return the time
+ */
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Runs a load in a child process, so its peak resident memory is its own, and prints its time and peak RSS
+ * @param name - the name of the load
+ * @param load - loads the matrix, returns an element so the work is not optimized away
+ */
+template <typename F>
+static void measure(const char* name, F load)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        double start = nowMs();
+        volatile float sink = load();
+        (void)sink;
+        printf("%-24s %10.1f ms", name, nowMs() - start);
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    struct rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    printf(" %10.1f MB peak RSS\n", usage.ru_maxrss / KB_PER_MB); // Linux reports KB
+}
+
+int main(int argc, char* argv[])
+{
+    int rows = argc > 2 ? atoi(argv[1]) : DEFAULT_SIZE;
+    int cols = argc > 2 ? atoi(argv[2]) : DEFAULT_SIZE;
+    std::string textPath = "/tmp/MatrixFileBench-" + std::to_string(getpid()) + ".txt";
+    std::string binPath = "/tmp/MatrixFileBench-" + std::to_string(getpid()) + ".bin";
+    {
+        Matrix m(rows, cols);
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                m(i, j) = (float)((i * 31 + j * 17) % 256) / 3;
+            }
+        }
+        std::ofstream text(textPath);
+        text << m;
+        saveBinary(m, binPath);
+    } // freed, so the children start small
+    printf("%d x %d\n", rows, cols);
+    measure("operator>> (text)", [&]
+    {
+        std::ifstream is(textPath);
+        Matrix m(rows, cols);
+        is >> m;
+        return m(rows - 1, cols - 1);
+    });
+    measure("loadBinary", [&]
+    {
+        Matrix m = loadBinary(binPath);
+        return m(rows - 1, cols - 1);
+    });
+    measure("MappedMatrix", [&]
+    {
+        MappedMatrix m(binPath);
+        return m.getRows() > 0 && m.getCols() > 0 ? m(0, 0) : 0; // pages fault in on use
+    });
+    measure("MappedMatrix + scan", [&]
+    {
+        MappedMatrix m(binPath);
+        float sum = 0;
+        for (int i = 0; i < m.getRows(); i++)
+        {
+            for (int j = 0; j < m.getCols(); j++)
+            {
+                sum += m.row(i)[j];
+            }
+        }
+        return sum;
+    });
+    unlink(textPath.c_str());
+    unlink(binPath.c_str());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+// g++ -std=c++17 -O2 -I.. MatrixTextBench.cpp ../*.cpp -pthread -o MatrixTextBench, run as
+// MatrixTextBench [rows cols]
+#include "Matrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#define DEFAULT_SIZE 2000
+#define REPS 3
+#define STREAM_CHUNK 65536 // the characters a pipe buffer hands out or takes at a time
+#define MEGA 1e6
+
+/**
+ * A stream buffer over a string that cannot seek, as a pipe: it hands the string out, or collects what is written,
+ * a chunk at a time
+ */
+class PipeBuffer : public std::streambuf
+{
+
+private:
+    std::string _text;
+    size_t _next;
+    char _out[STREAM_CHUNK];
+
+protected:
+    int_type underflow() override
+    {
+        if (_next == _text.size())
+        {
+            return traits_type::eof();
+        }
+        size_t count = std::min((size_t)STREAM_CHUNK, _text.size() - _next);
+        char* begin = &_text[_next];
+        setg(begin, begin, begin + count);
+        _next += count;
+        return traits_type::to_int_type(*begin);
+    }
+
+    int_type overflow(int_type c) override
+    {
+        sync();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        _text.append(pbase(), pptr() - pbase());
+        setp(_out, _out + STREAM_CHUNK);
+        return 0;
+    }
+
+public:
+    explicit PipeBuffer(std::string text = "") : _text(std::move(text)), _next(0) { setp(_out, _out + STREAM_CHUNK); }
+
+    /**
+     * The text written so far
+     * @return the text
+     */
+    const std::string& written()
+    {
+        sync();
+        return _text;
+    }
+};
+
+/**
+ * Reads a matrix a float at a time through the stream, as operator>> did before the chunked parser
+ * @param is - the input stream
+ * @param m - the matrix
+ */
+static void streamRead(std::istream& is, Matrix& m)
+{
+    for (int i = 0; i < m.getRows(); i++)
+    {
+        for (int j = 0; j < m.getCols(); j++)
+        {
+            is >> m(i, j);
+        }
+    }
+}
+
+/**
+ * Writes a matrix a float at a time through the stream, as operator<< did before the to_chars writer
+ * @param os - the output stream
+ * @param m - the matrix
+ */
+static void streamWrite(std::ostream& os, const Matrix& m)
+{
+    for (int i = 0; i < m.getRows(); i++)
+    {
+        for (int j = 0; j < m.getCols(); j++)
+        {
+            os << m(i, j);
+            if (j != m.getCols() - 1)
+            {
+                os << ' ';
+            }
+        }
+        if (i != m.getRows() - 1)
+        {
+            os << '\n';
+        }
+    }
+}
+
+/**
+ * Times a run, the best of REPS runs, and prints the throughput
+ * @param name - the name of the run
+ * @param bytes - the bytes of text the run reads or writes
+ * @param run - the run
+ */
+template <typename F>
+static void report(const char* name, size_t bytes, F run)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    printf("%-36s %10.1f MB/s\n", name, bytes / best / MEGA);
+}
+
+int main(int argc, char* argv[])
+{
+    int rows = argc > 2 ? atoi(argv[1]) : DEFAULT_SIZE;
+    int cols = argc > 2 ? atoi(argv[2]) : DEFAULT_SIZE;
+    Matrix m(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            m(i, j) = (float)((i * 31 + j * 17) % 1000) / 7 - 50;
+        }
+    }
+    std::ostringstream printed;
+    printed << m;
+    const std::string text = printed.str();
+    printf("%d x %d, %.1f MB of text\n", rows, cols, text.size() / MEGA);
+
+    Matrix read(rows, cols);
+    report("read  is >> val, seekable", text.size(), [&]
+    {
+        std::istringstream is(text);
+        streamRead(is, read);
+    });
+    report("read  operator>>, seekable", text.size(), [&]
+    {
+        std::istringstream is(text);
+        is >> read;
+    });
+    report("read  is >> val, unseekable", text.size(), [&]
+    {
+        PipeBuffer pipe(text);
+        std::istream is(&pipe);
+        streamRead(is, read);
+    });
+    report("read  operator>>, unseekable", text.size(), [&]
+    {
+        PipeBuffer pipe(text);
+        std::istream is(&pipe);
+        is >> read;
+    });
+    report("write os << val, seekable", text.size(), [&]
+    {
+        std::ostringstream os;
+        streamWrite(os, m);
+    });
+    report("write operator<<, seekable", text.size(), [&]
+    {
+        std::ostringstream os;
+        os << m;
+    });
+    report("write os << val, unseekable", text.size(), [&]
+    {
+        PipeBuffer pipe;
+        std::ostream os(&pipe);
+        streamWrite(os, m);
+    });
+    report("write operator<<, unseekable", text.size(), [&]
+    {
+        PipeBuffer pipe;
+        std::ostream os(&pipe);
+        os << m;
+    });
+    report("write writeExact, seekable", text.size(), [&]
+    {
+        std::ostringstream os;
+        writeExact(os, m);
+    });
+
+    std::ostringstream exact;
+    writeExact(exact, m);
+    std::istringstream seekable(exact.str());
+    seekable >> read;
+    PipeBuffer pipe(exact.str());
+    std::istream unseekable(&pipe);
+    Matrix streamed(rows, cols);
+    streamRead(unseekable, streamed);
+    if (read != m || streamed != m)
+    {
+        printf("the exact text did not read back to the matrix\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+// g++ -std=c++17 -O2 -I.. ByteFilterTest.cpp ../*.cpp -pthread -o ByteFilterTest
+#include "Filters.h"
+#include "TestCheck.h"
+#include <random>
+#include <string>
+
+#define NUM_KERNELS 2
+#define MAX_COLS 257 // past the vectors of the AVX2 kernels several times, with every tail length
+#define MAX_ROWS 5
+#define MAX_SHADE 255
+#define MID_SHADE 128
+
+/**
+ * The byte row kernels, the ones the cpu does not support are skipped
+ */
+static const char* const KERNELS[NUM_KERNELS] = {"avx2", "scalar"};
+
+/**
+ * The kinds of images the kernels are compared on
+ */
+enum ImageKind
+{
+    RANDOM_SHADES, // any shade
+    EXTREME_SHADES, // only 0 and 255, so the sums reach their limits and sobel saturates both ways
+    CONSTANT_SHADE, // one shade, so only the borders differ
+    NUM_IMAGE_KINDS
+};
+
+/**
+ * Makes an 8-bit image
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param kind - the kind of image
+ * @param gen - the random generator
+ * @return the image
+ */
+static ByteMatrix makeImage(int rows, int cols, int kind, std::mt19937& gen)
+{
+    ByteMatrix image(rows, cols);
+    for (int i = 0; i < rows * cols; i++)
+    {
+        switch (kind)
+        {
+            case RANDOM_SHADES:
+                image[i] = (uint8_t)(gen() % (MAX_SHADE + 1));
+                break;
+            case EXTREME_SHADES:
+                image[i] = gen() % 2 != 0 ? MAX_SHADE : 0;
+                break;
+            default:
+                image[i] = cols % 2 != 0 ? MAX_SHADE : MID_SHADE;
+        }
+    }
+    return image;
+}
+
+/**
+ * Every byte row kernel the cpu supports gives the float blur and sobel converted to bytes, bit for bit, at every
+ * number of cols up to MAX_COLS and a few numbers of rows, on random, 0/255 and constant images
+ */
+static void testSameAsFloat()
+{
+    std::string detected = byteFilterKernelName();
+    CHECK(useByteFilterKernel("scalar"));
+    CHECK(!useByteFilterKernel("sse9"));
+    CHECK(std::string(byteFilterKernelName()) == "scalar");
+    int kernelsRun = 0;
+    for (const char* kernel : KERNELS)
+    {
+        if (!useByteFilterKernel(kernel))
+        {
+            continue;
+        }
+        kernelsRun++;
+        std::mt19937 gen(kernelsRun);
+        bool blurOk = true, sobelOk = true;
+        for (int cols = 1; cols <= MAX_COLS; cols++)
+        {
+            for (int kind = 0; kind < NUM_IMAGE_KINDS; kind++)
+            {
+                int rows = 1 + (cols + kind) % MAX_ROWS;
+                ByteMatrix image = makeImage(rows, cols, kind, gen);
+                Matrix floats(image);
+                blurOk = blurOk && blur(image) == ByteMatrix(blur(floats));
+                sobelOk = sobelOk && sobel(image) == ByteMatrix(sobel(floats));
+            }
+        }
+        CHECK(blurOk);
+        CHECK(sobelOk);
+        if (!blurOk || !sobelOk)
+        {
+            std::cerr << "byte kernel " << kernel << " differs from the float filters" << std::endl;
+        }
+    }
+    CHECK(kernelsRun >= 1);
+    CHECK(useByteFilterKernel(detected.c_str()));
+}
+
+int main()
+{
+    testSameAsFloat();
+    return testResult();
+}
\ No newline at end of file
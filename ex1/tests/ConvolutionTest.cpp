@@ -0,0 +1,429 @@
+// g++ -std=c++17 -O2 -I.. ConvolutionTest.cpp ../*.cpp -pthread -o ConvolutionTest
+#include "Convolution.h"
+#include "Filters.h"
+#include "MatrixAlloc.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#define KERNEL_SIZE 3
+#define MIN_SHADE 0
+#define MAX_SHADE 255
+#define RANDOM_IMAGES 300
+#define BANDED_THREADS 4
+#define BANDED_ROWS 400
+#define BANDED_COLS 300
+#define BANDED_KERNEL_SIZE 5
+#define MAX_DIFF_RATE 1e-3 // the fraction of fractional pixels the separable order may round differently
+#define NUM_STRATEGY_CASES 7
+#define NUM_PINNED_SIZES 5
+#define NUM_KERNEL_NAMES 3
+#define ROI_MARGIN 9
+#define PINNED_MAX_KERNEL 63
+#define NUM_GRADIENT_SIZES 5
+#define EIGHTHS 8.0f // the fractional images are in eighths of a shade, so their responses are exact
+#define GRADIENT_TOLERANCE 1e-6f // the largest error of the magnitude, relative to it
+
+/**
+ * The sum the former per-pixel loop computed: the nine taps in order, pixels outside the image skipped
+ * @param image - the image
+ * @param kernel - the 3x3 kernel
+ * @param r - the row
+ * @param c - the column
+ * @return the sum
+ */
+static float tapSum(const Matrix& image, const Matrix& kernel, int r, int c)
+{
+    float sum = 0;
+    for (int i = 0; i < KERNEL_SIZE; i++)
+    {
+        for (int j = 0; j < KERNEL_SIZE; j++)
+        {
+            int y = r + i - 1, x = c + j - 1;
+            if (y >= 0 && y < image.getRows() && x >= 0 && x < image.getCols())
+            {
+                sum += image(y, x) * kernel(i, j);
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * The former convolution: tapSum rounded with rintf at every pixel
+ * @param image - the image
+ * @param kernel - the 3x3 kernel
+ * @return the convolved image
+ */
+static Matrix tapConvolution(const Matrix& image, const Matrix& kernel)
+{
+    Matrix res(image.getRows(), image.getCols());
+    for (int i = 0; i < image.getRows(); i++)
+    {
+        for (int j = 0; j < image.getCols(); j++)
+        {
+            res(i, j) = rintf(tapSum(image, kernel, i, j));
+        }
+    }
+    return res;
+}
+
+/**
+ * Limits the elements to the shades, as the filters do
+ * @param image - the image
+ * @return the limited image
+ */
+static Matrix limited(Matrix image)
+{
+    clampValues(image, MIN_SHADE, MAX_SHADE);
+    return image;
+}
+
+/**
+ * Makes a 3x3 kernel
+ * @param weights - the 9 weights, row by row
+ * @param scale - multiplies every weight
+ * @return the kernel
+ */
+static Matrix makeKernel(const float* weights, float scale)
+{
+    Matrix kernel(KERNEL_SIZE, KERNEL_SIZE);
+    for (int i = 0; i < KERNEL_SIZE * KERNEL_SIZE; i++)
+    {
+        kernel[i] = weights[i] * scale;
+    }
+    return kernel;
+}
+
+/**
+ * Compares two images
+ * @param a - the first image
+ * @param b - the second image
+ * @param diffs - incremented by the number of pixels that differ
+ * @return the largest difference of a pixel
+ */
+static float maxDiff(const Matrix& a, const Matrix& b, long& diffs)
+{
+    float largest = 0;
+    for (int i = 0; i < a.getRows() * a.getCols(); i++)
+    {
+        if (a[i] != b[i])
+        {
+            diffs++;
+            largest = std::max(largest, std::fabs(a[i] - b[i]));
+        }
+    }
+    return largest;
+}
+
+/**
+ * Compares blur, sobel and the convolve strategies with the former nine-tap code on random images: integer images
+ * and the direct strategy are the same bit for bit, fractional images through the separable passes differ by at
+ * most 1 at a few pixels
+ * @param fractional - if true the pixels are random floats, otherwise integers
+ */
+static void compareWithTaps(bool fractional)
+{
+    const float blurWeights[] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    const float sobelXWeights[] = {1, 0, -1, 2, 0, -2, 1, 0, -1};
+    const float sobelYWeights[] = {1, 2, 1, 0, 0, 0, -1, -2, -1};
+    Matrix blurKernel = makeKernel(blurWeights, 1.0f / 16);
+    Matrix sobelX = makeKernel(sobelXWeights, 1.0f / 8), sobelY = makeKernel(sobelYWeights, 1.0f / 8);
+    std::mt19937 gen(fractional ? 11 : 12);
+    std::uniform_real_distribution<float> shade(MIN_SHADE, MAX_SHADE);
+    std::uniform_int_distribution<int> size(1, 70);
+    long pixels = 0, separableDiffs = 0, directDiffs = 0;
+    float largest = 0;
+    for (int t = 0; t < RANDOM_IMAGES; t++)
+    {
+        Matrix image(size(gen), size(gen));
+        for (int i = 0; i < image.getRows() * image.getCols(); i++)
+        {
+            image[i] = fractional ? shade(gen) : std::floor(shade(gen));
+        }
+        Matrix random(KERNEL_SIZE, KERNEL_SIZE);
+        for (int i = 0; i < KERNEL_SIZE * KERNEL_SIZE; i++)
+        {
+            random[i] = shade(gen) / MAX_SHADE - 0.5f;
+        }
+        pixels += image.getRows() * image.getCols();
+        Matrix tapBlur = limited(tapConvolution(image, blurKernel));
+        Matrix tapSobel = limited(tapConvolution(image, sobelX) + tapConvolution(image, sobelY));
+        largest = std::max(largest, maxDiff(blur(image), tapBlur, separableDiffs));
+        largest = std::max(largest, maxDiff(sobel(image), tapSobel, separableDiffs));
+        largest = std::max(largest, maxDiff(convolve(MatrixView(image), blurKernel, CONV_SEPARABLE),
+                                            tapConvolution(image, blurKernel), separableDiffs));
+        maxDiff(convolve(MatrixView(image), blurKernel, CONV_DIRECT), tapConvolution(image, blurKernel), directDiffs);
+        maxDiff(convolve(MatrixView(image), random), tapConvolution(image, random), directDiffs);
+    }
+    CHECK(directDiffs == 0);
+    if (fractional)
+    {
+        CHECK(largest <= 1);
+        CHECK(separableDiffs <= (long)(pixels * MAX_DIFF_RATE));
+    }
+    else
+    {
+        CHECK(separableDiffs == 0);
+    }
+}
+
+/**
+ * The banded convolutions take their scratch from the allocator current on the calling thread, an arena here, even
+ * when the bands run on other threads, and give the same result as outside the scope
+ */
+static void testScratchFromCurrentAllocator()
+{
+    ThreadPool::setSharedThreads(BANDED_THREADS);
+    Matrix image(BANDED_ROWS, BANDED_COLS);
+    for (int i = 0; i < BANDED_ROWS * BANDED_COLS; i++)
+    {
+        image[i] = (float)(i * 7 % (MAX_SHADE + 1));
+    }
+    Matrix separable(BANDED_KERNEL_SIZE, BANDED_KERNEL_SIZE);
+    Matrix full(BANDED_KERNEL_SIZE, BANDED_KERNEL_SIZE);
+    for (int i = 0; i < BANDED_KERNEL_SIZE; i++)
+    {
+        for (int j = 0; j < BANDED_KERNEL_SIZE; j++)
+        {
+            separable(i, j) = (float)((i + 1) * (j + 2)) / 64;
+            full(i, j) = (float)((i * 3 + j * j) % 5) / 16;
+        }
+    }
+    Matrix expectSeparable = convolve(image, separable, CONV_SEPARABLE);
+    Matrix expectFull = convolve(image, full, CONV_DIRECT);
+    ArenaAllocator arena;
+    {
+        MatrixAllocatorScope scope(arena);
+        long heapBefore = defaultMatrixAllocator().getStats().allocations;
+        Matrix gotSeparable = convolve(image, separable, CONV_SEPARABLE);
+        Matrix gotFull = convolve(image, full, CONV_DIRECT);
+        CHECK(defaultMatrixAllocator().getStats().allocations == heapBefore);
+        CHECK(arena.getStats().allocations == 3); // the two results and the rings
+        CHECK(gotSeparable == expectSeparable);
+        CHECK(gotFull == expectFull);
+    }
+    ThreadPool::setSharedThreads(0);
+}
+
+/**
+ * The images and kernels the strategies are compared on: {image rows, image cols, kernel rows, kernel cols}, with
+ * large kernels, kernels wider or taller than the image and kernels larger than it both ways
+ */
+static const int STRATEGY_CASES[NUM_STRATEGY_CASES][4] = {{64, 80, 15, 15}, {90, 70, 31, 31}, {40, 130, 9, 21},
+                                                          {7, 5, 15, 21}, {3, 40, 11, 5}, {33, 2, 3, 13},
+                                                          {1, 1, 9, 9}};
+
+/**
+ * The image sizes the strategy choice is pinned on
+ */
+static const int PINNED_SIZES[NUM_PINNED_SIZES][2] = {{64, 64}, {512, 512}, {2048, 2048}, {100, 3000}, {8, 8}};
+
+/**
+ * The row kernels of convolve and, with each, the side of the smallest square kernel that is not separable for
+ * which chooseConvStrategy picks the fft on every one of PINNED_SIZES, -1 if it does not up to PINNED_MAX_KERNEL
+ */
+static const struct
+{
+    const char* name;
+    int firstFft[NUM_PINNED_SIZES];
+} PINNED_CHOICES[NUM_KERNEL_NAMES] = {{"avx512", {55, 29, 25, 25, -1}}, {"avx2", {27, 19, 17, 17, -1}},
+                                      {"scalar", {7, 7, 5, 7, 25}}};
+
+/**
+ * Makes a kernel that is not separable, with fractional weights of both signs summing to about 1
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param gen - the random generator
+ * @return the kernel
+ */
+static Matrix randomKernel(int rows, int cols, std::mt19937& gen)
+{
+    std::uniform_real_distribution<float> weight(-0.5f, 1.0f);
+    Matrix kernel(rows, cols);
+    for (int i = 0; i < rows * cols; i++)
+    {
+        kernel[i] = weight(gen) * 2 / (float)(rows * cols);
+    }
+    return kernel;
+}
+
+/**
+ * Makes a separable kernel, the outer product of two fractional profiles
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @return the kernel
+ */
+static Matrix separableKernel(int rows, int cols)
+{
+    Matrix kernel(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            kernel(i, j) = (float)(1 + i % 3) * (float)(2 + j % 5) / (float)(4 * rows * cols);
+        }
+    }
+    return kernel;
+}
+
+/**
+ * The separable and fft strategies agree with the direct one within 1 at every pixel, on fractional images and
+ * large kernels, separable or not, of any size relative to the image, and on regions of a larger image as on
+ * their copies (the separable strategy runs a kernel that is not separable directly, bit for bit)
+ */
+static void testStrategiesAgree()
+{
+    std::mt19937 gen(13);
+    std::uniform_real_distribution<float> shade(MIN_SHADE, MAX_SHADE);
+    for (const auto& sizes : STRATEGY_CASES)
+    {
+        int rows = sizes[0], cols = sizes[1];
+        Matrix large(rows + 2 * ROI_MARGIN, cols + 2 * ROI_MARGIN);
+        for (int i = 0; i < large.getRows() * large.getCols(); i++)
+        {
+            large[i] = shade(gen);
+        }
+        MatrixView region = MatrixView(large).roi(ROI_MARGIN, ROI_MARGIN, rows, cols);
+        Matrix image = region.toMatrix();
+        Matrix kernels[] = {randomKernel(sizes[2], sizes[3], gen), separableKernel(sizes[2], sizes[3])};
+        for (int k = 0; k < 2; k++)
+        {
+            const Matrix& kernel = kernels[k];
+            Matrix direct = convolve(image, kernel, CONV_DIRECT);
+            Matrix separable = convolve(image, kernel, CONV_SEPARABLE);
+            Matrix fft = convolve(image, kernel, CONV_FFT);
+            long diffs = 0;
+            CHECK(maxDiff(separable, direct, diffs) <= 1);
+            CHECK(maxDiff(fft, direct, diffs) <= 1);
+            CHECK(k == 1 || separable == direct);
+            CHECK(convolve(region, kernel, CONV_DIRECT) == direct);
+            CHECK(convolve(region, kernel, CONV_SEPARABLE) == separable);
+            CHECK(convolve(region, kernel, CONV_FFT) == fft);
+            CHECK(convolve(region, kernel) == convolve(image, kernel));
+        }
+    }
+}
+
+/**
+ * Pins the strategy convolve picks: a separable kernel always runs as two passes, and a kernel that is not moves
+ * from direct to fft at the pinned sizes, for the row kernels of this cpu
+ */
+static void testStrategyThresholds()
+{
+    std::mt19937 gen(14);
+    CHECK(chooseConvStrategy(PINNED_SIZES[0][0], PINNED_SIZES[0][1], separableKernel(1, 1)) == CONV_SEPARABLE);
+    CHECK(chooseConvStrategy(PINNED_SIZES[1][0], PINNED_SIZES[1][1], separableKernel(63, 63)) == CONV_SEPARABLE);
+    CHECK(chooseConvStrategy(PINNED_SIZES[4][0], PINNED_SIZES[4][1], separableKernel(31, 31)) == CONV_SEPARABLE);
+    const int* firstFft = nullptr;
+    for (const auto& choice : PINNED_CHOICES)
+    {
+        if (std::strcmp(choice.name, convKernelName()) == 0)
+        {
+            firstFft = choice.firstFft;
+        }
+    }
+    CHECK(firstFft != nullptr);
+    if (firstFft == nullptr)
+    {
+        return;
+    }
+    for (int s = 0; s < NUM_PINNED_SIZES; s++)
+    {
+        int found = -1;
+        for (int k = 1; k <= PINNED_MAX_KERNEL && found < 0; k += 2)
+        {
+            if (chooseConvStrategy(PINNED_SIZES[s][0], PINNED_SIZES[s][1], randomKernel(k, k, gen)) == CONV_FFT)
+            {
+                found = k;
+            }
+        }
+        CHECK(found == firstFft[s]);
+    }
+}
+
+/**
+ * The image sizes the gradient of sobel is checked on
+ */
+static const int GRADIENT_SIZES[NUM_GRADIENT_SIZES][2] = {{1, 1}, {2, 3}, {17, 9}, {40, 70}, {33, 130}};
+
+/**
+ * The responses of an image in eighths of a shade to a 3x3 kernel of eighths, from convolve: scaled to integers
+ * both are exact and rounding them changes nothing, and scaling back is exact too
+ * @param image - the image
+ * @param kernel - the kernel
+ * @return the responses, not rounded
+ */
+static Matrix exactResponses(const Matrix& image, const Matrix& kernel)
+{
+    Matrix scaledImage = image * EIGHTHS;
+    Matrix scaledKernel = kernel * EIGHTHS;
+    Matrix res = convolve(scaledImage, scaledKernel);
+    res /= EIGHTHS * EIGHTHS;
+    return res;
+}
+
+/**
+ * The magnitude and orientation sobel computes are std::hypot and std::atan2 of the gradients convolve gives with
+ * the two kernels, on integer and fractional images, on regions of a larger image, on any number of threads, and
+ * when the image is a view of the magnitude itself
+ */
+static void testSobelGradient()
+{
+    const float sobelXWeights[] = {1, 0, -1, 2, 0, -2, 1, 0, -1};
+    const float sobelYWeights[] = {1, 2, 1, 0, 0, 0, -1, -2, -1};
+    Matrix sobelX = makeKernel(sobelXWeights, 1.0f / 8), sobelY = makeKernel(sobelYWeights, 1.0f / 8);
+    std::mt19937 gen(15);
+    std::uniform_int_distribution<int> eighths(0, MAX_SHADE * (int)EIGHTHS);
+    for (int threads : {1, BANDED_THREADS})
+    {
+        ThreadPool::setSharedThreads(threads);
+        for (const auto& sizes : GRADIENT_SIZES)
+        {
+            int rows = sizes[0], cols = sizes[1];
+            Matrix large(rows + 2, cols + 2);
+            for (int i = 0; i < large.getRows() * large.getCols(); i++)
+            {
+                large[i] = (float)eighths(gen) / EIGHTHS;
+            }
+            MatrixView region = MatrixView(large).roi(1, 1, rows, cols);
+            Matrix image = region.toMatrix();
+            Matrix gx = exactResponses(image, sobelX), gy = exactResponses(image, sobelY);
+            Matrix magnitude, orientation;
+            Matrix res = sobel(region, &magnitude, &orientation);
+            CHECK(res == sobel(image));
+            CHECK(magnitude.getRows() == rows && magnitude.getCols() == cols);
+            CHECK(orientation.getRows() == rows && orientation.getCols() == cols);
+            bool magnitudeOk = true, orientationOk = true;
+            for (int i = 0; i < rows * cols && magnitude.getRows() == rows; i++)
+            {
+                float hypot = (float)std::hypot((double)gx[i], (double)gy[i]);
+                magnitudeOk = magnitudeOk && std::fabs(magnitude[i] - hypot) <= GRADIENT_TOLERANCE * hypot;
+                orientationOk = orientationOk && orientation[i] == std::atan2(gy[i], gx[i]);
+            }
+            CHECK(magnitudeOk);
+            CHECK(orientationOk);
+
+            Matrix onlyOrientation;
+            CHECK(sobel(region, nullptr, &onlyOrientation) == res);
+            CHECK(onlyOrientation == orientation);
+            Matrix self = image;
+            CHECK(sobel(MatrixView(self), &self, nullptr) == res);
+            CHECK(self == magnitude);
+        }
+    }
+    ThreadPool::setSharedThreads(0);
+}
+
+int main()
+{
+    compareWithTaps(false);
+    compareWithTaps(true);
+    testScratchFromCurrentAllocator();
+    testStrategiesAgree();
+    testStrategyThresholds();
+    testSobelGradient();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+// g++ -std=c++17 -O2 -I.. FilterBatchTest.cpp ../*.cpp -pthread -o FilterBatchTest
+#include "FilterBatch.h"
+#include "Filters.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <random>
+
+#define NUM_IMAGES 40
+#define MAX_IMAGE_SIZE 90
+#define NUM_FRAMES 13
+#define FRAME_COLS 70
+#define LEVELS 5
+#define PACKED_LEVELS 3
+#define OTHER_POOL_THREADS 3
+#define OTHER_POOL_TASKS 6
+
+/**
+ * Compares two matrices bit for bit
+ * @param a - the first matrix
+ * @param b - the second matrix
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameBits(const Matrix& a, const Matrix& b)
+{
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.getRows(); i++)
+    {
+        if (std::memcmp(a.getData() + (size_t)i * a.getStride(), b.getData() + (size_t)i * b.getStride(),
+                        a.getCols() * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Makes an image of random shades
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param gen - the random generator
+ * @return the image
+ */
+static Matrix randomImage(int rows, int cols, std::mt19937& gen)
+{
+    Matrix image(rows, cols);
+    for (int i = 0; i < rows * cols; i++)
+    {
+        image[i] = (float)(gen() % 256);
+    }
+    return image;
+}
+
+/**
+ * Every image of a batch gets the result of the single image filter, and a second batch writes into the results
+ * of the first in place
+ * @param gen - the random generator
+ */
+static void testBatchOfViews(std::mt19937& gen)
+{
+    std::vector<Matrix> images;
+    std::vector<MatrixView> views;
+    for (int k = 0; k < NUM_IMAGES; k++)
+    {
+        images.push_back(randomImage(1 + gen() % MAX_IMAGE_SIZE, 1 + gen() % MAX_IMAGE_SIZE, gen));
+    }
+    for (int k = 0; k < NUM_IMAGES; k++)
+    {
+        views.push_back(k % 3 == 0 ? MatrixView(images[k]).transposed() : MatrixView(images[k]));
+    }
+    std::vector<Matrix> results;
+    for (int rep = 0; rep < 2; rep++)
+    {
+        std::vector<const float*> buffers;
+        for (const Matrix& res : results)
+        {
+            buffers.push_back(res.getData());
+        }
+        blurBatch(views, results);
+        for (int k = 0; k < NUM_IMAGES; k++)
+        {
+            CHECK(sameBits(results[k], blur(views[k])));
+            CHECK(rep == 0 || results[k].getData() == buffers[k]);
+        }
+        sobelBatch(views, results);
+        for (int k = 0; k < NUM_IMAGES; k++)
+        {
+            CHECK(sameBits(results[k], sobel(views[k])));
+        }
+        quantizationBatch(views, LEVELS, results);
+        for (int k = 0; k < NUM_IMAGES; k++)
+        {
+            CHECK(sameBits(results[k], quantization(views[k], LEVELS)));
+        }
+    }
+}
+
+/**
+ * Checks the packed batch filters on a stack of frames against the single image filters
+ * @param packed - the frames, stacked
+ * @param frameRows - the rows of a frame
+ */
+static void checkPacked(const Matrix& packed, int frameRows)
+{
+    Matrix blurred = blurBatch(packed, frameRows);
+    Matrix edges = sobelBatch(packed, frameRows);
+    Matrix quantized = quantizationBatch(packed, frameRows, PACKED_LEVELS);
+    for (int k = 0; k < packed.getRows() / frameRows; k++)
+    {
+        MatrixView frame = MatrixView(packed).rowRange(k * frameRows, frameRows);
+        CHECK(sameBits(MatrixView(blurred).rowRange(k * frameRows, frameRows).toMatrix(), blur(frame)));
+        CHECK(sameBits(MatrixView(edges).rowRange(k * frameRows, frameRows).toMatrix(), sobel(frame)));
+        CHECK(sameBits(MatrixView(quantized).rowRange(k * frameRows, frameRows).toMatrix(),
+                       quantization(frame, PACKED_LEVELS)));
+    }
+}
+
+/**
+ * Every frame of a packed batch gets the result of the single image filter, also when the batch runs inside the
+ * tasks of another pool
+ * @param gen - the random generator
+ */
+static void testPackedFrames(std::mt19937& gen)
+{
+    for (int frameRows : {1, 7, 64})
+    {
+        checkPacked(randomImage(NUM_FRAMES * frameRows, FRAME_COLS, gen), frameRows);
+    }
+    Matrix packed = randomImage(NUM_FRAMES * 7, FRAME_COLS, gen);
+    std::vector<Matrix> nested(OTHER_POOL_TASKS);
+    ThreadPool other(OTHER_POOL_THREADS);
+    other.parallelFor(OTHER_POOL_TASKS, [&](int task, int) { nested[task] = blurBatch(packed, 7); });
+    for (const Matrix& res : nested)
+    {
+        CHECK(sameBits(res, blurBatch(packed, 7)));
+    }
+}
+
+int main()
+{
+    std::mt19937 gen(9);
+    for (int threads : {1, 3})
+    {
+        ThreadPool::setSharedThreads(threads);
+        testBatchOfViews(gen);
+        testPackedFrames(gen);
+    }
+    ThreadPool::setSharedThreads(0);
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,289 @@
+// g++ -std=c++17 -O2 -I.. FilterPipelineTest.cpp ../*.cpp -pthread -o FilterPipelineTest
+#include "FilterPipeline.h"
+#include "Filters.h"
+#include "MatrixFile.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#define CHAIN_LEVELS 4
+#define BIG_KERNEL_SIZE 5
+#define PIPE_CHUNK 4093 // bytes a PipeBuffer hands out at a time, so rows are split between chunks
+#define STREAM_TILE_ROWS 32
+#define STREAM_TILE_COLS 64
+#define FILE_ROWS 75
+#define FILE_COLS 300
+#define PIPE_BAND_ROWS 16
+
+/**
+ * A stream buffer over a string that cannot seek, as a pipe, and hands out a chunk at a time
+ */
+class PipeBuffer : public std::streambuf
+{
+
+private:
+    std::string _bytes;
+    size_t _next;
+
+protected:
+    int_type underflow() override
+    {
+        if (_next == _bytes.size())
+        {
+            return traits_type::eof();
+        }
+        size_t count = std::min((size_t)PIPE_CHUNK, _bytes.size() - _next);
+        char* begin = &_bytes[_next];
+        setg(begin, begin, begin + count);
+        _next += count;
+        return traits_type::to_int_type(*begin);
+    }
+
+public:
+    explicit PipeBuffer(std::string bytes) : _bytes(std::move(bytes)), _next(0) {}
+};
+
+/**
+ * Compares two matrices bit for bit
+ * @param a - the first matrix
+ * @param b - the second matrix
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameBits(const Matrix& a, const Matrix& b)
+{
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.getRows(); i++)
+    {
+        if (std::memcmp(a.getData() + (size_t)i * a.getStride(), b.getData() + (size_t)i * b.getStride(),
+                        a.getCols() * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * A pipeline gives bit for bit the result of running its stages one after the other on the whole image, for every
+ * tile size, including tiles smaller than the halo and larger than the image
+ */
+static void testSameAsBackToBack()
+{
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<float> shade(-20, 280);
+    Matrix kernel(BIG_KERNEL_SIZE, BIG_KERNEL_SIZE);
+    for (int i = 0; i < BIG_KERNEL_SIZE * BIG_KERNEL_SIZE; i++)
+    {
+        kernel[i] = shade(gen) / 500;
+    }
+    for (int rows : {1, 2, 5, 37, 130, 300})
+    {
+        for (int cols : {1, 3, 17, 64, 513, 700})
+        {
+            Matrix image(rows, cols);
+            for (int i = 0; i < rows * cols; i++)
+            {
+                image[i] = gen() % 3 != 0 ? (float)(gen() % 256) : shade(gen); // mostly integer shades
+            }
+            MatrixView transposed = MatrixView(image).transposed();
+            Matrix chain = quantization(sobel(blur(image)), CHAIN_LEVELS);
+            Matrix transposedChain = quantization(sobel(blur(transposed.toMatrix())), CHAIN_LEVELS);
+            Matrix convolved = blur(convolution(image, kernel));
+            for (auto tile : {std::make_pair(1, 1), std::make_pair(7, 5), std::make_pair(32, 64),
+                              std::make_pair(128, 512), std::make_pair(1000, 1000)})
+            {
+                FilterPipeline pipeline(tile.first, tile.second);
+                pipeline.blur().sobel().quantization(CHAIN_LEVELS);
+                CHECK(pipeline.getHalo() == 2);
+                CHECK(sameBits(pipeline.run(image), chain));
+                CHECK(sameBits(pipeline.run(transposed), transposedChain));
+                FilterPipeline withKernel(tile.first, tile.second);
+                withKernel.convolution(kernel).blur();
+                CHECK(sameBits(withKernel.run(image), convolved));
+                FilterPipeline empty(tile.first, tile.second);
+                CHECK(sameBits(empty.run(transposed), transposed.toMatrix()));
+            }
+        }
+    }
+}
+
+/**
+ * The raw floats of a matrix, row after row without padding
+ * @param m - the matrix
+ * @return the bytes
+ */
+static std::string rawRows(const Matrix& m)
+{
+    std::string bytes;
+    for (int i = 0; i < m.getRows(); i++)
+    {
+        bytes.append((const char*)(m.getData() + (size_t)i * m.getStride()), m.getCols() * sizeof(float));
+    }
+    return bytes;
+}
+
+/**
+ * The pipelines runStream is checked with: the filter chain, a convolution with a wider halo and the empty
+ * pipeline (which copies its input)
+ * @param kernel - the kernel of the convolution
+ * @return the pipelines
+ */
+static std::vector<FilterPipeline> streamPipelines(const Matrix& kernel)
+{
+    std::vector<FilterPipeline> pipelines(3, FilterPipeline(STREAM_TILE_ROWS, STREAM_TILE_COLS));
+    pipelines[0].blur().sobel().quantization(CHAIN_LEVELS);
+    pipelines[1].convolution(kernel).blur();
+    return pipelines;
+}
+
+/**
+ * runStream gives run() bit for bit for every band size, from a single row through the halo to more than the whole
+ * image, reading the image in order from an unseekable stream and writing every row once, in order
+ */
+static void testRunStream()
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> shade(-20, 280);
+    Matrix kernel(BIG_KERNEL_SIZE, BIG_KERNEL_SIZE);
+    for (int i = 0; i < BIG_KERNEL_SIZE * BIG_KERNEL_SIZE; i++)
+    {
+        kernel[i] = shade(gen) / 500;
+    }
+    std::vector<FilterPipeline> pipelines = streamPipelines(kernel);
+    for (auto size : {std::make_pair(1, 1), std::make_pair(5, 17), std::make_pair(37, 64),
+                      std::make_pair(130, 513)})
+    {
+        int rows = size.first, cols = size.second;
+        Matrix image(rows, cols);
+        for (int i = 0; i < rows * cols; i++)
+        {
+            image[i] = gen() % 3 != 0 ? (float)(gen() % 256) : shade(gen);
+        }
+        std::string bytes = rawRows(image);
+        for (const FilterPipeline& pipeline : pipelines)
+        {
+            Matrix expected = pipeline.run(image);
+            CHECK(pipeline.getHalo() > 0 || sameBits(expected, image));
+            for (int bandRows : {1, 2, 3, 7, pipeline.getHalo() + 1, rows - 1, rows, rows + 5, PIPELINE_BAND_ROWS})
+            {
+                if (bandRows <= 0)
+                {
+                    continue;
+                }
+                PipeBuffer pipe(bytes);
+                std::istream in(&pipe);
+                int rowsRead = 0, rowsWritten = 0;
+                bool readOk = true;
+                Matrix res(rows, cols);
+                pipeline.runStream(rows, cols, [&](float* dst, int numRows, int stride)
+                {
+                    for (int i = 0; i < numRows; i++)
+                    {
+                        readOk = readOk && in.read((char*)(dst + (size_t)i * stride), cols * sizeof(float));
+                    }
+                    rowsRead += numRows;
+                }, [&](const float* src, int numRows, int stride)
+                {
+                    for (int i = 0; i < numRows && rowsWritten + i < rows; i++)
+                    {
+                        std::memcpy(res.getData() + (size_t)(rowsWritten + i) * res.getStride(),
+                                    src + (size_t)i * stride, cols * sizeof(float));
+                    }
+                    rowsWritten += numRows;
+                }, bandRows);
+                CHECK(readOk && rowsRead == rows && in.peek() == std::char_traits<char>::eof());
+                CHECK(rowsWritten == rows);
+                CHECK(sameBits(res, expected));
+            }
+        }
+    }
+}
+
+/**
+ * Writes bytes into a pipe from another thread, the reader gets it as /dev/fd/N
+ * @param bytes - the bytes
+ * @param feeder - set to the thread writing them, which closes the write end when done
+ * @return the path of the read end, the caller closes it
+ */
+static std::string feedPipe(const std::string& bytes, std::thread& feeder)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return "";
+    }
+    feeder = std::thread([&bytes, fd = fds[1]]
+    {
+        for (size_t done = 0; done < bytes.size();)
+        {
+            ssize_t n = write(fd, bytes.data() + done, bytes.size() - done);
+            if (n <= 0)
+            {
+                break;
+            }
+            done += n;
+        }
+        close(fd);
+    });
+    return "/dev/fd/" + std::to_string(fds[0]);
+}
+
+/**
+ * runFile gives run() bit for bit from a binary matrix file into another one, for every band size, and reads its
+ * input from a pipe as well
+ */
+static void testRunFile()
+{
+    std::string inPath = "/tmp/FilterPipelineTest-" + std::to_string(getpid()) + "-in.bin";
+    std::string outPath = "/tmp/FilterPipelineTest-" + std::to_string(getpid()) + "-out.bin";
+    Matrix image(FILE_ROWS, FILE_COLS);
+    for (int i = 0; i < image.getRows() * image.getCols(); i++)
+    {
+        image[i] = (float)(i * 37 % 256);
+    }
+    saveBinary(image, inPath);
+    std::ifstream saved(inPath, std::ios::binary);
+    std::stringstream fileBytes;
+    fileBytes << saved.rdbuf();
+    std::string bytes = fileBytes.str();
+    Matrix kernel(BIG_KERNEL_SIZE, BIG_KERNEL_SIZE);
+    kernel[0] = 1;
+    for (const FilterPipeline& pipeline : streamPipelines(kernel))
+    {
+        Matrix expected = pipeline.run(image);
+        for (int bandRows : {1, 4, FILE_ROWS - 1, FILE_ROWS, FILE_ROWS * 10})
+        {
+            pipeline.runFile(inPath, outPath, bandRows);
+            CHECK(sameBits(loadBinary(outPath), expected));
+        }
+        std::thread feeder;
+        std::string pipePath = feedPipe(bytes, feeder);
+        CHECK(!pipePath.empty());
+        if (!pipePath.empty())
+        {
+            pipeline.runFile(pipePath, outPath, PIPE_BAND_ROWS);
+            feeder.join();
+            close(std::stoi(pipePath.substr(std::strlen("/dev/fd/"))));
+            CHECK(sameBits(loadBinary(outPath), expected));
+        }
+    }
+    unlink(inPath.c_str());
+    unlink(outPath.c_str());
+}
+
+int main()
+{
+    testSameAsBackToBack();
+    testRunStream();
+    testRunFile();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+// g++ -std=c++17 -O2 -I.. FilterThreadsTest.cpp ../*.cpp -pthread -o FilterThreadsTest
+#include "Convolution.h"
+#include "Filters.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <random>
+#include <vector>
+
+#define NUM_SIZES 7
+#define NUM_THREAD_COUNTS 5
+#define MAX_SHADE 255
+#define LEVELS 5
+#define KERNEL_SIZE 7
+#define ROI_OFFSET 3
+
+/**
+ * Odd image sizes, so the bands the rows are cut into end at every kind of row and the rows end in partial vectors;
+ * the largest is cut into several bands by every filter (see POOL_BAND_WORK)
+ */
+static const int SIZES[NUM_SIZES][2] = {{1, 1}, {3, 257}, {97, 33}, {131, 129}, {255, 65}, {513, 67}, {1031, 259}};
+
+/**
+ * The thread counts compared with a single thread, more than the rows of some of the images
+ */
+static const int THREAD_COUNTS[NUM_THREAD_COUNTS] = {2, 3, 4, 7, 16};
+
+/**
+ * The results of every banded filter on an image
+ */
+struct Results
+{
+    std::vector<Matrix> floats;
+    ByteMatrix blurBytes, sobelBytes, quantBytes;
+    ShortMatrix blurShorts, sobelShorts;
+    DoubleMatrix blurDoubles;
+};
+
+/**
+ * Runs every banded filter on an image on the shared pool
+ * @param image - the image (a region of a larger image)
+ * @param kernel - a kernel that is not separable
+ * @param separable - a separable kernel
+ * @return the results
+ */
+static Results filterAll(const MatrixView& image, const Matrix& kernel, const Matrix& separable)
+{
+    Results res;
+    Matrix magnitude, orientation;
+    res.floats.push_back(blur(image));
+    res.floats.push_back(sobel(image));
+    res.floats.push_back(sobel(image, &magnitude, &orientation));
+    res.floats.push_back(magnitude);
+    res.floats.push_back(orientation);
+    res.floats.push_back(quantization(image, LEVELS));
+    res.floats.push_back(quantization(image, QuantTable::equalized(image, LEVELS)));
+    res.floats.push_back(convolve(image, kernel, CONV_DIRECT));
+    res.floats.push_back(convolve(image, separable, CONV_SEPARABLE));
+    res.floats.push_back(convolve(image, kernel, CONV_FFT));
+    Matrix copy = image.toMatrix();
+    ByteMatrix bytes(copy);
+    res.blurBytes = blur(bytes);
+    res.sobelBytes = sobel(bytes);
+    res.quantBytes = quantization(bytes, LEVELS);
+    ShortMatrix shorts(copy);
+    res.blurShorts = blur(shorts);
+    res.sobelShorts = sobel(shorts);
+    res.blurDoubles = blur(DoubleMatrix(copy));
+    return res;
+}
+
+/**
+ * Every banded filter gives the same result bit for bit on any number of threads as on one, on odd sizes and on
+ * regions of a larger image, so no band reads or writes across its seam
+ */
+static void testThreadCountsAgree()
+{
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<float> shade(0, MAX_SHADE);
+    Matrix kernel(KERNEL_SIZE, KERNEL_SIZE), separable(KERNEL_SIZE, KERNEL_SIZE);
+    for (int i = 0; i < KERNEL_SIZE; i++)
+    {
+        for (int j = 0; j < KERNEL_SIZE; j++)
+        {
+            kernel(i, j) = (shade(gen) / MAX_SHADE - 0.3f) / KERNEL_SIZE;
+            separable(i, j) = (float)((i + 1) * (KERNEL_SIZE - j)) / (KERNEL_SIZE * KERNEL_SIZE * KERNEL_SIZE);
+        }
+    }
+    for (const auto& size : SIZES)
+    {
+        Matrix large(size[0] + 2 * ROI_OFFSET, size[1] + 2 * ROI_OFFSET);
+        for (int i = 0; i < large.getRows() * large.getCols(); i++)
+        {
+            large[i] = shade(gen);
+        }
+        MatrixView region = MatrixView(large).roi(ROI_OFFSET, ROI_OFFSET - 1, size[0], size[1]);
+        ThreadPool::setSharedThreads(1);
+        Results serial = filterAll(region, kernel, separable);
+        for (int threads : THREAD_COUNTS)
+        {
+            ThreadPool::setSharedThreads(threads);
+            Results banded = filterAll(region, kernel, separable);
+            bool floatsSame = true;
+            for (size_t f = 0; f < serial.floats.size(); f++)
+            {
+                floatsSame = floatsSame && banded.floats[f] == serial.floats[f];
+            }
+            CHECK(floatsSame);
+            CHECK(banded.blurBytes == serial.blurBytes);
+            CHECK(banded.sobelBytes == serial.sobelBytes);
+            CHECK(banded.quantBytes == serial.quantBytes);
+            CHECK(banded.blurShorts == serial.blurShorts);
+            CHECK(banded.sobelShorts == serial.sobelShorts);
+            CHECK(banded.blurDoubles == serial.blurDoubles);
+        }
+    }
+    ThreadPool::setSharedThreads(0);
+}
+
+int main()
+{
+    testThreadCountsAgree();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+// g++ -std=c++17 -O2 -I.. GemmTest.cpp ../*.cpp -pthread -o GemmTest
+#include "Gemm.h"
+#include "Matrix.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Multiplies strided matrices of small integers with gemm and compares with a plain triple loop, the sums are exact
+ * @param m - num of rows in a and c
+ * @param n - num of cols in b and c
+ * @param k - num of cols in a and rows in b
+ * @return true if every element is equal
+ */
+static bool gemmMatches(int m, int n, int k)
+{
+    int lda = k + 3, ldb = n + 5, ldc = n + 1;
+    std::vector<float> a((size_t)m * lda), b((size_t)k * ldb), c((size_t)m * ldc, -7);
+    for (float& x : a)
+    {
+        x = (float)(rand() % 7 - 3);
+    }
+    for (float& x : b)
+    {
+        x = (float)(rand() % 5 - 2);
+    }
+    gemm(m, n, k, a.data(), lda, b.data(), ldb, c.data(), ldc);
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            float expected = 0;
+            for (int p = 0; p < k; p++)
+            {
+                expected += a[(size_t)i * lda + p] * b[(size_t)p * ldb + j];
+            }
+            if (c[(size_t)i * ldc + j] != expected)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Sizes around the blocking and the tiles of every micro-kernel
+ */
+static void testSizes()
+{
+    int sizes[][3] = {{1, 1, 1}, {3, 5, 7}, {33, 17, 65}, {97, 130, 300}, {200, 1030, 257}, {6, 16, 400},
+                      {13, 2049, 31}, {300, 300, 300}, {GEMM_MC + 1, GEMM_NC + 1, GEMM_KC + 1}};
+    for (auto& size : sizes)
+    {
+        CHECK(gemmMatches(size[0], size[1], size[2]));
+    }
+}
+
+/**
+ * Matrix multiplication goes through gemm
+ */
+static void testMatrixProduct()
+{
+    Matrix a(150, 260), b(260, 170);
+    for (int i = 0; i < 150 * 260; i++)
+    {
+        a[i] = (float)(i % 11) - 5;
+    }
+    for (int i = 0; i < 260 * 170; i++)
+    {
+        b[i] = (float)(i % 7) - 3;
+    }
+    Matrix c = a * b;
+    bool same = true;
+    for (int i = 0; i < 150; i++)
+    {
+        for (int j = 0; j < 170; j++)
+        {
+            float expected = 0;
+            for (int p = 0; p < 260; p++)
+            {
+                expected += a(i, p) * b(p, j);
+            }
+            same = same && c(i, j) == expected;
+        }
+    }
+    CHECK(same);
+    Matrix d = a;
+    d *= b;
+    CHECK(d == c);
+}
+
+/**
+ * Products run from the tasks of another pool, larger than the shared one, run inline with valid scratch
+ */
+static void testInsideAnotherPool()
+{
+    Matrix a(300, 300), b(300, 300);
+    for (int i = 0; i < 300 * 300; i++)
+    {
+        a[i] = (float)(i % 13) * 0.25f;
+        b[i] = (float)(i % 11) * 0.5f;
+    }
+    Matrix expected = a * b;
+    ThreadPool::setSharedThreads(2);
+    ThreadPool other(4);
+    std::vector<char> same(4, 0);
+    other.parallelFor(4, [&](int task, int)
+    {
+        same[task] = a * b == expected;
+    });
+    CHECK(same == std::vector<char>(4, 1));
+    ThreadPool::setSharedThreads(0);
+}
+
+int main()
+{
+    std::cout << "kernel: " << gemmKernelName() << std::endl;
+    testSizes();
+    testMatrixProduct();
+    testInsideAnotherPool();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+// g++ -std=c++17 -O2 -I.. MatrixAllocTest.cpp ../*.cpp -pthread -o MatrixAllocTest
+#include "Convolution.h"
+#include "Filters.h"
+#include "Matrix.h"
+#include "MatrixAlloc.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include <stdexcept>
+#include <thread>
+
+#define FRAMES 5
+#define TEST_THREADS 4
+#define NUM_FRAME_SIZES 3
+#define NUM_CLASS_CASES 12
+#define SMALL_ARENA_BLOCK_BYTES 4096
+#define KERNEL_SIZE 5
+#define KERNEL_SCALE 256.0f
+#define QUANT_LEVELS 5
+
+/**
+ * The image sizes a frame filters: a wide padded image, a narrow one and one larger than a small arena block
+ */
+static const int FRAME_SIZES[NUM_FRAME_SIZES][2] = {{64, 200}, {37, 11}, {129, 77}};
+
+/**
+ * Sizes and the bytes of the size class holding them: multiples of ALLOC_ALIGNMENT up to 1 KB, then four classes
+ * per power of two
+ */
+static const size_t CLASS_CASES[NUM_CLASS_CASES][2] = {{0, 64}, {1, 64}, {64, 64}, {65, 128}, {1000, 1024},
+                                                       {1024, 1024}, {1025, 1280}, {1281, 1536}, {2048, 2048},
+                                                       {2049, 2560}, {3585, 4096}, {100000, 114688}};
+
+/**
+ * Makes an image of shades
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @return the image
+ */
+static Matrix makeImage(int rows, int cols)
+{
+    Matrix image(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            image(i, j) = (float)((i * 29 + j * 13) % 256);
+        }
+    }
+    return image;
+}
+
+/**
+ * Filters one frame: every filter and convolution strategy on every frame size, keeping nothing
+ * @param images - the images, one per frame size
+ * @param kernel - a kernel for the convolutions
+ */
+static void filterFrame(const Matrix* images, const Matrix& kernel)
+{
+    for (int s = 0; s < NUM_FRAME_SIZES; s++)
+    {
+        Matrix blurred = blur(images[s]);
+        Matrix edges = sobel(images[s]);
+        Matrix magnitude, orientation;
+        Matrix gradient = sobel(MatrixView(images[s]), &magnitude, &orientation);
+        Matrix quantized = quantization(images[s], QUANT_LEVELS);
+        Matrix direct = convolve(images[s], kernel, CONV_DIRECT);
+        Matrix separable = convolve(images[s], kernel, CONV_SEPARABLE);
+        Matrix fft = convolve(images[s], kernel, CONV_FFT);
+        Matrix sum = blurred + edges * 0.5f + direct;
+    }
+}
+
+/**
+ * The binomial kernel, separable
+ * @return the kernel
+ */
+static Matrix binomialKernel()
+{
+    static const float taps[KERNEL_SIZE] = {1, 4, 6, 4, 1};
+    Matrix kernel(KERNEL_SIZE, KERNEL_SIZE);
+    for (int i = 0; i < KERNEL_SIZE; i++)
+    {
+        for (int j = 0; j < KERNEL_SIZE; j++)
+        {
+            kernel(i, j) = taps[i] * taps[j] / KERNEL_SCALE;
+        }
+    }
+    return kernel;
+}
+
+/**
+ * Under a PoolAllocator scope the filters reach a steady state after the first frame: the later frames take no
+ * buffer from the heap, on one thread and on several, and the default allocator is not touched
+ */
+static void testPoolSteadyState()
+{
+    Matrix kernel = binomialKernel();
+    Matrix images[NUM_FRAME_SIZES];
+    for (int s = 0; s < NUM_FRAME_SIZES; s++)
+    {
+        images[s] = makeImage(FRAME_SIZES[s][0], FRAME_SIZES[s][1]);
+    }
+    for (int threads : {1, TEST_THREADS})
+    {
+        ThreadPool::setSharedThreads(threads);
+        PoolAllocator pool;
+        MatrixAllocatorScope scope(pool);
+        filterFrame(images, kernel);
+        MatrixAllocStats warm = pool.getStats();
+        long defaultBefore = defaultMatrixAllocator().getStats().allocations;
+        for (int f = 0; f < FRAMES; f++)
+        {
+            filterFrame(images, kernel);
+        }
+        MatrixAllocStats steady = pool.getStats();
+        CHECK(warm.heapAllocations > 0);
+        CHECK(steady.heapAllocations == warm.heapAllocations);
+        CHECK(steady.allocations > warm.allocations);
+        CHECK(steady.bytesInUse == warm.bytesInUse);
+        CHECK(steady.peakBytes == warm.peakBytes);
+        CHECK(defaultMatrixAllocator().getStats().allocations == defaultBefore);
+    }
+    ThreadPool::setSharedThreads(0);
+}
+
+/**
+ * Under an ArenaAllocator scope reset between frames the filters take no block from the heap after the first
+ * frame, with blocks smaller than some of the buffers too
+ */
+static void testArenaSteadyState()
+{
+    Matrix kernel = binomialKernel();
+    Matrix images[NUM_FRAME_SIZES];
+    for (int s = 0; s < NUM_FRAME_SIZES; s++)
+    {
+        images[s] = makeImage(FRAME_SIZES[s][0], FRAME_SIZES[s][1]);
+    }
+    for (size_t blockBytes : {(size_t)ARENA_DEFAULT_BLOCK_BYTES, (size_t)SMALL_ARENA_BLOCK_BYTES})
+    {
+        ArenaAllocator arena(blockBytes);
+        {
+            MatrixAllocatorScope scope(arena);
+            filterFrame(images, kernel);
+        }
+        arena.reset();
+        long warmHeap = arena.getStats().heapAllocations;
+        size_t warmCapacity = arena.getCapacity();
+        for (int f = 0; f < FRAMES; f++)
+        {
+            {
+                MatrixAllocatorScope scope(arena);
+                filterFrame(images, kernel);
+            }
+            arena.reset();
+        }
+        CHECK(warmHeap > 0);
+        CHECK(arena.getStats().heapAllocations == warmHeap);
+        CHECK(arena.getCapacity() == warmCapacity);
+        CHECK(arena.getStats().bytesInUse == 0);
+    }
+}
+
+/**
+ * A size is served from the smallest class holding it: a buffer given back is reused for any size of its class and
+ * not for a size of the next class, and the pool caches the bytes of the class
+ */
+static void testSizeClasses()
+{
+    for (const auto& sizes : CLASS_CASES)
+    {
+        size_t bytes = sizes[0];
+        size_t classBytes = sizes[1];
+        PoolAllocator pool;
+        void* p = pool.allocate(bytes);
+        pool.deallocate(p, bytes);
+        CHECK(pool.getCachedBytes() == classBytes);
+        CHECK(pool.allocate(classBytes) == p); // the largest size of the class
+        CHECK(pool.getCachedBytes() == 0);
+        pool.deallocate(p, classBytes);
+        void* next = pool.allocate(classBytes + 1); // the next class
+        CHECK(pool.getStats().heapAllocations == 2);
+        CHECK(pool.getCachedBytes() == classBytes);
+        pool.deallocate(next, classBytes + 1);
+        CHECK(classBytes % ALLOC_ALIGNMENT == 0 && classBytes >= bytes);
+        CHECK(bytes <= 1024 || (classBytes - bytes) * 5 <= classBytes);
+    }
+    PoolAllocator pool;
+    pool.deallocate(pool.allocate(1), 1);
+    pool.trim();
+    CHECK(pool.getCachedBytes() == 0);
+}
+
+/**
+ * Scopes nest, the destructor makes the previous allocator current again (when unwinding too), the scope of a
+ * thread does not apply on other threads, and a matrix gives its buffer back to the allocator it came from
+ */
+static void testScopeRestored()
+{
+    MatrixAllocator& heap = defaultMatrixAllocator();
+    PoolAllocator pool;
+    ArenaAllocator arena;
+    CHECK(&currentMatrixAllocator() == &heap);
+    Matrix* kept;
+    {
+        MatrixAllocatorScope outer(pool);
+        kept = new Matrix(10, 100);
+        {
+            MatrixAllocatorScope inner(arena);
+            CHECK(&currentMatrixAllocator() == &arena);
+            MatrixAllocator* other = nullptr;
+            std::thread([&other] { other = &currentMatrixAllocator(); }).join();
+            CHECK(other == &heap);
+        }
+        CHECK(&currentMatrixAllocator() == &pool);
+        try
+        {
+            MatrixAllocatorScope thrown(arena);
+            throw std::runtime_error("unwind");
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+        CHECK(&currentMatrixAllocator() == &pool);
+    }
+    CHECK(&currentMatrixAllocator() == &heap);
+    CHECK(pool.getStats().bytesInUse > 0);
+    delete kept; // after its scope ended
+    CHECK(pool.getStats().bytesInUse == 0);
+    CHECK(pool.getCachedBytes() > 0);
+}
+
+int main()
+{
+    testPoolSteadyState();
+    testArenaSteadyState();
+    testSizeClasses();
+    testScopeRestored();
+    return testResult();
+}
\ No newline at end of file
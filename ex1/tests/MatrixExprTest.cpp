@@ -0,0 +1,103 @@
+// g++ -std=c++17 -O2 -I.. MatrixExprTest.cpp ../*.cpp -pthread -o MatrixExprTest
+#include "Matrix.h"
+#include "TestCheck.h"
+#include <cstdlib>
+#include <sstream>
+#include <utility>
+
+#define ROWS 13
+#define COLS 70
+
+/**
+ * Makes a ROWS * COLS matrix of fractional elements
+ * @return the matrix
+ */
+static Matrix randomMatrix()
+{
+    Matrix m(ROWS, COLS);
+    for (int i = 0; i < ROWS * COLS; i++)
+    {
+        m[i] = (float)rand() / (float)RAND_MAX;
+    }
+    return m;
+}
+
+/**
+ * A fused expression gives the elements of the operators applied one at a time, bit for bit
+ */
+static void testFusedResults()
+{
+    Matrix a = randomMatrix(), b = randomMatrix(), c = randomMatrix();
+    Matrix expected(ROWS, COLS);
+    for (int i = 0; i < ROWS; i++)
+    {
+        for (int j = 0; j < COLS; j++)
+        {
+            float t = a(i, j) + b(i, j);
+            t = t * 2.0f;
+            t = t * (1 / 4.0f);
+            expected(i, j) = t + c(i, j);
+        }
+    }
+    Matrix x = 2.0f * (a + b) / 4.0f + c;
+    CHECK(x == expected);
+    Matrix q = a * 3, q2 = 3 * a;
+    CHECK(q == q2);
+    CHECK((a + b).eval() == Matrix(a + b));
+}
+
+/**
+ * Expressions work wherever a matrix did: dimensions, comparison, printing and multiplication
+ */
+static void testMatrixApi()
+{
+    Matrix a = randomMatrix(), b = randomMatrix(), m(COLS, 5);
+    for (int i = 0; i < COLS * 5; i++)
+    {
+        m[i] = (float)(i % 3);
+    }
+    Matrix ab = a + b;
+    CHECK((a + b).getRows() == ROWS && (a + b).getCols() == COLS);
+    CHECK((a + b) == ab && ab == (a + b) && !((a + b) != ab));
+    CHECK((a + b) * m == ab * m);
+    CHECK(ab * (m * 1.0f) == ab * m);
+    std::stringstream lazy, eager;
+    lazy << (a + b);
+    eager << ab;
+    CHECK(lazy.str() == eager.str());
+}
+
+/**
+ * Assignments that read the target, reshape it, or reuse an expiring operand
+ */
+static void testAssignment()
+{
+    Matrix a = randomMatrix(), b = randomMatrix();
+    Matrix ab = a + b;
+    Matrix y = a;
+    y = y + b;
+    CHECK(y == ab);
+    Matrix z = a;
+    z = std::move(z) + z;
+    CHECK(z == a * 2.0f);
+    Matrix w = a, w2 = a;
+    w += b * 2.0f;
+    Matrix b2 = b * 2.0f;
+    w2 += b2;
+    CHECK(w == w2);
+    Matrix t = a;
+    const float* buffer = t.getData();
+    Matrix u = std::move(t) + b;
+    CHECK(u.getData() == buffer && u == ab);
+    Matrix e(2, 2);
+    e = a + b;
+    CHECK(e == ab);
+}
+
+int main()
+{
+    testFusedResults();
+    testMatrixApi();
+    testAssignment();
+    return testResult();
+}
\ No newline at end of file
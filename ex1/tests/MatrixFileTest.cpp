@@ -0,0 +1,304 @@
+// g++ -std=c++17 -O2 -I.. MatrixFileTest.cpp ../*.cpp -pthread -o MatrixFileTest
+#include "MatrixFile.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PADDED_COLS 100 // wide enough to get a padded stride
+#define NARROW_COLS 5
+#define TEST_ROWS 7
+#define GAP_BYTES 64
+#define MISALIGNED_OFFSET (MAT_FILE_HEADER_SIZE + 2)
+#define HUGE_STREAM_OFFSET (2 << 20)
+
+/**
+ * Compares two matrices bit for bit, padding aside
+ * @param a - the first matrix
+ * @param data - the elements of the second one
+ * @param rows - num of rows in the second one
+ * @param cols - num of cols in the second one
+ * @param stride - the row stride of the second one
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameBits(const Matrix& a, const float* data, int rows, int cols, int stride)
+{
+    if (a.getRows() != rows || a.getCols() != cols)
+    {
+        return false;
+    }
+    for (int i = 0; i < rows; i++)
+    {
+        if (std::memcmp(a.getData() + (size_t)i * a.getStride(), data + (size_t)i * stride, cols * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compares two matrices bit for bit
+ * @param a - the first matrix
+ * @param b - the second matrix
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameBits(const Matrix& a, const Matrix& b)
+{
+    return sameBits(a, b.getData(), b.getRows(), b.getCols(), b.getStride());
+}
+
+/**
+ * Makes a matrix of assorted values, infinities and NaN included
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @return the matrix
+ */
+static Matrix assorted(int rows, int cols)
+{
+    Matrix m(rows, cols);
+    for (int i = 0; i < rows * cols; i++)
+    {
+        m[i] = (float)(i * 37 % 101) / 7 - 5;
+    }
+    if (rows > 0 && cols > 0)
+    {
+        m(0, 0) = std::numeric_limits<float>::infinity();
+        m(rows - 1, cols - 1) = std::nanf("");
+    }
+    return m;
+}
+
+/**
+ * A path for a temporary file of this process
+ * @param name - the name of the file
+ * @return the path
+ */
+static std::string tempPath(const std::string& name)
+{
+    return "/tmp/MatrixFileTest-" + std::to_string(getpid()) + "-" + name;
+}
+
+/**
+ * Runs an action in a child process, the errors of the library exit the process
+ * @param action - the action
+ * @return true if the child exited with EXIT_FAILURE
+ */
+template <typename F>
+static bool failsWithExit(F action)
+{
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        action();
+        _exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE;
+}
+
+/**
+ * Makes a valid header
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param stride - the row stride
+ * @param dataOffset - the offset of the payload
+ * @return the header
+ */
+static MatrixFileHeader makeHeader(int64_t rows, int64_t cols, int64_t stride, uint64_t dataOffset)
+{
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, MAT_FILE_MAGIC, MAT_FILE_MAGIC_LEN);
+    header.version = MAT_FILE_VERSION;
+    header.dtype = MAT_FILE_DTYPE_FLOAT32;
+    header.rows = rows;
+    header.cols = cols;
+    header.stride = stride;
+    header.dataOffset = dataOffset;
+    return header;
+}
+
+/**
+ * Writes raw bytes to a file descriptor
+ * @param fd - the file descriptor
+ * @param bytes - the bytes
+ */
+static void writeAll(int fd, const std::string& bytes)
+{
+    size_t done = 0;
+    while (done < bytes.size())
+    {
+        ssize_t n = write(fd, bytes.data() + done, bytes.size() - done);
+        if (n <= 0)
+        {
+            return;
+        }
+        done += (size_t)n;
+    }
+}
+
+/**
+ * Writes raw bytes as a file
+ * @param path - the file path
+ * @param bytes - the contents
+ */
+static void writeFile(const std::string& path, const std::string& bytes)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    writeAll(fd, bytes);
+    close(fd);
+}
+
+/**
+ * A header followed by a gap and a payload of zeros, as bytes
+ * @param header - the header
+ * @param bodyBytes - the bytes after the header
+ * @return the bytes
+ */
+static std::string fileBytes(const MatrixFileHeader& header, size_t bodyBytes)
+{
+    std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    return bytes + std::string(bodyBytes, '\0');
+}
+
+/**
+ * Feeds bytes through a pipe, the reader gets it as /dev/fd/N (the bytes must fit in the pipe buffer)
+ * @param bytes - the bytes
+ * @return the path of the read end
+ */
+static std::string pipeOf(const std::string& bytes)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return "";
+    }
+    writeAll(fds[1], bytes);
+    close(fds[1]);
+    return "/dev/fd/" + std::to_string(fds[0]);
+}
+
+/**
+ * Save and load, the streaming writer and reader, and the mapping keep every element, for padded and narrow
+ * strides and empty matrices
+ */
+static void testRoundTrips()
+{
+    std::string path = tempPath("round.bin");
+    const int shapes[][2] = {{TEST_ROWS, PADDED_COLS}, {TEST_ROWS, NARROW_COLS}, {0, 0}, {0, NARROW_COLS},
+                             {TEST_ROWS, 0}, {1, 1}};
+    for (const auto& shape : shapes)
+    {
+        Matrix m = assorted(shape[0], shape[1]);
+        saveBinary(m, path);
+        CHECK(sameBits(loadBinary(path), m));
+        MappedMatrix mapped(path);
+        CHECK(mapped.getStride() == m.getStride());
+        CHECK(sameBits(m, mapped.getData(), mapped.getRows(), mapped.getCols(), mapped.getStride()));
+        CHECK(sameBits(mapped.toMatrix(), m));
+        MappedMatrix moved(std::move(mapped));
+        CHECK(mapped.getData() == nullptr && sameBits(moved.toMatrix(), m));
+
+        // dense rows in the file, written a row at a time and read in uneven chunks into a padded matrix
+        {
+            MatrixFileWriter writer(path, m.getRows(), m.getCols());
+            for (int i = 0; i < m.getRows(); i++)
+            {
+                writer.writeRow(m.getData() + (size_t)i * m.getStride());
+            }
+            writer.close();
+        }
+        MatrixFileReader reader(path);
+        Matrix read(reader.getRows(), reader.getCols());
+        for (int i = 0; i < read.getRows(); i += 2)
+        {
+            int n = std::min(2, read.getRows() - i);
+            reader.readRows(read.getData() + (size_t)i * read.getStride(), n, read.getStride());
+        }
+        CHECK(sameBits(read, m));
+        CHECK(sameBits(MappedMatrix(path).toMatrix(), m));
+    }
+    Matrix a = assorted(TEST_ROWS, PADDED_COLS);
+    a(0, 0) = 1;
+    a(TEST_ROWS - 1, PADDED_COLS - 1) = 2;
+    saveBinary(a, path);
+    MappedMatrix mapped(path);
+    Matrix sum = mapped + a; // a leaf of expressions
+    Matrix twice = a * 2;
+    CHECK(sameBits(sum, twice));
+    unlink(path.c_str());
+}
+
+/**
+ * A header that does not describe a payload within the file is rejected by every reader
+ */
+static void testBadHeaders()
+{
+    std::string path = tempPath("bad.bin");
+    size_t payload = (size_t)TEST_ROWS * NARROW_COLS * sizeof(float);
+    MatrixFileHeader good = makeHeader(TEST_ROWS, NARROW_COLS, NARROW_COLS, MAT_FILE_HEADER_SIZE);
+    MatrixFileHeader badMagic = good;
+    badMagic.magic[0] = 'X';
+    MatrixFileHeader narrowStride = good;
+    narrowStride.stride = NARROW_COLS - 1;
+    MatrixFileHeader misaligned = good;
+    misaligned.dataOffset = MISALIGNED_OFFSET;
+    MatrixFileHeader hugeOffset = good;
+    hugeOffset.dataOffset = UINT64_MAX - 3; // offset + payload wraps around
+    MatrixFileHeader overflowing = makeHeader(INT32_MAX, INT32_MAX, INT32_MAX, MAT_FILE_HEADER_SIZE);
+    MatrixFileHeader negative = good;
+    negative.rows = -1;
+    const std::pair<MatrixFileHeader, size_t> cases[] = {{badMagic, payload}, {narrowStride, payload},
+        {misaligned, payload + 2}, {hugeOffset, payload}, {overflowing, payload}, {negative, payload},
+        {good, payload - 1}};
+    for (const auto& c : cases)
+    {
+        writeFile(path, fileBytes(c.first, c.second));
+        CHECK(failsWithExit([&] { loadBinary(path); }));
+        CHECK(failsWithExit([&] { MappedMatrix mapped(path); }));
+    }
+    writeFile(path, fileBytes(good, payload).substr(0, MAT_FILE_HEADER_SIZE / 2)); // a truncated header
+    CHECK(failsWithExit([&] { loadBinary(path); }));
+    CHECK(failsWithExit([&] { MappedMatrix mapped(path); }));
+    writeFile(path, fileBytes(good, payload));
+    CHECK(!failsWithExit([&] { loadBinary(path); }));
+    CHECK(!failsWithExit([&] { MappedMatrix mapped(path); }));
+    unlink(path.c_str());
+}
+
+/**
+ * Through a pipe, whose size is unknown, a gap before the payload is skipped, and a gap that is too large or runs
+ * past the end of the stream is rejected
+ */
+static void testPipe()
+{
+    Matrix m = assorted(TEST_ROWS, NARROW_COLS);
+    MatrixFileHeader header = makeHeader(TEST_ROWS, NARROW_COLS, NARROW_COLS, MAT_FILE_HEADER_SIZE + GAP_BYTES);
+    std::string bytes = fileBytes(header, GAP_BYTES);
+    bytes.append(reinterpret_cast<const char*>(m.getData()), (size_t)TEST_ROWS * NARROW_COLS * sizeof(float));
+    std::string path = pipeOf(bytes);
+    Matrix read = loadBinary(path);
+    close(std::stoi(path.substr(path.rfind('/') + 1)));
+    CHECK(sameBits(read, m));
+
+    MatrixFileHeader hugeGap = header;
+    hugeGap.dataOffset = HUGE_STREAM_OFFSET;
+    CHECK(failsWithExit([&] { loadBinary(pipeOf(fileBytes(hugeGap, 0))); }));
+    CHECK(failsWithExit([&] { loadBinary(pipeOf(fileBytes(header, GAP_BYTES / 2))); }));
+}
+
+int main()
+{
+    testRoundTrips();
+    testBadHeaders();
+    testPipe();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+// g++ -std=c++17 -O2 -I.. MatrixMoveTest.cpp ../*.cpp -pthread -o MatrixMoveTest
+#include "Matrix.h"
+#include "TestCheck.h"
+#include <utility>
+
+#define ROWS 37
+#define COLS 83
+
+/**
+ * Makes a matrix with distinct elements
+ * @param seed - varies the elements
+ * @return the matrix
+ */
+static Matrix makeMatrix(int seed)
+{
+    Matrix m(ROWS, COLS);
+    for (int i = 0; i < ROWS * COLS; i++)
+    {
+        m[i] = (float)((i * 31 + seed * 7) % 97) * 0.25f - 10;
+    }
+    return m;
+}
+
+/**
+ * The number of buffers an expression allocates
+ * @param expr - evaluates the expression
+ * @return the allocations made by expr
+ */
+template <typename F>
+static long allocationsOf(F expr)
+{
+    PoolAllocator pool;
+    MatrixAllocatorScope scope(pool);
+    Matrix a = makeMatrix(1), b = makeMatrix(2), c = makeMatrix(3);
+    long before = pool.getStats().allocations;
+    expr(a, b, c);
+    return pool.getStats().allocations - before;
+}
+
+/**
+ * Moving leaves the source an empty 0*0 matrix that can be assigned again
+ */
+static void testMovedFrom()
+{
+    Matrix a = makeMatrix(1);
+    const float* data = a.getData();
+    Matrix b(std::move(a));
+    CHECK(b.getData() == data);
+    CHECK(a.getRows() == 0 && a.getCols() == 0);
+    Matrix c;
+    c = std::move(b);
+    CHECK(c.getData() == data);
+    CHECK(b.getRows() == 0 && b.getCols() == 0);
+    a = c;
+    CHECK(a == c && a.getData() != c.getData());
+    b = makeMatrix(1);
+    CHECK(b == c);
+}
+
+/**
+ * Expressions on expiring operands give the same elements as on lvalues
+ */
+static void testRvalueResults()
+{
+    Matrix a = makeMatrix(1), b = makeMatrix(2), c = makeMatrix(3);
+    Matrix sum = a + b + c;
+    CHECK(makeMatrix(1) + b + c == sum);
+    CHECK(a + makeMatrix(2) + makeMatrix(3) == sum);
+    CHECK((makeMatrix(1) + makeMatrix(2)) + makeMatrix(3) == sum);
+    Matrix scaled = a * 3.0f / 2.0f;
+    CHECK(makeMatrix(1) * 3.0f / 2.0f == scaled);
+    CHECK(3.0f * makeMatrix(1) / 2.0f == scaled);
+    Matrix right(COLS, 5);
+    for (int i = 0; i < COLS * 5; i++)
+    {
+        right[i] = (float)(i % 9) - 4;
+    }
+    Matrix acc = a;
+    acc *= right;
+    CHECK(acc == a * right && acc.getRows() == ROWS && acc.getCols() == 5);
+}
+
+/**
+ * An expression over expiring operands reuses one of their buffers instead of allocating
+ */
+static void testAllocations()
+{
+    CHECK(allocationsOf([](Matrix& a, Matrix& b, Matrix& c) { Matrix r = a + b + c; }) == 1);
+    CHECK(allocationsOf([](Matrix& a, Matrix& b, Matrix& c) { Matrix r = std::move(a) + b + c; }) == 0);
+    CHECK(allocationsOf([](Matrix& a, Matrix&, Matrix&) { Matrix r = std::move(a) * 0.5f / 4.0f; }) == 0);
+    CHECK(allocationsOf([](Matrix& a, Matrix& b, Matrix& c) { c = a + b; }) == 0);
+    CHECK(allocationsOf([](Matrix& a, Matrix& b, Matrix&) { Matrix r = std::move(a); r = std::move(b); }) == 0);
+}
+
+int main()
+{
+    testMovedFrom();
+    testRvalueResults();
+    testAllocations();
+    return testResult();
+}
\ No newline at end of file
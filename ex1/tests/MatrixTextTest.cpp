@@ -0,0 +1,213 @@
+// g++ -std=c++17 -O2 -I.. MatrixTextTest.cpp ../*.cpp -pthread -o MatrixTextTest
+#include "Matrix.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#define PIPE_CHUNK 7 // characters a PipeBuffer hands out at a time, so tokens are split between chunks
+
+/**
+ * A stream buffer over a string that cannot seek, as a pipe, and hands out a few characters at a time
+ */
+class PipeBuffer : public std::streambuf
+{
+
+private:
+    std::string _text;
+    size_t _next;
+
+protected:
+    int_type underflow() override
+    {
+        if (_next == _text.size())
+        {
+            return traits_type::eof();
+        }
+        size_t count = std::min((size_t)PIPE_CHUNK, _text.size() - _next);
+        char* begin = &_text[_next];
+        setg(begin, begin, begin + count);
+        _next += count;
+        return traits_type::to_int_type(*begin);
+    }
+
+public:
+    explicit PipeBuffer(std::string text) : _text(std::move(text)), _next(0) {}
+};
+
+/**
+ * Compares floats bit for bit (any NaN matches any NaN of the same sign)
+ * @param a - the first float
+ * @param b - the second float
+ * @return true if they are the same
+ */
+static bool sameFloat(float a, float b)
+{
+    if (std::isnan(a) || std::isnan(b))
+    {
+        return std::isnan(a) && std::isnan(b) && std::signbit(a) == std::signbit(b);
+    }
+    uint32_t bitsA, bitsB;
+    std::memcpy(&bitsA, &a, sizeof(a));
+    std::memcpy(&bitsB, &b, sizeof(b));
+    return bitsA == bitsB;
+}
+
+/**
+ * Compares matrices element by element with sameFloat
+ * @param a - the first matrix
+ * @param b - the second matrix
+ * @return true if they have the same dimensions and elements
+ */
+static bool sameMatrix(const Matrix& a, const Matrix& b)
+{
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.getRows(); i++)
+    {
+        for (int j = 0; j < a.getCols(); j++)
+        {
+            if (!sameFloat(a(i, j), b(i, j)))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Makes a matrix of random bit patterns with the special values in its first row
+ * @return the matrix
+ */
+static Matrix randomBitsMatrix()
+{
+    Matrix m(200, 97);
+    std::mt19937 gen(5);
+    for (int i = 0; i < m.getRows() * m.getCols(); i++)
+    {
+        uint32_t bits = gen();
+        std::memcpy(&m[i], &bits, sizeof(bits));
+    }
+    float specials[] = {0.0f, -0.0f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                        std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+                        std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::max(),
+                        std::numeric_limits<float>::lowest(), std::numeric_limits<float>::min(), 0.1f, 1e-7f};
+    for (size_t j = 0; j < sizeof(specials) / sizeof(specials[0]); j++)
+    {
+        m(0, (int)j) = specials[j];
+    }
+    return m;
+}
+
+/**
+ * writeExact, and operator<< with 9 digits, read back to the same floats, including infinities and NaN
+ */
+static void testRoundTrip()
+{
+    Matrix m = randomBitsMatrix();
+    std::stringstream exact;
+    writeExact(exact, m);
+    Matrix fromExact(m.getRows(), m.getCols());
+    exact >> fromExact;
+    CHECK(!exact.fail() && sameMatrix(fromExact, m));
+
+    std::stringstream printed;
+    printed.precision(std::numeric_limits<float>::max_digits10);
+    printed << m;
+    Matrix fromPrinted(m.getRows(), m.getCols());
+    printed >> fromPrinted;
+    CHECK(!printed.fail() && sameMatrix(fromPrinted, m));
+
+    PipeBuffer pipe(exact.str());
+    std::istream piped(&pipe);
+    Matrix fromPipe(m.getRows(), m.getCols());
+    piped >> fromPipe;
+    CHECK(!piped.fail() && sameMatrix(fromPipe, m));
+}
+
+/**
+ * Decimal text is rounded as the stream extraction rounds it
+ */
+static void testRounding()
+{
+    const char* texts[] = {"0.1", "1e-45", "7e-46", "3.4028235e38", "-2.5", "+16777217", "1.00000005960464477539",
+                           "0.3333333333333333333333333333333", "123456789012345678901234567890"};
+    for (const char* text : texts)
+    {
+        std::istringstream viaStream(text), viaMatrix(text);
+        float expected;
+        viaStream >> expected;
+        Matrix m(1, 1);
+        viaMatrix >> m;
+        CHECK(!viaMatrix.fail() && sameFloat(m(0, 0), expected));
+    }
+    std::istringstream tooLarge("1e39");
+    Matrix m(1, 1);
+    tooLarge >> m;
+    CHECK(tooLarge.fail());
+}
+
+/**
+ * Reading a matrix leaves what follows it in the stream, seekable or not
+ */
+static void testReadAhead()
+{
+    std::string text = "1 2\n3 4\n5 6 -7.5\ttail";
+    std::istringstream seekable(text);
+    PipeBuffer pipe(text);
+    std::istream piped(&pipe);
+    for (std::istream* is : {(std::istream*)&seekable, &piped})
+    {
+        Matrix a(2, 2), b(1, 3);
+        std::string word;
+        *is >> a >> b >> word;
+        CHECK(a(0, 0) == 1 && a(1, 1) == 4 && b(0, 0) == 5 && b(0, 2) == -7.5f);
+        CHECK(word == "tail");
+    }
+    PipeBuffer shortPipe("1 2 3");
+    std::istream shortStream(&shortPipe);
+    Matrix tooMany(2, 2);
+    shortStream >> tooMany;
+    CHECK(shortStream.fail() && shortStream.eof());
+    for (const char* text : {"1 2x 3 4", "1 +x 3 4", "1 - 3 4"})
+    {
+        PipeBuffer badPipe(text);
+        std::istream badStream(&badPipe);
+        std::istringstream badString(text);
+        Matrix bad(2, 2);
+        badStream >> bad;
+        badString >> bad;
+        CHECK(badStream.fail() && badString.fail());
+    }
+}
+
+/**
+ * Printing flushes its buffer between rows too, also when the rows have no elements
+ */
+static void testLongOutput()
+{
+    Matrix empty(200000, 0);
+    std::ostringstream os;
+    os << empty;
+    CHECK(os.str() == std::string(199999, '\n'));
+    Matrix column(100000, 1);
+    column += 0.125f;
+    std::ostringstream col;
+    col << column;
+    CHECK(col.str().size() == 100000 * 6 - 1);
+}
+
+int main()
+{
+    testRoundTrip();
+    testRounding();
+    testReadAhead();
+    testLongOutput();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,346 @@
+// g++ -std=c++17 -O2 -I.. QuantizationTest.cpp ../*.cpp -pthread -o QuantizationTest
+#include "Filters.h"
+#include "Quantization.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#define NUM_KERNELS 3
+#define NUM_ROW_LENGTHS 17
+#define GUARD_BYTES 80 // past the row, more than a vector of the widest kernel
+#define SENTINEL 0xA5
+#define EQUALIZED_ROWS 32
+#define EQUALIZED_COLS 200
+
+/**
+ * The byte kernels of QuantTable, the ones the cpu does not support are skipped
+ */
+static const char* const KERNELS[NUM_KERNELS] = {"avx512vbmi", "avx2", "scalar"};
+
+/**
+ * Row lengths around the vectors of every kernel, so the full vectors and the tails of any length are run
+ */
+static const int ROW_LENGTHS[NUM_ROW_LENGTHS] = {0, 1, 7, 15, 16, 31, 32, 33, 63, 64, 65, 127, 129, 255, 256, 257,
+                                                 301};
+
+/**
+ * Runs an action in a child process, the errors of the library exit the process
+ * @param action - the action
+ * @return true if the child exited with EXIT_FAILURE
+ */
+template <typename F>
+static bool failsWithExit(F action)
+{
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        action();
+        _exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE;
+}
+
+/**
+ * Makes a table of levels given by their widths
+ * @param widths - the number of shades of every level, summing to QUANT_NUM_SHADES
+ * @param shades - the output shade of every level
+ * @return the table
+ */
+static QuantTable tableOfWidths(const std::vector<int>& widths, const std::vector<float>& shades)
+{
+    std::vector<int> bounds;
+    int bound = 0;
+    for (size_t k = 0; k + 1 < widths.size(); k++)
+    {
+        bound += widths[k];
+        bounds.push_back(bound);
+    }
+    return QuantTable(bounds, shades);
+}
+
+/**
+ * The number of different outputs of a table
+ * @param table - the table
+ * @return the number of runs of shades with the same output, if it never goes down
+ */
+static int countLevels(const QuantTable& table)
+{
+    int levels = 1;
+    for (int shade = 1; shade < QUANT_NUM_SHADES; shade++)
+    {
+        if (table[shade] < table[shade - 1])
+        {
+            return -1;
+        }
+        levels += table[shade] != table[shade - 1];
+    }
+    return levels;
+}
+
+/**
+ * The uniform tables cut the shades into levels of QUANT_NUM_SHADES / levels shades, the last one taking the
+ * remainder, each mapped to its middle shade, and are built once
+ */
+static void testUniform()
+{
+    bool entriesOk = true;
+    for (int levels = 1; levels <= QUANT_MAX_LEVELS; levels++)
+    {
+        const QuantTable& table = QuantTable::uniform(levels);
+        int range = QUANT_NUM_SHADES / levels;
+        for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+        {
+            int level = std::min(shade / range, levels - 1);
+            entriesOk = entriesOk && table[shade] == (float)(range / 2 - 1 + level * range);
+        }
+    }
+    CHECK(entriesOk);
+    CHECK(&QuantTable::uniform(7) == &QuantTable::uniform(7));
+    CHECK(QuantTable::uniform(4)[63] == 31 && QuantTable::uniform(4)[64] == 95);
+    CHECK(QuantTable::uniform(QUANT_MAX_LEVELS)[0] == -1); // the middle of a level of one shade is below it
+}
+
+/**
+ * A table of custom bounds maps every shade to the shade of its level, from the first shade of the level on,
+ * and invalid bounds or levels exit
+ */
+static void testCustomBounds()
+{
+    QuantTable table({10, 100, 101, 255}, {-20, 5.5f, 300, 77.7f, 255.5f});
+    CHECK(table[0] == -20 && table[9] == -20);
+    CHECK(table[10] == 5.5f && table[99] == 5.5f);
+    CHECK(table[100] == 300);
+    CHECK(table[101] == 77.7f && table[254] == 77.7f);
+    CHECK(table[255] == 255.5f);
+    QuantTable single({}, {42});
+    CHECK(single[0] == 42 && single[255] == 42);
+
+    CHECK(failsWithExit([] { QuantTable t({10, 10}, {1, 2, 3}); }));
+    CHECK(failsWithExit([] { QuantTable t({20, 10}, {1, 2, 3}); }));
+    CHECK(failsWithExit([] { QuantTable t({0}, {1, 2}); }));
+    CHECK(failsWithExit([] { QuantTable t({QUANT_NUM_SHADES}, {1, 2}); }));
+    CHECK(failsWithExit([] { QuantTable t({10}, {1, 2, 3}); }));
+    CHECK(failsWithExit([] { QuantTable t({}, {}); }));
+    CHECK(failsWithExit([] { QuantTable::uniform(0); }));
+    CHECK(failsWithExit([] { QuantTable::uniform(QUANT_MAX_LEVELS + 1); }));
+    CHECK(failsWithExit([] { QuantTable::equalized(ByteMatrix(1, 1), 0); }));
+    CHECK(!failsWithExit([] { QuantTable t({1, 255}, {1, 2, 3}); }));
+}
+
+/**
+ * The equalized tables cut a flat histogram as the uniform ones do, give every level at least one shade on a
+ * skewed histogram, hold about the same number of pixels in every level, and agree on 8-bit and float images
+ */
+static void testEqualized()
+{
+    ByteMatrix flat(1, QUANT_NUM_SHADES);
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        flat(0, shade) = (uint8_t)shade;
+    }
+    for (int levels : {1, 2, 4, 16, 64})
+    {
+        QuantTable table = QuantTable::equalized(flat, levels);
+        bool sameAsUniform = true;
+        for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+        {
+            sameAsUniform = sameAsUniform && table[shade] == QuantTable::uniform(levels)[shade];
+        }
+        CHECK(sameAsUniform);
+    }
+    QuantTable identity = QuantTable::equalized(flat, QUANT_MAX_LEVELS); // a level of one shade keeps it
+    bool keepsShades = true;
+    for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+    {
+        keepsShades = keepsShades && identity[shade] == shade;
+    }
+    CHECK(keepsShades);
+
+    ByteMatrix skewed(EQUALIZED_ROWS, EQUALIZED_COLS);
+    for (int i = 0; i < EQUALIZED_ROWS; i++)
+    {
+        for (int j = 0; j < EQUALIZED_COLS; j++)
+        {
+            skewed(i, j) = (uint8_t)(j < EQUALIZED_COLS / 2 ? 200 : (i * 7 + j) % 64);
+        }
+    }
+    Matrix skewedFloats(skewed);
+    for (int levels : {1, 2, 3, 5, 8, 64, QUANT_MAX_LEVELS})
+    {
+        QuantTable table = QuantTable::equalized(skewed, levels);
+        CHECK(countLevels(table) == levels);
+        QuantTable fromFloats = QuantTable::equalized(MatrixView(skewedFloats), levels);
+        bool sameTables = true;
+        for (int shade = 0; shade < QUANT_NUM_SHADES; shade++)
+        {
+            sameTables = sameTables && table[shade] == fromFloats[shade];
+        }
+        CHECK(sameTables);
+    }
+    QuantTable halves = QuantTable::equalized(skewed, 2); // half of the pixels are below 64, the other half at 200
+    CHECK(halves[0] == halves[63] && halves[63] != halves[64] && halves[64] == halves[255]);
+}
+
+/**
+ * Float pixels are looked up by their integer part limited to the shades: NaN, negative pixels and -inf take the
+ * first entry, pixels of 255 and above and inf the last
+ */
+static void testFloatLookup()
+{
+    QuantTable table({1, 4, 255}, {10, 20, 30, 40});
+    const float inf = std::numeric_limits<float>::infinity();
+    const float in[] = {std::nanf(""), -inf, -1e9f, -5, -0.5f, 0.99f, 1, 3.99f, 4, 254.99f, 255, 255.5f, 1e9f, inf};
+    const float expected[] = {10, 10, 10, 10, 10, 10, 20, 20, 30, 30, 40, 40, 40, 40};
+    const int n = sizeof(in) / sizeof(in[0]);
+    float out[n];
+    table.apply(in, out, n);
+    CHECK(std::memcmp(out, expected, sizeof(out)) == 0);
+    Matrix image(1, n);
+    for (int j = 0; j < n; j++)
+    {
+        image(0, j) = in[j];
+    }
+    Matrix quantized = quantization(MatrixView(image), table);
+    bool sameAsApply = true;
+    for (int j = 0; j < n; j++)
+    {
+        sameAsApply = sameAsApply && quantized(0, j) == expected[j];
+    }
+    CHECK(sameAsApply);
+    CHECK(QuantTable::shadeOf(std::nan("")) == 0 && QuantTable::shadeOf(-3) == 0 && QuantTable::shadeOf(300) == 255);
+}
+
+/**
+ * The tables the byte kernels are compared on: few and many runs, exactly QUANT_MAX_RUNS runs and one more (the
+ * shuffle cutoff), runs at the ends of the shades, and levels that saturate into the same byte and so merge
+ * @return the tables
+ */
+static std::vector<QuantTable> byteTables()
+{
+    std::vector<QuantTable> tables;
+    for (int levels : {1, 2, 3, 7, 15, 16, 17, 64, QUANT_MAX_LEVELS})
+    {
+        tables.push_back(QuantTable::uniform(levels));
+    }
+    std::vector<int> widths;
+    std::vector<float> shades;
+    for (int k = 0; k < QUANT_MAX_RUNS; k++)
+    {
+        widths.push_back(QUANT_NUM_SHADES / QUANT_MAX_RUNS);
+        shades.push_back((float)(QUANT_NUM_SHADES - 1 - k * 13));
+    }
+    tables.push_back(tableOfWidths(widths, shades)); // exactly QUANT_MAX_RUNS runs, descending
+    widths.back() -= 1;
+    widths.push_back(1);
+    shades.push_back(7);
+    tables.push_back(tableOfWidths(widths, shades)); // one run too many
+    tables.push_back(tableOfWidths({1, 254, 1}, {255, 0, 128})); // single shade runs at both ends
+    tables.push_back(tableOfWidths({1, 254, 1}, {-3, 12.5f, 999})); // saturated, rounded ties to even
+    // 20 levels but 3 runs: levels below 0 and above 255 saturate into the same bytes
+    std::vector<int> manyWidths(20, 12);
+    manyWidths.back() = QUANT_NUM_SHADES - 19 * 12;
+    std::vector<float> manyShades;
+    for (int k = 0; k < 20; k++)
+    {
+        manyShades.push_back(k < 9 ? -1.0f - k : (k < 10 ? 100.0f : 256.0f + k));
+    }
+    tables.push_back(tableOfWidths(manyWidths, manyShades));
+    return tables;
+}
+
+/**
+ * Every byte kernel the cpu supports gives the scalar lookup of saturateCast(table[shade]) for all the shades, at
+ * every row length and offset, in place too, and writes nothing past the row
+ */
+static void testByteKernels()
+{
+    std::string detected = quantKernelName();
+    CHECK(useQuantKernel("scalar"));
+    CHECK(!useQuantKernel("sse9"));
+    CHECK(std::string(quantKernelName()) == "scalar");
+    std::vector<QuantTable> tables = byteTables();
+    int kernelsRun = 0;
+    for (const char* kernel : KERNELS)
+    {
+        if (!useQuantKernel(kernel))
+        {
+            continue;
+        }
+        kernelsRun++;
+        bool kernelOk = true;
+        for (const QuantTable& table : tables)
+        {
+            for (int n : ROW_LENGTHS)
+            {
+                for (int offset : {0, 1, 7})
+                {
+                    std::vector<uint8_t> in(offset + n + GUARD_BYTES), out(offset + n + GUARD_BYTES, SENTINEL);
+                    for (int i = 0; i < n; i++)
+                    {
+                        in[offset + i] = (uint8_t)((i * 97 + offset * 31 + n) % QUANT_NUM_SHADES);
+                    }
+                    if (n == QUANT_NUM_SHADES)
+                    {
+                        for (int i = 0; i < n; i++)
+                        {
+                            in[offset + i] = (uint8_t)i; // every shade in order
+                        }
+                    }
+                    std::vector<uint8_t> inPlace = in;
+                    table.apply(in.data() + offset, out.data() + offset, n);
+                    table.apply(inPlace.data() + offset, inPlace.data() + offset, n);
+                    for (int i = 0; i < n; i++)
+                    {
+                        uint8_t expected = saturateCast<uint8_t>(table[in[offset + i]]);
+                        kernelOk = kernelOk && out[offset + i] == expected && inPlace[offset + i] == expected;
+                    }
+                    for (int i = 0; i < offset; i++)
+                    {
+                        kernelOk = kernelOk && out[i] == SENTINEL;
+                    }
+                    for (int i = offset + n; i < (int)out.size(); i++)
+                    {
+                        kernelOk = kernelOk && out[i] == SENTINEL && inPlace[i] == in[i];
+                    }
+                }
+            }
+        }
+        CHECK(kernelOk);
+        if (!kernelOk)
+        {
+            std::cerr << "byte kernel " << kernel << " differs from the lookup" << std::endl;
+        }
+        ByteMatrix image(EQUALIZED_ROWS, EQUALIZED_COLS);
+        for (int i = 0; i < EQUALIZED_ROWS * EQUALIZED_COLS; i++)
+        {
+            image[i] = (uint8_t)(i * 13 % QUANT_NUM_SHADES);
+        }
+        ByteMatrix quantized = image;
+        quantizeInPlace(quantized, tables.back());
+        CHECK(quantized == ByteMatrix(quantization(Matrix(image), tables.back())));
+        CHECK(quantization(image, 5) == ByteMatrix(quantization(Matrix(image), 5)));
+    }
+    CHECK(kernelsRun >= 1);
+    CHECK(useQuantKernel(detected.c_str()));
+}
+
+int main()
+{
+    testUniform();
+    testCustomBounds();
+    testEqualized();
+    testFloatLookup();
+    testByteKernels();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+// g++ -std=c++17 -O2 -I.. StencilTest.cpp ../*.cpp -pthread -o StencilTest
+#include "Convolution.h"
+#include "Stencil.h"
+#include "TestCheck.h"
+#include <random>
+
+#define NUM_SIZES 9
+#define MIN_SHADE 0
+#define MAX_SHADE 255
+#define UNCLAMPED 1e30f // a limit no response reaches
+#define VIEW_MARGIN 3
+
+/**
+ * Image sizes, from smaller than the stencils (all border) to wide enough for full vectors of every instruction set
+ * and tails of any length
+ */
+static const int SIZES[NUM_SIZES][2] = {{1, 1}, {2, 3}, {1, 40}, {9, 2}, {5, 17}, {13, 33}, {31, 64}, {64, 200},
+                                        {7, 515}};
+
+/**
+ * The 3x5 binomial: (1, 2, 1) / 4 down the columns and (1, 4, 6, 4, 1) / 16 along the rows
+ */
+typedef SeparableStencil<StencilTaps<2, 1, 2, 1>, StencilTaps<4, 1, 4, 6, 4, 1>> Binomial3x5;
+
+/**
+ * A derivative along the rows, its nonzero taps paired (summed or subtracted first, multiplied once)
+ */
+typedef SeparableStencil<StencilTaps<0, 1, 2, 1>, StencilTaps<3, 1, 0, -1>> DerivativeX;
+
+/**
+ * A derivative down the columns with a pair of taps of 2, a power of two other than 1
+ */
+typedef SeparableStencil<StencilTaps<1, -2, 0, 2>, StencilTaps<2, 1, 2, 1>> DerivativeY;
+
+/**
+ * Taps of 3, not a power of two, so they are not paired, with zero taps left out on both sides
+ */
+typedef SeparableStencil<StencilTaps<3, 0, 3, 0, -3, 0>, StencilTaps<1, 0, 1, 0>> UnpairedTall;
+
+/**
+ * A single tap, off the center: a shift of the image
+ */
+typedef SeparableStencil<StencilTaps<0, 0, 0, 1>, StencilTaps<0, 1, 0, 0, 0, 0, 0, 0>> Shift;
+
+/**
+ * A stencil of zero taps only
+ */
+typedef SeparableStencil<StencilTaps<0, 0>, StencilTaps<0, 0, 0, 0>> Zero;
+
+/**
+ * Makes a fractional image, a region of a larger one so its rows are strided
+ * @param large - set to the larger image
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param gen - the random generator
+ * @return the region
+ */
+static MatrixView fractionalRegion(Matrix& large, int rows, int cols, std::mt19937& gen)
+{
+    std::uniform_real_distribution<float> shade(-MAX_SHADE, 2 * MAX_SHADE);
+    large = Matrix(rows + 2 * VIEW_MARGIN, cols + 2 * VIEW_MARGIN);
+    for (int i = 0; i < large.getRows() * large.getCols(); i++)
+    {
+        large[i] = shade(gen);
+    }
+    return MatrixView(large).roi(VIEW_MARGIN, VIEW_MARGIN, rows, cols);
+}
+
+/**
+ * Convolves with a stencil's matrix at runtime and clamps, as one stencil is documented to
+ * @param image - the image
+ * @param lo - the smallest output value
+ * @param hi - the largest output value
+ * @return the convolved image
+ */
+template <typename S>
+static Matrix viaConvolve(const MatrixView& image, float lo, float hi)
+{
+    Matrix res = convolve(image, S::matrix());
+    clampValues(res, lo, hi);
+    return res;
+}
+
+/**
+ * A stencil gives convolve on its matrix() followed by clampValues bit for bit, on fractional images of any size,
+ * on strided regions and on transposed views, clamped or not
+ */
+template <typename S>
+static void checkAgainstConvolve()
+{
+    std::mt19937 gen(S::Col::size * 100 + S::Row::size);
+    bool same = true;
+    for (const auto& size : SIZES)
+    {
+        Matrix large;
+        MatrixView region = fractionalRegion(large, size[0], size[1], gen);
+        MatrixView transposed = region.transposed();
+        for (const MatrixView& view : {region, transposed})
+        {
+            same = same && convolveStencils<S>(view, -UNCLAMPED, UNCLAMPED) ==
+                           viaConvolve<S>(view, -UNCLAMPED, UNCLAMPED);
+            same = same && convolveStencils<S>(view, MIN_SHADE, MAX_SHADE) == viaConvolve<S>(view, MIN_SHADE, MAX_SHADE);
+        }
+    }
+    CHECK(same);
+    if (!same)
+    {
+        std::cerr << "a " << S::Col::size << "x" << S::Row::size << " stencil differs from convolve" << std::endl;
+    }
+}
+
+/**
+ * The taps count and pair their nonzero weights at compile time
+ */
+static void testTaps()
+{
+    typedef StencilTaps<4, 1, 4, 6, 4, 1> Binomial;
+    typedef StencilTaps<3, 1, 0, -1> Derivative;
+    typedef StencilTaps<3, 0, 3, 0, -3, 0> Threes;
+    typedef StencilTaps<0, 0, 0, 0> Zeros;
+    static_assert(Binomial::size == 5 && Binomial::radius == 2, "binomial taps");
+    static_assert(Binomial::count() == 5 && !Binomial::paired(), "binomial taps");
+    static_assert(Derivative::count() == 2 && Derivative::paired() && Derivative::first(1) == 2, "derivative taps");
+    static_assert(Threes::count() == 2 && !Threes::paired() && Threes::first(0) == 1, "taps of 3");
+    static_assert(Zeros::count() == 0 && Zeros::first(0) == Zeros::size, "zero taps");
+    CHECK(Binomial::weight(2) == 6.0f / 16);
+    CHECK(Derivative::weight(2) == -1.0f / 8);
+    Matrix binomial = Binomial3x5::matrix();
+    CHECK(binomial.getRows() == 3 && binomial.getCols() == 5);
+    CHECK(binomial(1, 2) == 2.0f / 4 * 6.0f / 16 && binomial(0, 0) == 1.0f / 64);
+}
+
+/**
+ * Two stencils give the rounded responses added and clamped, as convolveGradients does, which is the sum of the
+ * two convolutions (already rounded) clamped
+ */
+static void testTwoStencils()
+{
+    std::mt19937 gen(3);
+    bool same = true;
+    for (const auto& size : SIZES)
+    {
+        Matrix large;
+        MatrixView region = fractionalRegion(large, size[0], size[1], gen);
+        Matrix sum = convolve(region, DerivativeX::matrix()) + convolve(region, DerivativeY::matrix());
+        clampValues(sum, MIN_SHADE, MAX_SHADE);
+        same = same && convolveStencils<DerivativeX, DerivativeY>(region, MIN_SHADE, MAX_SHADE) == sum;
+        Matrix mixed = convolve(region, Binomial3x5::matrix()) + convolve(region, UnpairedTall::matrix());
+        clampValues(mixed, -UNCLAMPED, UNCLAMPED);
+        same = same && convolveStencils<Binomial3x5, UnpairedTall>(region, -UNCLAMPED, UNCLAMPED) == mixed;
+    }
+    CHECK(same);
+}
+
+int main()
+{
+    testTaps();
+    checkAgainstConvolve<Binomial3x5>();
+    checkAgainstConvolve<DerivativeX>();
+    checkAgainstConvolve<DerivativeY>();
+    checkAgainstConvolve<UnpairedTall>();
+    checkAgainstConvolve<Shift>();
+    checkAgainstConvolve<Zero>();
+    testTwoStencils();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef EXERCISE5_TESTCHECK_H
+#define EXERCISE5_TESTCHECK_H
+
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * Checks a condition of a test, printing the failed expression and where it is
+ */
+#define CHECK(cond) checkThat((cond), #cond, __FILE__, __LINE__)
+
+/**
+ * The number of failed checks so far
+ * @return a reference to the counter
+ */
+inline int& failedChecks()
+{
+    static int failed = 0;
+    return failed;
+}
+
+/**
+ * Records the result of a check
+ * @param ok - the result
+ * @param expr - the checked expression
+ * @param file - the file of the check
+ * @param line - the line of the check
+ */
+inline void checkThat(bool ok, const char* expr, const char* file, int line)
+{
+    if (!ok)
+    {
+        std::cerr << file << ":" << line << ": check failed: " << expr << std::endl;
+        failedChecks()++;
+    }
+}
+
+/**
+ * Reports the result of a test program
+ * @return EXIT_SUCCESS if every check passed, EXIT_FAILURE otherwise
+ */
+inline int testResult()
+{
+    if (failedChecks() != 0)
+    {
+        std::cerr << failedChecks() << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+#endif //EXERCISE5_TESTCHECK_H
\ No newline at end of file
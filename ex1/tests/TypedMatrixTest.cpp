@@ -0,0 +1,195 @@
+// g++ -std=c++17 -O2 -I.. TypedMatrixTest.cpp ../*.cpp -pthread -o TypedMatrixTest
+#include "Filters.h"
+#include "Matrix.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#define NUM_SHAPES 6
+#define SHORT_MIN_VAL -300 // the 16-bit images reach beyond the shades on both sides
+#define SHORT_MAX_VAL 600
+#define QUARTER 0.25
+
+/**
+ * The image shapes the filters are checked on: single pixels, single rows and columns, narrow (unpadded) and wide
+ * (padded) rows
+ */
+static const int SHAPES[NUM_SHAPES][2] = {{1, 1}, {1, 70}, {9, 1}, {17, 5}, {23, 64}, {31, 129}};
+
+/**
+ * The levels the quantization is checked with
+ */
+static const int LEVELS[] = {1, 3, 4, 7, 256};
+
+/**
+ * Makes an image of random integer shades
+ * @param rows - num of rows
+ * @param cols - num of cols
+ * @param lo - the smallest shade
+ * @param hi - the largest shade
+ * @param seed - the seed of the shades
+ * @return the image, as floats
+ */
+static Matrix randomImage(int rows, int cols, int lo, int hi, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> shade(lo, hi);
+    Matrix image(rows, cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            image(i, j) = (float)shade(gen);
+        }
+    }
+    return image;
+}
+
+/**
+ * Conversions to integer types round to the nearest integer with ties to even, for negative values too
+ */
+static void testSaturateCastRounding()
+{
+    CHECK(saturateCast<uint8_t>(0.5f) == 0);
+    CHECK(saturateCast<uint8_t>(1.5f) == 2);
+    CHECK(saturateCast<uint8_t>(2.5f) == 2);
+    CHECK(saturateCast<uint8_t>(2.5000002f) == 3);
+    CHECK(saturateCast<uint8_t>(254.5f) == 254);
+    CHECK(saturateCast<uint8_t>(-0.5f) == 0);
+    CHECK(saturateCast<int16_t>(-0.5) == 0);
+    CHECK(saturateCast<int16_t>(-1.5) == -2);
+    CHECK(saturateCast<int16_t>(-2.5) == -2);
+    CHECK(saturateCast<int16_t>(-2.4999) == -2);
+    CHECK(saturateCast<int16_t>(3.5f) == 4);
+}
+
+/**
+ * Conversions to integer types saturate at both limits of the type, from floating point and from wider integers,
+ * and NaN converts to 0
+ */
+static void testSaturateCastClamping()
+{
+    CHECK(saturateCast<uint8_t>(255.4f) == 255);
+    CHECK(saturateCast<uint8_t>(300.0f) == 255);
+    CHECK(saturateCast<uint8_t>(1e10) == 255);
+    CHECK(saturateCast<uint8_t>(-0.6f) == 0);
+    CHECK(saturateCast<uint8_t>(-1e10) == 0);
+    CHECK(saturateCast<uint8_t>(std::numeric_limits<float>::infinity()) == 255);
+    CHECK(saturateCast<uint8_t>(-std::numeric_limits<float>::infinity()) == 0);
+    CHECK(saturateCast<uint8_t>(std::nanf("")) == 0);
+    CHECK(saturateCast<int16_t>(32767.4) == 32767);
+    CHECK(saturateCast<int16_t>(40000.0f) == 32767);
+    CHECK(saturateCast<int16_t>(-32768.4) == -32768);
+    CHECK(saturateCast<int16_t>(-40000.0f) == -32768);
+    CHECK(saturateCast<int16_t>(std::nan("")) == 0);
+    CHECK(saturateCast<uint8_t>((int16_t)300) == 255);
+    CHECK(saturateCast<uint8_t>((int16_t)-5) == 0);
+    CHECK(saturateCast<uint8_t>((int16_t)200) == 200);
+    CHECK(saturateCast<int16_t>((uint8_t)255) == 255);
+    CHECK(saturateCast<float>((int16_t)-5) == -5.0f);
+    CHECK(saturateCast<double>(0.1f) == (double)0.1f);
+}
+
+/**
+ * Converting a matrix converts every element with saturateCast, through every pair of element types, and
+ * converting to a wider type and back gives the matrix again
+ */
+static void testConversions()
+{
+    for (int s = 0; s < NUM_SHAPES; s++)
+    {
+        int rows = SHAPES[s][0];
+        int cols = SHAPES[s][1];
+        Matrix m(rows, cols);
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                m(i, j) = (float)((i * 37 + j * 11) % 1201 - 400) * (float)QUARTER;
+            }
+        }
+        ByteMatrix bytes(m);
+        ShortMatrix shorts(m);
+        DoubleMatrix doubles(m);
+        bool convertedOk = true;
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                convertedOk = convertedOk && bytes(i, j) == saturateCast<uint8_t>(m(i, j)) &&
+                              shorts(i, j) == saturateCast<int16_t>(m(i, j)) && doubles(i, j) == (double)m(i, j);
+            }
+        }
+        CHECK(convertedOk);
+        CHECK(bytes.getRows() == rows && bytes.getCols() == cols);
+        CHECK(Matrix(doubles) == m);
+        CHECK(ByteMatrix(ShortMatrix(bytes)) == bytes);
+        CHECK(ByteMatrix(Matrix(bytes)) == bytes);
+        CHECK(ByteMatrix(shorts) == bytes);
+        CHECK(ShortMatrix(Matrix(shorts)) == shorts);
+        CHECK(ShortMatrix(doubles) == shorts);
+    }
+}
+
+/**
+ * The 8-bit, 16-bit and double blur, sobel and quantization give the float filter result converted to their type,
+ * the 16-bit images reaching below 0 and above 255
+ */
+static void testTypedFilters()
+{
+    for (int s = 0; s < NUM_SHAPES; s++)
+    {
+        int rows = SHAPES[s][0];
+        int cols = SHAPES[s][1];
+        Matrix byteImage = randomImage(rows, cols, 0, 255, s);
+        Matrix shortImage = randomImage(rows, cols, SHORT_MIN_VAL, SHORT_MAX_VAL, s + NUM_SHAPES);
+        ByteMatrix bytes(byteImage);
+        ShortMatrix shorts(shortImage);
+        DoubleMatrix doubles(shortImage);
+
+        CHECK(blur(bytes) == ByteMatrix(blur(byteImage)));
+        CHECK(sobel(bytes) == ByteMatrix(sobel(byteImage)));
+        CHECK(blur(shorts) == ShortMatrix(blur(shortImage)));
+        CHECK(sobel(shorts) == ShortMatrix(sobel(shortImage)));
+        CHECK(blur(doubles) == DoubleMatrix(blur(shortImage)));
+        CHECK(sobel(doubles) == DoubleMatrix(sobel(shortImage)));
+        for (int levels : LEVELS)
+        {
+            CHECK(quantization(bytes, levels) == ByteMatrix(quantization(byteImage, levels)));
+            CHECK(quantization(shorts, levels) == ShortMatrix(quantization(shortImage, levels)));
+            CHECK(quantization(doubles, levels) == DoubleMatrix(quantization(shortImage, levels)));
+        }
+    }
+}
+
+/**
+ * The double filters keep fractional pixels: on quarter shades (exact in float) they round every response the
+ * way the float filters do, ties to even
+ */
+static void testFractionalDoubles()
+{
+    for (int s = 0; s < NUM_SHAPES; s++)
+    {
+        Matrix image = randomImage(SHAPES[s][0], SHAPES[s][1], SHORT_MIN_VAL * 4, SHORT_MAX_VAL * 4, s);
+        image *= (float)QUARTER;
+        DoubleMatrix doubles(image);
+        CHECK(blur(doubles) == DoubleMatrix(blur(image)));
+        CHECK(sobel(doubles) == DoubleMatrix(sobel(image)));
+        for (int levels : LEVELS)
+        {
+            CHECK(quantization(doubles, levels) == DoubleMatrix(quantization(image, levels)));
+        }
+    }
+}
+
+int main()
+{
+    testSaturateCastRounding();
+    testSaturateCastClamping();
+    testConversions();
+    testTypedFilters();
+    testFractionalDoubles();
+    return testResult();
+}
\ No newline at end of file
@@ -1,14 +1,21 @@
 #ifndef EX6_HASHMAP_HPP
 #define EX6_HASHMAP_HPP
-#include <list>
 #include <cstdlib>
+#include <cstdint>
 #include <functional>
 #include <algorithm>
 #include <exception>
+#include <stdexcept>
+#include <new>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 #define DEFAULT_CAPACITY 16
 #define EMPTY_SIZE 0
+#define EMPTY_SLOT 0
+#define HOME_DIST 1
 #define LOWER_LOAD_FACTOR 0.25
 #define UPPER_LOAD_FACTOR 0.75
 #define REHASH_UP_FACTOR 2
@@ -17,9 +24,19 @@
 #define ROUND_UP 0.5
 #define INVALID_INPUT_EXC "Invalid input"
 #define NO_EXIST_KEY "key does not exist"
+#define TOO_LARGE_EXC "capacity too large"
 
 /**
- * This class represents a hash map
+ * This class represents a hash map.
+ * The pairs are kept in one array of slots, by open addressing with linear probing and robin hood placement: a pair
+ * is stored at the hash of its key (its bucket) or after it, and a pair that is further from its bucket than the
+ * one in its way takes its slot. The pairs of a bucket are then adjacent, and a search for a key stops at the first
+ * slot holding a pair nearer to its own bucket than the key would be. Erasing shifts the pairs that follow back, so
+ * there are no tombstones. The capacity doubles when an insertion would take the load above the max load factor and
+ * halves when an erase takes it below the min one (both can be set), reserve, rehash and shrink_to_fit set it.
+ * The iterators give a pair as a const std::pair<KeyT, ValueT>&, not the std::pair<const KeyT, ValueT>& of the
+ * standard maps: the pairs are moved between slots as the map changes, which a const key would only allow by copying
+ * it. The value of a pair is changed through value() of a mutable iterator (or at() and operator[]).
  * @tparam KeyT - the key
  * @tparam ValueT - the value
  */
@@ -29,49 +46,97 @@ class HashMap
 
 private:
 
+    typedef std::pair<KeyT, ValueT> Entry;
+
+    /**
+     * This struct represents a slot of the map, a probe reads the distance and the pair from the same cache line
+     */
+    struct Slot
+    {
+        uint32_t dist; // the distance of the pair from its bucket plus one, EMPTY_SLOT if the slot is empty
+        alignas(Entry) unsigned char storage[sizeof(Entry)]; // the pair, alive only while the slot is full
+
+        /**
+         * The pair of a full slot
+         * @return a reference to the pair
+         */
+        Entry& entry() noexcept
+        {
+            return *std::launder(reinterpret_cast<Entry*>(storage));
+        }
+
+        /**
+         * The pair of a full slot
+         * @return a const reference to the pair
+         */
+        const Entry& entry() const noexcept
+        {
+            return *std::launder(reinterpret_cast<const Entry*>(storage));
+        }
+    };
+
     /**
-     * This class represents a const iterator of hash map
+     * This struct represents the result of a probe for a key, a handle to its slot
      */
-    class ConstIterator
+    struct Probe
+    {
+        size_t hash; // the hash of the key
+        size_t idx; // the slot holding the key, or the slot a new pair of it would take
+        uint32_t dist; // the distance of idx from the bucket of the key plus one
+        bool found; // true if the map contains the key
+    };
+
+    /**
+     * This class represents an iterator of hash map: a pointer to the map and a position in its slots, nothing is
+     * copied. The slots are visited from an empty one on, around the array; erasing shifts back only the pairs
+     * between the erased slot and the next empty one, which are not visited yet, so erasing the current pair leaves
+     * the rest of the visit as it was. Inserting into the map invalidates its iterators.
+     * The pair is read through * and ->, the value of a mutable iterator is changed through value() (the key of a
+     * pair must not change, it places the pair).
+     * @tparam IsConst - true for a const iterator
+     */
+    template <bool IsConst>
+    class BaseIterator
     {
     private:
-        HashMap<KeyT, ValueT> _hashMap; // the hash map we are iterating
-        std::pair<KeyT, ValueT> * _cur; // a pointer to the current pair of <KeyT, ValueT>
-        int _curIdx; // the index in the _hashMap._hashTable we are in
-        typename std::list<std::pair<KeyT, ValueT>>::iterator _curListIter; // the list iterator in
-        // _hashMap._hashTable[_curIdx]
+        friend class HashMap<KeyT, ValueT>;
+        template <bool> friend class BaseIterator;
+        typedef typename std::conditional<IsConst, const HashMap<KeyT, ValueT>, HashMap<KeyT, ValueT>>::type Map;
+
+        Map * _hashMap; // the hash map we are iterating
+        size_t _first; // the empty slot the visit starts at
+        size_t _pos; // the number of slots from _first to the current one, the capacity of the map at the end
 
         /**
-         * Helper function for ++ (pre and post) operators
+         * Constructor of BaseIterator
+         * @param hashMap - the hash map we are iterating
+         * @param first - the empty slot the visit starts at
+         * @param pos - the number of slots from first to the current one
          */
-        void _advanceIterator() noexcept
+        BaseIterator(Map * hashMap, size_t first, size_t pos) noexcept : _hashMap(hashMap), _first(first), _pos(pos)
         {
-            _curListIter++;
-            if (_curListIter != _hashMap._hashTable[_curIdx].end())
-            {
-                _cur = &(*_curListIter);
-            }
-            else // we've reached the end of the current list
+        }
+
+        /**
+         * The current slot
+         * @return the index of the current slot
+         */
+        size_t _slot() const noexcept
+        {
+            return (_first + _pos) & (_hashMap->_capacity - 1);
+        }
+
+        /**
+         * Goes to the first full slot from the current one on
+         */
+        void _skipEmpty() noexcept
+        {
+            while (_pos < _hashMap->_capacity && _hashMap->_slots[_slot()].dist == EMPTY_SLOT)
             {
-                _curIdx++;
-                // go to the next non-empty list
-                while (_curIdx < _hashMap.capacity() && _hashMap._hashTable[_curIdx].empty())
-                {
-                    _curIdx++;
-                }
-                if (_curIdx >= _hashMap.capacity()) // we've reached the end of the map
-                {
-                    _cur = nullptr;
-                }
-                else
-                {
-                    _curListIter = _hashMap._hashTable[_curIdx].begin();
-                    _cur = &(*_curListIter);
-                }
+                _pos++;
             }
         }
 
-
     public:
         typedef std::pair<KeyT, ValueT> value_type;
         typedef const std::pair<KeyT, ValueT>& reference;
@@ -80,182 +145,532 @@ private:
         typedef std::forward_iterator_tag iterator_category;
 
         /**
-         * Default constructor of ConstIterator
+         * Default constructor of BaseIterator
          */
-        ConstIterator() : _cur(nullptr), _curIdx(FIRST_IDX) {}
+        BaseIterator() noexcept : _hashMap(nullptr), _first(FIRST_IDX), _pos(FIRST_IDX) {}
 
         /**
-         * Constructor of ConstIterator
-         * @param hashMap - the hash map we are iterating
+         * Constructor of a const iterator from a mutable one
+         * @tparam OtherConst - false
+         * @param other - the mutable iterator
          */
-        explicit ConstIterator(const HashMap<KeyT, ValueT>& hashMap) : _hashMap(hashMap), _curIdx(FIRST_IDX)
+        template <bool OtherConst, typename = typename std::enable_if<IsConst && !OtherConst>::type>
+        BaseIterator(const BaseIterator<OtherConst>& other) noexcept :
+            _hashMap(other._hashMap), _first(other._first), _pos(other._pos)
         {
-            if (_hashMap.empty())
-            {
-                _cur = nullptr;
-            }
-            else // go to first element in the map
-            {
-                while (_hashMap._hashTable[_curIdx].empty())
-                {
-                    _curIdx++;
-                }
-                _curListIter = _hashMap._hashTable[_curIdx].begin();
-                _cur = &(*_curListIter);
-            }
         }
 
         /**
          * Operator *
-         * @return a pair of <KeyT, ValueT>
+         * @return the current pair of <KeyT, ValueT>
+         */
+        reference operator*() const noexcept
+        {
+            return _hashMap->_slots[_slot()].entry();
+        }
+
+        /**
+         * Operator ->
+         * @return pointer to the element pointed to by the iterator
+         */
+        pointer operator->() const noexcept
+        {
+            return &_hashMap->_slots[_slot()].entry();
+        }
+
+        /**
+         * The value of the current pair, which a mutable iterator may change
+         * @return a reference to the value
          */
-        value_type operator*() const noexcept
+        typename std::conditional<IsConst, const ValueT&, ValueT&>::type value() const noexcept
         {
-            return *_cur;
+            return _hashMap->_slots[_slot()].entry().second;
         }
 
         /**
          * Operator ++ (prefix)
-         * @return a reference to ConstIterator
+         * @return a reference to BaseIterator
          */
-        ConstIterator& operator++() noexcept
+        BaseIterator& operator++() noexcept
         {
-            _advanceIterator();
+            _pos++;
+            _skipEmpty();
             return *this;
         }
 
         /**
          * Operator ++ (postfix)
-         * @return ConstIterator
+         * @return BaseIterator
          */
-        ConstIterator operator++(int) noexcept
+        BaseIterator operator++(int) noexcept
         {
-            ConstIterator tmp = *this;
-            _advanceIterator();
+            BaseIterator tmp = *this;
+            ++(*this);
             return tmp;
         }
 
         /**
-         * Operator ==
-         * @param other - another ConstIterator to compare to
+         * Operator ==, two iterators of a map are equal if they are both at its end or point to the same slot (the
+         * visits they are in may start at different slots)
+         * @param other - another BaseIterator to compare to
          * @return true if they are the same iterator, false otherwise
          */
-        bool operator==(const ConstIterator& other) const noexcept
+        bool operator==(const BaseIterator& other) const noexcept
         {
-            return this->_cur == other._cur;
+            if (_hashMap != other._hashMap || _hashMap == nullptr)
+            {
+                return _hashMap == other._hashMap;
+            }
+            bool atEnd = _pos >= _hashMap->_capacity;
+            bool otherAtEnd = other._pos >= _hashMap->_capacity;
+            return atEnd || otherAtEnd ? atEnd == otherAtEnd : _slot() == other._slot();
         }
 
         /**
          * Operator !=
-         * @param other - another ConstIterator to compare to
+         * @param other - another BaseIterator to compare to
          * @return true if they are not the same iterator, false otherwise
          */
-        bool operator!=(const ConstIterator& other) const noexcept
+        bool operator!=(const BaseIterator& other) const noexcept
         {
-            return this->_cur != other._cur;
-        }
-
-        /**
-         * Operator ->
-         * @return pointer to the element pointed to by the iterator
-         */
-        pointer operator->() const noexcept
-        {
-            return &(*_cur);
+            return !(*this == other);
         }
     };
 
     size_t _size{}, _capacity{};
-    std::list<std::pair<KeyT, ValueT>> * _hashTable; // an array of lists
-    int _upperSizeLimit{};  // max allowed size (calculated only once in _init)
-    int _lowerSizeLimit{};  // min allowed size (calculated only once in _init)
+    Slot * _slots{}; // an array of slots
+    float _maxLoadFactor{UPPER_LOAD_FACTOR}; // the map grows when an insertion would take its load above this
+    float _minLoadFactor{LOWER_LOAD_FACTOR}; // the map shrinks when an erase takes its load below this
+    int _upperSizeLimit{};  // max allowed size (calculated in _setLimits)
+    int _lowerSizeLimit{};  // min allowed size (calculated in _setLimits)
+    size_t _origin{}; // an empty slot, where iterators start their visit
+
+    /**
+     * The slots of a map that has none of its own, as a map moved from: one empty slot shared by all of them, which
+     * is only read (the first insertion rehashes into slots of the map's own)
+     * @return the shared slot
+     */
+    static Slot * _sharedEmptySlot() noexcept
+    {
+        static Slot empty{};
+        return &empty;
+    }
 
     /**
      * This function initiates a hash map
-     * @param capacity - the capacity of the hash map
+     * @param capacity - the capacity of the hash map, a power of 2
      */
     void _init(size_t capacity) noexcept(false)
     {
+        _slots = new Slot[capacity](); // all slots empty
         _capacity = capacity;
-        _hashTable = new std::list<std::pair<KeyT, ValueT>>[_capacity];
         _size = EMPTY_SIZE;
-        _upperSizeLimit = (int) (_capacity * UPPER_LOAD_FACTOR);
-        _lowerSizeLimit = (int) (_capacity * LOWER_LOAD_FACTOR + ROUND_UP); // round up
+        _origin = FIRST_IDX;
+        _setLimits();
+    }
+
+    /**
+     * This function makes the map an empty one on the shared empty slot, without allocating
+     */
+    void _initShared() noexcept
+    {
+        _slots = _sharedEmptySlot();
+        _capacity = 1;
+        _size = EMPTY_SIZE;
+        _origin = FIRST_IDX;
+        _setLimits();
+    }
+
+    /**
+     * This function calculates the sizes the map is rehashed at, for its capacity and load factors. The map shrinks
+     * to half its capacity, so the lower limit is kept low enough that the halved map is at most at the middle of
+     * the two load factors, and has room for an insertion: a map does not shrink into one that grows again after a
+     * few insertions, however close the load factors are (or small the map is).
+     */
+    void _setLimits() noexcept
+    {
+        float shrinkLoad = std::min<float>(_minLoadFactor, (_minLoadFactor + _maxLoadFactor) / 2 * REHASH_DOWN_FACTOR);
+        int halvedUpperLimit = (int) ((size_t) (_capacity * REHASH_DOWN_FACTOR) * _maxLoadFactor);
+        _upperSizeLimit = (int) (_capacity * _maxLoadFactor);
+        _lowerSizeLimit = std::min((int) (_capacity * shrinkLoad + ROUND_UP), halvedUpperLimit); // round up
+    }
+
+    /**
+     * This function doubles a capacity, throwing std::length_error if the doubled one does not fit in size_t
+     * @param capacity - the capacity, a power of 2
+     * @return the doubled capacity
+     */
+    static size_t _doubled(size_t capacity) noexcept(false)
+    {
+        if (capacity > SIZE_MAX / REHASH_UP_FACTOR)
+        {
+            throw std::length_error(TOO_LARGE_EXC);
+        }
+        return capacity * REHASH_UP_FACTOR;
+    }
+
+    /**
+     * This function finds the smallest capacity that holds a number of pairs under the max load factor (throwing
+     * std::length_error if no capacity that fits in size_t does)
+     * @param numOfPairs - the number of pairs
+     * @return the capacity, a power of 2
+     */
+    size_t _capacityFor(size_t numOfPairs) const noexcept(false)
+    {
+        size_t capacity = 1;
+        while ((size_t) (capacity * _maxLoadFactor) < numOfPairs)
+        {
+            capacity = _doubled(capacity);
+        }
+        return capacity;
     }
 
     /**
-     * This function resizes and rehashes the elements
-     * @param factor - the capacity will be changed according to this factor
-     * @return true if no exception was thrown, false otherwise
+     * This function destroys the pairs and frees the slots
      */
-    bool _reHash(const float& factor) noexcept(false)
+    void _free() noexcept
     {
-        std::list<std::pair<KeyT, ValueT>> * oldHashTable = _hashTable;
-        size_t oldCapacity = _capacity;
-        size_t newCapacity = _capacity * factor;
-        _init(newCapacity);
-        // add all oldHashTable elements to the new hashTable
-        //  _reHash will never be called from _addNew since we already rehashed !
-        for (int i = 0; i < (int)oldCapacity; i++)
+        _destroyAll();
+        if (_slots != _sharedEmptySlot())
         {
-            for (auto lItr = oldHashTable[i].begin(); lItr != oldHashTable[i].end(); lItr++)
+            delete[] _slots;
+        }
+    }
+
+    /**
+     * This function destroys the pairs and empties their slots (the capacity is kept)
+     */
+    void _destroyAll() noexcept
+    {
+        for (size_t i = 0; i < _capacity; i++)
+        {
+            if (_slots[i].dist != EMPTY_SLOT)
             {
-                _addNew(lItr->first, lItr->second);
+                _slots[i].entry().~Entry();
+                _slots[i].dist = EMPTY_SLOT;
             }
         }
-        delete[] oldHashTable;
-        return true;
+        _size = EMPTY_SIZE;
     }
 
     /**
-     * This function overrides the value of the given key, by the given value (the map contains the key)
+     * This function copies the slots of a map of the same capacity, pairs in the same slots
+     * @param rhs - the map we are copying
+     */
+    void _copySlots(const HashMap<KeyT, ValueT>& rhs) noexcept(false)
+    {
+        for (size_t i = 0; i < _capacity; i++)
+        {
+            if (rhs._slots[i].dist != EMPTY_SLOT)
+            {
+                new (_slots[i].storage) Entry(rhs._slots[i].entry());
+                _slots[i].dist = rhs._slots[i].dist;
+                _size++;
+            }
+        }
+        _origin = rhs._origin;
+    }
+
+    /**
+     * This function swaps the contents of two maps
+     * @param other - the map to swap with
+     */
+    void _swap(HashMap<KeyT, ValueT>& other) noexcept
+    {
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+        std::swap(_slots, other._slots);
+        std::swap(_maxLoadFactor, other._maxLoadFactor);
+        std::swap(_minLoadFactor, other._minLoadFactor);
+        std::swap(_upperSizeLimit, other._upperSizeLimit);
+        std::swap(_lowerSizeLimit, other._lowerSizeLimit);
+        std::swap(_origin, other._origin);
+    }
+
+    /**
+     * This function returns the slot after the given one, wrapping around
+     * @param idx - the slot
+     * @return the next slot
+     */
+    size_t _nextSlot(size_t idx) const noexcept
+    {
+        return (idx + 1) & (_capacity - 1);
+    }
+
+    /**
+     * This function resizes and rehashes the elements, every pair is moved once into its new slot (the keys and
+     * values are not copied). A pair whose move may throw is copied instead if it can be, so if an exception is
+     * thrown the map is left as it was.
+     * @param capacity - the new capacity, a power of 2 that holds the pairs
+     */
+    void _reHash(size_t capacity) noexcept(false)
+    {
+        HashMap<KeyT, ValueT> resized(*this, capacity); // freed with the pairs it has if an exception is thrown
+        // from the start of a cluster on, the pairs come in the order of their buckets, so a pair moved into the new
+        // slots rarely has to shift others up
+        size_t start = FIRST_IDX;
+        while (_slots[start].dist > HOME_DIST)
+        {
+            start++;
+        }
+        for (size_t i = 0; i < _capacity; i++)
+        {
+            Slot& slot = _slots[(start + i) & (_capacity - 1)];
+            if (slot.dist != EMPTY_SLOT)
+            {
+                resized._construct(resized._vacancy(std::hash<KeyT>{}(slot.entry().first)),
+                                   std::move_if_noexcept(slot.entry()));
+            }
+        }
+        _swap(resized); // the old slots are freed with resized
+    }
+
+    /**
+     * This function empties a full slot, shifting the pairs from it to the next empty slot up a slot (the pairs of a
+     * cluster stay in the order of their buckets, as robin hood placement keeps them)
+     * @param idx - the slot
+     */
+    void _shiftUp(size_t idx) noexcept(false)
+    {
+        size_t end = idx;
+        while (_slots[end].dist != EMPTY_SLOT)
+        {
+            end = _nextSlot(end);
+        }
+        while (end != idx)
+        {
+            size_t prev = (end - 1) & (_capacity - 1);
+            new (_slots[end].storage) Entry(std::move(_slots[prev].entry()));
+            _slots[end].dist = _slots[prev].dist + 1;
+            _slots[prev].entry().~Entry();
+            end = prev;
+        }
+        _slots[idx].dist = EMPTY_SLOT;
+    }
+
+    /**
+     * This function probes for a key, hashed already
      * @param key - KeyT
-     * @param value - ValueT
+     * @param hash - the hash of the key
+     * @return the probe, at the slot of the key or at the slot a new pair of it would take
      */
-    void _overrideExisting(const KeyT& key, const ValueT& value) noexcept
+    Probe _probe(const KeyT& key, size_t hash) const noexcept
     {
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
+        Probe probe{hash, hash & (_capacity - 1), HOME_DIST, false};
+        // a pair nearer to its bucket than the key would be ends the search, the key would take its slot
+        while (_slots[probe.idx].dist >= probe.dist)
         {
-            if (i->first == key)
+            if (_slots[probe.idx].dist == probe.dist && _slots[probe.idx].entry().first == key)
             {
-                i->second = value;
+                probe.found = true;
                 break;
             }
+            probe.idx = _nextSlot(probe.idx);
+            probe.dist++;
         }
+        return probe;
     }
 
     /**
-     *  This function adds a new pair to the map
+     * This function probes for a key
      * @param key - KeyT
-     * @param value - ValueT
+     * @return the probe, at the slot of the key or at the slot a new pair of it would take
      */
-    void _addNew(const KeyT& key, const ValueT& value) noexcept(false)
+    Probe _probe(const KeyT& key) const noexcept
     {
-        if ((int)_size + 1 > _upperSizeLimit) // we need to rehash
+        return _probe(key, std::hash<KeyT>{}(key));
+    }
+
+    /**
+     * This function finds the slot of a key that the map contains
+     * @param key - KeyT
+     * @return the slot holding the key
+     */
+    size_t _existingSlot(const KeyT& key) const noexcept(false)
+    {
+        Probe probe = _probe(key);
+        if (!probe.found)
         {
-            _reHash(REHASH_UP_FACTOR);
+            throw std::out_of_range(NO_EXIST_KEY);
         }
-        std::pair<KeyT, ValueT> addedPair(key, value); // create a pair with <key, value>
-        size_t hashIdx = _findHash(key);
-        _hashTable[hashIdx].push_back(addedPair); // we already know that key did not exist in the map
+        return probe.idx;
+    }
+
+    /**
+     * This function probes for the slot a new pair would take, for a key the map does not contain
+     * @param hash - the hash of the key
+     * @return the probe
+     */
+    Probe _vacancy(size_t hash) const noexcept
+    {
+        Probe probe{hash, hash & (_capacity - 1), HOME_DIST, false};
+        while (_slots[probe.idx].dist >= probe.dist)
+        {
+            probe.idx = _nextSlot(probe.idx);
+            probe.dist++;
+        }
+        return probe;
+    }
+
+    /**
+     * This function constructs a new pair at the slot a probe for its key ended in (there is an empty slot), the
+     * pairs from there on are shifted up. If that fills the origin of the iterators, it moves to the end of its
+     * cluster (an erase never fills a slot, the pair after an empty slot is in its bucket and is not shifted back).
+     * @tparam Args - the types of the arguments of the pair constructor
+     * @param probe - the probe for the key, which the map does not contain
+     * @param args - the arguments of the pair constructor
+     */
+    template <typename... Args>
+    void _construct(const Probe& probe, Args&&... args) noexcept(false)
+    {
+        Slot& slot = _slots[probe.idx];
+        if (slot.dist != EMPTY_SLOT)
+        {
+            _shiftUp(probe.idx);
+        }
+        try
+        {
+            new (slot.storage) Entry(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _closeGap(probe.idx); // as if the pair was added and erased
+            throw;
+        }
+        slot.dist = probe.dist;
         _size++;
+        while (_slots[_origin].dist != EMPTY_SLOT)
+        {
+            _origin = _nextSlot(_origin);
+        }
+    }
+
+    /**
+     * This function adds a new pair at the slot a probe for its key ended in, rehashing first if needed
+     * @tparam Args - the types of the arguments of the pair constructor
+     * @param probe - the probe for the key, which the map does not contain
+     * @param args - the arguments of the pair constructor
+     * @return the slot of the new pair
+     */
+    template <typename... Args>
+    size_t _addAt(Probe probe, Args&&... args) noexcept(false)
+    {
+        if ((int)_size + 1 > _upperSizeLimit) // we need to rehash
+        {
+            _reHash(std::max(_doubled(_capacity), _capacityFor(_size + 1)));
+            probe = _vacancy(probe.hash);
+        }
+        _construct(probe, std::forward<Args>(args)...);
+        return probe.idx;
+    }
+
+    /**
+     * This function shifts the pairs after an empty slot that are not in their bucket back a slot
+     * @param idx - the empty slot
+     */
+    void _closeGap(size_t idx) noexcept
+    {
+        size_t next = _nextSlot(idx);
+        while (_slots[next].dist > HOME_DIST)
+        {
+            new (_slots[idx].storage) Entry(std::move(_slots[next].entry()));
+            _slots[idx].dist = _slots[next].dist - 1;
+            _slots[next].entry().~Entry();
+            _slots[next].dist = EMPTY_SLOT;
+            idx = next;
+            next = _nextSlot(next);
+        }
+    }
+
+    /**
+     * This function erases the pair of a slot
+     * @param idx - the slot
+     */
+    void _eraseSlot(size_t idx) noexcept
+    {
+        _slots[idx].entry().~Entry();
+        _slots[idx].dist = EMPTY_SLOT;
+        _closeGap(idx);
+        _size--;
+    }
+
+    /**
+     * This function adds a pair if the map does not contain its key, the value constructed in place
+     * @tparam K - the type of the key, KeyT as a const or rvalue reference
+     * @tparam Args - the types of the arguments of the ValueT constructor
+     * @param key - KeyT
+     * @param args - the arguments of the ValueT constructor
+     * @return true if the pair was added, false otherwise
+     */
+    template <typename K, typename... Args>
+    bool _tryEmplace(K&& key, Args&&... args) noexcept(false)
+    {
+        Probe probe = _probe(key);
+        if (probe.found)
+        {
+            return false;
+        }
+        _addAt(probe, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+               std::forward_as_tuple(std::forward<Args>(args)...));
+        return true;
+    }
+
+    /**
+     * This function adds a pair, or overrides the value of the key if the map contains it
+     * @tparam K - the type of the key, KeyT as a const or rvalue reference
+     * @tparam V - the type of the value
+     * @param key - KeyT
+     * @param value - the value
+     * @return true if the pair was added, false if the value was assigned
+     */
+    template <typename K, typename V>
+    bool _insertOrAssign(K&& key, V&& value) noexcept(false)
+    {
+        Probe probe = _probe(key);
+        if (probe.found)
+        {
+            _slots[probe.idx].entry().second = std::forward<V>(value);
+            return false;
+        }
+        _addAt(probe, std::forward<K>(key), std::forward<V>(value));
+        return true;
     }
 
     /**
-     * This function adds a new pair (also checks if the map contains the key)
+     * This function returns the value of a key, adding the key with a value-initialized ValueT if it is new
+     * @tparam K - the type of the key, KeyT as a const or rvalue reference
      * @param key - KeyT
-     * @param value - ValueT
+     * @return a reference to the value
      */
-    void _addAllowOverride(const KeyT& key, const ValueT& value) noexcept(false)
+    template <typename K>
+    ValueT& _valueOf(K&& key) noexcept(false)
     {
-        if (contains_key(key))
+        Probe probe = _probe(key);
+        if (!probe.found)
         {
-            _overrideExisting(key, value);
+            probe.idx = _addAt(probe, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                               std::forward_as_tuple());
         }
-        else
+        return _slots[probe.idx].entry().second;
+    }
+
+    /**
+     * This function sets the load factors, growing the map if its load is above the max one
+     * @param minLoadFactor - the min load factor
+     * @param maxLoadFactor - the max load factor
+     */
+    void _setLoadFactors(float minLoadFactor, float maxLoadFactor) noexcept(false)
+    {
+        if (!(maxLoadFactor > 0 && maxLoadFactor < 1 && minLoadFactor >= 0 && minLoadFactor < maxLoadFactor))
+        {
+            throw std::invalid_argument(INVALID_INPUT_EXC);
+        }
+        _maxLoadFactor = maxLoadFactor;
+        _minLoadFactor = minLoadFactor;
+        _setLimits();
+        if ((int)_size > _upperSizeLimit)
         {
-            _addNew(key, value);
+            _reHash(_capacityFor(_size));
         }
     }
 
@@ -269,10 +684,21 @@ private:
         return std::hash<KeyT>{}(key) & (_capacity - 1);
     }
 
+    /**
+     * Constructor of an empty HashMap with the load factors of another one
+     * @param like - the map whose load factors are taken
+     * @param capacity - the capacity, a power of 2
+     */
+    HashMap(const HashMap<KeyT, ValueT>& like, size_t capacity) noexcept(false) :
+        _maxLoadFactor(like._maxLoadFactor), _minLoadFactor(like._minLoadFactor)
+    {
+        _init(capacity);
+    }
+
 public:
 
-    typedef ConstIterator const_iterator;
-    typedef ConstIterator iterator;
+    typedef BaseIterator<true> const_iterator;
+    typedef BaseIterator<false> iterator;
 
     /**
      * Default constructor of HashMap
@@ -312,11 +738,17 @@ public:
             throw std::invalid_argument(INVALID_INPUT_EXC);
         }
 
-        _init(DEFAULT_CAPACITY);
+        // sized once for all the keys, the capacity inserting them would grow the map to
+        _init(std::max((size_t)DEFAULT_CAPACITY, _capacityFor(numOfKeys)));
 
         for (auto ik = keysBegin, iv = valuesBegin; ik != keysEnd; ik++, iv++)
         {
-            _addAllowOverride(*ik, *iv);
+            insert_or_assign(*ik, *iv);
+        }
+        size_t fitted = std::max((size_t)DEFAULT_CAPACITY, _capacityFor(_size));
+        if (fitted < _capacity) // there were repeated keys
+        {
+            _reHash(fitted);
         }
     }
 
@@ -324,14 +756,32 @@ public:
      * Copy constructor of HashMap
      * @param rhs - the map we are copying
      */
-    HashMap(const HashMap<KeyT, ValueT>& rhs) noexcept(false)
+    HashMap(const HashMap<KeyT, ValueT>& rhs) noexcept(false) :
+        _maxLoadFactor(rhs._maxLoadFactor), _minLoadFactor(rhs._minLoadFactor)
     {
         _init(rhs._capacity);
-        for (int i = 0; i < (int)_capacity; i++)
+        try
         {
-            _hashTable[i] = rhs._hashTable[i]; // deep copy of the bucket
+            _copySlots(rhs);
         }
-        _size = rhs._size;
+        catch (...)
+        {
+            _free();
+            throw;
+        }
+    }
+
+    /**
+     * Move constructor of HashMap, the slots are taken from rhs and it is left an empty map (nothing is allocated,
+     * it allocates slots again on its first insertion)
+     * @param rhs - the map we are moving from
+     */
+    HashMap(HashMap<KeyT, ValueT>&& rhs) noexcept :
+        _size(rhs._size), _capacity(rhs._capacity), _slots(rhs._slots), _maxLoadFactor(rhs._maxLoadFactor),
+        _minLoadFactor(rhs._minLoadFactor), _upperSizeLimit(rhs._upperSizeLimit), _lowerSizeLimit(rhs._lowerSizeLimit),
+        _origin(rhs._origin)
+    {
+        rhs._initShared();
     }
 
     /**
@@ -339,7 +789,7 @@ public:
      */
     ~HashMap()
     {
-        delete [] _hashTable;
+        _free();
     }
 
     /**
@@ -368,14 +818,120 @@ public:
      */
     bool insert(const KeyT& key, const ValueT& value) noexcept(false)
     {
-        if (contains_key(key))
+        return _tryEmplace(key, value);
+    }
+
+    /**
+     * This function inserts a pair of <KeyT, ValueT> to the map, moving the key and the value into it
+     * @param key - the KeyT to be inserted
+     * @param value - the ValueT to be inserted
+     * @return true if insertion succeeded, false otherwise (then neither is moved from)
+     */
+    bool insert(KeyT&& key, ValueT&& value) noexcept(false)
+    {
+        return _tryEmplace(std::move(key), std::move(value));
+    }
+
+    /**
+     * This function inserts a pair constructed from the given arguments, as a std::pair<KeyT, ValueT> is, if the
+     * map does not contain its key. The pair is constructed before the map is searched and moved into its slot.
+     * @tparam Args - the types of the arguments of the pair constructor
+     * @param args - the arguments of the pair constructor
+     * @return true if insertion succeeded, false otherwise
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args) noexcept(false)
+    {
+        Entry entry(std::forward<Args>(args)...);
+        Probe probe = _probe(entry.first);
+        if (probe.found)
         {
             return false;
         }
-        _addNew(key, value); // new key, may insert
+        _addAt(probe, std::move(entry));
         return true;
     }
 
+    /**
+     * This function inserts a pair constructed piecewise, if the map does not contain its key: only the key is
+     * constructed before the map is searched, the value is constructed in its slot
+     * @tparam KeyArgs - the types of the arguments of the KeyT constructor
+     * @tparam ValueArgs - the types of the arguments of the ValueT constructor
+     * @param keyArgs - the arguments of the KeyT constructor
+     * @param valueArgs - the arguments of the ValueT constructor
+     * @return true if insertion succeeded, false otherwise
+     */
+    template <typename... KeyArgs, typename... ValueArgs>
+    bool emplace(std::piecewise_construct_t, std::tuple<KeyArgs...> keyArgs,
+                 std::tuple<ValueArgs...> valueArgs) noexcept(false)
+    {
+        KeyT key = std::make_from_tuple<KeyT>(std::move(keyArgs));
+        Probe probe = _probe(key);
+        if (probe.found)
+        {
+            return false;
+        }
+        _addAt(probe, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::move(valueArgs));
+        return true;
+    }
+
+    /**
+     * This function inserts a pair of <KeyT, ValueT> to the map if it does not contain the key, the value
+     * constructed in place from the given arguments (nothing is constructed if the key exists)
+     * @tparam Args - the types of the arguments of the ValueT constructor
+     * @param key - the KeyT to be inserted
+     * @param args - the arguments of the ValueT constructor
+     * @return true if insertion succeeded, false otherwise
+     */
+    template <typename... Args>
+    bool try_emplace(const KeyT& key, Args&&... args) noexcept(false)
+    {
+        return _tryEmplace(key, std::forward<Args>(args)...);
+    }
+
+    /**
+     * This function inserts a pair of <KeyT, ValueT> to the map if it does not contain the key, the key moved
+     * into it and the value constructed in place from the given arguments (nothing is constructed or moved from if
+     * the key exists)
+     * @tparam Args - the types of the arguments of the ValueT constructor
+     * @param key - the KeyT to be inserted
+     * @param args - the arguments of the ValueT constructor
+     * @return true if insertion succeeded, false otherwise
+     */
+    template <typename... Args>
+    bool try_emplace(KeyT&& key, Args&&... args) noexcept(false)
+    {
+        return _tryEmplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /**
+     * This function inserts a pair of <KeyT, ValueT> to the map, or overrides the value of the key if the map
+     * contains it
+     * @tparam V - the type of the value, a ValueT or one it can be constructed and assigned from
+     * @param key - the KeyT to be inserted
+     * @param value - the ValueT to be inserted or assigned
+     * @return true if the pair was inserted, false if the value was assigned
+     */
+    template <typename V>
+    bool insert_or_assign(const KeyT& key, V&& value) noexcept(false)
+    {
+        return _insertOrAssign(key, std::forward<V>(value));
+    }
+
+    /**
+     * This function inserts a pair of <KeyT, ValueT> to the map, the key moved into it, or overrides the value of
+     * the key if the map contains it
+     * @tparam V - the type of the value, a ValueT or one it can be constructed and assigned from
+     * @param key - the KeyT to be inserted
+     * @param value - the ValueT to be inserted or assigned
+     * @return true if the pair was inserted, false if the value was assigned
+     */
+    template <typename V>
+    bool insert_or_assign(KeyT&& key, V&& value) noexcept(false)
+    {
+        return _insertOrAssign(std::move(key), std::forward<V>(value));
+    }
+
     /**
      * This function checks if the map contains a given key
      * @param key - we will check if the map contains this key
@@ -383,15 +939,7 @@ public:
      */
     bool contains_key(const KeyT& key) const noexcept
     {
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (key == i->first)
-            {
-                return true;
-            }
-        }
-        return false;
+        return _probe(key).found;
     }
 
     /**
@@ -401,18 +949,7 @@ public:
      */
     ValueT at(const KeyT& key) const noexcept(false)
     {
-        if (!contains_key(key))
-        {
-            throw std::out_of_range(NO_EXIST_KEY);
-        }
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (key == i->first)
-            {
-                return i->second;
-            }
-        }
+        return _slots[_existingSlot(key)].entry().second;
     }
 
     /**
@@ -422,22 +959,7 @@ public:
     */
     ValueT& at(const KeyT& key) noexcept(false)
     {
-        if (!contains_key(key))
-        {
-            throw std::out_of_range(NO_EXIST_KEY);
-        }
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (key == i->first)
-            {
-                return i->second;
-            }
-        }
-
-        // we are never going to reach these next 2 lines
-        auto * dummyPtr = new ValueT;
-        return *dummyPtr;
+        return _slots[_existingSlot(key)].entry().second;
     }
 
     /**
@@ -447,24 +969,16 @@ public:
      */
     bool erase(const KeyT& key) noexcept(false)
     {
-        if (!contains_key(key))
+        Probe probe = _probe(key);
+        if (!probe.found)
         {
             return false;
         }
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (i->first == key)
-            {
-                _hashTable[hashIdx].erase(i);
-                _size--;
-                break;
-            }
-        }
+        _eraseSlot(probe.idx);
 
-        if (_size < _lowerSizeLimit) // we need to rehash
+        if ((int)_size < _lowerSizeLimit) // we need to rehash
         {
-            _reHash(REHASH_DOWN_FACTOR);
+            _reHash((size_t) (_capacity * REHASH_DOWN_FACTOR));
         }
         return true;
     }
@@ -476,18 +990,101 @@ public:
     double load_factor() const noexcept { return (double)_size / _capacity; }
 
     /**
-     * This function returns the size of the bucket of the given key
+     * This function returns the max load factor, the map grows when an insertion would take its load above it
+     * @return the max load factor
+     */
+    float max_load_factor() const noexcept { return _maxLoadFactor; }
+
+    /**
+     * This function sets the max load factor, growing the map if its load is above it
+     * @param maxLoadFactor - the max load factor, in (0, 1) and larger than the min load factor
+     */
+    void max_load_factor(float maxLoadFactor) noexcept(false)
+    {
+        _setLoadFactors(_minLoadFactor, maxLoadFactor);
+    }
+
+    /**
+     * This function returns the min load factor, the map shrinks when an erase takes its load below it (or below
+     * the lower load that keeps the halved map from growing again soon)
+     * @return the min load factor
+     */
+    float min_load_factor() const noexcept { return _minLoadFactor; }
+
+    /**
+     * This function sets the min load factor
+     * @param minLoadFactor - the min load factor, in [0, 1) and smaller than the max load factor
+     */
+    void min_load_factor(float minLoadFactor) noexcept(false)
+    {
+        _setLoadFactors(minLoadFactor, _maxLoadFactor);
+    }
+
+    /**
+     * This function makes room for a number of pairs: inserting until the map holds that many does not rehash it.
+     * std::length_error is thrown if no capacity that fits in size_t holds them.
+     * @param numOfPairs - the number of pairs
+     */
+    void reserve(size_t numOfPairs) noexcept(false)
+    {
+        size_t capacity = _capacityFor(numOfPairs);
+        if (capacity > _capacity)
+        {
+            _reHash(capacity);
+        }
+    }
+
+    /**
+     * This function rehashes the map into the smallest capacity that is at least the given one and holds its pairs
+     * (it may shrink the map). std::length_error is thrown if it is above the largest power of 2 that fits in size_t.
+     * @param capacity - the least capacity
+     */
+    void rehash(size_t capacity) noexcept(false)
+    {
+        size_t newCapacity = _capacityFor(_size);
+        while (newCapacity < capacity)
+        {
+            newCapacity = _doubled(newCapacity);
+        }
+        if (newCapacity != _capacity)
+        {
+            _reHash(newCapacity);
+        }
+    }
+
+    /**
+     * This function shrinks the map into the smallest capacity that holds its pairs
+     */
+    void shrink_to_fit() noexcept(false)
+    {
+        rehash(EMPTY_SIZE);
+    }
+
+    /**
+     * This function returns the size of the bucket of the given key (the pairs whose keys hash to its index)
      * @param key - KeyT
      * @return the size of the bucket of the given key
      */
     size_t bucket_size(const KeyT& key) const noexcept(false)
     {
-        if (!contains_key(key))
+        size_t bucketSize = 0;
+        bool found = false;
+        size_t idx = _findHash(key);
+        // the pairs of the bucket are adjacent, each one slot further from it than the one before
+        for (uint32_t dist = HOME_DIST; _slots[idx].dist >= dist; dist++)
+        {
+            if (_slots[idx].dist == dist)
+            {
+                bucketSize++;
+                found = found || _slots[idx].entry().first == key;
+            }
+            idx = _nextSlot(idx);
+        }
+        if (!found)
         {
             throw std::out_of_range(NO_EXIST_KEY);
         }
-        size_t hashIdx = _findHash(key);
-        return _hashTable[hashIdx].size();
+        return bucketSize;
     }
 
     /**
@@ -497,11 +1094,12 @@ public:
      */
     size_t bucket_index(KeyT key) const noexcept(false)
     {
-        if (!contains_key(key))
+        Probe probe = _probe(key);
+        if (!probe.found)
         {
             throw std::out_of_range(NO_EXIST_KEY);
         }
-        return _findHash(key);
+        return probe.hash & (_capacity - 1);
     }
 
     /**
@@ -509,11 +1107,7 @@ public:
      */
     void clear() noexcept
     {
-        for (int i = 0; i < (int)_capacity; i++)
-        {
-            _hashTable[i].clear();
-        }
-        _size = EMPTY_SIZE;
+        _destroyAll();
     }
 
     /**
@@ -525,18 +1119,23 @@ public:
     {
         if (this != &rhs)
         {
-            delete [] _hashTable;
-            _init(rhs._capacity);
-
-            for (int i = 0; i < _capacity; i++)
-            {
-                _hashTable[i] = rhs._hashTable[i]; // deep copy of the bucket
-            }
-            _size = rhs._size;
+            HashMap<KeyT, ValueT> copy(rhs); // this map is kept if the copy throws
+            _swap(copy);
         }
         return *this;
     }
 
+    /**
+     * Operator = (move), the slots are swapped with rhs
+     * @param rhs - the map we are moving from
+     * @return a reference to this map
+     */
+    HashMap& operator=(HashMap<KeyT, ValueT>&& rhs) noexcept
+    {
+        _swap(rhs);
+        return *this;
+    }
+
     /**
      * Operator [] (const)
      * @param key - KeyT
@@ -544,19 +1143,12 @@ public:
      */
     ValueT operator[](const KeyT& key) const noexcept
     {
-        if (!contains_key(key))
+        Probe probe = _probe(key);
+        if (!probe.found)
         {
-            ValueT newVal;
-            return newVal;
-        }
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (key == i->first)
-            {
-                return i->second;
-            }
+            return ValueT();
         }
+        return _slots[probe.idx].entry().second;
     }
 
     /**
@@ -566,23 +1158,17 @@ public:
      */
     ValueT& operator[](const KeyT& key) noexcept(false)
     {
-        if (!contains_key(key))
-        {
-            ValueT newVal;
-            _addNew(key, newVal);
-        }
+        return _valueOf(key);
+    }
 
-        size_t hashIdx = _findHash(key);
-        for (auto i = _hashTable[hashIdx].begin(); i != _hashTable[hashIdx].end(); i++)
-        {
-            if (key == i->first)
-            {
-                return i->second;
-            }
-        }
-        // we are never going to reach these next 2 lines
-        auto * dummyPtr = new ValueT;
-        return *dummyPtr;
+    /**
+     * Operator [] (non-const), a new key is moved into the map
+     * @param key - KeyT
+     * @return a reference to the value that matches the given key
+     */
+    ValueT& operator[](KeyT&& key) noexcept(false)
+    {
+        return _valueOf(std::move(key));
     }
 
     /**
@@ -597,20 +1183,16 @@ public:
             return false;
         }
 
-        for (int i = 0; i < (int)_capacity; i++)
+        for (size_t i = 0; i < _capacity; i++)
         {
-            if (_hashTable[i].size() != rhs._hashTable[i].size())
+            if (_slots[i].dist == EMPTY_SLOT)
             {
-                return false;
+                continue;
             }
-
-            for (auto iter = _hashTable[i].begin(); iter != _hashTable[i].end(); iter++)
+            Probe probe = rhs._probe(_slots[i].entry().first);
+            if (!probe.found || !(rhs._slots[probe.idx].entry() == _slots[i].entry()))
             {
-                auto rhsIter = std::find(rhs._hashTable[i].begin(), rhs._hashTable[i].end(), *iter);
-                if (rhsIter == rhs._hashTable[i].end())
-                {
-                    return false;
-                }
+                return false;
             }
         }
         return true;
@@ -626,14 +1208,33 @@ public:
         return !((*this) == rhs);
     }
 
+    /**
+     * This function returns an iterator to beginning of the map
+     * @return iterator to beginning of the map
+     */
+    iterator begin() noexcept
+    {
+        iterator it(this, _origin, FIRST_IDX);
+        it._skipEmpty();
+        return it;
+    }
+
+    /**
+     * This function returns an iterator to end of the map
+     * @return iterator to end of the map
+     */
+    iterator end() noexcept
+    {
+        return iterator(this, FIRST_IDX, _capacity);
+    }
+
     /**
      * This function returns a const iterator to beginning of the map
      * @return const iterator to beginning of the map
      */
     const_iterator begin() const noexcept
     {
-        const_iterator constIt = ConstIterator(*this);
-        return constIt;
+        return cbegin();
     }
 
     /**
@@ -642,8 +1243,7 @@ public:
      */
     const_iterator end() const noexcept
     {
-        const_iterator constIt;
-        return constIt;
+        return cend();
     }
 
     /**
@@ -652,7 +1252,8 @@ public:
      */
     const_iterator cbegin() const noexcept
     {
-        const_iterator constIt = ConstIterator(*this);
+        const_iterator constIt(this, _origin, FIRST_IDX);
+        constIt._skipEmpty();
         return constIt;
     }
 
@@ -662,8 +1263,51 @@ public:
      */
     const_iterator cend() const noexcept
     {
-        const_iterator constIt;
-        return constIt;
+        return const_iterator(this, FIRST_IDX, _capacity);
+    }
+
+    /**
+     * This function finds the pair of a key
+     * @param key - KeyT
+     * @return an iterator to the pair, end() if the map does not contain the key
+     */
+    iterator find(const KeyT& key) noexcept
+    {
+        Probe probe = _probe(key);
+        if (!probe.found)
+        {
+            return end();
+        }
+        return iterator(this, _origin, (probe.idx - _origin) & (_capacity - 1));
+    }
+
+    /**
+     * This function finds the pair of a key
+     * @param key - KeyT
+     * @return a const iterator to the pair, end() if the map does not contain the key
+     */
+    const_iterator find(const KeyT& key) const noexcept
+    {
+        Probe probe = _probe(key);
+        if (!probe.found)
+        {
+            return cend();
+        }
+        return const_iterator(this, _origin, (probe.idx - _origin) & (_capacity - 1));
+    }
+
+    /**
+     * This function erases the pair an iterator points to. The map is not shrunk here, so the other iterators of
+     * the map stay valid (the next erase by key shrinks it if needed).
+     * @param pos - an iterator to a pair of the map
+     * @return an iterator to the pair after it, end() if it was the last one
+     */
+    iterator erase(const_iterator pos) noexcept
+    {
+        _eraseSlot(pos._slot());
+        iterator next(this, pos._first, pos._pos); // the pair after it may have been shifted into its slot
+        next._skipEmpty();
+        return next;
     }
 
 };
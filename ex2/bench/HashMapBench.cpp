@@ -0,0 +1,237 @@
+// g++ -std=c++17 -O2 -I.. HashMapBench.cpp -o HashMapBench, run as HashMapBench [maxPairs] (10M by default, up to
+// 100M with enough memory)
+#include "HashMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define MIN_PAIRS 1000
+#define DEFAULT_MAX_PAIRS 10000000
+#define PAIRS_STEP 10
+#define REPEAT_PAIRS 3000000 // small maps are run again until about this many pairs went through them
+#define MIN_REPS 3
+#define NANO 1e9
+
+/**
+ * This class is the map of a list of pairs a bucket that HashMap stored before its slot array, kept here to compare
+ * with: the same capacities and load factors, a node allocation every insertion
+ */
+class ListBucketMap
+{
+private:
+    std::vector<std::list<std::pair<int, int>>> _buckets;
+    size_t _size;
+
+    /**
+     * Finds the pair of a key in its bucket
+     * @param key - the key
+     * @return an iterator to the pair, the end of the bucket if there is none
+     */
+    std::list<std::pair<int, int>>::iterator _find(int key)
+    {
+        auto& bucket = _buckets[std::hash<int>{}(key) & (_buckets.size() - 1)];
+        return std::find_if(bucket.begin(), bucket.end(),
+                            [key](const std::pair<int, int>& pair) { return pair.first == key; });
+    }
+
+    /**
+     * Moves every pair into a table of the given capacity, a new node each
+     * @param capacity - the capacity, a power of 2
+     */
+    void _reHash(size_t capacity)
+    {
+        std::vector<std::list<std::pair<int, int>>> old(capacity);
+        old.swap(_buckets);
+        for (const auto& bucket : old)
+        {
+            for (const auto& pair : bucket)
+            {
+                _buckets[std::hash<int>{}(pair.first) & (capacity - 1)].push_back(pair);
+            }
+        }
+    }
+
+public:
+    /**
+     * Default constructor of ListBucketMap
+     */
+    ListBucketMap() : _buckets(DEFAULT_CAPACITY), _size(EMPTY_SIZE) {}
+
+    /**
+     * This function inserts a pair if the map does not contain its key
+     * @param key - the key
+     * @param value - the value
+     * @return true if the pair was inserted, false otherwise
+     */
+    bool insert(int key, int value)
+    {
+        if (_find(key) != _buckets[std::hash<int>{}(key) & (_buckets.size() - 1)].end())
+        {
+            return false;
+        }
+        if (_size + 1 > _buckets.size() * UPPER_LOAD_FACTOR)
+        {
+            _reHash(_buckets.size() * REHASH_UP_FACTOR);
+        }
+        _buckets[std::hash<int>{}(key) & (_buckets.size() - 1)].emplace_back(key, value);
+        _size++;
+        return true;
+    }
+
+    /**
+     * This function checks if the map contains a key
+     * @param key - the key
+     * @return true if the map contains the key, false otherwise
+     */
+    bool contains_key(int key)
+    {
+        return _find(key) != _buckets[std::hash<int>{}(key) & (_buckets.size() - 1)].end();
+    }
+
+    /**
+     * This function returns the value of a key the map contains
+     * @param key - the key
+     * @return the value
+     */
+    int at(int key)
+    {
+        return _find(key)->second;
+    }
+
+    /**
+     * This function erases the pair of a key
+     * @param key - the key
+     * @return true if the pair was erased, false otherwise
+     */
+    bool erase(int key)
+    {
+        auto& bucket = _buckets[std::hash<int>{}(key) & (_buckets.size() - 1)];
+        auto it = _find(key);
+        if (it == bucket.end())
+        {
+            return false;
+        }
+        bucket.erase(it);
+        _size--;
+        if (_size < _buckets.size() * LOWER_LOAD_FACTOR && _buckets.size() > 1)
+        {
+            _reHash((size_t)(_buckets.size() * REHASH_DOWN_FACTOR));
+        }
+        return true;
+    }
+};
+
+/**
+ * The operations the benchmark runs, on HashMap and ListBucketMap
+ * @tparam M - the map
+ */
+template <typename M>
+struct MapOps
+{
+    static bool insert(M& map, int key, int value) { return map.insert(key, value); }
+    static bool contains(M& map, int key) { return map.contains_key(key); }
+    static int at(M& map, int key) { return map.at(key); }
+    static bool erase(M& map, int key) { return map.erase(key); }
+};
+
+/**
+ * The operations the benchmark runs, on std::unordered_map
+ */
+template <>
+struct MapOps<std::unordered_map<int, int>>
+{
+    typedef std::unordered_map<int, int> M;
+    static bool insert(M& map, int key, int value) { return map.insert({key, value}).second; }
+    static bool contains(M& map, int key) { return map.count(key) == 1; }
+    static int at(M& map, int key) { return map.at(key); }
+    static bool erase(M& map, int key) { return map.erase(key) == 1; }
+};
+
+/**
+ * Seconds since an arbitrary point
+ * @return the time
+ */
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Inserts the keys into an empty map, looks every one up, looks up keys it does not contain and erases the keys,
+ * and prints the best time of each phase
+ * @tparam M - the map
+ * @param name - the name of the map
+ * @param keys - the keys, distinct
+ * @param missing - keys that are not in keys, as many
+ */
+template <typename M>
+static void bench(const char* name, const std::vector<int>& keys, const std::vector<int>& missing)
+{
+    size_t n = keys.size();
+    double best[4] = {1e30, 1e30, 1e30, 1e30};
+    long long sink = 0;
+    size_t reps = std::max((size_t)MIN_REPS, REPEAT_PAIRS / n);
+    for (size_t r = 0; r < reps; r++)
+    {
+        M* map = new M();
+        double t0 = now();
+        for (size_t i = 0; i < n; i++)
+        {
+            sink += MapOps<M>::insert(*map, keys[i], (int)i);
+        }
+        double t1 = now();
+        for (size_t i = 0; i < n; i++)
+        {
+            sink += MapOps<M>::at(*map, keys[n - 1 - i]);
+        }
+        double t2 = now();
+        for (size_t i = 0; i < n; i++)
+        {
+            sink += MapOps<M>::contains(*map, missing[i]);
+        }
+        double t3 = now();
+        for (size_t i = 0; i < n; i++)
+        {
+            sink += MapOps<M>::erase(*map, keys[i]);
+        }
+        double t4 = now();
+        delete map;
+        double phases[4] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+        for (int k = 0; k < 4; k++)
+        {
+            best[k] = std::min(best[k], phases[k]);
+        }
+    }
+    printf("%-12s %10zu %10.1f %10.1f %10.1f %10.1f   (%lld)\n", name, n, best[0] / n * NANO, best[1] / n * NANO,
+           best[2] / n * NANO, best[3] / n * NANO, sink & 1);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t maxPairs = argc > 1 ? strtoull(argv[1], nullptr, 10) : DEFAULT_MAX_PAIRS;
+    printf("%-12s %10s %10s %10s %10s %10s   ns/op\n", "map", "pairs", "insert", "hit", "miss", "erase");
+    for (size_t n = MIN_PAIRS; n <= maxPairs; n *= PAIRS_STEP)
+    {
+        std::mt19937 gen(1);
+        std::vector<int> all(2 * n);
+        for (int& key : all)
+        {
+            key = (int)gen(); // random keys, the ones std::hash leaves as they are
+        }
+        std::sort(all.begin(), all.end());
+        all.erase(std::unique(all.begin(), all.end()), all.end());
+        std::shuffle(all.begin(), all.end(), gen);
+        std::vector<int> keys(all.begin(), all.begin() + n);
+        std::vector<int> missing(all.begin() + n, all.end());
+        missing.resize(n, missing.front()); // the few repeated random keys are made up by one of the others
+        bench<HashMap<int, int>>("HashMap", keys, missing);
+        bench<ListBucketMap>("list buckets", keys, missing);
+        bench<std::unordered_map<int, int>>("unordered", keys, missing);
+    }
+    return 0;
+}
\ No newline at end of file
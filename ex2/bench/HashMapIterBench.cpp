@@ -0,0 +1,74 @@
+// g++ -std=c++17 -O2 -I.. HashMapIterBench.cpp -o HashMapIterBench, run as HashMapIterBench [maxPairs]
+#include "HashMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+#define MIN_PAIRS 1000
+#define DEFAULT_MAX_PAIRS 10000000
+#define PAIRS_STEP 10
+#define VISIT_PAIRS 20000000 // small maps are visited again until about this many pairs were visited
+#define MIN_REPS 3
+#define KEY_FACTOR 2654435761u // spreads the keys over the range of int
+#define NANO 1e9
+#define MICRO 1e6
+
+/**
+ * Seconds since an arbitrary point
+ * @return the time
+ */
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Visits every pair of a map through its const iterators, and prints the time begin() takes and the best time of a
+ * visit per pair
+ * @tparam M - the map
+ * @param name - the name of the map
+ * @param map - the map
+ */
+template <typename M>
+static void bench(const char* name, const M& map)
+{
+    size_t n = map.size();
+    double bestBegin = 1e30, bestVisit = 1e30;
+    long long sink = 0;
+    size_t reps = std::max((size_t)MIN_REPS, VISIT_PAIRS / n);
+    for (size_t r = 0; r < reps; r++)
+    {
+        double t0 = now();
+        auto it = map.begin();
+        double t1 = now();
+        for (auto end = map.end(); it != end; ++it)
+        {
+            sink += it->second;
+        }
+        double t2 = now();
+        bestBegin = std::min(bestBegin, t1 - t0);
+        bestVisit = std::min(bestVisit, t2 - t0);
+    }
+    printf("%-10s %10zu %12.3f %12.2f   (%lld)\n", name, n, bestBegin * MICRO, bestVisit / n * NANO, sink & 1);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t maxPairs = argc > 1 ? strtoull(argv[1], nullptr, 10) : DEFAULT_MAX_PAIRS;
+    printf("%-10s %10s %12s %12s\n", "map", "pairs", "begin us", "ns/pair");
+    for (size_t n = MIN_PAIRS; n <= maxPairs; n *= PAIRS_STEP)
+    {
+        HashMap<int, int> map;
+        std::unordered_map<int, int> unordered;
+        for (size_t i = 0; i < n; i++)
+        {
+            map.insert((int)(i * KEY_FACTOR), (int)i);
+            unordered.insert({(int)(i * KEY_FACTOR), (int)i});
+        }
+        bench("HashMap", map);
+        bench("unordered", unordered);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+// g++ -std=c++17 -O2 -I.. HashMapMoveBench.cpp -o HashMapMoveBench
+#include "HashMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define NUM_PAIRS 1000000
+#define PAYLOAD_SIZE 512
+#define REPS 3
+#define MIN_REHASH_PAIRS 300000 // the rehash timed is the first one of at least this many pairs
+#define NANO 1e9
+#define MILLI 1e3
+
+/**
+ * This struct is a heavy value that counts its copies and moves
+ */
+struct Heavy
+{
+    static long copies, moves;
+    std::vector<char> payload;
+
+    Heavy() = default;
+
+    explicit Heavy(int size) : payload(size) {}
+
+    Heavy(const Heavy& other) : payload(other.payload) { copies++; }
+
+    Heavy(Heavy&& other) noexcept : payload(std::move(other.payload)) { moves++; }
+
+    Heavy& operator=(const Heavy& other)
+    {
+        payload = other.payload;
+        copies++;
+        return *this;
+    }
+
+    Heavy& operator=(Heavy&& other) noexcept
+    {
+        payload = std::move(other.payload);
+        moves++;
+        return *this;
+    }
+};
+
+long Heavy::copies = 0, Heavy::moves = 0;
+
+typedef HashMap<std::string, Heavy> HeavyMap;
+
+/**
+ * Seconds since an arbitrary point
+ * @return the time
+ */
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Fills an empty map with NUM_PAIRS pairs and prints the best time and the value copies and moves per pair
+ * @param name - the name of the way the pairs are inserted
+ * @param keys - the keys
+ * @param fill - inserts the pairs of the first NUM_PAIRS keys into a map
+ */
+template <typename F>
+static void benchFill(const char* name, const std::vector<std::string>& keys, F fill)
+{
+    double best = 1e30;
+    long copies = 0, moves = 0;
+    for (int r = 0; r < REPS; r++)
+    {
+        HeavyMap map;
+        Heavy::copies = Heavy::moves = 0;
+        double start = now();
+        fill(map, keys);
+        best = std::min(best, now() - start);
+        copies = Heavy::copies;
+        moves = Heavy::moves;
+    }
+    printf("%-30s %8.1f ns/pair %8.2f copies/pair %8.2f moves/pair\n", name, best / NUM_PAIRS * NANO,
+           (double)copies / NUM_PAIRS, (double)moves / NUM_PAIRS);
+}
+
+/**
+ * Times the insertion that grows a map of at least MIN_REHASH_PAIRS pairs, and prints it with the value copies and
+ * moves per pair it made
+ * @param keys - the keys
+ */
+static void benchRehash(const std::vector<std::string>& keys)
+{
+    double best = 1e30;
+    long copies = 0, moves = 0;
+    size_t pairs = 0;
+    for (int r = 0; r < REPS; r++)
+    {
+        HeavyMap map;
+        size_t i = 0;
+        while (i < MIN_REHASH_PAIRS || map.size() + 1 <= map.capacity() * map.max_load_factor())
+        {
+            map.try_emplace(keys[i++], PAYLOAD_SIZE);
+        }
+        Heavy value(PAYLOAD_SIZE);
+        Heavy::copies = Heavy::moves = 0;
+        double start = now();
+        map.insert(keys[i], value); // one copy, of the new value
+        best = std::min(best, now() - start);
+        copies = Heavy::copies - 1;
+        moves = Heavy::moves;
+        pairs = i;
+    }
+    printf("%-30s %8.2f ms for %zu pairs %8.2f copies/pair %8.2f moves/pair\n", "rehash", best * MILLI, pairs,
+           (double)copies / pairs, (double)moves / pairs);
+}
+
+int main()
+{
+    std::vector<std::string> keys;
+    for (int i = 0; i <= NUM_PAIRS; i++)
+    {
+        keys.push_back("user/session/" + std::to_string(i * 2654435761u));
+    }
+    benchFill("insert(key, value)", keys, [](HeavyMap& map, const std::vector<std::string>& ks)
+    {
+        Heavy value(PAYLOAD_SIZE);
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            map.insert(ks[i], value);
+        }
+    });
+    benchFill("insert(move(key), Heavy())", keys, [](HeavyMap& map, const std::vector<std::string>& ks)
+    {
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            std::string key = ks[i];
+            map.insert(std::move(key), Heavy(PAYLOAD_SIZE));
+        }
+    });
+    benchFill("emplace(key, Heavy())", keys, [](HeavyMap& map, const std::vector<std::string>& ks)
+    {
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            map.emplace(ks[i], Heavy(PAYLOAD_SIZE));
+        }
+    });
+    benchFill("try_emplace(key, size)", keys, [](HeavyMap& map, const std::vector<std::string>& ks)
+    {
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            map.try_emplace(ks[i], PAYLOAD_SIZE);
+        }
+    });
+    benchRehash(keys);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+// g++ -std=c++17 -O2 -I.. HashMapIteratorTest.cpp -o HashMapIteratorTest
+#include "HashMap.hpp"
+#include "TestCheck.hpp"
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#define TRIALS 300
+#define MAX_PAIRS 200
+#define FEW_KEYS 64
+#define MANY_KEYS 100000
+#define SPREAD 16
+#define MISSING_KEY (-1)
+
+/**
+ * Fills a map and its reference with random keys, few of them (long clusters) or many, spread apart or not
+ * @param map - the map
+ * @param ref - the reference map
+ * @param trial - picks the kind of keys
+ * @param gen - the random generator
+ */
+static void fill(HashMap<int, int>& map, std::map<int, int>& ref, int trial, std::mt19937& gen)
+{
+    int numOfPairs = (int)(gen() % MAX_PAIRS);
+    int range = trial % 3 == 0 ? FEW_KEYS : MANY_KEYS;
+    for (int i = 0; i < numOfPairs; i++)
+    {
+        int key = (int)(gen() % range) * (trial % 2 == 0 ? 1 : SPREAD);
+        map[key] = i;
+        ref[key] = i;
+    }
+}
+
+/**
+ * The iterators visit every pair once, and a mutable iterator changes the values through value()
+ * @param gen - the random generator
+ */
+static void testVisit(std::mt19937& gen)
+{
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        HashMap<int, int> map;
+        std::map<int, int> ref;
+        fill(map, ref, trial, gen);
+        std::map<int, int> seen;
+        for (const auto& pair : map)
+        {
+            CHECK(seen.count(pair.first) == 0);
+            seen[pair.first] = pair.second;
+        }
+        CHECK(seen == ref);
+        for (auto it = map.begin(); it != map.end(); ++it)
+        {
+            it.value() += 1;
+        }
+        const HashMap<int, int>& constMap = map;
+        size_t visited = 0;
+        for (auto it = constMap.cbegin(); it != constMap.cend(); it++)
+        {
+            CHECK(it->second == ref[it->first] + 1);
+            visited++;
+        }
+        CHECK(visited == ref.size());
+    }
+    HashMap<std::string, std::string> text;
+    text["a"] = "b";
+    for (auto it = text.begin(); it != text.end(); ++it)
+    {
+        it.value() += "c";
+    }
+    CHECK(text.at("a") == "bc");
+}
+
+/**
+ * Erasing through iterators while iterating visits every pair once, and the iterator it returns equals the one
+ * find gives for the same pair
+ * @param gen - the random generator
+ */
+static void testEraseWhileIterating(std::mt19937& gen)
+{
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        HashMap<int, int> map;
+        std::map<int, int> ref;
+        fill(map, ref, trial, gen);
+        std::set<int> visited;
+        std::map<int, int> kept;
+        for (auto it = map.begin(); it != map.end();)
+        {
+            CHECK(visited.count(it->first) == 0);
+            visited.insert(it->first);
+            if (gen() % 2 == 0)
+            {
+                kept[it->first] = it->second;
+                it++;
+                continue;
+            }
+            it = map.erase(it);
+            CHECK(it == map.end() || map.find(it->first) == it);
+        }
+        CHECK(visited.size() == ref.size() && map.size() == kept.size());
+        for (const auto& pair : kept)
+        {
+            auto found = map.find(pair.first);
+            CHECK(found != map.end() && found->second == pair.second);
+        }
+        const HashMap<int, int>& constMap = map;
+        CHECK(constMap.find(MISSING_KEY) == constMap.end() && map.find(MISSING_KEY) == map.end());
+        for (auto it = map.begin(); it != map.end();)
+        {
+            it = map.erase(it);
+        }
+        CHECK(map.empty() && map.begin() == map.end());
+    }
+}
+
+/**
+ * The visit from the iterator find gives goes on as the visit from begin() does, after insertions and erases have
+ * moved the slot the visits start at
+ * @param gen - the random generator
+ */
+static void testFindContinuesVisit(std::mt19937& gen)
+{
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        HashMap<int, int> map;
+        std::map<int, int> ref;
+        fill(map, ref, trial, gen);
+        for (const auto& pair : ref)
+        {
+            if (gen() % 3 == 0)
+            {
+                map.erase(pair.first);
+            }
+        }
+        fill(map, ref, trial, gen);
+        std::vector<int> order;
+        for (const auto& pair : map)
+        {
+            order.push_back(pair.first);
+        }
+        bool same = true;
+        for (size_t i = 0; i < order.size(); i += 1 + gen() % SPREAD)
+        {
+            size_t j = i;
+            auto it = map.find(order[i]);
+            for (; it != map.end() && j < order.size(); ++it, j++)
+            {
+                same = same && it->first == order[j];
+            }
+            same = same && it == map.end() && j == order.size();
+        }
+        CHECK(same);
+    }
+}
+
+/**
+ * Iterators of different maps, or default constructed ones, are not mixed up
+ */
+static void testEquality()
+{
+    HashMap<int, int> map;
+    HashMap<int, int> other;
+    map[1] = 1;
+    other[1] = 1;
+    CHECK(map.begin() != other.begin() && map.end() != other.end());
+    typedef HashMap<int, int>::iterator Iterator;
+    CHECK(Iterator() == Iterator() && Iterator() != map.end());
+    CHECK(map.begin() == map.find(1) && ++map.begin() == map.end());
+    HashMap<int, int>::const_iterator fromMutable = map.begin();
+    CHECK(fromMutable == map.cbegin());
+}
+
+int main()
+{
+    std::mt19937 gen(5);
+    testVisit(gen);
+    testEraseWhileIterating(gen);
+    testFindContinuesVisit(gen);
+    testEquality();
+    return testResult();
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+// g++ -std=c++17 -O2 -I.. HashMapMoveTest.cpp -o HashMapMoveTest
+#include "HashMap.hpp"
+#include "TestCheck.hpp"
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#define HEAVY_SIZE 256
+#define MANY_PAIRS 100000
+#define KEPT_PAIRS 10
+#define THROW_AFTER 50
+
+/**
+ * This struct is a value that counts how it is constructed, copied and moved
+ */
+struct Heavy
+{
+    static long constructs, copies, moves;
+    std::vector<char> payload;
+
+    Heavy() : payload(HEAVY_SIZE) { constructs++; }
+
+    explicit Heavy(int size) : payload(size) { constructs++; }
+
+    Heavy(const Heavy& other) : payload(other.payload) { copies++; }
+
+    Heavy(Heavy&& other) noexcept : payload(std::move(other.payload)) { moves++; }
+
+    Heavy& operator=(const Heavy& other)
+    {
+        payload = other.payload;
+        copies++;
+        return *this;
+    }
+
+    Heavy& operator=(Heavy&& other) noexcept
+    {
+        payload = std::move(other.payload);
+        moves++;
+        return *this;
+    }
+
+    bool operator==(const Heavy& other) const { return payload == other.payload; }
+
+    /**
+     * Resets the counters
+     */
+    static void reset() { constructs = copies = moves = 0; }
+};
+
+long Heavy::constructs = 0, Heavy::copies = 0, Heavy::moves = 0;
+
+/**
+ * This struct is a value whose move may throw, and whose copy throws once a given number of copies were made
+ */
+struct Fragile
+{
+    static int copiesLeft; // a copy throws when this reaches 0, negative means never
+    int value;
+
+    explicit Fragile(int v = 0) : value(v) {}
+
+    Fragile(const Fragile& other) : value(other.value)
+    {
+        if (copiesLeft-- == 0)
+        {
+            throw std::runtime_error("copy failed");
+        }
+    }
+
+    Fragile(Fragile&& other) : Fragile(static_cast<const Fragile&>(other)) {} // may throw, so rehash copies
+
+    Fragile& operator=(const Fragile& other) = default;
+
+    bool operator==(const Fragile& other) const { return value == other.value; }
+};
+
+int Fragile::copiesLeft = -1;
+
+/**
+ * The insertion functions construct the value in place or move it in, and never copy it
+ */
+static void testNoCopies()
+{
+    HashMap<std::string, Heavy> map;
+    Heavy::reset();
+    CHECK(map.try_emplace("a", 10));
+    CHECK(Heavy::constructs == 1 && Heavy::copies == 0 && Heavy::moves == 0);
+    Heavy::reset();
+    CHECK(!map.try_emplace("a", 10));
+    CHECK(Heavy::constructs == 0);
+    Heavy::reset();
+    std::string key = "b";
+    Heavy value(5);
+    CHECK(map.insert(std::move(key), std::move(value)));
+    CHECK(Heavy::copies == 0 && Heavy::moves == 1 && key.empty());
+    std::string sameKey = "b";
+    Heavy otherValue(7);
+    CHECK(!map.insert(std::move(sameKey), std::move(otherValue))); // neither is moved from
+    CHECK(sameKey == "b" && otherValue.payload.size() == 7);
+    Heavy::reset();
+    CHECK(map.emplace(std::piecewise_construct, std::forward_as_tuple("c"), std::forward_as_tuple(3)));
+    CHECK(Heavy::constructs == 1 && Heavy::copies == 0 && Heavy::moves == 0);
+    Heavy::reset();
+    CHECK(map.emplace("d", Heavy(4)) && !map.emplace("d", Heavy(4)));
+    CHECK(map.insert_or_assign("e", Heavy(2)) && !map.insert_or_assign("e", Heavy(9)));
+    CHECK(Heavy::copies == 0 && map.at("e").payload.size() == 9);
+    std::string newKey = "f";
+    map[std::move(newKey)].payload.resize(1);
+    CHECK(newKey.empty() && map.at("f").payload.size() == 1);
+}
+
+/**
+ * Growing and shrinking the map moves every pair into its new slot, without copying
+ */
+static void testRehashMoves()
+{
+    HashMap<std::string, Heavy> map;
+    Heavy::reset();
+    for (int i = 0; i < MANY_PAIRS; i++)
+    {
+        map.try_emplace("key" + std::to_string(i), 8);
+    }
+    CHECK(Heavy::copies == 0 && Heavy::moves < 4 * MANY_PAIRS);
+    Heavy::reset();
+    for (int i = KEPT_PAIRS; i < MANY_PAIRS; i++)
+    {
+        map.erase("key" + std::to_string(i));
+    }
+    CHECK(Heavy::copies == 0);
+    CHECK(map.size() == KEPT_PAIRS && map.capacity() < MANY_PAIRS / KEPT_PAIRS);
+    for (int i = 0; i < KEPT_PAIRS; i++)
+    {
+        CHECK(map.at("key" + std::to_string(i)).payload.size() == 8);
+    }
+}
+
+/**
+ * The move constructor takes the slots without allocating or throwing, and leaves an empty map that can be used
+ */
+static void testMoveConstructor()
+{
+    static_assert(std::is_nothrow_move_constructible<HashMap<std::string, Heavy>>::value, "move may throw");
+    static_assert(std::is_nothrow_move_assignable<HashMap<std::string, Heavy>>::value, "move may throw");
+    HashMap<std::string, Heavy> map;
+    for (int i = 0; i < KEPT_PAIRS; i++)
+    {
+        map.try_emplace(std::to_string(i), i);
+    }
+    Heavy::reset();
+    HashMap<std::string, Heavy> moved(std::move(map));
+    CHECK(Heavy::copies == 0 && Heavy::moves == 0);
+    CHECK(moved.size() == KEPT_PAIRS && map.empty() && !map.contains_key("0") && !map.erase("0"));
+    CHECK(map.begin() == map.end());
+    HashMap<std::string, Heavy> copy(map);
+    CHECK(copy.empty() && copy == map);
+    map["z"];
+    CHECK(map.size() == 1 && map.contains_key("z"));
+    HashMap<std::string, Heavy> again(std::move(map));
+    map.clear();
+    map.reserve(KEPT_PAIRS);
+    CHECK(map.empty());
+    map = std::move(moved);
+    CHECK(map.size() == KEPT_PAIRS);
+}
+
+/**
+ * A rehash whose copies throw leaves the map as it was (values whose move may throw are copied into the new slots)
+ */
+static void testRehashThrows()
+{
+    HashMap<int, Fragile> map;
+    int i = 0;
+    while (map.size() + 1 <= map.capacity() * map.max_load_factor())
+    {
+        map.try_emplace(i, i);
+        i++;
+    }
+    size_t capacity = map.capacity();
+    HashMap<int, Fragile> before(map);
+    Fragile::copiesLeft = THROW_AFTER < i ? THROW_AFTER : i / 2;
+    try
+    {
+        map.try_emplace(i, i); // grows the map
+        CHECK(false);
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    Fragile::copiesLeft = -1;
+    CHECK(map.capacity() == capacity && map == before && !map.contains_key(i));
+    CHECK(map.try_emplace(i, i) && map.capacity() > capacity && map.at(i) == Fragile(i));
+}
+
+int main()
+{
+    testNoCopies();
+    testRehashMoves();
+    testMoveConstructor();
+    testRehashThrows();
+    return testResult();
+}
\ No newline at end of file
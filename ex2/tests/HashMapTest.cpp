@@ -0,0 +1,334 @@
+// g++ -std=c++17 -O2 -I.. HashMapTest.cpp -o HashMapTest
+#include "HashMap.hpp"
+#include "TestCheck.hpp"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define RANGE_KEYS 1000
+#define RANGE_DISTINCT 700
+#define CHECK_EVERY 997
+#define CLEAR_ODDS 500
+#define NUM_OPS 8
+#define NUM_PAIRS 1000
+#define NUM_FACTOR_PAIRS 4
+
+/**
+ * Checks the whole map against the reference: the pairs, the buckets and the load
+ * @tparam K - the key
+ * @tparam V - the value
+ * @param map - the map
+ * @param ref - the reference map
+ */
+template <typename K, typename V>
+static void checkContents(const HashMap<K, V>& map, const std::unordered_map<K, V>& ref)
+{
+    CHECK(map.size() == ref.size());
+    CHECK((map.capacity() & (map.capacity() - 1)) == 0);
+    CHECK(map.load_factor() <= map.max_load_factor());
+    std::unordered_map<size_t, size_t> bucketSizes;
+    size_t visited = 0;
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        CHECK(ref.count(it->first) == 1 && ref.at(it->first) == it->second);
+        CHECK(map.bucket_index(it->first) == (std::hash<K>{}(it->first) & (map.capacity() - 1)));
+        bucketSizes[map.bucket_index(it->first)]++;
+        visited++;
+    }
+    CHECK(visited == ref.size());
+    for (const auto& pair : ref)
+    {
+        CHECK(map.bucket_size(pair.first) == bucketSizes[map.bucket_index(pair.first)]);
+    }
+}
+
+/**
+ * Runs random operations on a map and on std::unordered_map, checking they agree
+ * @tparam K - the key
+ * @tparam V - the value
+ * @param make - makes a key or a value of an integer
+ * @param numOfOps - the number of operations
+ * @param range - keys are made of integers in [0, range)
+ */
+template <typename K, typename V, typename Make>
+static void testRandomOps(Make make, int numOfOps, int range)
+{
+    HashMap<K, V> map;
+    const HashMap<K, V>& constMap = map;
+    std::unordered_map<K, V> ref;
+    std::mt19937 gen(7);
+    for (int t = 0; t < numOfOps; t++)
+    {
+        K key = make(gen() % range);
+        V value = make(gen() % RANGE_KEYS);
+        switch (gen() % NUM_OPS)
+        {
+            case 0:
+            case 1:
+                CHECK(map.insert(key, value) == ref.insert({key, value}).second);
+                break;
+            case 2:
+            case 3:
+                CHECK(map.erase(key) == (ref.erase(key) == 1));
+                break;
+            case 4:
+                map[key] = value;
+                ref[key] = value;
+                break;
+            case 5:
+                CHECK(map.contains_key(key) == (ref.count(key) == 1));
+                if (ref.count(key) == 1)
+                {
+                    CHECK(map.at(key) == ref.at(key));
+                    break;
+                }
+                try
+                {
+                    map.at(key);
+                    CHECK(false);
+                }
+                catch (const std::out_of_range&)
+                {
+                }
+                break;
+            case 6:
+                CHECK(constMap[key] == (ref.count(key) == 1 ? ref.at(key) : V()));
+                break;
+            default:
+                if (gen() % CLEAR_ODDS == 0)
+                {
+                    map.clear();
+                    ref.clear();
+                }
+        }
+        CHECK(map.size() == ref.size());
+        if (t % CHECK_EVERY == 0)
+        {
+            checkContents(map, ref);
+            HashMap<K, V> copy(map);
+            CHECK(copy == map);
+            HashMap<K, V> assigned;
+            assigned = map;
+            CHECK(assigned == map && !(assigned != map));
+            if (!ref.empty())
+            {
+                assigned.erase(ref.begin()->first);
+                CHECK(assigned != map);
+            }
+        }
+    }
+    checkContents(map, ref);
+}
+
+/**
+ * The range constructor keeps the last value of a repeated key and rejects ranges of different lengths
+ * @tparam K - the key
+ * @tparam V - the value
+ * @param make - makes a key or a value of an integer
+ */
+template <typename K, typename V, typename Make>
+static void testRangeConstructor(Make make)
+{
+    std::vector<K> keys;
+    std::vector<V> values;
+    std::unordered_map<K, V> ref;
+    for (int i = 0; i < RANGE_KEYS; i++)
+    {
+        keys.push_back(make(i % RANGE_DISTINCT));
+        values.push_back(make(i));
+        ref[keys.back()] = values.back();
+    }
+    HashMap<K, V> map(keys.begin(), keys.end(), values.begin(), values.end());
+    checkContents(map, ref);
+    try
+    {
+        HashMap<K, V> bad(keys.begin(), keys.end(), values.begin(), values.begin() + 1);
+        CHECK(false);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+}
+
+/**
+ * Checks that a call throws an exception of a type
+ * @tparam Exc - the type of the exception
+ * @param call - the call
+ * @return true if it threw Exc, false otherwise
+ */
+template <typename Exc, typename Call>
+static bool throws(Call call)
+{
+    try
+    {
+        call();
+    }
+    catch (const Exc&)
+    {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * The smallest power of 2 that holds a number of pairs under a max load factor
+ * @param numOfPairs - the number of pairs
+ * @param maxLoadFactor - the max load factor
+ * @return the capacity
+ */
+static size_t fittingCapacity(size_t numOfPairs, float maxLoadFactor)
+{
+    size_t capacity = 1;
+    while ((size_t)(capacity * maxLoadFactor) < numOfPairs)
+    {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+ * reserve makes room for the pairs without ever shrinking, rehash and shrink_to_fit set the capacity (up or down)
+ * keeping the pairs, and a capacity that does not fit in size_t throws std::length_error leaving the map as it was
+ */
+static void testCapacity()
+{
+    HashMap<int, int> map;
+    std::unordered_map<int, int> ref;
+    map.reserve(NUM_PAIRS);
+    size_t reserved = map.capacity();
+    CHECK(reserved == fittingCapacity(NUM_PAIRS, map.max_load_factor()));
+    for (int i = 0; i < NUM_PAIRS; i++)
+    {
+        map[i] = i;
+        ref[i] = i;
+    }
+    CHECK(map.capacity() == reserved);
+    map.reserve(1);
+    CHECK(map.capacity() == reserved);
+    map.rehash(reserved * 4 + 1);
+    CHECK(map.capacity() == reserved * 8);
+    checkContents(map, ref);
+    map.rehash(1);
+    CHECK(map.capacity() == reserved);
+    for (int i = 0; i < NUM_PAIRS; i += 2)
+    {
+        map.erase(i);
+        ref.erase(i);
+    }
+    map.shrink_to_fit();
+    CHECK(map.capacity() == fittingCapacity(ref.size(), map.max_load_factor()));
+    checkContents(map, ref);
+
+    size_t capacity = map.capacity();
+    CHECK(throws<std::length_error>([&map] { map.reserve(SIZE_MAX); }));
+    CHECK(throws<std::length_error>([&map] { map.reserve(SIZE_MAX / 2); }));
+    CHECK(throws<std::length_error>([&map] { map.rehash(SIZE_MAX); }));
+    CHECK(throws<std::length_error>([&map] { map.rehash(SIZE_MAX / 2 + 2); }));
+    CHECK(map.capacity() == capacity);
+    checkContents(map, ref);
+
+    HashMap<int, int> empty;
+    empty.shrink_to_fit();
+    CHECK(empty.capacity() == 1 && empty.empty());
+    empty[1] = 1;
+    CHECK(empty.at(1) == 1 && empty.size() == 1);
+}
+
+/**
+ * The load factor setters reject values outside their ranges, and a max load factor one that crossed the min one,
+ * leaving the map as it was, and a lower max load factor grows the map
+ */
+static void testLoadFactorSetters()
+{
+    HashMap<int, int> map;
+    std::unordered_map<int, int> ref;
+    for (int i = 0; i < NUM_PAIRS; i++)
+    {
+        map[i] = i;
+        ref[i] = i;
+    }
+    float minLoad = map.min_load_factor();
+    float maxLoad = map.max_load_factor();
+    for (float bad : {0.0f, 1.0f, 1.5f, -0.5f, NAN, minLoad, minLoad / 2})
+    {
+        CHECK(throws<std::invalid_argument>([&map, bad] { map.max_load_factor(bad); }));
+    }
+    for (float bad : {-0.1f, 1.0f, NAN, maxLoad, (maxLoad + 1) / 2})
+    {
+        CHECK(throws<std::invalid_argument>([&map, bad] { map.min_load_factor(bad); }));
+    }
+    CHECK(map.min_load_factor() == minLoad && map.max_load_factor() == maxLoad);
+    CHECK(map.capacity() == fittingCapacity(NUM_PAIRS, maxLoad));
+
+    map.max_load_factor(0.5f);
+    CHECK(map.max_load_factor() == 0.5f && map.capacity() == fittingCapacity(NUM_PAIRS, 0.5f));
+    checkContents(map, ref);
+    map.min_load_factor(0);
+    size_t capacity = map.capacity();
+    for (int i = 0; i < NUM_PAIRS; i++)
+    {
+        map.erase(i);
+    }
+    CHECK(map.empty() && map.capacity() == capacity); // a min load factor of 0 never shrinks the map
+}
+
+/**
+ * A map that shrinks has room for the next insertion, however close the load factors are, and a map of capacity 2
+ * does not shrink into one that holds no pair
+ */
+static void testShrinkHysteresis()
+{
+    HashMap<int, int> small;
+    small[1] = 1;
+    small.shrink_to_fit();
+    CHECK(small.capacity() == 2);
+    small.erase(1);
+    CHECK(small.capacity() == 2);
+    small[2] = 2;
+    CHECK(small.capacity() == 2 && small.at(2) == 2);
+
+    const float factors[NUM_FACTOR_PAIRS][2] = {{0.7f, 0.75f}, {0.49f, 0.5f}, {0.3f, 0.9f}, {0.25f, 0.75f}};
+    for (const auto& loads : factors)
+    {
+        HashMap<int, int> map;
+        map.max_load_factor(loads[1]);
+        map.min_load_factor(loads[0]);
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            map[i] = i;
+        }
+        bool roomAfterShrink = true;
+        for (int i = 0; i < NUM_PAIRS; i++)
+        {
+            size_t capacity = map.capacity();
+            map.erase(i);
+            if (map.capacity() < capacity)
+            {
+                capacity = map.capacity();
+                map[i] = i;
+                roomAfterShrink = roomAfterShrink && map.capacity() == capacity;
+                map.erase(i);
+            }
+        }
+        CHECK(roomAfterShrink && map.empty());
+    }
+}
+
+int main()
+{
+    auto number = [](int x) { return x; };
+    auto clustered = [](int x) { return x * 1024; }; // hashes with the low bits all zero
+    auto text = [](int x) { return std::string(30, 'a') + std::to_string(x); };
+    testRandomOps<int, int>(number, 200000, 3000);
+    testRandomOps<int, int>(clustered, 100000, 500);
+    testRandomOps<std::string, std::string>(text, 100000, 2000);
+    testRangeConstructor<int, int>(number);
+    testRangeConstructor<std::string, std::string>(text);
+    testCapacity();
+    testLoadFactorSetters();
+    testShrinkHysteresis();
+    return testResult();
+}
\ No newline at end of file